@@ -12,12 +12,33 @@
 #include "driver.h"
 #include "common.h"
 #include "./lib/led_proc.h"
+#include "./lib/button_proc.h"
 
 #define CLOCK_SYS_CLOCK_HERTZ 24000000
-#define LED_PWM_HERTZ		1000
-#define LED_TIMER_MS		500
+#define LED_PWM_CLOCK_HERTZ	CLOCK_SYS_CLOCK_HERTZ	// PWM counter clock, undivided system clock
+#define LED_PWM_HERTZ		1000	// PWM frequency in Hz, above 20000 keeps the white LED from flickering on camera
+#define LED_PWM_MIN_STEPS	256		// least steps per PWM frame, init_led fails if LED_PWM_HERTZ cannot give them
+#define LED_PWM_CAMERA_HERTZ	25000	// white LED frequency a double click on SW1 switches to and from
+#define LED_TIMER_MS		500		// Timer0 period, every led_proc instance must tick at a multiple of it
 #define LED_PWM_BRIGHTEST	0
 #define LED_PWM_DIMMEST		100
+#define LED_FADE_TICK_MS	5
+#define LED_FADE_STEP		64		// 16 bit brightness step per fade tick, about 5 seconds from off to full
+
+// flash ring used by led_store to keep LED settings across resets, must not overlap firmware or calibration data
+#define LED_STORE_FLASH_ADDR	0x70000
+#define LED_STORE_SECTOR_SIZE	4096
+#define LED_STORE_NUM_SECTORS	4
+#define LED_STORE_HOLDOFF_MS	10000
+
+#define BUTTON_DEBOUNCE_MS		20
+#define BUTTON_LONG_PRESS_MS	800
+#define BUTTON_MULTI_CLICK_MS	300
+
+// 1 to build the led_trace tracks into led_lib, see start_led_lib_trace.  0 leaves no trace code in the interrupt
+#ifndef LED_TRACE_ENABLE
+#define LED_TRACE_ENABLE		0
+#endif
 
 
 #define LED_RED 	GPIO_PD5
@@ -25,6 +46,8 @@
 #define LED_GREEN	GPIO_PD3
 #define LED_BLUE	GPIO_PD2
 
+#define BUTTON_SW1	GPIO_PB2
+
 typedef enum LED_NUMS {
 	LED_RED_NUM,
 	LED_WHITE_NUM,
@@ -40,8 +63,6 @@ typedef struct app_led_pwm_info_t {
 	GPIO_FuncTypeDef pwm_type;
 }app_led_pwm_info_t;
 
-app_led_pwm_info_t white_led_pwm_info;
-
 led_t red_led = {
 		.led_ptr = LED_RED,
 		.led_type = LED_TYPE_OUTPUT
@@ -49,9 +70,13 @@ led_t red_led = {
 
 led_t white_led = {
 		.led_ptr = LED_WHITE,
-		.led_type = LED_TYPE_PWM,
-		.led_state.led_pwm_state.led_duty_cycle = 95,
-		.led_state.led_pwm_state.led_pwm_hertz = LED_PWM_HERTZ
+		.led_type = LED_TYPE_PWM
+};
+
+led_pwm_state_t white_led_pwm = {
+		.led_duty_cycle = 95,
+		.led_pwm_hertz = LED_PWM_HERTZ,
+		.led_duty_inverted = (LED_PWM_BRIGHTEST < LED_PWM_DIMMEST)		// the pin is inverted, 0 is the brightest
 };
 
 led_t green_led = {
@@ -66,5 +91,16 @@ led_t blue_led = {
 
 #define NUM_LEDS 4
 
+typedef enum BUTTON_NUMS {
+	BUTTON_SW1_NUM
+}button_nums;
+
+button_t sw1_button = {
+		.button_ptr = BUTTON_SW1,
+		.button_active_level = 0		// pulled up, pressing the button pulls it low
+};
+
+#define NUM_BUTTONS 1
+
 
 #endif /* VENDOR_TEL_TEST_BSP_H_ */
@@ -0,0 +1,219 @@
+/*
+ * button_proc.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+#include "button_proc.h"
+
+#ifndef NULL
+#define NULL   ((void *) 0)
+#endif
+
+#define BUTTON_PROC_MAX_REARM	4		// times the edge is re-armed when the pin moves while it is being armed
+
+static void queue_button_event(struct button_proc_t * button_proc, button_t * button, button_event_type event_type, unsigned char clicks, unsigned int now)
+{
+	unsigned char head = button_proc->button_event_head;
+	button_event_t * event;
+
+	// head and tail run freely and wrap together, so full is when they are a whole queue apart
+	if ((unsigned char)(head - button_proc->button_event_tail) >= BUTTON_PROC_QUEUE_SIZE)
+	{
+		button_proc->button_events_dropped++;
+		return;
+	}
+
+	event = &button_proc->button_events[head & (BUTTON_PROC_QUEUE_SIZE - 1)];
+	event->event_type = event_type;
+	event->button_num = (unsigned char)(button - button_proc->button_array);
+	event->button_clicks = clicks;
+	event->timestamp = now;
+
+	button_proc->button_event_head = (unsigned char)(head + 1);
+}
+
+static void change_button_state(struct button_proc_t * button_proc, button_t * button, unsigned char pressed, unsigned int now)
+{
+	button->button_pressed = pressed;
+	button->button_edge_time = now;
+
+	if (pressed)
+	{
+		button->button_long_sent = 0;
+		queue_button_event(button_proc, button, BUTTON_EVENT_PRESS, 0, now);
+	}
+	else
+	{
+		// a long press ends the clicks rather than adding to them
+		if (!button->button_long_sent && button->button_clicks < 0xFF)
+			button->button_clicks++;
+		queue_button_event(button_proc, button, BUTTON_EVENT_RELEASE, 0, now);
+	}
+}
+
+led_proc_error_type init_button_proc(struct button_proc_t * button_proc, button_t buttons[], int num_buttons)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+	int level;
+
+	// NULL checks
+	if (button_proc == NULL || buttons == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (button_proc->button_init == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (button_proc->button_read == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (button_proc->button_set_edge == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	button_proc->button_array = buttons;
+	button_proc->num_buttons = num_buttons;
+	button_proc->button_event_head = 0;
+	button_proc->button_event_tail = 0;
+	button_proc->button_events_dropped = 0;
+
+	for (int i = 0; i < num_buttons; i++)
+	{
+		status = button_proc->button_init(&buttons[i]);
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+			return status;
+
+		status = button_proc->button_read(&buttons[i], &level);
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+			return status;
+
+		buttons[i].button_raw = (unsigned char)level;
+		buttons[i].button_pressed = (level == buttons[i].button_active_level);
+		buttons[i].button_clicks = 0;
+		buttons[i].button_long_sent = buttons[i].button_pressed;	// no long press for a button held through a reset
+		buttons[i].button_edge_time = 0;
+
+		status = button_proc->button_set_edge(&buttons[i], level);
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+			return status;
+	}
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type handle_button_edge(struct button_proc_t * button_proc, button_t * button, unsigned int now)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+	unsigned char pressed;
+	int level;
+	int check;
+
+	status = button_proc->button_read(button, &level);
+	if (status != LED_PROC_ERROR_TYPE_NONE)
+		return status;
+	if (level == button->button_raw)
+		return LED_PROC_ERROR_TYPE_NONE;
+
+	// arm for the opposite edge, then read again so an edge between the read and the arm is not lost
+	for (int i = 0; i < BUTTON_PROC_MAX_REARM; i++)
+	{
+		status = button_proc->button_set_edge(button, level);
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+			return status;
+
+		status = button_proc->button_read(button, &check);
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+			return status;
+		if (check == level)
+			break;
+		level = check;
+	}
+
+	button->button_raw = (unsigned char)level;
+	pressed = (level == button->button_active_level);
+	if (pressed == button->button_pressed)
+		return LED_PROC_ERROR_TYPE_NONE;
+
+	// a bounce, if the pin settles on the new level process_button_proc takes it once the debounce time is over
+	if ((unsigned int)(now - button->button_edge_time) < button_proc->button_debounce_time)
+		return LED_PROC_ERROR_TYPE_NONE;
+
+	change_button_state(button_proc, button, pressed, now);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type handle_button_num_edge(struct button_proc_t * button_proc, int button_num_in_array, unsigned int now)
+{
+	return handle_button_edge(button_proc, &button_proc->button_array[button_num_in_array], now);
+}
+
+led_proc_error_type handle_button_edges(struct button_proc_t * button_proc, unsigned int now)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+
+	for (int i = 0; i < button_proc->num_buttons; i++)
+	{
+		status = handle_button_edge(button_proc, &button_proc->button_array[i], now);
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+			return status;
+	}
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type process_button_proc(struct button_proc_t * button_proc, unsigned int now)
+{
+	button_event_t event;
+	unsigned int key = 0;
+
+	for (int i = 0; i < button_proc->num_buttons; i++)
+	{
+		button_t * button = &button_proc->button_array[i];
+
+		if (button_proc->button_enter_critical != NULL)
+			key = button_proc->button_enter_critical();
+
+		unsigned int held = now - button->button_edge_time;
+		unsigned char raw_pressed = (button->button_raw == button->button_active_level);
+
+		// the level of the last edge is the level of the pin, so a change that bounced inside the debounce time
+		// is picked up here without reading the pin
+		if (raw_pressed != button->button_pressed && held >= button_proc->button_debounce_time)
+		{
+			change_button_state(button_proc, button, raw_pressed, now);
+			held = 0;
+		}
+
+		if (button->button_pressed && !button->button_long_sent && held >= button_proc->button_long_press_time)
+		{
+			button->button_long_sent = 1;
+			button->button_clicks = 0;
+			queue_button_event(button_proc, button, BUTTON_EVENT_LONG_PRESS, 0, now);
+		}
+		else if (!button->button_pressed && button->button_clicks != 0 && held >= button_proc->button_multi_click_time)
+		{
+			queue_button_event(button_proc, button, BUTTON_EVENT_MULTI_CLICK, button->button_clicks, now);
+			button->button_clicks = 0;
+		}
+
+		if (button_proc->button_exit_critical != NULL)
+			button_proc->button_exit_critical(key);
+	}
+
+	if (button_proc->button_event_handler == NULL)
+		return LED_PROC_ERROR_TYPE_NONE;
+
+	while (get_button_event(button_proc, &event) == LED_PROC_ERROR_TYPE_NONE)
+		button_proc->button_event_handler(button_proc, &event);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type get_button_event(struct button_proc_t * button_proc, button_event_t * event)
+{
+	unsigned char tail = button_proc->button_event_tail;
+
+	if (tail == button_proc->button_event_head)
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	*event = button_proc->button_events[tail & (BUTTON_PROC_QUEUE_SIZE - 1)];
+	button_proc->button_event_tail = (unsigned char)(tail + 1);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
@@ -0,0 +1,262 @@
+/*
+ * button_proc.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef VENDOR_TEL_TEST_LIB_BUTTON_PROC_H_
+#define VENDOR_TEL_TEST_LIB_BUTTON_PROC_H_
+
+#include "led_proc.h"
+
+#ifndef BUTTON_PROC_QUEUE_SIZE
+#define BUTTON_PROC_QUEUE_SIZE		8		// events held until process_button_proc, must be a power of 2
+#endif
+
+typedef enum BUTTON_EVENT_TYPES {
+	BUTTON_EVENT_PRESS,			// debounced press
+	BUTTON_EVENT_RELEASE,		// debounced release
+	BUTTON_EVENT_LONG_PRESS,	// held for button_long_press_time, sent once per press while still held
+	BUTTON_EVENT_MULTI_CLICK	// clicks ended, button_clicks is how many, 1 for a single click
+}button_event_type;
+
+typedef struct button_event_t {
+	button_event_type event_type;
+	unsigned char button_num;		// place of the button in the button_array
+	unsigned char button_clicks;	// number of clicks of a BUTTON_EVENT_MULTI_CLICK, 0 for the other events
+	unsigned int timestamp;			// time of the edge or deadline that made the event
+}button_event_t;
+
+/******* NOTE! *******
+ * User MUST change the button_ptr type to the GPIO TypeDef for the selected API SDK, the same as led_t
+ */
+typedef struct BUTTON {
+	GPIO_PinTypeDef button_ptr;
+	unsigned char button_active_level;		// level the pin reads while the button is pressed
+
+	// maintained by button_proc, should not be touched by the application
+	unsigned char button_raw;				// level of the pin at the last edge
+	unsigned char button_pressed;			// debounced state
+	unsigned char button_clicks;			// clicks so far in the multi click window
+	unsigned char button_long_sent;			// BUTTON_EVENT_LONG_PRESS sent for this press
+	unsigned int button_edge_time;			// time of the last debounced change
+}button_t;
+
+
+
+/**************************************************************/
+/**\name	button_proc_t   		                          */
+/**************************************************************/
+/*!
+ *	@brief This struct is used to keep the button processor library generic in the same way as led_proc_t.  The
+ *	pins are never polled, each edge interrupts and is timestamped.  The first edge of a change is taken right away
+ *	and the bounces after it are ignored for button_debounce_time.  The deadlines, long press, end of a multi click
+ *	and a change that bounced back inside the debounce time, are checked by process_button_proc
+ *
+ *	 @param button_init
+ *	 	a function for initializing a single button as an input, with its edge interrupt enabled
+ *
+ *	 @param button_read
+ *	 	for reading the level of the pin of a button, 0 or 1, a reference to an Integer is passed for the level
+ *
+ *	 @param button_set_edge
+ *	 	for arming the edge interrupt of a button to fire when the pin leaves the level passed, so a pin that reads
+ *	 	1 is armed for a falling edge.  Called from the edge interrupt
+ *
+ *	 @param button_enter_critical
+ *	 	OPTIONAL, may be left NULL.  Should mask the edge interrupt, and return a key for button_exit_critical.
+ *	 	Held by process_button_proc while it updates the state shared with the edge interrupt
+ *
+ *	 @param button_exit_critical
+ *	 	OPTIONAL, may be left NULL.  Restores what button_enter_critical masked, using the key it returned
+ *
+ *	 @param button_event_handler
+ *	 	OPTIONAL, may be left NULL.  Called by process_button_proc for every queued event, so events can trigger LED
+ *	 	patterns directly.  When NULL the events are left in the queue for get_button_event
+ *
+ *	 @param button_array
+ *	 	a reference to array of button_t types, owned by this instance
+ *
+ *	 @param num_buttons
+ *	 	the number of buttons in button_array, set by init_button_proc
+ *
+ *	 @param button_debounce_time
+ *	 	time after a debounced change during which edges are ignored.  All of the times are in the time base of the
+ *	 	now passed to the functions below
+ *
+ *	 @param button_long_press_time
+ *	 	how long a button is held before BUTTON_EVENT_LONG_PRESS
+ *
+ *	 @param button_multi_click_time
+ *	 	how long after a release another press still adds to the clicks
+ *
+ *	 @param button_context
+ *	 	OPTIONAL, may be left NULL.  Application state for button_event_handler, such as the led_proc_t to drive
+ *
+ *	 The remaining fields are maintained by button_proc and should not be touched by the application
+ *
+*/
+typedef struct button_proc_t {
+	led_proc_error_type (*button_init)(button_t*);
+	led_proc_error_type (*button_read)(button_t*, int*);
+	led_proc_error_type (*button_set_edge)(button_t*, int);
+	unsigned int (*button_enter_critical)(void);
+	void (*button_exit_critical)(unsigned int);
+	void (*button_event_handler)(struct button_proc_t*, button_event_t*);
+	button_t *button_array;
+	int num_buttons;
+	unsigned int button_debounce_time;
+	unsigned int button_long_press_time;
+	unsigned int button_multi_click_time;
+	void *button_context;
+
+	button_event_t button_events[BUTTON_PROC_QUEUE_SIZE];
+	volatile unsigned char button_event_head;		// written only when an event is queued
+	volatile unsigned char button_event_tail;		// written only when an event is taken
+	unsigned int button_events_dropped;				// events lost to a full queue
+}button_proc_t;
+
+
+
+/**************************************************************/
+/**\name	init_button_proc		                          */
+/**************************************************************/
+/*!
+ *	@brief This function is to initialize an array of buttons.  The current level of each pin is taken as its
+ *		debounced state, so a button held through a reset only gives events from its release
+ *
+ *	 @param button_proc_t structure pointer.
+ *	 @param buttons - an array of buttons
+ *	 @param int - the number of buttons in the array
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - results of button initializations
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type init_button_proc(struct button_proc_t * button_proc, button_t buttons[], int num_buttons);
+
+
+
+/**************************************************************/
+/**\name	handle_button_edge		                          */
+/**************************************************************/
+/*!
+ *	@brief This function is to be called from the edge interrupt of a button.  It reads the pin, arms the edge
+ *		interrupt for the opposite edge and queues a BUTTON_EVENT_PRESS or BUTTON_EVENT_RELEASE when the change
+ *		is outside of the debounce time
+ *
+ *	 @param button_proc_t structure pointer.
+ *	 @param button_t
+ *	 @param unsigned int - the current time
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of reading the button
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type handle_button_edge(struct button_proc_t * button_proc, button_t * button, unsigned int now);
+
+
+
+/**************************************************************/
+/**\name	handle_button_num_edge	                          */
+/**************************************************************/
+/*!
+ *	@brief This function is handle_button_edge by the number associated with the button in the array
+ *
+ *	 @param button_proc_t structure pointer.
+ *	 @param int - the place in the button array
+ *	 @param unsigned int - the current time
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of reading the button
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type handle_button_num_edge(struct button_proc_t * button_proc, int button_num_in_array, unsigned int now);
+
+
+
+/**************************************************************/
+/**\name	handle_button_edges		                          */
+/**************************************************************/
+/*!
+ *	@brief This function is handle_button_edge for every button, for MCUs where all of the pins share one edge
+ *		interrupt.  Buttons whose pin has not changed are skipped
+ *
+ *	 @param button_proc_t structure pointer.
+ *	 @param unsigned int - the current time
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of reading the buttons
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type handle_button_edges(struct button_proc_t * button_proc, unsigned int now);
+
+
+
+/**************************************************************/
+/**\name	process_button_proc		                          */
+/**************************************************************/
+/*!
+ *	@brief This function checks the deadlines of the buttons, sends BUTTON_EVENT_LONG_PRESS and
+ *		BUTTON_EVENT_MULTI_CLICK, then hands the queued events to button_event_handler if there is one.  No pin is
+ *		read, the level seen at the last edge is used.  Meant to be called from the main loop or a timer, often
+ *		enough for the shortest of the times in button_proc_t
+ *
+ *	 @param button_proc_t structure pointer.
+ *	 @param unsigned int - the current time
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of processing the buttons
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type process_button_proc(struct button_proc_t * button_proc, unsigned int now);
+
+
+
+/**************************************************************/
+/**\name	get_button_event		                          */
+/**************************************************************/
+/*!
+ *	@brief This function takes the oldest event from the queue, for applications without a button_event_handler
+ *
+ *	 @param button_proc_t structure pointer.
+ *	 @param reference to button_event_t to pass the event
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of getting the event
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_NULL -> the queue is empty
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type get_button_event(struct button_proc_t * button_proc, button_event_t * event);
+
+#endif /* VENDOR_TEL_TEST_LIB_BUTTON_PROC_H_ */
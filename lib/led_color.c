@@ -0,0 +1,148 @@
+/*
+ * led_color.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+#include "led_color.h"
+
+#ifndef NULL
+#define NULL   ((void *) 0)
+#endif
+
+// x / 255 rounded to nearest without a divide, exact for 0 <= x <= 255 * 255
+static int led_color_div255(int x)
+{
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+static unsigned char led_color_clamp(int x)
+{
+	if (x < 0)
+		return 0;
+	if (x > LED_COLOR_MAX)
+		return LED_COLOR_MAX;
+	return (unsigned char)x;
+}
+
+led_proc_error_type init_led_rgb_group(struct led_rgb_group_t * group, int red_num, int green_num, int blue_num, int duty_brightest, int duty_dimmest)
+{
+	if (group == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	group->led_nums[LED_COLOR_RED] = red_num;
+	group->led_nums[LED_COLOR_GREEN] = green_num;
+	group->led_nums[LED_COLOR_BLUE] = blue_num;
+
+	for (int row = 0; row < LED_COLOR_NUM_CHANNELS; row++)
+	{
+		for (int col = 0; col < LED_COLOR_NUM_CHANNELS; col++)
+			group->calibration[row][col] = (row == col) ? LED_COLOR_CAL_ONE : 0;
+	}
+
+	group->brightness = LED_COLOR_MAX;
+	group->duty_brightest = duty_brightest;
+	group->duty_dimmest = duty_dimmest;
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+void led_hsv_to_rgb(unsigned short hue, unsigned char sat, unsigned char val, struct led_rgb_t * rgb)
+{
+	int sector;
+	int frac;
+	int p, q, t;
+
+	if (sat == 0)
+	{
+		rgb->red = rgb->green = rgb->blue = val;
+		return;
+	}
+
+	if (hue >= LED_COLOR_HUE_MAX)
+		hue %= LED_COLOR_HUE_MAX;
+	sector = hue >> 8;
+	frac = hue & (LED_COLOR_HUE_SECTOR - 1);
+
+	p = led_color_div255(val * (LED_COLOR_MAX - sat));
+	q = led_color_div255(val * (LED_COLOR_MAX - led_color_div255(sat * frac)));
+	t = led_color_div255(val * (LED_COLOR_MAX - led_color_div255(sat * (LED_COLOR_MAX - frac))));
+
+	switch (sector)
+	{
+	case 0:		rgb->red = val;				rgb->green = (unsigned char)t;	rgb->blue = (unsigned char)p;	break;
+	case 1:		rgb->red = (unsigned char)q;	rgb->green = val;				rgb->blue = (unsigned char)p;	break;
+	case 2:		rgb->red = (unsigned char)p;	rgb->green = val;				rgb->blue = (unsigned char)t;	break;
+	case 3:		rgb->red = (unsigned char)p;	rgb->green = (unsigned char)q;	rgb->blue = val;				break;
+	case 4:		rgb->red = (unsigned char)t;	rgb->green = (unsigned char)p;	rgb->blue = val;				break;
+	default:	rgb->red = val;				rgb->green = (unsigned char)p;	rgb->blue = (unsigned char)q;	break;
+	}
+}
+
+void led_rgb_to_duty_cycles(struct led_rgb_group_t * group, struct led_rgb_t * rgb, int duty_cycles[], unsigned char levels[])
+{
+	int in[LED_COLOR_NUM_CHANNELS] = { rgb->red, rgb->green, rgb->blue };
+	int duty_range = group->duty_brightest - group->duty_dimmest;
+	int duty_span = (duty_range < 0) ? -duty_range : duty_range;
+
+	for (int row = 0; row < LED_COLOR_NUM_CHANNELS; row++)
+	{
+		int mixed = 0;
+		for (int col = 0; col < LED_COLOR_NUM_CHANNELS; col++)
+			mixed += group->calibration[row][col] * in[col];
+
+		// Q8 back to a channel level, rounded, then scaled by the global brightness
+		levels[row] = led_color_clamp((mixed + (LED_COLOR_CAL_ONE / 2)) >> 8);
+		levels[row] = (unsigned char)led_color_div255(levels[row] * group->brightness);
+
+		// the duty range can run either way, on this board the PWM is inverted and 0 is the brightest
+		int duty_offset = led_color_div255(levels[row] * duty_span);
+		duty_cycles[row] = group->duty_dimmest + ((duty_range < 0) ? -duty_offset : duty_offset);
+	}
+}
+
+led_proc_error_type set_led_rgb_group(struct led_proc_t * led_proc, struct led_rgb_group_t * group, struct led_rgb_t * rgb)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+	int duty_cycles[LED_COLOR_NUM_CHANNELS];
+	unsigned char levels[LED_COLOR_NUM_CHANNELS];
+	unsigned int key = 0;
+
+	if (led_proc == NULL || group == NULL || rgb == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	led_rgb_to_duty_cycles(group, rgb, duty_cycles, levels);
+
+	// commit all three channels at once, so an interrupt never sees half of a colour change
+	if (led_proc->led_enter_critical != NULL)
+		key = led_proc->led_enter_critical();
+
+	for (int channel = 0; channel < LED_COLOR_NUM_CHANNELS; channel++)
+	{
+		int led_num = group->led_nums[channel];
+
+		if (led_proc->led_array[led_num].led_type == LED_TYPE_PWM)
+			status = set_led_num_pwm_duty_cycle(led_proc, led_num, duty_cycles[channel]);
+		else if (levels[channel] > (LED_COLOR_MAX / 2))
+			status = turn_led_num_on(led_proc, led_num);
+		else
+			status = turn_led_num_off(led_proc, led_num);
+
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+			break;
+	}
+
+	if (led_proc->led_exit_critical != NULL)
+		led_proc->led_exit_critical(key);
+
+	return status;
+}
+
+led_proc_error_type set_led_rgb_group_hsv(struct led_proc_t * led_proc, struct led_rgb_group_t * group, unsigned short hue, unsigned char sat, unsigned char val)
+{
+	struct led_rgb_t rgb;
+
+	led_hsv_to_rgb(hue, sat, val, &rgb);
+
+	return set_led_rgb_group(led_proc, group, &rgb);
+}
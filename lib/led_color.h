@@ -0,0 +1,183 @@
+/*
+ * led_color.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef VENDOR_TEL_TEST_LIB_LED_COLOR_H_
+#define VENDOR_TEL_TEST_LIB_LED_COLOR_H_
+
+#include "led_proc.h"
+
+#define LED_COLOR_MAX			255		// full scale of a channel, saturation, value and brightness
+#define LED_COLOR_HUE_SECTOR	256		// hue steps per sector of the colour wheel, so the sector is a shift
+#define LED_COLOR_HUE_MAX		(6 * LED_COLOR_HUE_SECTOR)	// hue is 0 .. LED_COLOR_HUE_MAX - 1
+#define LED_COLOR_CAL_ONE		256		// 1.0 in the Q8 calibration matrix
+
+typedef enum LED_COLOR_CHANNELS {
+	LED_COLOR_RED,
+	LED_COLOR_GREEN,
+	LED_COLOR_BLUE,
+	LED_COLOR_NUM_CHANNELS
+}led_color_channel;
+
+typedef struct led_rgb_t {
+	unsigned char red;
+	unsigned char green;
+	unsigned char blue;
+}led_rgb_t;
+
+
+
+/**************************************************************/
+/**\name	led_rgb_group_t			                          */
+/**************************************************************/
+/*!
+ *	@brief This struct groups three LEDs of a led_proc_t into one RGB LED.  All of the maths is done in
+ *	integers, there is no FPU on the TLS8258
+ *
+ *	 @param led_nums
+ *	 	the places in the led_array of the red, green and blue LEDs, indexed by led_color_channel
+ *
+ *	 @param calibration
+ *	 	Q8 white balance matrix, LED_COLOR_CAL_ONE is 1.0.  Each row is an output channel and each column the
+ *	 	amount of the requested red, green and blue mixed into it, so the diagonal alone is a per-channel gain
+ *
+ *	 @param brightness
+ *	 	global brightness applied after calibration, 0 .. LED_COLOR_MAX
+ *
+ *	 @param duty_brightest
+ *	 	duty cycle passed to led_set_duty_cycle for a channel at full scale
+ *
+ *	 @param duty_dimmest
+ *	 	duty cycle passed to led_set_duty_cycle for a channel that is off.  LED_TYPE_OUTPUT channels have no
+ *	 	duty cycle, they are turned on from half scale upwards
+ *
+*/
+typedef struct led_rgb_group_t {
+	int led_nums[LED_COLOR_NUM_CHANNELS];
+	short calibration[LED_COLOR_NUM_CHANNELS][LED_COLOR_NUM_CHANNELS];
+	unsigned char brightness;
+	int duty_brightest;
+	int duty_dimmest;
+}led_rgb_group_t;
+
+
+
+/**************************************************************/
+/**\name	init_led_rgb_group		                          */
+/**************************************************************/
+/*!
+ *	@brief This function sets up an RGB group with an identity calibration and full brightness
+ *
+ *	 @param led_rgb_group_t structure pointer.
+ *	 @param int - the places in the LED array of the red, green and blue LEDs
+ *	 @param int - the duty cycle of a channel at full scale
+ *	 @param int - the duty cycle of a channel that is off
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of the setup
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type init_led_rgb_group(struct led_rgb_group_t * group, int red_num, int green_num, int blue_num, int duty_brightest, int duty_dimmest);
+
+
+
+/**************************************************************/
+/**\name	led_hsv_to_rgb			                          */
+/**************************************************************/
+/*!
+ *	@brief This function converts a colour from HSV to RGB with integer maths only
+ *
+ *	 @param unsigned short - hue, 0 .. LED_COLOR_HUE_MAX - 1, red at 0, green at 2 sectors and blue at 4 sectors
+ *	 @param unsigned char - saturation, 0 .. LED_COLOR_MAX
+ *	 @param unsigned char - value, 0 .. LED_COLOR_MAX
+ *	 @param reference to led_rgb_t to pass the colour
+ *
+ *
+ *
+ *
+ *	@return none
+ *
+ *
+*/
+void led_hsv_to_rgb(unsigned short hue, unsigned char sat, unsigned char val, struct led_rgb_t * rgb);
+
+
+
+/**************************************************************/
+/**\name	led_rgb_to_duty_cycles	                          */
+/**************************************************************/
+/*!
+ *	@brief This function runs a colour through the calibration matrix and brightness of the group and
+ *		gives the duty cycle of each channel, without touching the LEDs
+ *
+ *	 @param led_rgb_group_t structure pointer.
+ *	 @param reference to led_rgb_t - the requested colour
+ *	 @param int array - the duty cycles, indexed by led_color_channel
+ *	 @param unsigned char array - the calibrated level of each channel, indexed by led_color_channel
+ *
+ *
+ *
+ *
+ *	@return none
+ *
+ *
+*/
+void led_rgb_to_duty_cycles(struct led_rgb_group_t * group, struct led_rgb_t * rgb, int duty_cycles[], unsigned char levels[]);
+
+
+
+/**************************************************************/
+/**\name	set_led_rgb_group		                          */
+/**************************************************************/
+/*!
+ *	@brief This function sets the colour of an RGB group.  All three duty cycles are worked out before any
+ *		LED is written, then they are committed together inside the led_proc_t critical section hooks
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param led_rgb_group_t structure pointer.
+ *	 @param reference to led_rgb_t - the colour
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of setting the LEDs
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type set_led_rgb_group(struct led_proc_t * led_proc, struct led_rgb_group_t * group, struct led_rgb_t * rgb);
+
+
+
+/**************************************************************/
+/**\name	set_led_rgb_group_hsv	                          */
+/**************************************************************/
+/*!
+ *	@brief This function sets the colour of an RGB group from HSV, see led_hsv_to_rgb and set_led_rgb_group
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param led_rgb_group_t structure pointer.
+ *	 @param unsigned short - hue
+ *	 @param unsigned char - saturation
+ *	 @param unsigned char - value
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of setting the LEDs
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type set_led_rgb_group_hsv(struct led_proc_t * led_proc, struct led_rgb_group_t * group, unsigned short hue, unsigned char sat, unsigned char val);
+
+#endif /* VENDOR_TEL_TEST_LIB_LED_COLOR_H_ */
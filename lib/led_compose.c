@@ -0,0 +1,257 @@
+/*
+ * led_compose.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+#include "led_compose.h"
+
+#ifndef NULL
+#define NULL   ((void *) 0)
+#endif
+
+#define LED_COMPOSE_ON_LEVEL	0x8000		// output LEDs are on from half scale up
+
+static void mark_led_compose_dirty(struct led_compositor_t * compositor, unsigned int mask)
+{
+	struct led_proc_t * led_proc = compositor->led_proc;
+	unsigned int key = 0;
+
+	if (led_proc->led_enter_critical != NULL)
+		key = led_proc->led_enter_critical();
+
+	compositor->compose_dirty |= mask;
+
+	if (led_proc->led_exit_critical != NULL)
+		led_proc->led_exit_critical(key);
+}
+
+static int find_led_layer(struct led_compositor_t * compositor, struct led_layer_t * layer)
+{
+	for (int i = 0; i < compositor->num_layers; i++)
+	{
+		if (compositor->layers[i] == layer)
+			return i;
+	}
+
+	return -1;
+}
+
+static unsigned short blend_led_layers(struct led_compositor_t * compositor, int led_num)
+{
+	unsigned int bit = 1u << led_num;
+	unsigned int out = 0;
+
+	for (int i = 0; i < compositor->num_layers; i++)
+	{
+		struct led_layer_t * layer = compositor->layers[i];
+		if ((layer->layer_mask & bit) == 0 || layer->layer_alpha == 0)
+			continue;
+
+		// alpha 0 - 255 taken to 0 - 256 so full alpha is an exact shift
+		unsigned int alpha = layer->layer_alpha + (layer->layer_alpha >> 7);
+		unsigned int value = layer->layer_values[led_num];
+
+		switch (layer->layer_blend)
+		{
+		case LED_BLEND_OVERRIDE:
+			out = (out * (256 - alpha) + value * alpha) >> 8;
+			break;
+		case LED_BLEND_MAX:
+			value = (value * alpha) >> 8;
+			if (value > out)
+				out = value;
+			break;
+		case LED_BLEND_ADD:
+			out += (value * alpha) >> 8;
+			if (out > LED_COMPOSE_VALUE_MAX)
+				out = LED_COMPOSE_VALUE_MAX;
+			break;
+		case LED_BLEND_MULTIPLY:
+		{
+			// the factor runs from full scale with no alpha to the value with full alpha, then full scale is
+			// taken to 65536 so multiplying by it leaves the output as it is
+			unsigned int factor = (LED_COMPOSE_VALUE_MAX * (256 - alpha) + value * alpha) >> 8;
+			out = (out * (factor + (factor >> 15))) >> 16;
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	return (unsigned short)out;
+}
+
+static led_proc_error_type send_led_compose_output(struct led_proc_t * led_proc, int led_num, unsigned short value)
+{
+	if (led_proc->led_array[led_num].led_type == LED_TYPE_PWM)
+		return set_led_num_pwm_brightness(led_proc, led_num, value);
+	if (value != 0)
+		return turn_led_num_on(led_proc, led_num);
+
+	return turn_led_num_off(led_proc, led_num);
+}
+
+led_proc_error_type init_led_compositor(struct led_compositor_t * compositor, struct led_proc_t * led_proc)
+{
+	if (compositor == NULL || led_proc == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (led_proc->led_array == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (led_proc->num_leds > LED_COMPOSE_MAX_LEDS)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	compositor->led_proc = led_proc;
+	compositor->num_layers = 0;
+	compositor->compose_sent = 0;
+	compositor->compose_dirty = (led_proc->num_leds >= 32) ? 0xFFFFFFFFu : ((1u << led_proc->num_leds) - 1);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type init_led_layer(struct led_layer_t * layer, led_blend_mode blend, unsigned char alpha, unsigned char priority)
+{
+	if (layer == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	layer->layer_blend = blend;
+	layer->layer_alpha = alpha;
+	layer->layer_priority = priority;
+	layer->layer_mask = 0;
+	for (int i = 0; i < LED_COMPOSE_MAX_LEDS; i++)
+		layer->layer_values[i] = 0;
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type add_led_layer(struct led_compositor_t * compositor, struct led_layer_t * layer)
+{
+	int place;
+
+	if (compositor == NULL || layer == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (compositor->num_layers >= LED_COMPOSE_MAX_LAYERS || find_led_layer(compositor, layer) >= 0)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	// kept sorted when added, so a commit never has to sort
+	place = compositor->num_layers;
+	while (place > 0 && compositor->layers[place - 1]->layer_priority > layer->layer_priority)
+	{
+		compositor->layers[place] = compositor->layers[place - 1];
+		place--;
+	}
+	compositor->layers[place] = layer;
+	compositor->num_layers++;
+
+	mark_led_compose_dirty(compositor, layer->layer_mask);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type remove_led_layer(struct led_compositor_t * compositor, struct led_layer_t * layer)
+{
+	int place;
+
+	if (compositor == NULL || layer == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	place = find_led_layer(compositor, layer);
+	if (place < 0)
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	for (int i = place; i < compositor->num_layers - 1; i++)
+		compositor->layers[i] = compositor->layers[i + 1];
+	compositor->num_layers--;
+
+	mark_led_compose_dirty(compositor, layer->layer_mask);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type set_led_layer_num_value(struct led_compositor_t * compositor, struct led_layer_t * layer, int led_num_in_array, unsigned short value)
+{
+	unsigned int bit;
+
+	if (led_num_in_array < 0 || led_num_in_array >= compositor->led_proc->num_leds)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	bit = 1u << led_num_in_array;
+	if ((layer->layer_mask & bit) && layer->layer_values[led_num_in_array] == value)
+		return LED_PROC_ERROR_TYPE_NONE;
+
+	layer->layer_values[led_num_in_array] = value;
+	layer->layer_mask |= bit;
+	mark_led_compose_dirty(compositor, bit);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type clear_led_layer_num_value(struct led_compositor_t * compositor, struct led_layer_t * layer, int led_num_in_array)
+{
+	unsigned int bit;
+
+	if (led_num_in_array < 0 || led_num_in_array >= compositor->led_proc->num_leds)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	bit = 1u << led_num_in_array;
+	if ((layer->layer_mask & bit) == 0)
+		return LED_PROC_ERROR_TYPE_NONE;
+
+	layer->layer_mask &= ~bit;
+	mark_led_compose_dirty(compositor, bit);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type set_led_layer_alpha(struct led_compositor_t * compositor, struct led_layer_t * layer, unsigned char alpha)
+{
+	if (layer->layer_alpha == alpha)
+		return LED_PROC_ERROR_TYPE_NONE;
+
+	layer->layer_alpha = alpha;
+	mark_led_compose_dirty(compositor, layer->layer_mask);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type commit_led_compositor(struct led_compositor_t * compositor)
+{
+	struct led_proc_t * led_proc = compositor->led_proc;
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+	unsigned int key = 0;
+	unsigned int dirty;
+
+	// take the dirty LEDs in one go, a layer changed while this commit runs is picked up by the next one
+	if (led_proc->led_enter_critical != NULL)
+		key = led_proc->led_enter_critical();
+	dirty = compositor->compose_dirty;
+	compositor->compose_dirty = 0;
+	if (led_proc->led_exit_critical != NULL)
+		led_proc->led_exit_critical(key);
+
+	for (int led_num = 0; dirty != 0; led_num++)
+	{
+		unsigned int bit = 1u << led_num;
+		if ((dirty & bit) == 0)
+			continue;
+		dirty &= ~bit;
+
+		unsigned short value = blend_led_layers(compositor, led_num);
+		if (led_proc->led_array[led_num].led_type != LED_TYPE_PWM)
+			value = (value >= LED_COMPOSE_ON_LEVEL) ? LED_COMPOSE_VALUE_MAX : 0;
+		if ((compositor->compose_sent & bit) && compositor->compose_output[led_num] == value)
+			continue;
+
+		status = send_led_compose_output(led_proc, led_num, value);
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+		{
+			mark_led_compose_dirty(compositor, dirty | bit);
+			return status;
+		}
+
+		compositor->compose_output[led_num] = value;
+		compositor->compose_sent |= bit;
+	}
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
@@ -0,0 +1,272 @@
+/*
+ * led_compose.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef VENDOR_TEL_TEST_LIB_LED_COMPOSE_H_
+#define VENDOR_TEL_TEST_LIB_LED_COMPOSE_H_
+
+#include "led_proc.h"
+
+#ifndef LED_COMPOSE_MAX_LEDS
+#define LED_COMPOSE_MAX_LEDS		8		// LEDs a compositor can drive, at most 32 as they are tracked in a bitmask
+#endif
+#ifndef LED_COMPOSE_MAX_LAYERS
+#define LED_COMPOSE_MAX_LAYERS		4
+#endif
+#define LED_COMPOSE_VALUE_MAX		LED_PWM_BRIGHTNESS_MAX		// full scale of a layer value, output LEDs are on from half
+#define LED_COMPOSE_ALPHA_MAX		255
+
+typedef enum LED_BLEND_MODES {
+	LED_BLEND_OVERRIDE,		// replaces what is below, mixed by the alpha
+	LED_BLEND_MAX,			// the brighter of the layer and what is below
+	LED_BLEND_ADD,			// adds to what is below, saturating at LED_COMPOSE_VALUE_MAX
+	LED_BLEND_MULTIPLY		// scales what is below, LED_COMPOSE_VALUE_MAX leaves it as it is
+}led_blend_mode;
+
+
+
+/**************************************************************/
+/**\name	led_layer_t   			                          */
+/**************************************************************/
+/*!
+ *	@brief This struct is a layer of a compositor, owned by one subsystem such as a status heartbeat or an error
+ *	flash.  A layer only covers the LEDs it has set a value for, the others show the layers below it
+ *
+ *	 @param layer_blend
+ *	 	how the layer is blended onto the layers below it
+ *
+ *	 @param layer_alpha
+ *	 	0 - LED_COMPOSE_ALPHA_MAX, how much of the layer is applied, 0 is the same as not being there
+ *
+ *	 @param layer_priority
+ *	 	layers are blended from the lowest priority up, so the highest priority has the last say
+ *
+ *	 The remaining fields are maintained by the compositor and should be changed through the functions below
+ *
+*/
+typedef struct led_layer_t {
+	led_blend_mode layer_blend;
+	unsigned char layer_alpha;
+	unsigned char layer_priority;
+	unsigned int layer_mask;						// LEDs the layer covers
+	unsigned short layer_values[LED_COMPOSE_MAX_LEDS];
+}led_layer_t;
+
+
+
+/**************************************************************/
+/**\name	led_compositor_t   		                          */
+/**************************************************************/
+/*!
+ *	@brief This struct blends a stack of layers into the LEDs of a led_proc_t.  Every change to a layer marks the
+ *	LEDs it touches dirty, and commit_led_compositor only blends the dirty LEDs and only calls the HAL for outputs
+ *	that changed, so a tick where nothing changed costs next to nothing however many LEDs and layers there are
+ *
+ *	 @param led_proc
+ *	 	the LEDs the compositor drives, PWM LEDs need led_set_compare as they are set with set_led_pwm_brightness
+ *
+ *	 The remaining fields are maintained by the compositor and should not be touched by the application
+ *
+*/
+typedef struct led_compositor_t {
+	struct led_proc_t * led_proc;
+	struct led_layer_t * layers[LED_COMPOSE_MAX_LAYERS];	// lowest priority first
+	int num_layers;
+	unsigned int compose_dirty;								// LEDs to blend again at the next commit
+	unsigned int compose_sent;								// LEDs that have had an output sent
+	unsigned short compose_output[LED_COMPOSE_MAX_LEDS];	// last output sent to each LED
+}led_compositor_t;
+
+
+
+/**************************************************************/
+/**\name	init_led_compositor		                          */
+/**************************************************************/
+/*!
+ *	@brief This function sets up a compositor with no layers for an initialized led_proc_t.  Every LED is dirty
+ *		so the first commit sends an output to all of them
+ *
+ *	 @param led_compositor_t structure pointer.
+ *	 @param led_proc_t structure pointer.
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of the setup
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> the led_proc_t has more than LED_COMPOSE_MAX_LEDS LEDs
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type init_led_compositor(struct led_compositor_t * compositor, struct led_proc_t * led_proc);
+
+
+
+/**************************************************************/
+/**\name	init_led_layer			                          */
+/**************************************************************/
+/*!
+ *	@brief This function sets up a layer that covers no LEDs yet
+ *
+ *	 @param led_layer_t structure pointer.
+ *	 @param led_blend_mode - how the layer is blended
+ *	 @param unsigned char - alpha, 0 - LED_COMPOSE_ALPHA_MAX
+ *	 @param unsigned char - priority, higher is blended later
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of the setup
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type init_led_layer(struct led_layer_t * layer, led_blend_mode blend, unsigned char alpha, unsigned char priority);
+
+
+
+/**************************************************************/
+/**\name	add_led_layer			                          */
+/**************************************************************/
+/*!
+ *	@brief This function adds a layer to a compositor in order of its priority, layers of the same priority are
+ *		blended in the order they were added
+ *
+ *	 @param led_compositor_t structure pointer.
+ *	 @param led_layer_t structure pointer.
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of adding the layer
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> already LED_COMPOSE_MAX_LAYERS layers, or the layer is already added
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type add_led_layer(struct led_compositor_t * compositor, struct led_layer_t * layer);
+
+
+
+/**************************************************************/
+/**\name	remove_led_layer		                          */
+/**************************************************************/
+/*!
+ *	@brief This function takes a layer out of a compositor, the LEDs it covered are blended again at the next commit
+ *
+ *	 @param led_compositor_t structure pointer.
+ *	 @param led_layer_t structure pointer.
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of removing the layer
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_NULL -> the layer was not in the compositor
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type remove_led_layer(struct led_compositor_t * compositor, struct led_layer_t * layer);
+
+
+
+/**************************************************************/
+/**\name	set_led_layer_num_value	                          */
+/**************************************************************/
+/*!
+ *	@brief This function sets the value of a layer for an LED by the number associated with LED in the array, and
+ *		the layer covers that LED from then on.  Nothing is sent to the LED until commit_led_compositor
+ *
+ *	 @param led_compositor_t structure pointer.
+ *	 @param led_layer_t structure pointer.
+ *	 @param int - the place in the LED array
+ *	 @param unsigned short - value, 0 - LED_COMPOSE_VALUE_MAX
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of setting the value
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type set_led_layer_num_value(struct led_compositor_t * compositor, struct led_layer_t * layer, int led_num_in_array, unsigned short value);
+
+
+
+/**************************************************************/
+/**\name	clear_led_layer_num_value                          */
+/**************************************************************/
+/*!
+ *	@brief This function stops a layer covering an LED by the number associated with LED in the array, so the
+ *		layers below it show through again
+ *
+ *	 @param led_compositor_t structure pointer.
+ *	 @param led_layer_t structure pointer.
+ *	 @param int - the place in the LED array
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of clearing the value
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type clear_led_layer_num_value(struct led_compositor_t * compositor, struct led_layer_t * layer, int led_num_in_array);
+
+
+
+/**************************************************************/
+/**\name	set_led_layer_alpha		                          */
+/**************************************************************/
+/*!
+ *	@brief This function sets the alpha of a whole layer, such as to fade an error flash in and out
+ *
+ *	 @param led_compositor_t structure pointer.
+ *	 @param led_layer_t structure pointer.
+ *	 @param unsigned char - alpha, 0 - LED_COMPOSE_ALPHA_MAX
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of setting the alpha
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type set_led_layer_alpha(struct led_compositor_t * compositor, struct led_layer_t * layer, unsigned char alpha);
+
+
+
+/**************************************************************/
+/**\name	commit_led_compositor	                          */
+/**************************************************************/
+/*!
+ *	@brief This function blends the dirty LEDs through every layer that covers them and sends the outputs that
+ *		changed to the LEDs.  Meant to be called once per tick, such as from the led_tick of the led_proc_t
+ *
+ *	 @param led_compositor_t structure pointer.
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of setting the LEDs, the first error stops the commit and the LEDs
+ *		not yet sent stay dirty
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type commit_led_compositor(struct led_compositor_t * compositor);
+
+#endif /* VENDOR_TEL_TEST_LIB_LED_COMPOSE_H_ */
@@ -0,0 +1,174 @@
+/*
+ * led_coro.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+#include "led_coro.h"
+
+#ifndef NULL
+#define NULL   ((void *) 0)
+#endif
+
+static int unlink_led_coro(struct led_coro_t ** link, struct led_coro_t * coro, int is_timer_list)
+{
+	while (*link != NULL)
+	{
+		if (*link == coro)
+		{
+			// the time of a timer is relative to the one before it, so it is handed on to the one after it
+			if (is_timer_list && coro->coro_next != NULL)
+				coro->coro_next->coro_delay += coro->coro_delay;
+			*link = coro->coro_next;
+			coro->coro_next = NULL;
+			return 1;
+		}
+		link = &(*link)->coro_next;
+	}
+
+	return 0;
+}
+
+led_proc_error_type init_led_coro_sched(struct led_coro_sched_t * sched, struct led_proc_t * led_proc)
+{
+	if (sched == NULL || led_proc == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	sched->led_proc = led_proc;
+	sched->coro_timers = NULL;
+	sched->coro_waiters = NULL;
+	sched->coro_ready = NULL;
+	sched->coro_posted = 0;
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type start_led_coro(struct led_coro_sched_t * sched, struct led_coro_t * coro, led_coro_fn fn)
+{
+	if (sched == NULL || coro == NULL || fn == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	stop_led_coro(sched, coro);
+
+	coro->coro_fn = fn;
+	coro->coro_line = 0;
+	coro->coro_next = NULL;
+	wait_led_coro_ms(sched, coro, 0);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type stop_led_coro(struct led_coro_sched_t * sched, struct led_coro_t * coro)
+{
+	if (unlink_led_coro(&sched->coro_timers, coro, 1))
+		return LED_PROC_ERROR_TYPE_NONE;
+	if (unlink_led_coro(&sched->coro_waiters, coro, 0))
+		return LED_PROC_ERROR_TYPE_NONE;
+	if (unlink_led_coro(&sched->coro_ready, coro, 0))
+		return LED_PROC_ERROR_TYPE_NONE;
+
+	return LED_PROC_ERROR_TYPE_NULL;
+}
+
+void wait_led_coro_ms(struct led_coro_sched_t * sched, struct led_coro_t * coro, unsigned int ms)
+{
+	struct led_coro_t ** link = &sched->coro_timers;
+
+	// after the timers due at the same time, so coroutines waiting the same time run in the order they waited
+	while (*link != NULL && (*link)->coro_delay <= ms)
+	{
+		ms -= (*link)->coro_delay;
+		link = &(*link)->coro_next;
+	}
+
+	coro->coro_delay = ms;
+	coro->coro_events = 0;
+	coro->coro_next = *link;
+	if (*link != NULL)
+		(*link)->coro_delay -= ms;
+	*link = coro;
+}
+
+void wait_led_coro_event(struct led_coro_sched_t * sched, struct led_coro_t * coro, unsigned char events)
+{
+	coro->coro_events = events;
+	coro->coro_next = sched->coro_waiters;
+	sched->coro_waiters = coro;
+}
+
+void post_led_coro_event(struct led_coro_sched_t * sched, unsigned char events)
+{
+	struct led_proc_t * led_proc = sched->led_proc;
+	unsigned int key = 0;
+
+	if (led_proc->led_enter_critical != NULL)
+		key = led_proc->led_enter_critical();
+
+	sched->coro_posted |= events;
+
+	if (led_proc->led_exit_critical != NULL)
+		led_proc->led_exit_critical(key);
+}
+
+int run_led_coros(struct led_coro_sched_t * sched, unsigned int elapsed_ms)
+{
+	struct led_proc_t * led_proc = sched->led_proc;
+	struct led_coro_t ** ready_tail = &sched->coro_ready;
+	struct led_coro_t * coro;
+	unsigned int key = 0;
+	unsigned char posted;
+	int resumed = 0;
+
+	if (led_proc->led_enter_critical != NULL)
+		key = led_proc->led_enter_critical();
+	posted = sched->coro_posted;
+	sched->coro_posted = 0;
+	if (led_proc->led_exit_critical != NULL)
+		led_proc->led_exit_critical(key);
+
+	// move everything that has fired onto the ready list first, so a coroutine that waits again while it is
+	// resumed is not resumed a second time in the same run
+	while (*ready_tail != NULL)
+		ready_tail = &(*ready_tail)->coro_next;
+
+	if (posted != 0)
+	{
+		struct led_coro_t ** link = &sched->coro_waiters;
+		while (*link != NULL)
+		{
+			coro = *link;
+			if ((coro->coro_events & posted) == 0)
+			{
+				link = &coro->coro_next;
+				continue;
+			}
+			*link = coro->coro_next;
+			coro->coro_next = NULL;
+			*ready_tail = coro;
+			ready_tail = &coro->coro_next;
+		}
+	}
+
+	// only the timers that are due are looked at, the first one not due takes the rest of the elapsed time
+	while (sched->coro_timers != NULL && sched->coro_timers->coro_delay <= elapsed_ms)
+	{
+		coro = sched->coro_timers;
+		elapsed_ms -= coro->coro_delay;
+		sched->coro_timers = coro->coro_next;
+		coro->coro_next = NULL;
+		*ready_tail = coro;
+		ready_tail = &coro->coro_next;
+	}
+	if (sched->coro_timers != NULL)
+		sched->coro_timers->coro_delay -= elapsed_ms;
+
+	while (sched->coro_ready != NULL)
+	{
+		coro = sched->coro_ready;
+		sched->coro_ready = coro->coro_next;
+		coro->coro_next = NULL;
+		coro->coro_fn(sched, coro);
+		resumed++;
+	}
+
+	return resumed;
+}
@@ -0,0 +1,240 @@
+/*
+ * led_coro.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef VENDOR_TEL_TEST_LIB_LED_CORO_H_
+#define VENDOR_TEL_TEST_LIB_LED_CORO_H_
+
+#include "led_proc.h"
+
+/******* NOTE! *******
+ * LED coroutines are stackless, in the style of protothreads.  The body of a coroutine is a switch on the line it
+ * last waited at, so local variables do NOT keep their value across a wait.  Anything that must survive a wait,
+ * such as a loop counter, has to live in a struct that starts with the led_coro_t, see led_coro_t.  A wait cannot
+ * be inside a switch of the coroutine's own, and a coroutine function can only have one LED_CORO_BEGIN
+ */
+typedef enum LED_CORO_STATES {
+	LED_CORO_WAITING,		// waiting, the coroutine is resumed when what it waits on fires
+	LED_CORO_DONE			// finished, the scheduler drops it
+}led_coro_state;
+
+#define LED_CORO_EVENT_FADE_DONE	0x01	// posted by the application when a fade reaches its end
+#define LED_CORO_EVENT_USER			0x02	// first event free for the application, events are single bits
+
+struct led_coro_sched_t;
+struct led_coro_t;
+typedef led_coro_state (*led_coro_fn)(struct led_coro_sched_t*, struct led_coro_t*);
+
+
+
+/**************************************************************/
+/**\name	led_coro_t   			                          */
+/**************************************************************/
+/*!
+ *	@brief This struct is the whole state of a coroutine, there is no stack of its own.  To keep state across a
+ *	wait, put the led_coro_t first in a struct of the application and cast the led_coro_t pointer back to it
+ *
+ *	 All of the fields are maintained by the scheduler and the macros below, and should not be touched
+ *
+*/
+typedef struct led_coro_t {
+	led_coro_fn coro_fn;
+	struct led_coro_t * coro_next;		// next in the list the coroutine waits in
+	unsigned int coro_delay;			// ms after the coroutine before it in the timer list
+	unsigned short coro_line;			// line to resume at, 0 is the start
+	unsigned char coro_events;			// events waited on, 0 when waiting on time
+}led_coro_t;
+
+
+
+/**************************************************************/
+/**\name	led_coro_sched_t   		                          */
+/**************************************************************/
+/*!
+ *	@brief This struct schedules the coroutines of a led_proc_t.  Waits on time are kept in a list sorted by when
+ *	they are due, each holding only the time after the one before it, so advancing the time only looks at the
+ *	coroutines that are due.  Waits on events are kept in a second list that is only walked when an event is posted
+ *
+ *	 @param led_proc
+ *	 	the LEDs the coroutines drive, its critical hooks protect the posted events
+ *
+ *	 The remaining fields are maintained by the scheduler and should not be touched by the application
+ *
+*/
+typedef struct led_coro_sched_t {
+	struct led_proc_t * led_proc;
+	struct led_coro_t * coro_timers;
+	struct led_coro_t * coro_waiters;
+	struct led_coro_t * coro_ready;			// fired and not yet resumed by the run_led_coros in progress
+	volatile unsigned char coro_posted;		// events posted since the last run_led_coros
+}led_coro_sched_t;
+
+// start and end the body of a coroutine function
+#define LED_CORO_BEGIN(coro)					switch ((coro)->coro_line) { case 0:
+#define LED_CORO_END(coro)						} (coro)->coro_line = 0; return LED_CORO_DONE
+
+// return to the scheduler, and carry on from here after ms or when one of the events is posted
+#define LED_AWAIT_MS(sched, coro, ms)			do { wait_led_coro_ms((sched), (coro), (ms)); (coro)->coro_line = __LINE__; return LED_CORO_WAITING; case __LINE__:; } while (0)
+#define LED_AWAIT_EVENT(sched, coro, events)	do { wait_led_coro_event((sched), (coro), (events)); (coro)->coro_line = __LINE__; return LED_CORO_WAITING; case __LINE__:; } while (0)
+#define LED_AWAIT_FADE_DONE(sched, coro)		LED_AWAIT_EVENT((sched), (coro), LED_CORO_EVENT_FADE_DONE)
+#define LED_CORO_YIELD(sched, coro)				LED_AWAIT_MS((sched), (coro), 0)
+
+
+
+/**************************************************************/
+/**\name	init_led_coro_sched		                          */
+/**************************************************************/
+/*!
+ *	@brief This function sets up a scheduler with no coroutines
+ *
+ *	 @param led_coro_sched_t structure pointer.
+ *	 @param led_proc_t structure pointer.
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of the setup
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type init_led_coro_sched(struct led_coro_sched_t * sched, struct led_proc_t * led_proc);
+
+
+
+/**************************************************************/
+/**\name	start_led_coro			                          */
+/**************************************************************/
+/*!
+ *	@brief This function starts a coroutine from the top, it first runs at the next run_led_coros.  A coroutine that
+ *		is already running is started again
+ *
+ *	 @param led_coro_sched_t structure pointer.
+ *	 @param led_coro_t structure pointer.
+ *	 @param led_coro_fn - the body of the coroutine
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of starting the coroutine
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type start_led_coro(struct led_coro_sched_t * sched, struct led_coro_t * coro, led_coro_fn fn);
+
+
+
+/**************************************************************/
+/**\name	stop_led_coro			                          */
+/**************************************************************/
+/*!
+ *	@brief This function stops a coroutine wherever it is waiting
+ *
+ *	 @param led_coro_sched_t structure pointer.
+ *	 @param led_coro_t structure pointer.
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of stopping the coroutine
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_NULL -> the coroutine was not running
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type stop_led_coro(struct led_coro_sched_t * sched, struct led_coro_t * coro);
+
+
+
+/**************************************************************/
+/**\name	wait_led_coro_ms		                          */
+/**************************************************************/
+/*!
+ *	@brief This function puts a coroutine in the timer list, used by LED_AWAIT_MS and not meant to be called
+ *		directly
+ *
+ *	 @param led_coro_sched_t structure pointer.
+ *	 @param led_coro_t structure pointer.
+ *	 @param unsigned int - ms to wait
+ *
+ *
+ *
+ *
+ *	@return none
+ *
+ *
+*/
+void wait_led_coro_ms(struct led_coro_sched_t * sched, struct led_coro_t * coro, unsigned int ms);
+
+
+
+/**************************************************************/
+/**\name	wait_led_coro_event		                          */
+/**************************************************************/
+/*!
+ *	@brief This function puts a coroutine in the event list, used by LED_AWAIT_EVENT and not meant to be called
+ *		directly
+ *
+ *	 @param led_coro_sched_t structure pointer.
+ *	 @param led_coro_t structure pointer.
+ *	 @param unsigned char - the events to wait on, any one of them resumes the coroutine
+ *
+ *
+ *
+ *
+ *	@return none
+ *
+ *
+*/
+void wait_led_coro_event(struct led_coro_sched_t * sched, struct led_coro_t * coro, unsigned char events);
+
+
+
+/**************************************************************/
+/**\name	post_led_coro_event		                          */
+/**************************************************************/
+/*!
+ *	@brief This function posts events, the coroutines waiting on them are resumed at the next run_led_coros.  Safe
+ *		to call from an interrupt or another task than run_led_coros
+ *
+ *	 @param led_coro_sched_t structure pointer.
+ *	 @param unsigned char - the events
+ *
+ *
+ *
+ *
+ *	@return none
+ *
+ *
+*/
+void post_led_coro_event(struct led_coro_sched_t * sched, unsigned char events);
+
+
+
+/**************************************************************/
+/**\name	run_led_coros			                          */
+/**************************************************************/
+/*!
+ *	@brief This function advances the time of the scheduler and resumes the coroutines whose wait has fired, each
+ *		at most once.  Meant to be called from the led_tick of the led_proc_t.  The coroutines run in the
+ *		context of the caller, all of them must be started, stopped and run from the same context
+ *
+ *	 @param led_coro_sched_t structure pointer.
+ *	 @param unsigned int - ms since the last call
+ *
+ *
+ *
+ *
+ *	@return int - the number of coroutines resumed
+ *
+ *
+*/
+int run_led_coros(struct led_coro_sched_t * sched, unsigned int elapsed_ms);
+
+#endif /* VENDOR_TEL_TEST_LIB_LED_CORO_H_ */
@@ -6,60 +6,290 @@
  */
 #include "led_lib.h"
 #include "led_proc.h"
+#include "led_store.h"
+#include "led_color.h"
+#include "button_proc.h"
+#include "led_coro.h"
+#include "led_pattern.h"
+#include "led_trace.h"
 #include "../bsp.h"
 #include "common.h"
 #include "../app_config.h"
 
+#ifndef NULL
+#define NULL   ((void *) 0)
+#endif
+
 
 #define FLASH_ALL_LEDS	1
 #define CYCLE_LEDS		2
+#define COLOR_WHEEL		3		// red, green and blue as one RGB LED stepping around the colour wheel
+#define LED_SEQUENCE	4		// after each white fade up, red flashes 3 times then green holds, as a coroutine
+#define LED_PATTERN		5		// plays tools/patterns/onchip.txt, compiled to a blob that is read from flash
 
+// may be set on the command line, tools/led_soak.c is built with each of them
+#ifndef LED_BEHAVIOR
 #define LED_BEHAVIOR	CYCLE_LEDS
+#endif
+
+// the coroutine of LED_SEQUENCE, the flash count lives here as locals do not survive a wait
+typedef struct app_led_sequence_t {
+	led_coro_t coro;		// first, so the coroutine can be cast back to the sequence
+	unsigned char flashes;
+}app_led_sequence_t;
+
+// everything the on-chip LED bank needs is owned by its led_proc_t through led_context, so more banks, such as
+// an external LED driver, can run next to it at their own rate
+typedef struct app_led_bank_t {
+	led_t leds[NUM_LEDS];
+	app_led_pwm_info_t white_led_pwm_info;
+	led_pwm_state_t white_led_pwm;			// PWM side table, the only LED that needs one
+	struct led_rgb_group_t rgb_group;
+#if (LED_BEHAVIOR==CYCLE_LEDS)
+	volatile unsigned char cntr;		// 0 - 2, unsigned so a corrupt value can never index below the first LED
+#elif (LED_BEHAVIOR==COLOR_WHEEL)
+	volatile unsigned short wheel_hue;
+#elif (LED_BEHAVIOR==LED_SEQUENCE)
+	struct led_coro_sched_t coro_sched;
+	app_led_sequence_t sequence;
+#elif (LED_BEHAVIOR==LED_PATTERN)
+	struct led_pattern_t pattern;
+#endif
+}app_led_bank_t;
+
+#define LED_RETAINED_VERSION	1		// bumped whenever app_led_retained_t changes
 
+// the state of run_led_loop and the bank kept with the snapshot across a deep sleep, see suspend_led_lib
+typedef struct app_led_retained_t {
+	int white_level;
+	int white_up;
 #if (LED_BEHAVIOR==CYCLE_LEDS)
-volatile int cntr = 0;
+	unsigned char cntr;
+#elif (LED_BEHAVIOR==COLOR_WHEEL)
+	unsigned short wheel_hue;
+#elif (LED_BEHAVIOR==LED_PATTERN)
+	struct led_pattern_t pattern;		// only the position is used, the pointers are set again by init_led_pattern
 #endif
+	// the LED_SEQUENCE coroutine is not kept, it starts again waiting for the next fade to finish
+}app_led_retained_t;
+
+// tracks of start_led_lib_trace after one per LED, which are numbered as the LEDs are
+typedef enum LED_LIB_TRACE_TRACKS {
+	LED_LIB_TRACK_PWM2_IRQ = NUM_LEDS,
+	LED_LIB_TRACK_TIMER0_IRQ,
+	LED_LIB_TRACK_GPIO_IRQ,
+	LED_LIB_TRACK_MAIN_LOOP,				// the fade step of run_led_loop
+	LED_LIB_NUM_TRACKS
+}led_lib_trace_track;
+
+// keys of the values kept in the flash store, so they survive a reset
+typedef enum LED_STORE_KEYS {
+	LED_STORE_KEY_WHITE_LEVEL,
+	LED_STORE_KEY_WHITE_FADE_UP,
+	LED_STORE_KEY_CYCLE_POS
+}led_store_keys;
 
 led_proc_error_type init_led(led_t * led);
 led_proc_error_type set_led_polarity(led_t * led, led_output_state_t state);
 led_proc_error_type set_led_duty_cycle(led_t * led, int pwm_dc);
+led_proc_error_type set_led_compare(led_t * led, unsigned int on_cycles);
+led_proc_error_type set_led_cycles(led_t * led, unsigned int cycles);
+led_proc_error_type set_led_frame_irq(led_t * led, int enable);
+void set_led_tick_irq(int enable);
 led_proc_error_type get_state_of_led(led_t * led, int * state);
 led_proc_error_type deinit_led(led_t * led);
+led_proc_error_type init_led_outputs(led_t * leds, int num_leds);
+led_proc_error_type verify_led_output_pins(led_t * leds, int num_leds, unsigned int * mismatch);
+led_proc_error_type set_led_output_pins(led_t * leds, int num_leds, unsigned int mask);
+unsigned int enter_led_critical(void);
+void exit_led_critical(unsigned int key);
+led_proc_error_type read_led_flash(unsigned int addr, unsigned char * buf, unsigned int len);
+led_proc_error_type write_led_flash(unsigned int addr, unsigned char * buf, unsigned int len);
+led_proc_error_type erase_led_flash(unsigned int addr);
+void run_onchip_led_tick(struct led_proc_t * led_proc);
+led_proc_error_type init_button(button_t * button);
+led_proc_error_type read_button(button_t * button, int * level);
+led_proc_error_type set_button_edge(button_t * button, int level);
+void handle_button_event(struct button_proc_t * button_proc, button_event_t * event);
 
 
 struct led_proc_t led_proc;
-led_t bsp_leds[NUM_LEDS];
+app_led_bank_t onchip_led_bank;
+struct led_store_t led_store;
+struct button_proc_t button_proc;
+button_t onchip_buttons[NUM_BUTTONS];
+
+// white LED fade position, kept outside of run_led_loop so it can be restored from the store
+int pwm_level = 0;		// 16 bit brightness, dithered in the PWM frame interrupt
+int pwm_up = 1;
+
+unsigned int led_boot_timestamps[LED_BOOT_NUM_PHASES];
+_attribute_data_retention_ led_snapshot_t led_retained;	// the only LED state that survives a deep sleep
+unsigned char led_lib_resumed = 0;
+led_isr_stats_t led_isr_stats;
+volatile unsigned char led_tick_running = 0;		// Timer0 is running, see set_led_tick_irq
 
+#if LED_TRACE_ENABLE
+struct led_trace_t * led_lib_trace = NULL;
+
+static const char * const led_lib_track_names[LED_LIB_NUM_TRACKS] = {
+	[LED_RED_NUM] = "red",
+	[LED_WHITE_NUM] = "white",
+	[LED_GREEN_NUM] = "green",
+	[LED_BLUE_NUM] = "blue",
+	[LED_LIB_TRACK_PWM2_IRQ] = "pwm2_irq",
+	[LED_LIB_TRACK_TIMER0_IRQ] = "timer0_irq",
+	[LED_LIB_TRACK_GPIO_IRQ] = "gpio_irq",
+	[LED_LIB_TRACK_MAIN_LOOP] = "main_loop"
+};
+
+// called from the interrupt and the main loop alike, so the trace is always fed with interrupts masked
+static void trace_led_lib(int track, unsigned int value)
+{
+	unsigned char r = irq_disable();
+	if (led_lib_trace != NULL)
+		log_led_trace(led_lib_trace, track, clock_time(), value);
+	irq_restore(r);
+}
+
+static void trace_onchip_led(struct led_proc_t * led_proc, int led_num, unsigned int value)
+{
+	trace_led_lib(led_num, value);
+}
+#else
+#define trace_led_lib(track, value)
+#endif
+
+
+// the frame status latches whether or not its interrupt is enabled, so it only counts while led_proc has it enabled
+static inline int get_white_led_frame_pending(void)
+{
+	return onchip_led_bank.white_led_pwm.led_frame_irq_on && pwm_get_interrupt_status(PWM_IRQ_PWM2_FRAME);
+}
 
 // PWM seems to require the irq_handler going by the examples
 _attribute_ram_code_sec_noinline_ void irq_handler(void)
 {
-	if(pwm_get_interrupt_status(PWM_IRQ_PWM2_FRAME)){
+	unsigned int isr_start = clock_time();
+	unsigned int isr_ticks;
+	int frame_run = 0;
+	int timer_run = 0;
+
+	if(get_white_led_frame_pending()){
+		frame_run = 1;
+		trace_led_lib(LED_LIB_TRACK_PWM2_IRQ, 1);
 		pwm_clear_interrupt_status(PWM_IRQ_PWM2_FRAME);
+		run_led_num_pwm_frame(&led_proc, LED_WHITE_NUM);
+		trace_led_lib(LED_LIB_TRACK_PWM2_IRQ, 0);
 	}
 
 	if(timer_get_interrupt_status(TMR_STA_TMR0))
 	{
+		timer_run = 1;
+		trace_led_lib(LED_LIB_TRACK_TIMER0_IRQ, 1);
 		timer_clear_interrupt_status(TMR_STA_TMR0); //clear irq status
+		dispatch_led_proc_tick(LED_TIMER_MS);
+		trace_led_lib(LED_LIB_TRACK_TIMER0_IRQ, 0);
+	}
+
+	if(reg_irq_src & FLD_IRQ_GPIO_EN)
+	{
+		trace_led_lib(LED_LIB_TRACK_GPIO_IRQ, 1);
+		reg_irq_src |= FLD_IRQ_GPIO_EN;		// write 1 to clear
+		handle_button_edges(&button_proc, clock_time());
+		trace_led_lib(LED_LIB_TRACK_GPIO_IRQ, 0);
+	}
+
+	// a frame or timer handled above that is pending again already means this interrupt ran past a frame or timer
+	// period, so the compare and cycle writes above may have missed the frame boundary they were meant for.  One that
+	// was not handled has only just come in, during a button edge say, and is taken by the next interrupt
+	led_isr_stats.isr_count++;
+	isr_ticks = clock_time() - isr_start;
+	if (isr_ticks > led_isr_stats.isr_max_ticks)
+		led_isr_stats.isr_max_ticks = isr_ticks;
+	if ((frame_run && get_white_led_frame_pending()) || (timer_run && timer_get_interrupt_status(TMR_STA_TMR0)))
+		led_isr_stats.isr_overruns++;
+}
+
+void run_onchip_led_tick(struct led_proc_t * led_proc)
+{
+	app_led_bank_t * bank = (app_led_bank_t *)led_proc->led_context;
+
 #if (LED_BEHAVIOR==FLASH_ALL_LEDS)
 
-		int toggling_led_nums[3] = { LED_RED_NUM, LED_GREEN_NUM, LED_BLUE_NUM };	// preferred method since it syncs the state and error checks the LED type
-		toggle_leds_nums_ensure(&led_proc, toggling_led_nums, 3);
+	// one pass that type checks every LED and writes their port once, see verify_led_outputs to check the pins
+	static const unsigned int toggling_leds[LED_PROC_MASK_WORDS(NUM_LEDS)] = {
+		LED_PROC_MASK_BIT(LED_RED_NUM) | LED_PROC_MASK_BIT(LED_GREEN_NUM) | LED_PROC_MASK_BIT(LED_BLUE_NUM) };
+	toggle_leds_mask(led_proc, toggling_leds, NULL, LED_PROC_MASK_WORDS(NUM_LEDS));
+	(void)bank;
 
 #elif (LED_BEHAVIOR==CYCLE_LEDS)
-		if (cntr == 0)
-			toggle_led_num_ensure(&led_proc, LED_RED_NUM);
-		else if (cntr == 1)
-			toggle_led_num_ensure(&led_proc, LED_GREEN_NUM);
-		else if (cntr == 2)
-			toggle_led_num_ensure(&led_proc, LED_BLUE_NUM);
+	if (bank->cntr == 0)
+		toggle_led_num_ensure(led_proc, LED_RED_NUM);
+	else if (bank->cntr == 1)
+		toggle_led_num_ensure(led_proc, LED_GREEN_NUM);
+	else if (bank->cntr == 2)
+		toggle_led_num_ensure(led_proc, LED_BLUE_NUM);
+
+	if (bank->cntr >= 2)
+		bank->cntr = 0;
+	else
+		bank->cntr++;
+
+#elif (LED_BEHAVIOR==COLOR_WHEEL)
+	set_led_rgb_group_hsv(led_proc, &bank->rgb_group, bank->wheel_hue, LED_COLOR_MAX, LED_COLOR_MAX);
+	bank->wheel_hue += LED_COLOR_HUE_SECTOR;
+	if (bank->wheel_hue >= LED_COLOR_HUE_MAX)
+		bank->wheel_hue = 0;
+
+#elif (LED_BEHAVIOR==LED_SEQUENCE)
+	run_led_coros(&bank->coro_sched, LED_TIMER_MS);
+	// with every coroutine waiting on an event there is nothing to time, run_led_loop wakes the tick on the post
+	if (bank->coro_sched.coro_timers == NULL)
+		set_led_proc_tick_idle(led_proc);
 
-		cntr++;
-		if (cntr > 2)
-			cntr = 0;
+#elif (LED_BEHAVIOR==LED_PATTERN)
+	if (run_led_pattern(&bank->pattern) != LED_PROC_ERROR_TYPE_NONE || bank->pattern.pattern_done)
+		set_led_proc_tick_idle(led_proc);
 #endif
+}
+
+#if (LED_BEHAVIOR==LED_SEQUENCE)
+static led_coro_state run_led_sequence(struct led_coro_sched_t * sched, struct led_coro_t * coro)
+{
+	app_led_sequence_t * sequence = (app_led_sequence_t *)coro;
+
+	LED_CORO_BEGIN(coro);
+	while (1)
+	{
+		// posted by run_led_loop when the white LED reaches the top of its fade
+		LED_AWAIT_FADE_DONE(sched, coro);
+
+		for (sequence->flashes = 0; sequence->flashes < 3; sequence->flashes++)
+		{
+			turn_led_num_on(sched->led_proc, LED_RED_NUM);
+			LED_AWAIT_MS(sched, coro, LED_TIMER_MS);
+			turn_led_num_off(sched->led_proc, LED_RED_NUM);
+			LED_AWAIT_MS(sched, coro, LED_TIMER_MS);
+		}
+
+		turn_led_num_on(sched->led_proc, LED_GREEN_NUM);
+		LED_AWAIT_MS(sched, coro, 4 * LED_TIMER_MS);
+		turn_led_num_off(sched->led_proc, LED_GREEN_NUM);
 	}
+	LED_CORO_END(coro);
 }
+#endif
+
+#if (LED_BEHAVIOR==LED_PATTERN)
+// made by tools/led_patc.c from tools/patterns/onchip.txt, do not edit
+static const unsigned char onchip_led_pattern[43] = {
+	0x4C, 0x50, 0x01, 0x04, 0xF4, 0x01, 0x10, 0xFF, 0x31, 0x10, 0x00, 0x12,
+	0xFF, 0x31, 0x12, 0x00, 0x13, 0xFF, 0x31, 0x13, 0x00, 0x40, 0x0F, 0x01,
+	0x10, 0xFF, 0x12, 0xFF, 0x13, 0xFF, 0x31, 0x10, 0x00, 0x12, 0x00, 0x13,
+	0x00, 0x31, 0x40, 0x0E, 0x02, 0x32, 0x01
+};
+#endif
 
 led_proc_error_type init_led(led_t * led)
 {
@@ -68,43 +298,226 @@ led_proc_error_type init_led(led_t * led)
 		gpio_set_output_en(led->led_ptr, 1); 		//enable output
 		gpio_set_input_en(led->led_ptr,0);			//disable input
 		gpio_write(led->led_ptr, 0);              	//LED Off
-		led->led_state.led_output_state = LED_OFF;
+		led->led_output_state = LED_OFF;
 	}
 	else if (led->led_type == LED_TYPE_PWM)
 	{
-		app_led_pwm_info_t * info = (app_led_pwm_info_t *)led->led_state.led_pwm_state.led_pwm_info;
+		led_pwm_state_t * pwm_state = led->led_pwm_state;
+		app_led_pwm_info_t * info = (app_led_pwm_info_t *)pwm_state->led_pwm_info;
+		led_proc_error_type status = get_led_pwm_timing(LED_PWM_CLOCK_HERTZ, (unsigned int)pwm_state->led_pwm_hertz, LED_PWM_MIN_STEPS, &pwm_state->led_pwm_timing);
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+			return status;
+
 		gpio_set_func(led->led_ptr, info->pwm_type);			// white LED GPIO is on PWM2, this is being hard coded here, but needs to be NOTED
 		pwm_set_mode(info->id, info->mode);
-		pwm_set_cycle_and_duty(info->id, led->led_state.led_pwm_state.led_pwm_hertz * CLOCK_SYS_CLOCK_1US, led->led_state.led_pwm_state.led_duty_cycle);			// initialize the Duty Cycle to 0 and let the processor set the DC
-		pwm_set_interrupt_enable(info->irq);
+		pwm_set_cycle_and_duty(info->id, (unsigned short)pwm_state->led_pwm_timing.cycles, (unsigned short)get_led_pwm_duty_cycles(&pwm_state->led_pwm_timing, pwm_state->led_duty_cycle));
+		// the frame interrupt is left to led_proc, which only enables it while there is dithering to do
 		irq_enable();
 		pwm_start(info->id);
-		//led->led_state.led_pwm_state.led_duty_cycle = 0;
+		//led->led_pwm_state->led_duty_cycle = 0;
+	}
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+#define LED_GPIO_NUM_PORTS	5		// GPIO_PinTypeDef is the port in the upper byte and the pin mask in the lower byte
+
+led_proc_error_type init_led_outputs(led_t * leds, int num_leds)
+{
+	unsigned char port_mask[LED_GPIO_NUM_PORTS] = { 0 };
+	unsigned char port_on[LED_GPIO_NUM_PORTS] = { 0 };
+
+	for (int i = 0; i < num_leds; i++)
+	{
+		if (leds[i].led_type != LED_TYPE_OUTPUT)
+			continue;
+
+		int port = (int)leds[i].led_ptr >> 8;
+		unsigned char bit = (unsigned char)(leds[i].led_ptr & 0xFF);
+		if (port >= LED_GPIO_NUM_PORTS)
+			return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+		port_mask[port] |= bit;
+		if (leds[i].led_output_state == LED_ON)
+			port_on[port] |= bit;
+	}
+
+	// one write per port for the output level, then one for the output enable, so the pins never glitch
+	for (int port = 0; port < LED_GPIO_NUM_PORTS; port++)
+	{
+		if (port_mask[port] == 0)
+			continue;
+
+		GPIO_PinTypeDef port_pin = (GPIO_PinTypeDef)(port << 8);
+		reg_gpio_out(port_pin) = (reg_gpio_out(port_pin) & ~port_mask[port]) | port_on[port];
+		reg_gpio_oen(port_pin) &= ~port_mask[port];		// output enable is active low
+	}
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type verify_led_output_pins(led_t * leds, int num_leds, unsigned int * mismatch)
+{
+	unsigned char port_mask[LED_GPIO_NUM_PORTS] = { 0 };
+	unsigned char port_on[LED_GPIO_NUM_PORTS] = { 0 };
+	unsigned char port_bad[LED_GPIO_NUM_PORTS] = { 0 };
+	unsigned char r;
+
+	// masked so Timer0 cannot change an LED between taking the expected level and reading the port
+	r = irq_disable();
+	for (int i = 0; i < num_leds; i++)
+	{
+		if (leds[i].led_type != LED_TYPE_OUTPUT || ((int)leds[i].led_ptr >> 8) >= LED_GPIO_NUM_PORTS)
+			continue;
+
+		int port = (int)leds[i].led_ptr >> 8;
+		unsigned char bit = (unsigned char)(leds[i].led_ptr & 0xFF);
+		port_mask[port] |= bit;
+		if (leds[i].led_output_state == LED_ON)
+			port_on[port] |= bit;
+	}
+
+	// one read and one compare per port, for all of its LEDs at once
+	for (int port = 0; port < LED_GPIO_NUM_PORTS; port++)
+	{
+		if (port_mask[port] != 0)
+			port_bad[port] = (reg_gpio_out((GPIO_PinTypeDef)(port << 8)) ^ port_on[port]) & port_mask[port];
+	}
+	irq_restore(r);
+
+	for (int i = 0; i < num_leds; i++)
+	{
+		if (leds[i].led_type != LED_TYPE_OUTPUT || ((int)leds[i].led_ptr >> 8) >= LED_GPIO_NUM_PORTS)
+			continue;
+		if (port_bad[(int)leds[i].led_ptr >> 8] & (leds[i].led_ptr & 0xFF))
+			mismatch[i / 32] |= 1u << (i % 32);
+	}
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type set_led_output_pins(led_t * leds, int num_leds, unsigned int mask)
+{
+	unsigned char port_mask[LED_GPIO_NUM_PORTS] = { 0 };
+	unsigned char port_on[LED_GPIO_NUM_PORTS] = { 0 };
+	unsigned char r;
+
+	// masked so the levels taken from led_output_state are the ones written, and Timer0 cannot write the port between
+	r = irq_disable();
+	for (int i = 0; i < num_leds; i++)
+	{
+		if (!(mask & (1u << i)) || leds[i].led_type != LED_TYPE_OUTPUT || ((int)leds[i].led_ptr >> 8) >= LED_GPIO_NUM_PORTS)
+			continue;
+
+		int port = (int)leds[i].led_ptr >> 8;
+		unsigned char bit = (unsigned char)(leds[i].led_ptr & 0xFF);
+		port_mask[port] |= bit;
+		if (leds[i].led_output_state == LED_ON)
+			port_on[port] |= bit;
+	}
+
+	// one read-modify-write per port, for all of its LEDs at once
+	for (int port = 0; port < LED_GPIO_NUM_PORTS; port++)
+	{
+		if (port_mask[port] == 0)
+			continue;
+
+		GPIO_PinTypeDef port_pin = (GPIO_PinTypeDef)(port << 8);
+		reg_gpio_out(port_pin) = (reg_gpio_out(port_pin) & ~port_mask[port]) | port_on[port];
 	}
+	irq_restore(r);
+
 	return LED_PROC_ERROR_TYPE_NONE;
 }
 
+static void disable_led_inputs(led_t * leds, int num_leds)
+{
+	// input buffers only cost power on an output, so this is left until after the first frame
+	for (int i = 0; i < num_leds; i++)
+	{
+		if (leds[i].led_type == LED_TYPE_OUTPUT)
+			gpio_set_input_en(leds[i].led_ptr, 0);
+	}
+}
+
 led_proc_error_type set_led_polarity(led_t * led, led_output_state_t state)
 {
+	// gpio_write is a read-modify-write of the whole port, which the Timer0 interrupt also writes to
+	unsigned char r = irq_disable();
 	gpio_write(led->led_ptr, (unsigned int)state);
-	// work around to fix issue with gpio_read function
-	led->led_state.led_output_state = state;
+	irq_restore(r);
+	// led_output_state is kept by led_proc, which works around the issue with the gpio_read function
 	return LED_PROC_ERROR_TYPE_NONE;
 }
 
 led_proc_error_type set_led_duty_cycle(led_t * led, int pwm_dc)
 {
-	app_led_pwm_info_t * info = (app_led_pwm_info_t *)led->led_state.led_pwm_state.led_pwm_info;
-	pwm_set_cmp(info->id, pwm_dc * 10 * CLOCK_SYS_CLOCK_1US);
+	app_led_pwm_info_t * info = (app_led_pwm_info_t *)led->led_pwm_state->led_pwm_info;
+	pwm_set_cmp(info->id, (unsigned short)get_led_pwm_duty_cycles(&led->led_pwm_state->led_pwm_timing, pwm_dc));
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type set_led_compare(led_t * led, unsigned int on_cycles)
+{
+	app_led_pwm_info_t * info = (app_led_pwm_info_t *)led->led_pwm_state->led_pwm_info;
+	// PWM on this pin is Inverted, the LED is lit for the part of the frame after the compare value
+	pwm_set_cmp(info->id, (unsigned short)(led->led_pwm_state->led_pwm_timing.cycles - on_cycles));
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type set_led_cycles(led_t * led, unsigned int cycles)
+{
+	app_led_pwm_info_t * info = (app_led_pwm_info_t *)led->led_pwm_state->led_pwm_info;
+	// like the compare, the cycle register is latched by the hardware at the end of the current frame
+	pwm_set_cycle(info->id, (unsigned short)cycles);
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type set_led_frame_irq(led_t * led, int enable)
+{
+	app_led_pwm_info_t * info = (app_led_pwm_info_t *)led->led_pwm_state->led_pwm_info;
+	// the status still latches every frame while the interrupt is masked, a stale one must not be mistaken for a
+	// frame by irq_handler, or fire the moment the interrupt is enabled again
+	if (enable)
+	{
+		pwm_clear_interrupt_status(info->irq);
+		pwm_set_interrupt_enable(info->irq);
+	}
+	else
+	{
+		pwm_set_interrupt_disable(info->irq);
+		pwm_clear_interrupt_status(info->irq);
+	}
 	return LED_PROC_ERROR_TYPE_NONE;
 }
 
+void set_led_tick_irq(int enable)
+{
+	// started again from a full period, and only when stopped so an instance waking does not delay the others
+	if ((enable != 0) == led_tick_running)
+		return;
+	led_tick_running = (enable != 0);
+
+	if (enable)
+	{
+		timer0_set_mode(TIMER_MODE_SYSCLK,0,LED_TIMER_MS * CLOCK_SYS_CLOCK_1MS);
+		timer_start(TIMER0);
+	}
+	else
+	{
+		timer_stop(TIMER0);
+	}
+}
+
 led_proc_error_type get_state_of_led(led_t * led, int * state)
 {
-	// the gpio_read function appears to be broken
-	//*state = gpio_read(led);
-	//work around for gpio_read function
-	*state = led->led_state.led_output_state;
+	// gpio_read reads the input register, and the input buffer of an LED pin is disabled, so it is always 0.  The
+	// output data register reads back what was last written to the pin instead
+	if (led->led_type != LED_TYPE_OUTPUT)
+	{
+		*state = led->led_output_state;
+		return LED_PROC_ERROR_TYPE_NONE;
+	}
+	*state = (reg_gpio_out(led->led_ptr) & (led->led_ptr & 0xFF)) ? LED_ON : LED_OFF;
 
 	return LED_PROC_ERROR_TYPE_NONE;
 }
@@ -115,62 +528,367 @@ led_proc_error_type deinit_led(led_t * led)
 	return LED_PROC_ERROR_TYPE_NONE;
 }
 
+unsigned int enter_led_critical(void)
+{
+	// the TC32 compiler has no atomic builtins, so led_proc masks interrupts around its state updates
+	return irq_disable();
+}
+
+void exit_led_critical(unsigned int key)
+{
+	irq_restore((unsigned char)key);
+}
+
+led_proc_error_type read_led_flash(unsigned int addr, unsigned char * buf, unsigned int len)
+{
+	flash_read_page(addr, len, buf);
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type write_led_flash(unsigned int addr, unsigned char * buf, unsigned int len)
+{
+	flash_write_page(addr, len, buf);
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type erase_led_flash(unsigned int addr)
+{
+	flash_erase_sector(addr);
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type init_button(button_t * button)
+{
+	gpio_set_func(button->button_ptr, AS_GPIO);
+	gpio_set_output_en(button->button_ptr, 0);
+	gpio_set_input_en(button->button_ptr, 1);
+	gpio_setup_up_down_resistor(button->button_ptr, PM_PIN_PULLUP_10K);
+	gpio_set_interrupt(button->button_ptr, POL_FALLING);
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type read_button(button_t * button, int * level)
+{
+	// reading inputs works, the gpio_read issue is only with outputs
+	*level = (gpio_read(button->button_ptr) != 0);
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type set_button_edge(button_t * button, int level)
+{
+	// the GPIO interrupt only fires on one edge, so it is flipped to catch the pin leaving its current level
+	gpio_set_interrupt_pol(button->button_ptr, level ? POL_FALLING : POL_RISING);
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+void handle_button_event(struct button_proc_t * button_proc, button_event_t * event)
+{
+	struct led_proc_t * led_proc = (struct led_proc_t *)button_proc->button_context;
+	led_pwm_timing_t timing;
+
+	// called from run_led_loop through process_button_proc, the same context as the white LED fade
+	if (event->event_type == BUTTON_EVENT_MULTI_CLICK && event->button_clicks == 1)
+	{
+		pwm_up = !pwm_up;
+	}
+	else if (event->event_type == BUTTON_EVENT_MULTI_CLICK && event->button_clicks == 2)
+	{
+		unsigned int hertz = LED_PWM_HERTZ;
+		if (led_proc->led_array[LED_WHITE_NUM].led_pwm_state->led_pwm_timing.hertz == LED_PWM_HERTZ)
+			hertz = LED_PWM_CAMERA_HERTZ;
+		if (get_led_pwm_timing(LED_PWM_CLOCK_HERTZ, hertz, LED_PWM_MIN_STEPS, &timing) == LED_PROC_ERROR_TYPE_NONE)
+			retune_led_num_pwm(led_proc, LED_WHITE_NUM, &timing);
+	}
+	else if (event->event_type == BUTTON_EVENT_LONG_PRESS)
+	{
+		pwm_level = 0;
+		pwm_up = 1;
+	}
+}
+
+static void restore_led_lib_state()
+{
+	unsigned short value;
+
+	if (get_led_store_value(&led_store, LED_STORE_KEY_WHITE_LEVEL, &value) == LED_PROC_ERROR_TYPE_NONE)
+		pwm_level = value;
+	if (get_led_store_value(&led_store, LED_STORE_KEY_WHITE_FADE_UP, &value) == LED_PROC_ERROR_TYPE_NONE)
+		pwm_up = (value != 0);
+#if (LED_BEHAVIOR==CYCLE_LEDS)
+	if (get_led_store_value(&led_store, LED_STORE_KEY_CYCLE_POS, &value) == LED_PROC_ERROR_TYPE_NONE
+			&& value <= 2)
+		onchip_led_bank.cntr = (unsigned char)value;
+#endif
+}
+
+static void save_led_lib_state()
+{
+	set_led_store_value(&led_store, LED_STORE_KEY_WHITE_LEVEL, (unsigned short)pwm_level);
+	set_led_store_value(&led_store, LED_STORE_KEY_WHITE_FADE_UP, (unsigned short)pwm_up);
+#if (LED_BEHAVIOR==CYCLE_LEDS)
+	set_led_store_value(&led_store, LED_STORE_KEY_CYCLE_POS, (unsigned short)onchip_led_bank.cntr);
+#endif
+}
+
+void suspend_led_lib()
+{
+	app_led_retained_t retained;
+
+	retained.white_level = pwm_level;
+	retained.white_up = pwm_up;
+#if (LED_BEHAVIOR==CYCLE_LEDS)
+	retained.cntr = onchip_led_bank.cntr;
+#elif (LED_BEHAVIOR==COLOR_WHEEL)
+	retained.wheel_hue = onchip_led_bank.wheel_hue;
+#elif (LED_BEHAVIOR==LED_PATTERN)
+	retained.pattern = onchip_led_bank.pattern;
+#endif
+	save_led_proc_snapshot(&led_proc, &led_retained, LED_RETAINED_VERSION, &retained, sizeof(retained));
+}
+
 void init_led_lib()
 {
-	pwm_set_clk(CLOCK_SYS_CLOCK_HERTZ, CLOCK_SYS_CLOCK_HERTZ);
+	app_led_retained_t retained;
+	led_proc_error_type store_status;
+
+	led_boot_timestamps[LED_BOOT_PHASE_START] = clock_time();
 
 	led_proc.led_init = init_led;
 	led_proc.led_set_polarity = set_led_polarity;
 	led_proc.led_set_duty_cycle = set_led_duty_cycle;
 	led_proc.led_get_state = get_state_of_led;
 	led_proc.led_deinit = deinit_led;
+	led_proc.led_init_outputs = init_led_outputs;
+	led_proc.led_verify_outputs = verify_led_output_pins;
+	led_proc.led_set_outputs = set_led_output_pins;
+	led_proc.led_set_compare = set_led_compare;
+	led_proc.led_set_cycles = set_led_cycles;
+	led_proc.led_set_frame_irq = set_led_frame_irq;
+	led_proc.led_set_tick_irq = set_led_tick_irq;
+	// PWM2 shares its clock with every other channel and only the white LED is on a PWM pin, so nothing here can
+	// blink in hardware, blink_led runs every blink from the tick
+	led_proc.led_caps = 0;
+	led_proc.led_enter_critical = enter_led_critical;
+	led_proc.led_exit_critical = exit_led_critical;
+
+	led_proc.led_tick = run_onchip_led_tick;
+	led_proc.led_tick_period_ms = LED_TIMER_MS;
+	led_proc.led_context = &onchip_led_bank;
+
+	onchip_led_bank.white_led_pwm_info.id = PWM2_ID;
+	onchip_led_bank.white_led_pwm_info.irq = PWM_IRQ_PWM2_FRAME;
+	onchip_led_bank.white_led_pwm_info.mode = PWM_NORMAL_MODE;
+	onchip_led_bank.white_led_pwm_info.pwm_type = AS_PWM2_N;
 
-	white_led_pwm_info.id = PWM2_ID;
-	white_led_pwm_info.irq = PWM_IRQ_PWM2_FRAME;
-	white_led_pwm_info.mode = PWM_NORMAL_MODE;
-	white_led_pwm_info.pwm_type = AS_PWM2_N;
-	white_led.led_state.led_pwm_state.led_pwm_info = &white_led_pwm_info;
+	onchip_led_bank.leds[LED_RED_NUM] = red_led;
+	onchip_led_bank.leds[LED_WHITE_NUM] = white_led;
+	onchip_led_bank.leds[LED_GREEN_NUM] = green_led;
+	onchip_led_bank.leds[LED_BLUE_NUM] = blue_led;
+	onchip_led_bank.white_led_pwm = white_led_pwm;
+	onchip_led_bank.white_led_pwm.led_pwm_info = &onchip_led_bank.white_led_pwm_info;
+	onchip_led_bank.leds[LED_WHITE_NUM].led_pwm_state = &onchip_led_bank.white_led_pwm;
 
-	bsp_leds[LED_RED_NUM] = red_led;
-	bsp_leds[LED_WHITE_NUM] = white_led;
-	bsp_leds[LED_GREEN_NUM] = green_led;
-	bsp_leds[LED_BLUE_NUM] = blue_led;
+	init_led_rgb_group(&onchip_led_bank.rgb_group, LED_RED_NUM, LED_GREEN_NUM, LED_BLUE_NUM, LED_PWM_BRIGHTEST, LED_PWM_DIMMEST);
 
-	led_proc.led_array = bsp_leds;
+	// waking from a deep sleep that kept retention RAM, the LEDs are put back where suspend_led_lib left them
+	// before they are initialized, so the init below drives them straight there with its batched writes
+	led_lib_resumed = pm_is_MCU_deepRetentionWakeup()
+			&& restore_led_proc_snapshot(&led_proc, onchip_led_bank.leds, NUM_LEDS, &led_retained, LED_RETAINED_VERSION, &retained, sizeof(retained)) == LED_PROC_ERROR_TYPE_NONE;
 
-	init_led_proc(&led_proc, bsp_leds, NUM_LEDS);
+	// only the output LEDs are needed for the first frame, everything else is deferred until after it is shown
+	init_led_proc_fast(&led_proc, onchip_led_bank.leds, NUM_LEDS);
+	led_boot_timestamps[LED_BOOT_PHASE_FIRST_FRAME] = clock_time();
 
-	timer0_set_mode(TIMER_MODE_SYSCLK,0,LED_TIMER_MS * CLOCK_SYS_CLOCK_1MS);
-	timer_start(TIMER0);
+	disable_led_inputs(onchip_led_bank.leds, NUM_LEDS);
+	pwm_set_clk(CLOCK_SYS_CLOCK_HERTZ, LED_PWM_CLOCK_HERTZ);
+	init_led_proc_deferred(&led_proc, onchip_led_bank.leds, NUM_LEDS);
+	led_boot_timestamps[LED_BOOT_PHASE_PWM_STARTED] = clock_time();
+
+	led_store.store_read = read_led_flash;
+	led_store.store_write = write_led_flash;
+	led_store.store_erase = erase_led_flash;
+	led_store.store_base_addr = LED_STORE_FLASH_ADDR;
+	led_store.store_sector_size = LED_STORE_SECTOR_SIZE;
+	led_store.store_num_sectors = LED_STORE_NUM_SECTORS;
+	led_store.store_holdoff = LED_STORE_HOLDOFF_MS * CLOCK_16M_SYS_TIMER_CLK_1MS;		// clock_time() runs at 16MHz
+	store_status = init_led_store(&led_store);
+	if (led_lib_resumed)
+	{
+		pwm_level = retained.white_level;
+		pwm_up = retained.white_up;
+#if (LED_BEHAVIOR==CYCLE_LEDS)
+		onchip_led_bank.cntr = retained.cntr;
+#elif (LED_BEHAVIOR==COLOR_WHEEL)
+		onchip_led_bank.wheel_hue = retained.wheel_hue;
+#endif
+	}
+	else if (store_status == LED_PROC_ERROR_TYPE_NONE)
+	{
+		restore_led_lib_state();
+	}
+	set_led_num_pwm_brightness(&led_proc, LED_WHITE_NUM, (unsigned short)pwm_level);
+	led_boot_timestamps[LED_BOOT_PHASE_STATE_RESTORED] = clock_time();
+
+	button_proc.button_init = init_button;
+	button_proc.button_read = read_button;
+	button_proc.button_set_edge = set_button_edge;
+	button_proc.button_enter_critical = enter_led_critical;
+	button_proc.button_exit_critical = exit_led_critical;
+	button_proc.button_event_handler = handle_button_event;
+	button_proc.button_debounce_time = BUTTON_DEBOUNCE_MS * CLOCK_16M_SYS_TIMER_CLK_1MS;
+	button_proc.button_long_press_time = BUTTON_LONG_PRESS_MS * CLOCK_16M_SYS_TIMER_CLK_1MS;
+	button_proc.button_multi_click_time = BUTTON_MULTI_CLICK_MS * CLOCK_16M_SYS_TIMER_CLK_1MS;
+	button_proc.button_context = &led_proc;
+	onchip_buttons[BUTTON_SW1_NUM] = sw1_button;
+	init_button_proc(&button_proc, onchip_buttons, NUM_BUTTONS);
+	irq_enable_type(FLD_IRQ_GPIO_EN);
+
+#if (LED_BEHAVIOR==LED_SEQUENCE)
+	init_led_coro_sched(&onchip_led_bank.coro_sched, &led_proc);
+	start_led_coro(&onchip_led_bank.coro_sched, &onchip_led_bank.sequence.coro, run_led_sequence);
+#elif (LED_BEHAVIOR==LED_PATTERN)
+	if (init_led_pattern(&onchip_led_bank.pattern, &led_proc, onchip_led_pattern, sizeof(onchip_led_pattern), LED_TIMER_MS) == LED_PROC_ERROR_TYPE_NONE
+			&& led_lib_resumed)
+	{
+		retained.pattern.led_proc = onchip_led_bank.pattern.led_proc;
+		retained.pattern.pattern_blob = onchip_led_bank.pattern.pattern_blob;
+		retained.pattern.pattern_len = onchip_led_bank.pattern.pattern_len;
+		onchip_led_bank.pattern = retained.pattern;
+	}
+#endif
+	register_led_proc(&led_proc);
+	set_led_tick_irq(1);
 	irq_enable();
+	led_boot_timestamps[LED_BOOT_PHASE_TIMER_STARTED] = clock_time();
+}
+
+led_proc_error_type start_led_lib_trace(struct led_trace_t * trace)
+{
+#if LED_TRACE_ENABLE
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+	unsigned char r;
+
+	if (trace == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (led_lib_trace != NULL)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	for (int i = 0; i < LED_LIB_NUM_TRACKS && status == LED_PROC_ERROR_TYPE_NONE; i++)
+	{
+		// the white LED is traced as its compare, 16 bits covers every period LED_PWM_MIN_STEPS allows
+		status = add_led_trace_track(trace, led_lib_track_names[i], (i == LED_WHITE_NUM) ? 16 : 1);
+	}
+	if (status == LED_PROC_ERROR_TYPE_NONE)
+		status = start_led_trace(trace, clock_time());
+	if (status != LED_PROC_ERROR_TYPE_NONE)
+		return status;
+
+	r = irq_disable();
+	led_lib_trace = trace;
+	led_proc.led_trace = trace_onchip_led;
+	irq_restore(r);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+#else
+	return LED_PROC_ERROR_TYPE_BAD_STATE;
+#endif
+}
+
+led_proc_error_type stop_led_lib_trace()
+{
+#if LED_TRACE_ENABLE
+	struct led_trace_t * trace;
+	unsigned char r = irq_disable();
+
+	trace = led_lib_trace;
+	led_lib_trace = NULL;
+	led_proc.led_trace = NULL;
+	irq_restore(r);
+
+	// ended outside of the mask, the last write can be slow
+	if (trace == NULL)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	return end_led_trace(trace);
+#else
+	return LED_PROC_ERROR_TYPE_BAD_STATE;
+#endif
+}
+
+int get_led_lib_resumed()
+{
+	return led_lib_resumed;
+}
+
+unsigned int get_led_boot_timestamp(led_boot_phase phase)
+{
+	if (phase < 0 || phase >= LED_BOOT_NUM_PHASES)
+		return 0;
+
+	return led_boot_timestamps[phase];
+}
+
+void get_led_isr_stats(led_isr_stats_t * stats)
+{
+	unsigned char r = irq_disable();
+	*stats = led_isr_stats;
+	irq_restore(r);
 }
 
 void run_led_loop()
 {
-	int pwm_dc = 0;
-	int pwm_up = 1;
+	unsigned int fade_tick;
+
 	timer1_set_mode(TIMER_MODE_TICK,0,0);
 	timer_start(TIMER1);
+	fade_tick = reg_tmr1_tick;
 	while(1)
 	{
-		if(reg_tmr1_tick > 50 * CLOCK_SYS_CLOCK_1US * 1000)
+		// Timer1 is left free running, clearing it dropped the time spent in the loop body from every period.
+		// The unsigned difference keeps working when the tick wraps
+		unsigned int fade_elapsed = reg_tmr1_tick - fade_tick;
+		if(fade_elapsed >= LED_FADE_TICK_MS * CLOCK_SYS_CLOCK_1MS)
 		{
-			// PWM on this pin is Inverted, bigger number is dimmer LED
+			trace_led_lib(LED_LIB_TRACK_MAIN_LOOP, 1);
+
+			// step from the deadline so the fade keeps its rate, unless the loop was held up by a whole period
+			// or more, such as by a flash erase, then start again from now rather than catch up in a burst
+			if (fade_elapsed >= 2 * LED_FADE_TICK_MS * CLOCK_SYS_CLOCK_1MS)
+				fade_tick += fade_elapsed;
+			else
+				fade_tick += LED_FADE_TICK_MS * CLOCK_SYS_CLOCK_1MS;
+
+			// 16 bit brightness, the dithering in the PWM frame interrupt keeps the low end of the fade smooth
+			set_led_num_pwm_brightness(&led_proc, LED_WHITE_NUM, (unsigned short)pwm_level);
 			if (pwm_up == 1)
 			{
-				set_led_num_pwm_duty_cycle(&led_proc, LED_WHITE_NUM, pwm_dc);
-				pwm_dc += 1;
-				if (pwm_dc > LED_PWM_DIMMEST)
+				pwm_level += LED_FADE_STEP;
+				if (pwm_level >= LED_PWM_BRIGHTNESS_MAX)
+				{
+					pwm_level = LED_PWM_BRIGHTNESS_MAX;
 					pwm_up = 0;
+#if (LED_BEHAVIOR==LED_SEQUENCE)
+					post_led_coro_event(&onchip_led_bank.coro_sched, LED_CORO_EVENT_FADE_DONE);
+					wake_led_proc_tick(&led_proc);
+#endif
+				}
 			}
 			else
 			{
-				set_led_num_pwm_duty_cycle(&led_proc, LED_WHITE_NUM, pwm_dc);
-				pwm_dc -= 1;
-				if (pwm_dc < LED_PWM_BRIGHTEST)
+				pwm_level -= LED_FADE_STEP;
+				if (pwm_level <= 0)
+				{
+					pwm_level = 0;
 					pwm_up = 1;
+				}
 			}
-			reg_tmr1_tick = 0;
+
+			// the store coalesces these, flash is only written once per LED_STORE_HOLDOFF_MS
+			save_led_lib_state();
+			process_led_store(&led_store, clock_time());
+
+			// only deadlines and queued events, the button pins are never polled
+			process_button_proc(&button_proc, clock_time());
+			trace_led_lib(LED_LIB_TRACK_MAIN_LOOP, 0);
 		}
 	}
 }
@@ -9,8 +9,48 @@
 #define VENDOR_TEL_TEST_LIB_LED_LIB_H_
 
 #include "common.h"
+#include "led_proc.h"
+
+struct led_trace_t;
+
+// boot phases timestamped by init_led_lib, read back with get_led_boot_timestamp
+typedef enum LED_BOOT_PHASES {
+	LED_BOOT_PHASE_START,				// entry of init_led_lib
+	LED_BOOT_PHASE_FIRST_FRAME,			// output LEDs are driven
+	LED_BOOT_PHASE_PWM_STARTED,			// PWM LEDs are running
+	LED_BOOT_PHASE_STATE_RESTORED,		// LED state is restored from flash, or from retention RAM on a resume
+	LED_BOOT_PHASE_TIMER_STARTED,		// Timer0 is running, init is done
+	LED_BOOT_NUM_PHASES
+}led_boot_phase;
+
+// interrupt timing kept by irq_handler, read back with get_led_isr_stats to check it never overruns
+typedef struct led_isr_stats_t {
+	unsigned int isr_count;			// interrupts handled
+	unsigned int isr_max_ticks;		// longest interrupt in clock_time() ticks
+	unsigned int isr_overruns;		// interrupts that ran into the next PWM frame or Timer0 period
+}led_isr_stats_t;
 
 void init_led_lib();
 void run_led_loop();
 
+// keeps the LED state in retention RAM, call right before a deep sleep that keeps it.  init_led_lib then resumes
+// from it on the wake instead of booting from the flash store
+void suspend_led_lib();
+
+// streams the LEDs, every interrupt source and the main loop into a trace, a track each, the trace must have been
+// through init_led_trace and is started here.  Needs LED_TRACE_ENABLE in bsp.h, LED_PROC_ERROR_TYPE_BAD_STATE without
+led_proc_error_type start_led_lib_trace(struct led_trace_t * trace);
+
+// stops feeding the trace and ends it, which flushes what is left
+led_proc_error_type stop_led_lib_trace();
+
+// 1 when the last init_led_lib resumed from retention RAM, to tell the boot timestamps of a resume from a boot
+int get_led_lib_resumed();
+
+// returns the clock_time() tick of a boot phase, subtract two phases to get the time spent between them
+unsigned int get_led_boot_timestamp(led_boot_phase phase);
+
+// copies the interrupt timing, taken with interrupts masked so the fields are consistent
+void get_led_isr_stats(led_isr_stats_t * stats);
+
 #endif /* VENDOR_TEL_TEST_LIB_LED_LIB_H_ */
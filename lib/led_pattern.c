@@ -0,0 +1,214 @@
+/*
+ * led_pattern.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+#include "led_pattern.h"
+
+#ifndef NULL
+#define NULL   ((void *) 0)
+#endif
+
+static int read_led_pattern_byte(struct led_pattern_t * pattern, unsigned char * value)
+{
+	if (pattern->pattern_pc >= pattern->pattern_len)
+		return 0;
+
+	*value = pattern->pattern_blob[pattern->pattern_pc++];
+	return 1;
+}
+
+static int read_led_pattern_number(struct led_pattern_t * pattern, unsigned int * value)
+{
+	unsigned char byte;
+	int shift = 0;
+
+	*value = 0;
+	do
+	{
+		if (shift > 28 || !read_led_pattern_byte(pattern, &byte))
+			return 0;
+		*value |= (unsigned int)(byte & 0x7F) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+
+	return 1;
+}
+
+static led_proc_error_type send_led_pattern_level(struct led_pattern_t * pattern, int led_num)
+{
+	struct led_proc_t * led_proc = pattern->led_proc;
+	unsigned short level = pattern->pattern_level[led_num];
+
+	if (led_proc->led_array[led_num].led_type == LED_TYPE_PWM)
+		return set_led_num_pwm_brightness(led_proc, led_num, level);
+	if (level & 0x8000)
+		return turn_led_num_on(led_proc, led_num);
+
+	return turn_led_num_off(led_proc, led_num);
+}
+
+static led_proc_error_type step_led_pattern_fades(struct led_pattern_t * pattern)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+
+	for (int i = 0; i < pattern->led_proc->num_leds && i < LED_PATTERN_MAX_LEDS; i++)
+	{
+		if (pattern->pattern_fade_ticks[i] == 0)
+			continue;
+
+		pattern->pattern_level[i] = (unsigned short)(pattern->pattern_level[i] + pattern->pattern_step[i]);
+		pattern->pattern_fade_ticks[i]--;
+
+		status = send_led_pattern_level(pattern, i);
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+			return status;
+	}
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type run_led_pattern_op(struct led_pattern_t * pattern)
+{
+	unsigned int op_at = pattern->pattern_pc;
+	unsigned char op;
+	unsigned char level;
+	unsigned int count;
+	unsigned int back;
+	int led_num;
+
+	if (!read_led_pattern_byte(pattern, &op))
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	led_num = op & 0x0F;
+	switch (op & 0xF0)
+	{
+	case 0x00:
+		if (op == LED_PATTERN_OP_END)
+		{
+			pattern->pattern_done = 1;
+			return LED_PROC_ERROR_TYPE_NONE;
+		}
+		if (op != LED_PATTERN_OP_RESTART)
+			return LED_PROC_ERROR_TYPE_BAD_STATE;
+		pattern->pattern_pc = LED_PATTERN_HEADER_SIZE;
+		pattern->pattern_depth = 0;
+		return LED_PROC_ERROR_TYPE_NONE;
+
+	case LED_PATTERN_OP_SET:
+		if (led_num >= pattern->led_proc->num_leds || !read_led_pattern_byte(pattern, &level))
+			return LED_PROC_ERROR_TYPE_BAD_STATE;
+		pattern->pattern_level[led_num] = (unsigned short)(level * 257);
+		pattern->pattern_fade_ticks[led_num] = 0;
+		return send_led_pattern_level(pattern, led_num);
+
+	case LED_PATTERN_OP_FADE:
+		if (led_num >= pattern->led_proc->num_leds || !read_led_pattern_byte(pattern, &level)
+				|| !read_led_pattern_number(pattern, &count) || count == 0)
+			return LED_PROC_ERROR_TYPE_BAD_STATE;
+		// the divide is once per fade, the last step lands exactly on the level
+		pattern->pattern_step[led_num] = ((int)(level * 257) - (int)pattern->pattern_level[led_num]) / (int)count;
+		pattern->pattern_level[led_num] = (unsigned short)((int)(level * 257) - pattern->pattern_step[led_num] * (int)count);
+		pattern->pattern_fade_ticks[led_num] = count;
+		return LED_PROC_ERROR_TYPE_NONE;
+
+	case LED_PATTERN_OP_WAIT:
+		count = op & 0x0F;
+		if (count == 0 && (!read_led_pattern_number(pattern, &count) || count == 0))
+			return LED_PROC_ERROR_TYPE_BAD_STATE;
+		pattern->pattern_wait = count;
+		return LED_PROC_ERROR_TYPE_NONE;
+
+	case LED_PATTERN_OP_REPEAT:
+		if (!read_led_pattern_number(pattern, &back) || !read_led_pattern_number(pattern, &count))
+			return LED_PROC_ERROR_TYPE_BAD_STATE;
+		if (back > op_at - LED_PATTERN_HEADER_SIZE)
+			return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+		// REPEATs nest like brackets, so the innermost one in progress is always on top
+		if (pattern->pattern_depth > 0 && pattern->pattern_loop_at[pattern->pattern_depth - 1] == op_at)
+		{
+			if (--pattern->pattern_loop_left[pattern->pattern_depth - 1] == 0)
+			{
+				pattern->pattern_depth--;
+				return LED_PROC_ERROR_TYPE_NONE;
+			}
+		}
+		else
+		{
+			if (count == 0)
+				return LED_PROC_ERROR_TYPE_NONE;
+			if (pattern->pattern_depth >= LED_PATTERN_MAX_DEPTH)
+				return LED_PROC_ERROR_TYPE_BAD_STATE;
+			pattern->pattern_loop_at[pattern->pattern_depth] = (unsigned short)op_at;
+			pattern->pattern_loop_left[pattern->pattern_depth] = count;
+			pattern->pattern_depth++;
+		}
+		pattern->pattern_pc = op_at - back;
+		return LED_PROC_ERROR_TYPE_NONE;
+
+	default:
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	}
+}
+
+led_proc_error_type init_led_pattern(struct led_pattern_t * pattern, struct led_proc_t * led_proc, const unsigned char * blob, unsigned int len, unsigned int tick_ms)
+{
+	if (pattern == NULL || led_proc == NULL || blob == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (len <= LED_PATTERN_HEADER_SIZE || len > 0xFFFF)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	if (blob[0] != 'L' || blob[1] != 'P' || blob[2] != LED_PATTERN_VERSION)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	if (blob[3] > led_proc->num_leds || blob[3] > LED_PATTERN_MAX_LEDS)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	if ((unsigned int)(blob[4] | (blob[5] << 8)) != tick_ms)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	pattern->led_proc = led_proc;
+	pattern->pattern_blob = blob;
+	pattern->pattern_len = len;
+	pattern->pattern_pc = LED_PATTERN_HEADER_SIZE;
+	pattern->pattern_wait = 0;
+	pattern->pattern_done = 0;
+	pattern->pattern_depth = 0;
+	for (int i = 0; i < LED_PATTERN_MAX_LEDS; i++)
+	{
+		pattern->pattern_level[i] = 0;
+		pattern->pattern_step[i] = 0;
+		pattern->pattern_fade_ticks[i] = 0;
+	}
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type run_led_pattern(struct led_pattern_t * pattern)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+
+	if (pattern->pattern_done)
+		return LED_PROC_ERROR_TYPE_NONE;
+
+	status = step_led_pattern_fades(pattern);
+	if (status != LED_PROC_ERROR_TYPE_NONE)
+		return status;
+
+	if (pattern->pattern_wait > 0 && --pattern->pattern_wait > 0)
+		return LED_PROC_ERROR_TYPE_NONE;
+
+	for (int ops = 0; ops < LED_PATTERN_MAX_OPS; ops++)
+	{
+		status = run_led_pattern_op(pattern);
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+		{
+			pattern->pattern_done = 1;
+			return status;
+		}
+		if (pattern->pattern_wait > 0 || pattern->pattern_done)
+			return LED_PROC_ERROR_TYPE_NONE;
+	}
+
+	// a pattern that never waits would hold up the tick forever
+	pattern->pattern_done = 1;
+	return LED_PROC_ERROR_TYPE_BAD_STATE;
+}
@@ -0,0 +1,93 @@
+/*
+ * led_pattern.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef VENDOR_TEL_TEST_LIB_LED_PATTERN_H_
+#define VENDOR_TEL_TEST_LIB_LED_PATTERN_H_
+
+#include "led_proc.h"
+#include "led_pattern_format.h"
+
+#ifndef LED_PATTERN_MAX_LEDS
+#define LED_PATTERN_MAX_LEDS		8		// at most 16, the LED is the low nibble of SET and FADE
+#endif
+
+
+
+/**************************************************************/
+/**\name	led_pattern_t   		                          */
+/**************************************************************/
+/*!
+ *	@brief This struct plays a pattern blob on the LEDs of a led_proc_t.  The blob is read in place, straight from
+ *	flash on the TLS8258, nothing is unpacked into RAM, the player only keeps where it is and the LEDs that are fading
+ *
+ *	 All of the fields are maintained by the player and should not be touched by the application
+ *
+*/
+typedef struct led_pattern_t {
+	struct led_proc_t * led_proc;
+	const unsigned char * pattern_blob;
+	unsigned int pattern_len;
+	unsigned int pattern_pc;								// offset of the next op
+	unsigned int pattern_wait;								// ticks left of the current WAIT
+	unsigned char pattern_done;
+	unsigned char pattern_depth;
+	unsigned short pattern_loop_at[LED_PATTERN_MAX_DEPTH];	// offset of each REPEAT in progress
+	unsigned int pattern_loop_left[LED_PATTERN_MAX_DEPTH];
+	unsigned short pattern_level[LED_PATTERN_MAX_LEDS];		// 16 bit level of each LED
+	int pattern_step[LED_PATTERN_MAX_LEDS];					// change per tick of a fading LED
+	unsigned int pattern_fade_ticks[LED_PATTERN_MAX_LEDS];	// ticks left of the fade, 0 when not fading
+}led_pattern_t;
+
+
+
+/**************************************************************/
+/**\name	init_led_pattern		                          */
+/**************************************************************/
+/*!
+ *	@brief This function checks the header of a pattern blob and gets the player ready to run it from the start
+ *
+ *	 @param led_pattern_t structure pointer.
+ *	 @param led_proc_t structure pointer.
+ *	 @param const unsigned char pointer - the blob, left where it is
+ *	 @param unsigned int - size of the blob in bytes
+ *	 @param unsigned int - tick the pattern is run at in ms, it must match the tick the blob was compiled for
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of checking the blob
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> not a pattern blob, another version, another tick, or too many LEDs
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type init_led_pattern(struct led_pattern_t * pattern, struct led_proc_t * led_proc, const unsigned char * blob, unsigned int len, unsigned int tick_ms);
+
+
+
+/**************************************************************/
+/**\name	run_led_pattern			                          */
+/**************************************************************/
+/*!
+ *	@brief This function plays one tick of a pattern: it steps the fades, then runs ops until a WAIT or the end.
+ *		Meant to be called from the led_tick of the led_proc_t
+ *
+ *	 @param led_pattern_t structure pointer.
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of playing the tick, on an error the pattern stops
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> the blob is corrupt, or ran LED_PATTERN_MAX_OPS ops without a WAIT
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type run_led_pattern(struct led_pattern_t * pattern);
+
+#endif /* VENDOR_TEL_TEST_LIB_LED_PATTERN_H_ */
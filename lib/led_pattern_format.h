@@ -0,0 +1,40 @@
+/*
+ * led_pattern_format.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef VENDOR_TEL_TEST_LIB_LED_PATTERN_FORMAT_H_
+#define VENDOR_TEL_TEST_LIB_LED_PATTERN_FORMAT_H_
+
+// Shared by the player and tools/led_patc.c, so it must not include anything from the SDK
+
+/******* NOTE! *******
+ * Pattern blobs are made by tools/led_patc.c from a text description, the encoding here and in the tool must be
+ * kept in step, and LED_PATTERN_VERSION bumped on any change.  All multi-byte fields are little endian
+ *
+ *	header		'L' 'P' version num_leds tick_ms(2 bytes)
+ *	0x00		END, the LEDs hold where they are
+ *	0x01		RESTART from the first op after the header
+ *	0x1L lv		SET LED L to level lv, 0 - 255
+ *	0x2L lv n	FADE LED L to level lv over n ticks
+ *	0x3n		WAIT n ticks, 1 - 15
+ *	0x30 n		WAIT n ticks
+ *	0x40 b n	REPEAT, jump back b bytes from this op, n more times
+ *
+ * n and b are variable length, 7 bits per byte with the top bit set on every byte but the last
+ */
+#define LED_PATTERN_VERSION			1
+#define LED_PATTERN_HEADER_SIZE		6
+
+#define LED_PATTERN_OP_END			0x00
+#define LED_PATTERN_OP_RESTART		0x01
+#define LED_PATTERN_OP_SET			0x10
+#define LED_PATTERN_OP_FADE			0x20
+#define LED_PATTERN_OP_WAIT			0x30
+#define LED_PATTERN_OP_REPEAT		0x40
+
+#define LED_PATTERN_MAX_DEPTH		4		// REPEATs that can be nested, the player keeps one entry for each
+#define LED_PATTERN_MAX_OPS			64		// ops run in one tick before a pattern with no WAIT is stopped
+
+#endif /* VENDOR_TEL_TEST_LIB_LED_PATTERN_FORMAT_H_ */
@@ -10,16 +10,185 @@
 #define NULL   ((void *) 0)
 #endif
 
-led_proc_error_type init_led_proc(struct led_proc_t * led_proc, led_t leds[], int num_leds)
+// the dispatch table behind register_led_proc and dispatch_led_proc_tick, the only state led_proc keeps outside of
+// the instances.  Everything else takes its led_proc_dispatch_t, so separate boards can share one process
+static struct led_proc_dispatch_t default_led_proc_dispatch;
+
+static led_output_state_t load_led_output_state(led_t * led)
+{
+#if LED_PROC_HAS_ATOMIC_CAS
+	return (led_output_state_t)__atomic_load_n(&led->led_output_state, __ATOMIC_ACQUIRE);
+#else
+	return (led_output_state_t)led->led_output_state;
+#endif
+}
+
+static void store_led_output_state(led_t * led, led_output_state_t state)
+{
+#if LED_PROC_HAS_ATOMIC_CAS
+	__atomic_store_n(&led->led_output_state, (unsigned char)state, __ATOMIC_RELEASE);
+#else
+	led->led_output_state = (unsigned char)state;
+#endif
+}
+
+// flips the state of an LED and returns the new state, without losing a toggle made by another context
+static led_output_state_t claim_led_toggle(struct led_proc_t * led_proc, led_t * led)
+{
+	led_output_state_t new_state;
+#if LED_PROC_HAS_ATOMIC_CAS
+	unsigned char old_state = __atomic_load_n(&led->led_output_state, __ATOMIC_RELAXED);
+
+	do {
+		new_state = (old_state == LED_ON) ? LED_OFF : LED_ON;
+	} while (!__atomic_compare_exchange_n(&led->led_output_state, &old_state, (unsigned char)new_state,
+			0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+#else
+	unsigned int key = 0;
+
+	if (led_proc->led_enter_critical != NULL)
+		key = led_proc->led_enter_critical();
+	new_state = (load_led_output_state(led) == LED_ON) ? LED_OFF : LED_ON;
+	store_led_output_state(led, new_state);
+	if (led_proc->led_exit_critical != NULL)
+		led_proc->led_exit_critical(key);
+#endif
+	return new_state;
+}
+
+// passes what an LED was just driven to on to the trace hook, see led_trace in led_proc_t
+static void trace_led(struct led_proc_t * led_proc, led_t * led, unsigned int value)
+{
+	if (led_proc->led_trace != NULL)
+		led_proc->led_trace(led_proc, (int)(led - led_proc->led_array), value);
+}
+
+// drives the pin to the state that was just published.  If another context changed the state in the meantime
+// the pin is driven again, so the last pin write always matches the state once everyone is done
+static led_proc_error_type drive_led_output(struct led_proc_t * led_proc, led_t * led, led_output_state_t state)
 {
 	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+	led_output_state_t latest_state;
+
+	while (1)
+	{
+		status = led_proc->led_set_polarity(led, state);
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+			return status;
+		trace_led(led_proc, led, state);
+
+		latest_state = load_led_output_state(led);
+		if (latest_state == state)
+			return LED_PROC_ERROR_TYPE_NONE;
+		state = latest_state;
+	}
+}
+
+// the frame interrupt is only wanted while there is something for run_led_pwm_frame to do, called inside the
+// critical section that hands it the work
+static void request_led_pwm_frames(struct led_proc_t * led_proc, led_t * led)
+{
+	if (led_proc->led_set_frame_irq == NULL || led->led_pwm_state->led_frame_irq_on)
+		return;
+
+	led->led_pwm_state->led_frame_irq_on = 1;
+	led_proc->led_set_frame_irq(led, 1);
+}
+
+// the master and group level of a PWM LED as one Q15 scale, applied with a single multiply where it is written
+static unsigned int get_led_level_scale(struct led_proc_t * led_proc, led_pwm_state_t * pwm_state)
+{
+	unsigned int group = (pwm_state->led_group < LED_PROC_MAX_GROUPS) ? pwm_state->led_group : 0;
+
+	return LED_PROC_LEVEL_FULL - led_proc->led_scale_dim[group];
+}
+
+static unsigned int scale_led_level(unsigned int value, unsigned int scale)
+{
+	return (value * scale + (LED_PROC_LEVEL_FULL / 2)) >> LED_PROC_LEVEL_SHIFT;
+}
+
+// applies the level to the lit part of the duty cycle, which on an inverted pin is the part above the duty cycle
+static int scale_led_duty_cycle(struct led_proc_t * led_proc, led_pwm_state_t * pwm_state, int pwm_dc)
+{
+	unsigned int scale = get_led_level_scale(led_proc, pwm_state);
+
+	if (pwm_state->led_duty_inverted)
+		return LED_PWM_DUTY_MAX - (int)scale_led_level((unsigned int)(LED_PWM_DUTY_MAX - pwm_dc), scale);
+	return (int)scale_led_level((unsigned int)pwm_dc, scale);
+}
+
+static void update_led_level_scale(struct led_proc_t * led_proc, int group)
+{
+	unsigned int scale = scale_led_level(LED_PROC_LEVEL_FULL - led_proc->led_master_dim, LED_PROC_LEVEL_FULL - led_proc->led_group_dim[group]);
+
+	led_proc->led_scale_dim[group] = LED_PROC_LEVEL_FULL - scale;
+}
+
+// a handle is the place of the LED in bits 0 - 15, its led_type_t in bits 16 - 23 and the led_handle_tag of the
+// instance that issued it in bits 24 - 31
+#define LED_HANDLE_NUM_MASK			0xFFFF
+#define LED_HANDLE_TYPE_SHIFT		16
+#define LED_HANDLE_TAG_SHIFT		24
+
+// changes on every init, and is mixed with the address so instances issue different handles.  Never 0, so a zeroed
+// handle is never valid.  The step is odd and steps over 0, so a tag only comes back after 255 inits
+static unsigned char get_next_led_handle_tag(struct led_proc_t * led_proc)
+{
+	unsigned int address = (unsigned int)(unsigned long)led_proc;
+	unsigned char step = (unsigned char)(1 + ((address >> 2) ^ (address >> 10)) * 2);
+	unsigned char tag = (unsigned char)(led_proc->led_handle_tag + step);
+
+	return tag != 0 ? tag : step;
+}
+
+static unsigned int make_led_handle(struct led_proc_t * led_proc, int led_num, led_type_t type)
+{
+	return (unsigned int)led_num | ((unsigned int)type << LED_HANDLE_TYPE_SHIFT) |
+			((unsigned int)led_proc->led_handle_tag << LED_HANDLE_TAG_SHIFT);
+}
+
+#if LED_PROC_CHECK_HANDLES
+// catches a handle from before the last init, of another instance or made up, which are not caught without it
+static led_proc_error_type check_led_handle(struct led_proc_t * led_proc, unsigned int handle, led_type_t type)
+{
+	unsigned int led_num = handle & LED_HANDLE_NUM_MASK;
+
+	if (led_proc == NULL || led_proc->led_array == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if ((handle >> LED_HANDLE_TAG_SHIFT) != led_proc->led_handle_tag || led_num >= (unsigned int)led_proc->num_leds)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	if (((handle >> LED_HANDLE_TYPE_SHIFT) & 0xFF) != (unsigned int)type || led_proc->led_array[led_num].led_type != type)
+		return LED_PROC_ERROR_TYPE_WRONG_TYPE;
+	if (type == LED_TYPE_PWM && led_proc->led_array[led_num].led_pwm_state == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+#define CHECK_LED_HANDLE(led_proc, handle, type)											\
+	do {																					\
+		led_proc_error_type handle_status = check_led_handle(led_proc, handle, type);		\
+		if (handle_status != LED_PROC_ERROR_TYPE_NONE)										\
+			return handle_status;															\
+	} while (0)
+#else
+#define CHECK_LED_HANDLE(led_proc, handle, type)
+#endif
+
+#define LED_OF_HANDLE(led_proc, handle)		(&(led_proc)->led_array[(handle) & LED_HANDLE_NUM_MASK])
+
+static led_proc_error_type check_led_proc(struct led_proc_t * led_proc, led_t leds[], int num_leds)
+{
 	// NULL checks
 	if (led_proc == NULL)
 		return LED_PROC_ERROR_TYPE_NULL;
 	if (leds == NULL)
 		return LED_PROC_ERROR_TYPE_NULL;
-	else if (sizeof(leds) == 0)
+	else if (num_leds <= 0)
 		return LED_PROC_ERROR_TYPE_NULL;
+	if (num_leds > LED_HANDLE_NUM_MASK + 1)		// past what a handle can hold
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
 	if (led_proc->led_init == NULL)
 		return LED_PROC_ERROR_TYPE_NULL;
 	if (led_proc->led_set_polarity == NULL)	//consider making this a warning and not hard returning an error
@@ -29,11 +198,73 @@ led_proc_error_type init_led_proc(struct led_proc_t * led_proc, led_t leds[], in
 	if (led_proc->led_get_state == NULL)
 		return LED_PROC_ERROR_TYPE_NULL;
 
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type init_led_proc(struct led_proc_t * led_proc, led_t leds[], int num_leds)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+
+	status = init_led_proc_fast(led_proc, leds, num_leds);
+	if (status != LED_PROC_ERROR_TYPE_NONE)
+		return status;
+
+	return init_led_proc_deferred(led_proc, leds, num_leds);
+}
+
+led_proc_error_type init_led_proc_fast(struct led_proc_t * led_proc, led_t leds[], int num_leds)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+
+	status = check_led_proc(led_proc, leds, num_leds);
+	if (status != LED_PROC_ERROR_TYPE_NONE)
+		return status;
+
+	led_proc->led_array = leds;
+	led_proc->num_leds = num_leds;
+	led_proc->led_handle_tag = get_next_led_handle_tag(led_proc);
+
+	// batched path, the HAL initializes all of the outputs at once
+	if (led_proc->led_init_outputs != NULL)
+		return led_proc->led_init_outputs(leds, num_leds);
+
+	for (int i = 0; i < num_leds; i++)
+	{
+		if (leds[i].led_type != LED_TYPE_OUTPUT)
+			continue;
+		status = led_proc->led_init(&leds[i]);
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+			return status;
+	}
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type init_led_proc_deferred(struct led_proc_t * led_proc, led_t leds[], int num_leds)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+
+	status = check_led_proc(led_proc, leds, num_leds);
+	if (status != LED_PROC_ERROR_TYPE_NONE)
+		return status;
+
 	for (int i = 0; i < num_leds; i++)
 	{
+		if (leds[i].led_type == LED_TYPE_OUTPUT)
+			continue;
+		if (leds[i].led_type == LED_TYPE_PWM && leds[i].led_pwm_state == NULL)
+			return LED_PROC_ERROR_TYPE_NULL;
 		status = led_proc->led_init(&leds[i]);
 		if (status != LED_PROC_ERROR_TYPE_NONE)
 			return status;
+
+		// a brightness put back by restore_led_proc_snapshot needs its frame interrupt to be dithered again
+		if (leds[i].led_type == LED_TYPE_PWM && leds[i].led_pwm_state->led_dithering && led_proc->led_set_compare != NULL)
+		{
+			status = set_led_pwm_brightness(led_proc, &leds[i], leds[i].led_pwm_state->led_brightness);
+			if (status != LED_PROC_ERROR_TYPE_NONE)
+				return status;
+		}
 	}
 
 	return LED_PROC_ERROR_TYPE_NONE;
@@ -41,7 +272,8 @@ led_proc_error_type init_led_proc(struct led_proc_t * led_proc, led_t leds[], in
 
 led_proc_error_type turn_led_on(struct led_proc_t * led_proc, led_t * led)
 {
-	return led_proc->led_set_polarity(led, LED_ON);
+	store_led_output_state(led, LED_ON);
+	return drive_led_output(led_proc, led, LED_ON);
 }
 
 led_proc_error_type turn_leds_on(struct led_proc_t * led_proc, led_t * leds[], int num_leds)
@@ -65,7 +297,6 @@ led_proc_error_type turn_led_num_on(struct led_proc_t * led_proc, int led_num_in
 	if (led_proc->led_array[led_num_in_array].led_type == LED_TYPE_OUTPUT)
 	{
 		status = turn_led_on(led_proc, &led_proc->led_array[led_num_in_array]);
-		led_proc->led_array[led_num_in_array].led_state.led_output_state = LED_ON;
 	} else {
 		return LED_PROC_ERROR_TYPE_WRONG_TYPE;
 	}
@@ -80,7 +311,7 @@ led_proc_error_type turn_leds_nums_on(struct led_proc_t * led_proc, int led_nums
 	for (int i = 0; i < num_leds; i++)
 	{
 		status = turn_led_num_on(led_proc, led_nums_in_array[i]);
-		led_proc->led_array[led_nums_in_array[i]].led_state.led_output_state = LED_ON;
+		store_led_output_state(&led_proc->led_array[led_nums_in_array[i]], LED_ON);
 		if (status != LED_PROC_ERROR_TYPE_NONE)
 			return status;
 	}
@@ -90,7 +321,8 @@ led_proc_error_type turn_leds_nums_on(struct led_proc_t * led_proc, int led_nums
 
 led_proc_error_type turn_led_off(struct led_proc_t * led_proc, led_t * led)
 {
-	return led_proc->led_set_polarity(led, LED_OFF);
+	store_led_output_state(led, LED_OFF);
+	return drive_led_output(led_proc, led, LED_OFF);
 }
 
 led_proc_error_type turn_leds_off(struct led_proc_t * led_proc, led_t * leds[], int num_leds)
@@ -112,7 +344,6 @@ led_proc_error_type turn_led_num_off(struct led_proc_t * led_proc, int led_num_i
 	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
 
 	status = turn_led_off(led_proc, &led_proc->led_array[led_num_in_array]);
-	led_proc->led_array[led_num_in_array].led_state.led_output_state = LED_OFF;
 
 	return status;
 }
@@ -131,36 +362,50 @@ led_proc_error_type turn_leds_nums_off(struct led_proc_t * led_proc, int led_num
 	return LED_PROC_ERROR_TYPE_NONE;
 }
 
+// reads the pin back until it agrees with the state a toggle claimed, or another context has changed the LED since.
+// Up to LED_PROC_ENSURE_READS times, so a pin that lags its write is waited for rather than driven again
+static led_proc_error_type read_led_toggle(struct led_proc_t * led_proc, led_t * led, led_output_state_t new_state, int * state)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+
+	for (int reads = 0; reads < LED_PROC_ENSURE_READS; reads++)
+	{
+		status = get_led_state(led_proc, led, state);
+		if (status != LED_PROC_ERROR_TYPE_NONE || *state == (int)new_state || load_led_output_state(led) != new_state)
+			break;
+	}
+
+	return status;
+}
+
 led_proc_error_type toggle_led_ensure(struct led_proc_t * led_proc, led_t * led)
 {
 	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
 	int curr_led_state;
+	led_output_state_t new_led_state;
 	status |= get_led_state(led_proc, led, &curr_led_state);
 	if (status != LED_PROC_ERROR_TYPE_NONE)
 		return status;
 
-	if (curr_led_state == LED_ON)
+	// the new state is claimed atomically, so two contexts toggling the same LED both take effect
+	new_led_state = claim_led_toggle(led_proc, led);
+	status = drive_led_output(led_proc, led, new_led_state);
+	status |= read_led_toggle(led_proc, led, new_led_state, &curr_led_state);
+	// still the state this toggle claimed and the pin has had every read to follow.  Either it does not, or another
+	// context was stopped between a stale write and its recheck, which only driving it once more tells apart
+	if (status == LED_PROC_ERROR_TYPE_NONE && curr_led_state != (int)new_led_state && load_led_output_state(led) == new_led_state)
 	{
-		status = turn_led_off(led_proc, led);
-		status |= get_led_state(led_proc, led, &curr_led_state);
-		if (status == LED_PROC_ERROR_TYPE_NONE && curr_led_state == LED_OFF)
-			return LED_PROC_ERROR_TYPE_NONE;
-		else if (curr_led_state != LED_OFF)
-			return LED_PROC_ERROR_TYPE_BAD_STATE;
-		else
-			return status;
+		status = drive_led_output(led_proc, led, new_led_state);
+		status |= read_led_toggle(led_proc, led, new_led_state, &curr_led_state);
 	}
+	if (status == LED_PROC_ERROR_TYPE_NONE && curr_led_state == (int)new_led_state)
+		return LED_PROC_ERROR_TYPE_NONE;
+	else if (status == LED_PROC_ERROR_TYPE_NONE && load_led_output_state(led) != new_led_state)
+		return LED_PROC_ERROR_TYPE_NONE;		// another context changed the LED after this toggle took effect
+	else if (curr_led_state != (int)new_led_state)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
 	else
-	{
-		status = turn_led_on(led_proc, led);
-		status |= get_led_state(led_proc, led, &curr_led_state);
-		if (status == LED_PROC_ERROR_TYPE_NONE && curr_led_state == LED_ON)
-			return LED_PROC_ERROR_TYPE_NONE;
-		else if (curr_led_state != LED_ON)
-			return LED_PROC_ERROR_TYPE_BAD_STATE;
-		else
-			return status;
-	}
+		return status;
 }
 
 led_proc_error_type toggle_leds_ensure(struct led_proc_t * led_proc, led_t * leds[], int num_leds)
@@ -182,13 +427,10 @@ led_proc_error_type toggle_led_num_ensure(struct led_proc_t * led_proc, int led_
 	int curr_led_state;
 	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
 
+	// toggle_led_ensure already keeps led_output_state, writing back what was read here could undo a newer change
 	status = toggle_led_ensure(led_proc, &led_proc->led_array[led_num_in_array]);
 	status |= get_led_num_state(led_proc, led_num_in_array, &curr_led_state);
 
-	// we need to make sure everything went well before we update the state of the led output
-	if (status == LED_PROC_ERROR_TYPE_NONE)
-		led_proc->led_array[led_num_in_array].led_state.led_output_state = (led_output_state_t)curr_led_state;
-
 	return status;
 }
 
@@ -206,51 +448,1115 @@ led_proc_error_type toggle_leds_nums_ensure(struct led_proc_t * led_proc, int le
 	return LED_PROC_ERROR_TYPE_NONE;
 }
 
-led_proc_error_type set_led_pwm_duty_cycle(struct led_proc_t * led_proc, led_t * led, int pwm_dc)
+#define LED_MASK_TOGGLE		2		// for apply_leds_mask, next to LED_OFF and LED_ON
+
+// the selected bits of a word of a mask that are past the LED array
+static unsigned int get_leds_mask_overflow(struct led_proc_t * led_proc, int word, unsigned int bits)
 {
-	return led_proc->led_set_duty_cycle(led, pwm_dc);
+	int leds_in_word = led_proc->num_leds - word * 32;
+
+	if (leds_in_word <= 0)
+		return bits;
+	if (leds_in_word >= 32)
+		return 0;
+	return bits & ~((1u << leds_in_word) - 1);
 }
 
-led_proc_error_type set_leds_pwm_duty_cycle(struct led_proc_t * led_proc, led_t * leds[], int pwm_dc, int num_leds)
+// the place of the lowest selected bit of a word of a mask, which is cleared, so a loop visits only the selected LEDs
+static int take_leds_mask_bit(unsigned int * bits)
+{
+	int bit;
+#if LED_PROC_HAS_CTZ
+	bit = __builtin_ctz(*bits);
+#else
+	unsigned int rest = *bits;
+
+	bit = 0;
+	if ((rest & 0xFFFF) == 0)
+	{
+		rest >>= 16;
+		bit += 16;
+	}
+	if ((rest & 0xFF) == 0)
+	{
+		rest >>= 8;
+		bit += 8;
+	}
+	if ((rest & 0xF) == 0)
+	{
+		rest >>= 4;
+		bit += 4;
+	}
+	if ((rest & 0x3) == 0)
+	{
+		rest >>= 2;
+		bit += 2;
+	}
+	if ((rest & 0x1) == 0)
+		bit += 1;
+#endif
+	*bits &= *bits - 1;
+	return bit;
+}
+
+// the one pass behind the output mask calls.  The state of every selected LED is set first, then the LEDs of each
+// word are driven together through led_set_outputs, or one at a time without it
+static led_proc_error_type apply_leds_mask(struct led_proc_t * led_proc, const unsigned int mask[], unsigned int failed[],
+		int num_words, int action)
 {
 	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+	led_proc_error_type led_status;
+	led_output_state_t state;
 
-	for (int i = 0; i < num_leds; i++)
+	if (led_proc == NULL || mask == NULL || led_proc->led_array == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	for (int word = 0; word < num_words; word++)
 	{
-		status = set_led_pwm_duty_cycle(led_proc, leds[i], pwm_dc);
-		if (status != LED_PROC_ERROR_TYPE_NONE)
-			return status;
+		led_t * leds = &led_proc->led_array[word * 32];
+		unsigned int bad = get_leds_mask_overflow(led_proc, word, mask[word]);
+		unsigned int bits = mask[word] & ~bad;
+		unsigned int driven = 0;
+
+		if (bad != 0 && status == LED_PROC_ERROR_TYPE_NONE)
+			status = LED_PROC_ERROR_TYPE_BAD_STATE;
+
+		while (bits != 0)
+		{
+			int bit = take_leds_mask_bit(&bits);
+
+			if (leds[bit].led_type != LED_TYPE_OUTPUT)
+			{
+				bad |= 1u << bit;
+				if (status == LED_PROC_ERROR_TYPE_NONE)
+					status = LED_PROC_ERROR_TYPE_WRONG_TYPE;
+				continue;
+			}
+
+			if (action == LED_MASK_TOGGLE)
+			{
+				state = claim_led_toggle(led_proc, &leds[bit]);
+			}
+			else
+			{
+				state = (led_output_state_t)action;
+				store_led_output_state(&leds[bit], state);
+			}
+
+			if (led_proc->led_set_outputs != NULL)
+			{
+				driven |= 1u << bit;
+				continue;
+			}
+			led_status = drive_led_output(led_proc, &leds[bit], state);
+			if (led_status != LED_PROC_ERROR_TYPE_NONE)
+			{
+				bad |= 1u << bit;
+				if (status == LED_PROC_ERROR_TYPE_NONE)
+					status = led_status;
+			}
+		}
+
+		if (driven != 0)
+		{
+			int leds_in_word = led_proc->num_leds - word * 32;
+
+			led_status = led_proc->led_set_outputs(leds, leds_in_word < 32 ? leds_in_word : 32, driven);
+			if (led_status != LED_PROC_ERROR_TYPE_NONE)
+			{
+				bad |= driven;
+				if (status == LED_PROC_ERROR_TYPE_NONE)
+					status = led_status;
+			}
+			else if (led_proc->led_trace != NULL)
+			{
+				while (driven != 0)
+				{
+					int bit = take_leds_mask_bit(&driven);
+
+					trace_led(led_proc, &leds[bit], load_led_output_state(&leds[bit]));
+				}
+			}
+		}
+
+		if (failed != NULL)
+			failed[word] = bad;
 	}
 
-	return LED_PROC_ERROR_TYPE_NONE;
+	return status;
 }
 
-led_proc_error_type set_led_num_pwm_duty_cycle(struct led_proc_t * led_proc, int led_num_in_array, int pwm_dc)
+led_proc_error_type turn_leds_mask_on(struct led_proc_t * led_proc, const unsigned int mask[], unsigned int failed[], int num_words)
 {
-	return set_led_pwm_duty_cycle(led_proc, &led_proc->led_array[led_num_in_array], pwm_dc);
+	return apply_leds_mask(led_proc, mask, failed, num_words, LED_ON);
 }
 
-led_proc_error_type set_led_nums_pwm_duty_cycle(struct led_proc_t * led_proc, int led_nums_in_array[], int pwm_dc, int num_leds)
+led_proc_error_type turn_leds_mask_off(struct led_proc_t * led_proc, const unsigned int mask[], unsigned int failed[], int num_words)
+{
+	return apply_leds_mask(led_proc, mask, failed, num_words, LED_OFF);
+}
+
+led_proc_error_type toggle_leds_mask(struct led_proc_t * led_proc, const unsigned int mask[], unsigned int failed[], int num_words)
+{
+	return apply_leds_mask(led_proc, mask, failed, num_words, LED_MASK_TOGGLE);
+}
+
+led_proc_error_type set_leds_mask_pwm_duty_cycle(struct led_proc_t * led_proc, const unsigned int mask[], int pwm_dc, unsigned int failed[], int num_words)
 {
 	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+	led_proc_error_type led_status;
 
-	for (int i = 0; i < num_leds; i++)
+	if (led_proc == NULL || mask == NULL || led_proc->led_array == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	for (int word = 0; word < num_words; word++)
 	{
-		status = set_led_pwm_duty_cycle(led_proc, &led_proc->led_array[led_nums_in_array[i]], pwm_dc);
-		if (status != LED_PROC_ERROR_TYPE_NONE)
-			return status;
+		led_t * leds = &led_proc->led_array[word * 32];
+		unsigned int bad = get_leds_mask_overflow(led_proc, word, mask[word]);
+		unsigned int bits = mask[word] & ~bad;
+
+		if (bad != 0 && status == LED_PROC_ERROR_TYPE_NONE)
+			status = LED_PROC_ERROR_TYPE_BAD_STATE;
+
+		while (bits != 0)
+		{
+			int bit = take_leds_mask_bit(&bits);
+
+			// set_led_pwm_duty_cycle turns down an output LED and a PWM LED with no side table entry
+			led_status = set_led_pwm_duty_cycle(led_proc, &leds[bit], pwm_dc);
+			if (led_status != LED_PROC_ERROR_TYPE_NONE)
+			{
+				bad |= 1u << bit;
+				if (status == LED_PROC_ERROR_TYPE_NONE)
+					status = led_status;
+			}
+		}
+
+		if (failed != NULL)
+			failed[word] = bad;
+	}
+
+	return status;
+}
+
+led_proc_error_type verify_led_outputs(struct led_proc_t * led_proc, unsigned int mismatch[], int num_words)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+
+	if (led_proc == NULL || mismatch == NULL || led_proc->led_verify_outputs == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (num_words < (led_proc->num_leds + 31) / 32)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	for (int i = 0; i < num_words; i++)
+		mismatch[i] = 0;
+
+	status = led_proc->led_verify_outputs(led_proc->led_array, led_proc->num_leds, mismatch);
+	if (status != LED_PROC_ERROR_TYPE_NONE)
+		return status;
+
+	for (int i = 0; i < num_words; i++)
+	{
+		if (mismatch[i] != 0)
+			return LED_PROC_ERROR_TYPE_BAD_STATE;
 	}
 
 	return LED_PROC_ERROR_TYPE_NONE;
 }
 
-led_proc_error_type get_led_state(struct led_proc_t * led_proc, led_t * led, int * led_state)
+// the duty cycle write behind set_led_pwm_duty_cycle and set_led_handle_duty_cycle.  The LED must be a PWM LED with
+// a led_pwm_state, which the callers check, or a handle vouches for
+static led_proc_error_type write_led_pwm_duty_cycle(struct led_proc_t * led_proc, led_t * led, int pwm_dc)
 {
-	return led_proc->led_get_state(led, led_state);
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+
+	// the duty cycle is kept at full scale, only what reaches the HAL has the master and group level applied
+	led->led_pwm_state->led_dithering = 0;
+	led->led_pwm_state->led_duty_cycle = pwm_dc;
+	if (pwm_dc >= 0 && pwm_dc <= LED_PWM_DUTY_MAX)
+		pwm_dc = scale_led_duty_cycle(led_proc, led->led_pwm_state, pwm_dc);
+	status = led_proc->led_set_duty_cycle(led, pwm_dc);
+	if (status == LED_PROC_ERROR_TYPE_NONE)
+		trace_led(led_proc, led, get_led_pwm_duty_cycles(&led->led_pwm_state->led_pwm_timing, pwm_dc));
+
+	return status;
 }
 
-led_proc_error_type get_led_num_state(struct led_proc_t * led_proc, int led_num_in_array, int * led_state)
+// the same for set_led_pwm_brightness and set_led_handle_brightness.  The callers also check led_set_compare, a
+// handle does not vouch for the hooks of the instance.  The period is checked here, a retune can change it
+static led_proc_error_type write_led_pwm_brightness(struct led_proc_t * led_proc, led_t * led, unsigned short brightness)
 {
-	return get_led_state(led_proc, &led_proc->led_array[led_num_in_array], led_state);
+	led_pwm_state_t * pwm_state = led->led_pwm_state;
+	unsigned int key = 0;
+
+	if (pwm_state->led_pwm_timing.cycles > LED_PWM_BRIGHTNESS_MAX)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	// a retune in the frame interrupt rescales the target, so it must not land between reading the period and
+	// writing the target
+	if (led_proc->led_enter_critical != NULL)
+		key = led_proc->led_enter_critical();
+
+	pwm_state->led_brightness = brightness;
+	pwm_state->led_dither_target = scale_led_level(brightness, get_led_level_scale(led_proc, pwm_state)) * pwm_state->led_pwm_timing.cycles;
+	pwm_state->led_dithering = 1;
+	request_led_pwm_frames(led_proc, led);
+
+	if (led_proc->led_exit_critical != NULL)
+		led_proc->led_exit_critical(key);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type get_led_output_handle(struct led_proc_t * led_proc, int led_num_in_array, led_output_handle_t * handle)
+{
+	if (led_proc == NULL || handle == NULL || led_proc->led_array == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (led_num_in_array < 0 || led_num_in_array >= led_proc->num_leds)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	if (led_proc->led_array[led_num_in_array].led_type != LED_TYPE_OUTPUT)
+		return LED_PROC_ERROR_TYPE_WRONG_TYPE;
+
+	handle->handle = make_led_handle(led_proc, led_num_in_array, LED_TYPE_OUTPUT);
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type get_led_pwm_handle(struct led_proc_t * led_proc, int led_num_in_array, led_pwm_handle_t * handle)
+{
+	if (led_proc == NULL || handle == NULL || led_proc->led_array == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (led_num_in_array < 0 || led_num_in_array >= led_proc->num_leds)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	if (led_proc->led_array[led_num_in_array].led_type != LED_TYPE_PWM)
+		return LED_PROC_ERROR_TYPE_WRONG_TYPE;
+	if (led_proc->led_array[led_num_in_array].led_pwm_state == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	handle->handle = make_led_handle(led_proc, led_num_in_array, LED_TYPE_PWM);
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type turn_led_handle_on(struct led_proc_t * led_proc, led_output_handle_t handle)
+{
+	CHECK_LED_HANDLE(led_proc, handle.handle, LED_TYPE_OUTPUT);
+	return turn_led_on(led_proc, LED_OF_HANDLE(led_proc, handle.handle));
+}
+
+led_proc_error_type turn_led_handle_off(struct led_proc_t * led_proc, led_output_handle_t handle)
+{
+	CHECK_LED_HANDLE(led_proc, handle.handle, LED_TYPE_OUTPUT);
+	return turn_led_off(led_proc, LED_OF_HANDLE(led_proc, handle.handle));
+}
+
+led_proc_error_type toggle_led_handle(struct led_proc_t * led_proc, led_output_handle_t handle)
+{
+	led_t * led;
+
+	CHECK_LED_HANDLE(led_proc, handle.handle, LED_TYPE_OUTPUT);
+	led = LED_OF_HANDLE(led_proc, handle.handle);
+	return drive_led_output(led_proc, led, claim_led_toggle(led_proc, led));
+}
+
+led_proc_error_type set_led_handle_duty_cycle(struct led_proc_t * led_proc, led_pwm_handle_t handle, int pwm_dc)
+{
+	CHECK_LED_HANDLE(led_proc, handle.handle, LED_TYPE_PWM);
+	return write_led_pwm_duty_cycle(led_proc, LED_OF_HANDLE(led_proc, handle.handle), pwm_dc);
+}
+
+led_proc_error_type set_led_handle_brightness(struct led_proc_t * led_proc, led_pwm_handle_t handle, unsigned short brightness)
+{
+	CHECK_LED_HANDLE(led_proc, handle.handle, LED_TYPE_PWM);
+	if (led_proc->led_set_compare == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	return write_led_pwm_brightness(led_proc, LED_OF_HANDLE(led_proc, handle.handle), brightness);
+}
+
+led_proc_error_type set_led_pwm_duty_cycle(struct led_proc_t * led_proc, led_t * led, int pwm_dc)
+{
+	// the HAL reaches the PWM channel through led_pwm_state, which an output LED does not have
+	if (led->led_type != LED_TYPE_PWM)
+		return LED_PROC_ERROR_TYPE_WRONG_TYPE;
+	if (led->led_pwm_state == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	return write_led_pwm_duty_cycle(led_proc, led, pwm_dc);
 }
 
+led_proc_error_type set_leds_pwm_duty_cycle(struct led_proc_t * led_proc, led_t * leds[], int pwm_dc, int num_leds)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+
+	for (int i = 0; i < num_leds; i++)
+	{
+		status = set_led_pwm_duty_cycle(led_proc, leds[i], pwm_dc);
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+			return status;
+	}
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type set_led_num_pwm_duty_cycle(struct led_proc_t * led_proc, int led_num_in_array, int pwm_dc)
+{
+	return set_led_pwm_duty_cycle(led_proc, &led_proc->led_array[led_num_in_array], pwm_dc);
+}
+
+led_proc_error_type set_led_nums_pwm_duty_cycle(struct led_proc_t * led_proc, int led_nums_in_array[], int pwm_dc, int num_leds)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+
+	for (int i = 0; i < num_leds; i++)
+	{
+		status = set_led_pwm_duty_cycle(led_proc, &led_proc->led_array[led_nums_in_array[i]], pwm_dc);
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+			return status;
+	}
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type set_led_pwm_brightness(struct led_proc_t * led_proc, led_t * led, unsigned short brightness)
+{
+	if (led_proc->led_set_compare == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (led->led_type != LED_TYPE_PWM)
+		return LED_PROC_ERROR_TYPE_WRONG_TYPE;
+	if (led->led_pwm_state == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	return write_led_pwm_brightness(led_proc, led, brightness);
+}
+
+led_proc_error_type set_led_num_pwm_brightness(struct led_proc_t * led_proc, int led_num_in_array, unsigned short brightness)
+{
+	return set_led_pwm_brightness(led_proc, &led_proc->led_array[led_num_in_array], brightness);
+}
+
+led_proc_error_type get_led_pwm_timing(unsigned int clock_hz, unsigned int hertz, unsigned int min_steps, led_pwm_timing_t * timing)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+	unsigned int cycles;
+
+	if (timing == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (hertz == 0 || hertz > clock_hz)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	// nearest whole number of counts, the only divides are here so the hot paths are a multiply and a shift
+	cycles = (clock_hz + hertz / 2) / hertz;
+	if (cycles > LED_PWM_MAX_CYCLES)
+	{
+		cycles = LED_PWM_MAX_CYCLES;
+		status = LED_PROC_ERROR_TYPE_BAD_STATE;
+	}
+
+	timing->cycles = cycles;
+	timing->hertz = (clock_hz + cycles / 2) / cycles;
+	timing->duty_scale = ((cycles << 16) + (LED_PWM_DUTY_MAX / 2)) / LED_PWM_DUTY_MAX;
+	timing->resolution_bits = 0;
+	while (timing->resolution_bits < 31 && (2u << timing->resolution_bits) <= cycles)
+		timing->resolution_bits++;
+
+	if (cycles < min_steps)
+		status = LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	return status;
+}
+
+unsigned int get_led_pwm_duty_cycles(led_pwm_timing_t * timing, int pwm_dc)
+{
+	if (pwm_dc <= 0)
+		return 0;
+	if (pwm_dc >= LED_PWM_DUTY_MAX)
+		return timing->cycles;
+
+	// duty_scale is under 2^26, so this stays inside 32 bits for the whole duty range
+	return ((unsigned int)pwm_dc * timing->duty_scale + 0x8000) >> 16;
+}
+
+led_proc_error_type retune_led_pwm(struct led_proc_t * led_proc, led_t * led, led_pwm_timing_t * timing)
+{
+	led_pwm_state_t * pwm_state = led->led_pwm_state;
+	unsigned int key = 0;
+
+	if (led_proc->led_set_cycles == NULL || timing == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (led->led_type != LED_TYPE_PWM)
+		return LED_PROC_ERROR_TYPE_WRONG_TYPE;
+	if (pwm_state == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (timing->cycles == 0 || timing->cycles > LED_PWM_MAX_CYCLES)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	// the frame interrupt takes the retune as soon as cycles is set, so the whole timing goes in at once
+	if (led_proc->led_enter_critical != NULL)
+		key = led_proc->led_enter_critical();
+
+	pwm_state->led_pwm_retune = *timing;
+	request_led_pwm_frames(led_proc, led);
+
+	if (led_proc->led_exit_critical != NULL)
+		led_proc->led_exit_critical(key);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type retune_led_num_pwm(struct led_proc_t * led_proc, int led_num_in_array, led_pwm_timing_t * timing)
+{
+	return retune_led_pwm(led_proc, &led_proc->led_array[led_num_in_array], timing);
+}
+
+led_proc_error_type run_led_pwm_frame(struct led_proc_t * led_proc, led_t * led)
+{
+	led_pwm_state_t * pwm_state = led->led_pwm_state;
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+	unsigned int target;
+	unsigned short acc;
+	unsigned int compare;
+	int useful = 0;
+
+	if (pwm_state == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	pwm_state->led_frame_stats.irq_taken++;
+
+	// called at the start of a frame, the period and compare written here are both picked up at the next one
+	if (pwm_state->led_pwm_retune.cycles != 0)
+	{
+		pwm_state->led_pwm_timing = pwm_state->led_pwm_retune;
+		pwm_state->led_pwm_retune.cycles = 0;
+		pwm_state->led_dither_target = scale_led_level(pwm_state->led_brightness, get_led_level_scale(led_proc, pwm_state)) * pwm_state->led_pwm_timing.cycles;
+		useful = 1;
+
+		status = led_proc->led_set_cycles(led, pwm_state->led_pwm_timing.cycles);
+		if (status == LED_PROC_ERROR_TYPE_NONE && !pwm_state->led_dithering)
+		{
+			int pwm_dc = pwm_state->led_duty_cycle;
+			if (pwm_dc >= 0 && pwm_dc <= LED_PWM_DUTY_MAX)
+				pwm_dc = scale_led_duty_cycle(led_proc, pwm_state, pwm_dc);
+			status = led_proc->led_set_duty_cycle(led, pwm_dc);
+			trace_led(led_proc, led, get_led_pwm_duty_cycles(&pwm_state->led_pwm_timing, pwm_dc));
+		}
+	}
+
+	if (status == LED_PROC_ERROR_TYPE_NONE && pwm_state->led_dithering)
+	{
+		// first order sigma-delta, one extra count whenever the fractional part carries out of the accumulator
+		target = pwm_state->led_dither_target;
+		acc = (unsigned short)(pwm_state->led_dither_acc + (target & 0xFFFF));
+		compare = (target >> 16) + (acc < pwm_state->led_dither_acc);
+		pwm_state->led_dither_acc = acc;
+
+		if (compare != pwm_state->led_compare)
+			useful = 1;
+		pwm_state->led_compare = (unsigned short)compare;
+		status = led_proc->led_set_compare(led, compare);
+		trace_led(led_proc, led, compare);
+	}
+
+	if (useful)
+		pwm_state->led_frame_stats.irq_useful++;
+
+	// with no fraction left the compare is the same every frame, so the interrupt is not needed until the next
+	// brightness or retune
+	if (led_proc->led_set_frame_irq != NULL && pwm_state->led_pwm_retune.cycles == 0
+			&& (!pwm_state->led_dithering || (pwm_state->led_dither_target & 0xFFFF) == 0))
+	{
+		pwm_state->led_frame_irq_on = 0;
+		led_proc->led_set_frame_irq(led, 0);
+	}
+
+	return status;
+}
+
+led_proc_error_type run_led_num_pwm_frame(struct led_proc_t * led_proc, int led_num_in_array)
+{
+	return run_led_pwm_frame(led_proc, &led_proc->led_array[led_num_in_array]);
+}
+
+led_proc_error_type get_led_state(struct led_proc_t * led_proc, led_t * led, int * led_state)
+{
+	return led_proc->led_get_state(led, led_state);
+}
+
+led_proc_error_type get_led_num_state(struct led_proc_t * led_proc, int led_num_in_array, int * led_state)
+{
+	return get_led_state(led_proc, &led_proc->led_array[led_num_in_array], led_state);
+}
+
+static int find_led_blink(struct led_proc_t * led_proc, int led_num)
+{
+	for (int i = 0; i < LED_PROC_MAX_BLINKS; i++)
+	{
+		if (led_proc->led_blinks[i].blink_period_ms != 0 && led_proc->led_blinks[i].blink_led_num == led_num)
+			return i;
+	}
+
+	return -1;
+}
+
+static void remove_led_blink(struct led_proc_t * led_proc, int led_num)
+{
+	unsigned int key = 0;
+	int entry;
+
+	if (led_proc->led_enter_critical != NULL)
+		key = led_proc->led_enter_critical();
+
+	entry = find_led_blink(led_proc, led_num);
+	if (entry >= 0)
+	{
+		led_proc->led_blinks[entry].blink_period_ms = 0;
+		led_proc->led_num_blinks--;
+	}
+
+	if (led_proc->led_exit_critical != NULL)
+		led_proc->led_exit_critical(key);
+}
+
+// drives a blink to where its phase is, returns 1 when the LED had to change
+static int drive_led_blink(struct led_proc_t * led_proc, led_blink_t * blink)
+{
+	led_t * led = &led_proc->led_array[blink->blink_led_num];
+	led_output_state_t state = (blink->blink_phase_ms < blink->blink_on_ms) ? LED_ON : LED_OFF;
+
+	if (load_led_output_state(led) == state)
+		return 0;
+
+	if (state == LED_ON)
+		turn_led_on(led_proc, led);
+	else
+		turn_led_off(led_proc, led);
+
+	return 1;
+}
+
+static int step_led_blinks(struct led_proc_t * led_proc, unsigned int elapsed_ms)
+{
+	int edges = 0;
+
+	for (int i = 0; i < LED_PROC_MAX_BLINKS; i++)
+	{
+		led_blink_t * blink = &led_proc->led_blinks[i];
+		if (blink->blink_period_ms == 0)
+			continue;
+
+		blink->blink_phase_ms += elapsed_ms;
+		if (blink->blink_phase_ms >= blink->blink_period_ms)
+			blink->blink_phase_ms %= blink->blink_period_ms;
+		edges += drive_led_blink(led_proc, blink);
+	}
+
+	return edges;
+}
+
+led_proc_error_type blink_led(struct led_proc_t * led_proc, led_t * led, unsigned int period_ms, unsigned int on_ms)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+	int led_num = (int)(led - led_proc->led_array);
+	led_blink_t * blink = NULL;
+	unsigned int key = 0;
+	int entry;
+
+	if (period_ms == 0 || led_num < 0 || led_num >= led_proc->num_leds)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	if (on_ms > period_ms)
+		on_ms = period_ms;
+
+	if ((led_proc->led_caps & LED_PROC_CAP_HW_BLINK) && led_proc->led_set_blink != NULL)
+	{
+		status = led_proc->led_set_blink(led, period_ms, on_ms);
+		if (status == LED_PROC_ERROR_TYPE_NONE)
+		{
+			// the hardware has it now, a blink left in the table would fight it
+			remove_led_blink(led_proc, led_num);
+			return LED_PROC_ERROR_TYPE_NONE;
+		}
+		if (status != LED_PROC_ERROR_TYPE_WRONG_TYPE && status != LED_PROC_ERROR_TYPE_BAD_STATE)
+			return status;
+
+		// the hardware cannot take this one, and must not be left blinking it from before
+		led_proc->led_set_blink(led, 0, 0);
+	}
+
+	if (led->led_type != LED_TYPE_OUTPUT)
+		return LED_PROC_ERROR_TYPE_WRONG_TYPE;
+
+	if (led_proc->led_enter_critical != NULL)
+		key = led_proc->led_enter_critical();
+
+	entry = find_led_blink(led_proc, led_num);
+	for (int i = 0; entry < 0 && i < LED_PROC_MAX_BLINKS; i++)
+	{
+		if (led_proc->led_blinks[i].blink_period_ms == 0)
+		{
+			entry = i;
+			led_proc->led_num_blinks++;
+		}
+	}
+	if (entry >= 0)
+	{
+		blink = &led_proc->led_blinks[entry];
+		blink->blink_led_num = led_num;
+		blink->blink_on_ms = on_ms;
+		blink->blink_phase_ms = 0;
+		blink->blink_period_ms = period_ms;
+	}
+
+	if (led_proc->led_exit_critical != NULL)
+		led_proc->led_exit_critical(key);
+
+	if (blink == NULL)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	// the tick may have been stopped with nothing to do
+	if (led_proc->led_set_tick_irq != NULL)
+		led_proc->led_set_tick_irq(1);
+	drive_led_blink(led_proc, blink);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type blink_led_num(struct led_proc_t * led_proc, int led_num_in_array, unsigned int period_ms, unsigned int on_ms)
+{
+	return blink_led(led_proc, &led_proc->led_array[led_num_in_array], period_ms, on_ms);
+}
+
+led_proc_error_type stop_led_blink(struct led_proc_t * led_proc, led_t * led)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+
+	remove_led_blink(led_proc, (int)(led - led_proc->led_array));
+
+	if ((led_proc->led_caps & LED_PROC_CAP_HW_BLINK) && led_proc->led_set_blink != NULL)
+	{
+		status = led_proc->led_set_blink(led, 0, 0);
+		if (status == LED_PROC_ERROR_TYPE_WRONG_TYPE || status == LED_PROC_ERROR_TYPE_BAD_STATE)
+			status = LED_PROC_ERROR_TYPE_NONE;
+	}
+
+	return status;
+}
+
+led_proc_error_type stop_led_num_blink(struct led_proc_t * led_proc, int led_num_in_array)
+{
+	return stop_led_blink(led_proc, &led_proc->led_array[led_num_in_array]);
+}
+
+led_proc_error_type register_led_proc_dispatch(struct led_proc_dispatch_t * dispatch, struct led_proc_t * led_proc)
+{
+	unsigned int key = 0;
+
+	if (dispatch == NULL || led_proc == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (led_proc->led_tick == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (led_proc->led_tick_period_ms == 0)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	for (int i = 0; i < dispatch->dispatch_num_instances; i++)
+	{
+		if (dispatch->dispatch_instances[i] == led_proc)
+			return LED_PROC_ERROR_TYPE_NONE;
+	}
+	if (dispatch->dispatch_num_instances >= LED_PROC_MAX_INSTANCES)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	led_proc->led_tick_countdown_ms = (int)led_proc->led_tick_period_ms;
+
+	if (led_proc->led_enter_critical != NULL)
+		key = led_proc->led_enter_critical();
+	dispatch->dispatch_instances[dispatch->dispatch_num_instances] = led_proc;
+	dispatch->dispatch_num_instances++;
+	if (led_proc->led_exit_critical != NULL)
+		led_proc->led_exit_critical(key);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type unregister_led_proc_dispatch(struct led_proc_dispatch_t * dispatch, struct led_proc_t * led_proc)
+{
+	unsigned int key = 0;
+
+	if (dispatch == NULL || led_proc == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	if (led_proc->led_enter_critical != NULL)
+		key = led_proc->led_enter_critical();
+	for (int i = 0; i < dispatch->dispatch_num_instances; i++)
+	{
+		if (dispatch->dispatch_instances[i] != led_proc)
+			continue;
+
+		// keep the table packed, the order of the instances does not matter
+		dispatch->dispatch_num_instances--;
+		dispatch->dispatch_instances[i] = dispatch->dispatch_instances[dispatch->dispatch_num_instances];
+		break;
+	}
+	if (led_proc->led_exit_critical != NULL)
+		led_proc->led_exit_critical(key);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+void run_led_proc_dispatch(struct led_proc_dispatch_t * dispatch, unsigned int elapsed_ms)
+{
+	int busy = 0;
+
+	for (int i = 0; i < dispatch->dispatch_num_instances; i++)
+	{
+		struct led_proc_t * led_proc = dispatch->dispatch_instances[i];
+		int useful = 0;
+
+		led_proc->led_tick_stats.irq_taken++;
+		if (led_proc->led_levels_dirty != 0)
+		{
+			commit_led_proc_levels(led_proc);
+			useful = 1;
+		}
+		if (led_proc->led_num_blinks > 0)
+		{
+			if (step_led_blinks(led_proc, elapsed_ms) > 0)
+				useful = 1;
+			busy = 1;
+		}
+
+		if (!led_proc->led_tick_idle)
+		{
+			led_proc->led_tick_countdown_ms -= (int)elapsed_ms;
+			if (led_proc->led_tick_countdown_ms <= 0)
+			{
+				// reload from the overshoot so the rate stays exact, but never queue up a burst of ticks
+				led_proc->led_tick_countdown_ms += (int)led_proc->led_tick_period_ms;
+				if (led_proc->led_tick_countdown_ms <= 0)
+					led_proc->led_tick_countdown_ms = (int)led_proc->led_tick_period_ms;
+				useful = 1;
+				led_proc->led_tick(led_proc);
+			}
+			if (!led_proc->led_tick_idle)
+				busy = 1;
+		}
+
+		if (useful)
+			led_proc->led_tick_stats.irq_useful++;
+	}
+
+	if (busy)
+		return;
+
+	// nothing is due anywhere, the tick stays stopped until wake_led_proc_tick
+	for (int i = 0; i < dispatch->dispatch_num_instances; i++)
+	{
+		if (dispatch->dispatch_instances[i]->led_set_tick_irq != NULL)
+			dispatch->dispatch_instances[i]->led_set_tick_irq(0);
+	}
+}
+
+led_proc_error_type register_led_proc(struct led_proc_t * led_proc)
+{
+	return register_led_proc_dispatch(&default_led_proc_dispatch, led_proc);
+}
+
+led_proc_error_type unregister_led_proc(struct led_proc_t * led_proc)
+{
+	return unregister_led_proc_dispatch(&default_led_proc_dispatch, led_proc);
+}
+
+void dispatch_led_proc_tick(unsigned int elapsed_ms)
+{
+	run_led_proc_dispatch(&default_led_proc_dispatch, elapsed_ms);
+}
+
+void set_led_proc_tick_idle(struct led_proc_t * led_proc)
+{
+	led_proc->led_tick_idle = 1;
+}
+
+void wake_led_proc_tick(struct led_proc_t * led_proc)
+{
+	unsigned int key = 0;
+
+	if (led_proc->led_enter_critical != NULL)
+		key = led_proc->led_enter_critical();
+
+	if (led_proc->led_tick_idle)
+	{
+		led_proc->led_tick_idle = 0;
+		led_proc->led_tick_countdown_ms = (int)led_proc->led_tick_period_ms;
+		if (led_proc->led_set_tick_irq != NULL)
+			led_proc->led_set_tick_irq(1);
+	}
+
+	if (led_proc->led_exit_critical != NULL)
+		led_proc->led_exit_critical(key);
+}
+
+led_proc_error_type set_led_proc_master_level(struct led_proc_t * led_proc, unsigned int level)
+{
+	unsigned int key = 0;
+
+	if (led_proc == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (level > LED_PROC_LEVEL_FULL)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	// only the level and the scale of each group change here, the LEDs are left to commit_led_proc_levels
+	if (led_proc->led_enter_critical != NULL)
+		key = led_proc->led_enter_critical();
+
+	led_proc->led_master_dim = LED_PROC_LEVEL_FULL - level;
+	for (int i = 0; i < LED_PROC_MAX_GROUPS; i++)
+		update_led_level_scale(led_proc, i);
+	led_proc->led_levels_dirty = ~0u;
+
+	if (led_proc->led_exit_critical != NULL)
+		led_proc->led_exit_critical(key);
+
+	if (led_proc->led_set_tick_irq != NULL)
+		led_proc->led_set_tick_irq(1);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type set_led_proc_group_level(struct led_proc_t * led_proc, int group, unsigned int level)
+{
+	unsigned int key = 0;
+
+	if (led_proc == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (group < 0 || group >= LED_PROC_MAX_GROUPS || level > LED_PROC_LEVEL_FULL)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	if (led_proc->led_enter_critical != NULL)
+		key = led_proc->led_enter_critical();
+
+	led_proc->led_group_dim[group] = LED_PROC_LEVEL_FULL - level;
+	update_led_level_scale(led_proc, group);
+	led_proc->led_levels_dirty |= 1u << group;
+
+	if (led_proc->led_exit_critical != NULL)
+		led_proc->led_exit_critical(key);
+
+	if (led_proc->led_set_tick_irq != NULL)
+		led_proc->led_set_tick_irq(1);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type commit_led_proc_levels(struct led_proc_t * led_proc)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+	led_proc_error_type led_status;
+	led_pwm_state_t * pwm_state;
+	unsigned int dirty;
+	unsigned int key = 0;
+
+	if (led_proc == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	// taken and cleared together, a level set while the LEDs are being rewritten is left for the next commit
+	if (led_proc->led_enter_critical != NULL)
+		key = led_proc->led_enter_critical();
+	dirty = led_proc->led_levels_dirty;
+	led_proc->led_levels_dirty = 0;
+	if (led_proc->led_exit_critical != NULL)
+		led_proc->led_exit_critical(key);
+
+	if (dirty == 0)
+		return LED_PROC_ERROR_TYPE_NONE;
+
+	for (int i = 0; i < led_proc->num_leds; i++)
+	{
+		led_t * led = &led_proc->led_array[i];
+
+		pwm_state = led->led_pwm_state;
+		if (led->led_type != LED_TYPE_PWM || pwm_state == NULL)
+			continue;
+		if (!(dirty & (1u << ((pwm_state->led_group < LED_PROC_MAX_GROUPS) ? pwm_state->led_group : 0))))
+			continue;
+
+		if (pwm_state->led_dithering)
+			led_status = set_led_pwm_brightness(led_proc, led, pwm_state->led_brightness);
+		else
+			led_status = set_led_pwm_duty_cycle(led_proc, led, pwm_state->led_duty_cycle);
+		if (status == LED_PROC_ERROR_TYPE_NONE)
+			status = led_status;
+	}
+
+	return status;
+}
+
+static void copy_led_snapshot_bytes(void * to, const void * from, unsigned int len)
+{
+	unsigned char * to_bytes = (unsigned char *)to;
+	const unsigned char * from_bytes = (const unsigned char *)from;
+
+	for (unsigned int i = 0; i < len; i++)
+		to_bytes[i] = from_bytes[i];
+}
+
+static unsigned int get_led_snapshot_check(const led_snapshot_t * snap)
+{
+	const unsigned char * bytes = (const unsigned char *)snap;
+	unsigned int check = 5381;
+
+	// snap_check is the last field and every field before it packs without padding, so no stray bytes are covered
+	for (unsigned int i = 0; i < sizeof(led_snapshot_t) - sizeof(snap->snap_check); i++)
+		check = (check << 5) + check + bytes[i];
+
+	return check;
+}
+
+led_proc_error_type save_led_proc_snapshot(struct led_proc_t * led_proc, led_snapshot_t * snap, unsigned char app_version, const void * app_state, unsigned int app_len)
+{
+	led_pwm_state_t * pwm_state;
+	unsigned int key = 0;
+	int num_pwm = 0;
+	int too_many_pwm = 0;
+
+	if (led_proc == NULL || snap == NULL || (app_state == NULL && app_len != 0))
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	snap->snap_magic = 0;
+	if (led_proc->num_leds > LED_SNAPSHOT_MAX_LEDS || app_len > LED_SNAPSHOT_APP_SIZE)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	snap->snap_version = LED_SNAPSHOT_VERSION;
+	snap->snap_num_leds = (unsigned char)led_proc->num_leds;
+	snap->snap_outputs = 0;
+	snap->snap_master_dim = led_proc->led_master_dim;
+	for (int i = 0; i < LED_PROC_MAX_GROUPS; i++)
+		snap->snap_group_dim[i] = led_proc->led_group_dim[i];
+	for (int i = 0; i < LED_SNAPSHOT_MAX_PWM; i++)
+	{
+		snap->snap_pwm[i].pwm_hertz = 0;
+		snap->snap_pwm[i].pwm_brightness = 0;
+		snap->snap_pwm[i].pwm_duty_cycle = 0;
+		snap->snap_pwm[i].pwm_dithering = 0;
+	}
+
+	if (led_proc->led_enter_critical != NULL)
+		key = led_proc->led_enter_critical();
+
+	for (int i = 0; i < led_proc->num_leds; i++)
+	{
+		led_t * led = &led_proc->led_array[i];
+
+		if (led->led_type == LED_TYPE_OUTPUT && load_led_output_state(led) == LED_ON)
+			snap->snap_outputs |= 1u << i;
+		if (led->led_type != LED_TYPE_PWM || led->led_pwm_state == NULL)
+			continue;
+		if (num_pwm >= LED_SNAPSHOT_MAX_PWM)
+		{
+			too_many_pwm = 1;
+			continue;
+		}
+
+		// a retune still waiting for its frame is kept as though it had landed
+		pwm_state = led->led_pwm_state;
+		snap->snap_pwm[num_pwm].pwm_hertz = (pwm_state->led_pwm_retune.cycles != 0) ? pwm_state->led_pwm_retune.hertz : pwm_state->led_pwm_timing.hertz;
+		snap->snap_pwm[num_pwm].pwm_brightness = pwm_state->led_brightness;
+		snap->snap_pwm[num_pwm].pwm_duty_cycle = (unsigned char)pwm_state->led_duty_cycle;
+		snap->snap_pwm[num_pwm].pwm_dithering = pwm_state->led_dithering;
+		num_pwm++;
+	}
+	copy_led_snapshot_bytes(snap->snap_blinks, led_proc->led_blinks, sizeof(snap->snap_blinks));
+	snap->snap_num_blinks = (unsigned char)led_proc->led_num_blinks;
+
+	if (led_proc->led_exit_critical != NULL)
+		led_proc->led_exit_critical(key);
+
+	if (too_many_pwm)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	snap->snap_app_version = app_version;
+	snap->snap_app_len = (unsigned short)app_len;
+	for (unsigned int i = 0; i < LED_SNAPSHOT_APP_SIZE; i++)
+		snap->snap_app[i] = 0;
+	copy_led_snapshot_bytes(snap->snap_app, app_state, app_len);
+
+	// the magic goes in before the check is worked out, a snapshot cut short by a reset never matches it
+	snap->snap_magic = LED_SNAPSHOT_MAGIC;
+	snap->snap_check = get_led_snapshot_check(snap);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type restore_led_proc_snapshot(struct led_proc_t * led_proc, led_t leds[], int num_leds, led_snapshot_t * snap, unsigned char app_version, void * app_state, unsigned int app_len)
+{
+	led_pwm_state_t * pwm_state;
+	int num_pwm = 0;
+	int num_blinks = 0;
+	int valid;
+
+	if (led_proc == NULL || leds == NULL || snap == NULL || (app_state == NULL && app_len != 0))
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	valid = snap->snap_magic == LED_SNAPSHOT_MAGIC && snap->snap_version == LED_SNAPSHOT_VERSION
+			&& snap->snap_check == get_led_snapshot_check(snap) && snap->snap_num_leds == num_leds
+			&& snap->snap_app_version == app_version && snap->snap_app_len == app_len
+			&& snap->snap_num_blinks <= LED_PROC_MAX_BLINKS;
+	snap->snap_magic = 0;
+	if (!valid || snap->snap_master_dim > LED_PROC_LEVEL_FULL)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	for (int i = 0; i < LED_PROC_MAX_GROUPS; i++)
+	{
+		if (snap->snap_group_dim[i] > LED_PROC_LEVEL_FULL)
+			return LED_PROC_ERROR_TYPE_BAD_STATE;
+	}
+
+	// the table is sparse, stopping a blink frees its entry wherever it is, so every entry is checked and the used
+	// ones are counted
+	for (int i = 0; i < LED_PROC_MAX_BLINKS; i++)
+	{
+		led_blink_t * blink = &snap->snap_blinks[i];
+		if (blink->blink_period_ms == 0)
+			continue;
+		if (blink->blink_led_num < 0 || blink->blink_led_num >= num_leds || blink->blink_phase_ms >= blink->blink_period_ms
+				|| leds[blink->blink_led_num].led_type != LED_TYPE_OUTPUT)
+			return LED_PROC_ERROR_TYPE_BAD_STATE;
+		num_blinks++;
+	}
+	if (num_blinks != snap->snap_num_blinks)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	for (int i = 0; i < num_leds; i++)
+	{
+		if (leds[i].led_type == LED_TYPE_OUTPUT)
+			leds[i].led_output_state = (snap->snap_outputs & (1u << i)) ? LED_ON : LED_OFF;
+		if (leds[i].led_type != LED_TYPE_PWM || leds[i].led_pwm_state == NULL || num_pwm >= LED_SNAPSHOT_MAX_PWM)
+			continue;
+
+		// init_led_proc_deferred programs the period and duty cycle in one go and restarts the dithering
+		pwm_state = leds[i].led_pwm_state;
+		if (snap->snap_pwm[num_pwm].pwm_hertz != 0)
+			pwm_state->led_pwm_hertz = (int)snap->snap_pwm[num_pwm].pwm_hertz;
+		pwm_state->led_duty_cycle = snap->snap_pwm[num_pwm].pwm_duty_cycle;
+		pwm_state->led_brightness = snap->snap_pwm[num_pwm].pwm_brightness;
+		pwm_state->led_dithering = snap->snap_pwm[num_pwm].pwm_dithering;
+		pwm_state->led_dither_acc = 0;
+		pwm_state->led_pwm_retune.cycles = 0;
+		pwm_state->led_frame_irq_on = 0;
+		num_pwm++;
+	}
+
+	copy_led_snapshot_bytes(led_proc->led_blinks, snap->snap_blinks, sizeof(led_proc->led_blinks));
+	led_proc->led_num_blinks = snap->snap_num_blinks;
+
+	// led_init starts a duty cycle LED at full scale, the first dispatch_led_proc_tick brings it down to its level
+	led_proc->led_master_dim = snap->snap_master_dim;
+	for (int i = 0; i < LED_PROC_MAX_GROUPS; i++)
+	{
+		led_proc->led_group_dim[i] = snap->snap_group_dim[i];
+		update_led_level_scale(led_proc, i);
+	}
+	led_proc->led_levels_dirty = (led_proc->led_master_dim != 0) ? ~0u : 0;
+	for (int i = 0; i < LED_PROC_MAX_GROUPS; i++)
+	{
+		if (led_proc->led_group_dim[i] != 0)
+			led_proc->led_levels_dirty |= 1u << i;
+	}
+	copy_led_snapshot_bytes(app_state, snap->snap_app, app_len);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
@@ -10,6 +10,44 @@
 
 #include "common.h"
 
+// led_output_state is shared between interrupts and tasks.  Single LED updates are done with a compare-and-swap
+// when the compiler has the GCC __atomic builtins, otherwise they fall back on the critical section hooks in
+// led_proc_t.  Define LED_PROC_HAS_ATOMIC_CAS as 0 or 1 to override
+#ifndef LED_PROC_HAS_ATOMIC_CAS
+#if defined(__GNUC__) && defined(__ATOMIC_ACQ_REL)
+#define LED_PROC_HAS_ATOMIC_CAS		1
+#else
+#define LED_PROC_HAS_ATOMIC_CAS		0
+#endif
+#endif
+
+// the mask calls walk only the selected bits of each word, finding the next with __builtin_ctz when the compiler has
+// it, otherwise with a few plain C shifts.  Define LED_PROC_HAS_CTZ as 0 or 1 to override
+#ifndef LED_PROC_HAS_CTZ
+#if defined(__GNUC__)
+#define LED_PROC_HAS_CTZ			1
+#else
+#define LED_PROC_HAS_CTZ			0
+#endif
+#endif
+
+// handles from get_led_output_handle and get_led_pwm_handle are checked on every call when this is 1, which is
+// meant for debug builds.  At 0 a handle is trusted, it was checked once when it was issued
+#ifndef LED_PROC_CHECK_HANDLES
+#define LED_PROC_CHECK_HANDLES		0
+#endif
+
+// reads toggle_led_ensure gives a pin to follow its write before the toggle counts as not taking, for pins that
+// lag behind their write, such as on an I/O expander.  A GPIO output register follows on the first read
+#ifndef LED_PROC_ENSURE_READS
+#define LED_PROC_ENSURE_READS		4
+#endif
+
+/******* NOTE! *******
+ * The functions that take an array of LEDs work through it in order and return the first error, the LEDs after it
+ * are left untouched.  Faster paths for any of the functions below must keep the same results, including the odd
+ * ones noted on turn_leds_nums_on and toggle_led_ensure, since application code already depends on them
+ */
 typedef enum LED_PROC_ERROR_TYPES {
 	LED_PROC_ERROR_TYPE_NONE = 1,		// No errors
 	LED_PROC_ERROR_TYPE_WRONG_TYPE,		// Passed LED is of wrong type
@@ -28,28 +66,111 @@ typedef enum LED_TYPE {
 	LED_TYPE_PWM
 }led_type_t;
 
+#define LED_PWM_BRIGHTNESS_MAX	0xFFFF		// full scale of the 16 bit brightness, see set_led_pwm_brightness
+#define LED_PWM_DUTY_MAX		100			// full scale of the duty cycle passed to led_set_duty_cycle
+#define LED_PWM_MAX_CYCLES		0xFFFF		// longest PWM period in counts, the compare registers are 16 bit
+#define LED_PROC_LEVEL_SHIFT	15
+#define LED_PROC_LEVEL_FULL		(1 << LED_PROC_LEVEL_SHIFT)	// full scale of the master and group levels, Q15
+
+#ifndef LED_PROC_MAX_GROUPS
+#define LED_PROC_MAX_GROUPS		4			// brightness groups of an instance, at most 32, see set_led_proc_group_level
+#endif
+
+/**************************************************************/
+/**\name	led_pwm_timing_t		                          */
+/**************************************************************/
+/*!
+ *	@brief This struct holds everything the hot paths need to drive a PWM channel at a given frequency.  It is
+ *	worked out once by get_led_pwm_timing, so a duty cycle or brightness change is a multiply and a shift
+ *
+ *	 @param hertz
+ *	 	the frequency actually achieved, the nearest whole number of counts to the one requested
+ *
+ *	 @param cycles
+ *	 	PWM period in counts of the PWM clock
+ *
+ *	 @param duty_scale
+ *	 	reciprocal of LED_PWM_DUTY_MAX in Q16, times cycles, see get_led_pwm_duty_cycles
+ *
+ *	 @param resolution_bits
+ *	 	whole bits of resolution of a single frame, dithering with set_led_pwm_brightness adds to it over time
+ *
+*/
+typedef struct led_pwm_timing_t {
+	unsigned int hertz;
+	unsigned int cycles;
+	unsigned int duty_scale;
+	unsigned char resolution_bits;
+}led_pwm_timing_t;
+
+// taken and useful counts of an interrupt source, see led_set_frame_irq and led_set_tick_irq in led_proc_t.  A
+// taken interrupt that was not useful had nothing to do, a governed source keeps the two close
+typedef struct led_irq_stats_t {
+	unsigned int irq_taken;
+	unsigned int irq_useful;
+}led_irq_stats_t;
+
 typedef struct led_pwm_state_t{
-	int led_pwm_hertz;
-	int led_duty_cycle;
+	int led_pwm_hertz;		// requested PWM frequency in Hz
+	int led_duty_cycle;		// last duty cycle set, 0 - LED_PWM_DUTY_MAX
 	void * led_pwm_info;	// optional generic void to define and make a struct on application side to reference any other pwm specific APIs required
+	led_pwm_timing_t led_pwm_timing;	// set by led_init with get_led_pwm_timing
+	led_pwm_timing_t led_pwm_retune;	// waits here for the next frame while cycles is non zero, see retune_led_pwm
+	unsigned int led_dither_target;		// brightness * cycles, whole compare counts in the upper 16 bits
+	unsigned short led_brightness;		// last brightness set, so a retune can scale it to the new period
+	unsigned short led_dither_acc;		// fractional compare count carried from frame to frame
+	unsigned char led_dithering;		// set while the brightness is dithered, cleared by setting a duty cycle
+	unsigned char led_frame_irq_on;		// the frame interrupt is enabled, maintained when led_set_frame_irq is set
+	unsigned char led_group;			// brightness group, 0 - LED_PROC_MAX_GROUPS - 1, see set_led_proc_group_level
+	unsigned char led_duty_inverted;	// the LED is lit for LED_PWM_DUTY_MAX - duty cycle, so levels dim toward LED_PWM_DUTY_MAX
+	unsigned short led_compare;			// last compare written by run_led_pwm_frame
+	led_irq_stats_t led_frame_stats;	// frame interrupts taken, and those that wrote a new period or compare
 }led_pwm_state_t;
 
-union led_state_t {
-	led_output_state_t led_output_state;
-	led_pwm_state_t led_pwm_state;
-};
-
 /******* NOTE! *******
  * User MUST change the led_ptr type to the GPIO TypeDef for the selected API SDK
+ *
+ * led_t is kept small as a panel can have hundreds of LEDs, most of them plain outputs.  The type and output state
+ * are a byte each, and the PWM state, which was half of the old size, lives in a side table of led_pwm_state_t that
+ * only the PWM LEDs point into.  On the TLS8258 an led_t is 12 bytes, and 8 with a 16 bit pin typedef
  */
 #warning "User Must Change GPIO_PinTypeDef to correct SDK GPIO Typedef"
 typedef struct LED {
 	GPIO_PinTypeDef led_ptr;
-	led_type_t led_type;
-	union led_state_t led_state;
-	int led_pwm_hertz;
+	unsigned char led_type;						// led_type_t
+	volatile unsigned char led_output_state;	// led_output_state_t, only used by LED_TYPE_OUTPUT LEDs
+	led_pwm_state_t * led_pwm_state;			// only used by LED_TYPE_PWM LEDs, which must point it at their entry
 }led_t;
 
+// selects LED n of an instance in a mask for the mask calls, bit n % 32 of word n / 32
+#define LED_PROC_MASK_WORDS(num_leds)	(((num_leds) + 31) / 32)
+#define LED_PROC_MASK_WORD(led_num)		((led_num) / 32)
+#define LED_PROC_MASK_BIT(led_num)		(1u << ((led_num) % 32))
+
+// an LED of an instance, checked once when it is issued so the calls that take it need no checks.  Output and PWM
+// LEDs have handles of different types, so one cannot be passed for the other.  The contents are opaque
+typedef struct led_output_handle_t {
+	unsigned int handle;
+}led_output_handle_t;
+
+typedef struct led_pwm_handle_t {
+	unsigned int handle;
+}led_pwm_handle_t;
+
+#ifndef LED_PROC_MAX_BLINKS
+#define LED_PROC_MAX_BLINKS			4		// LEDs of an instance that can blink from the tick at the same time
+#endif
+
+#define LED_PROC_CAP_HW_BLINK		0x01	// led_set_blink can blink at least some of the LEDs in hardware
+
+// a blink run from dispatch_led_proc_tick, for LEDs the HAL cannot blink in hardware
+typedef struct led_blink_t {
+	unsigned int blink_period_ms;		// 0 when the entry is free
+	unsigned int blink_on_ms;
+	unsigned int blink_phase_ms;		// time into the current period
+	int blink_led_num;
+}led_blink_t;
+
 
 
 /**************************************************************/
@@ -68,7 +189,9 @@ typedef struct LED {
  *	 @param led_set_polarity
  *	 	for setting the LED GPIOs output.  The parameters are for LED_ON or LED_OFF. It is up to the
  *	 	developer to know whether that means the GPIO is a sink and needs to be set to 0 to turn on the LED
- *	 	or if the GPIO is push / pull and needs to be set to 1 to turn on the LED
+ *	 	or if the GPIO is push / pull and needs to be set to 1 to turn on the LED.  Only the pin should be driven,
+ *	 	led_proc keeps led_output_state itself.  It can be called from an interrupt and a task at the same time, so
+ *	 	any read-modify-write of a port register shared with other pins must be protected
  *
  *	 @param led_set_duty_cycle
  *	 	for setting the duty cycle of a PWM LED
@@ -81,12 +204,123 @@ typedef struct LED {
  *	 @param led_deinit
  *	 	for deinitializing an LED and cleanup, or if GPIO needs to be reused for another function
  *
+ *	 @param led_init_outputs
+ *	 	OPTIONAL, may be left NULL.  For initializing every LED_TYPE_OUTPUT LED of an array in one call, so the
+ *	 	register writes can be batched per port instead of done per LED.  LEDs of any other type must be skipped, they
+ *	 	are still initialized through led_init.  Each LED must be driven to its led_output_state
+ *
+ *	 @param led_verify_outputs
+ *	 	OPTIONAL, may be left NULL, but then verify_led_outputs is not available.  For checking the pin of every
+ *	 	LED_TYPE_OUTPUT LED of an array against its led_output_state, reading each port once and comparing all of
+ *	 	its LEDs in one go.  Sets bit n % 32 of word n / 32 of the mask for LED n when its pin disagrees, and leaves
+ *	 	the bits of LEDs of any other type alone.  The mask is cleared by the caller
+ *
+ *	 @param led_set_outputs
+ *	 	OPTIONAL, may be left NULL, then the mask calls drive each LED through led_set_polarity.  For driving the
+ *	 	LED_TYPE_OUTPUT LEDs of up to 32 LEDs of an array whose bit is set in the mask, writing each port once.  Each
+ *	 	LED must be driven to its led_output_state as it is when its port is written
+ *
+ *	 @param led_set_compare
+ *	 	OPTIONAL, may be left NULL, but then set_led_pwm_brightness is not available.  For writing the raw compare
+ *	 	value of a PWM LED, given as the number of counts of the PWM period the LED is lit for, so 0 is off and
+ *	 	led_pwm_timing.cycles is fully on.  Called from the PWM frame interrupt, it must take effect at a frame boundary
+ *
+ *	 @param led_set_cycles
+ *	 	OPTIONAL, may be left NULL, but then retune_led_pwm is not available.  For writing the PWM period of a PWM
+ *	 	LED in counts.  Called from the PWM frame interrupt right before the compare value for the new period is
+ *	 	written, both must take effect together at the next frame boundary
+ *
+ *	 @param led_set_frame_irq
+ *	 	OPTIONAL, may be left NULL, then the frame interrupt of a PWM LED must be left enabled.  For enabling or
+ *	 	disabling the PWM frame interrupt of a PWM LED.  led_proc enables it when a brightness or retune is set and
+ *	 	disables it from run_led_pwm_frame once there is nothing left to dither, so a steady LED costs no interrupts.
+ *	 	Called inside led_enter_critical, and from the frame interrupt itself
+ *
+ *	 @param led_set_tick_irq
+ *	 	OPTIONAL, may be left NULL, then the tick interrupt must be left running.  For starting or stopping the
+ *	 	periodic interrupt that calls dispatch_led_proc_tick.  dispatch_led_proc_tick stops it once every registered
+ *	 	instance is idle, see set_led_proc_tick_idle, and wake_led_proc_tick starts it again.  When it is shared by
+ *	 	several instances they should all be given the same hook.  It can be asked to start when already running,
+ *	 	and must then leave it running as it is
+ *
+ *	 @param led_set_blink
+ *	 	OPTIONAL, may be left NULL, only used when led_caps has LED_PROC_CAP_HW_BLINK.  For blinking an LED in
+ *	 	hardware, such as from a PWM channel clocked down to a few Hz or a timer output compare pin, so the blink takes
+ *	 	no interrupts at all.  Takes the period and on time in ms, a period of 0 stops the blink and is also passed
+ *	 	for LEDs that are not blinking in hardware, which should be left as they are.  Should return
+ *	 	LED_PROC_ERROR_TYPE_WRONG_TYPE for an LED, or LED_PROC_ERROR_TYPE_BAD_STATE for a period, it cannot do in
+ *	 	hardware, blink_led then runs the blink from the tick instead
+ *
+ *	 @param led_caps
+ *	 	what the HAL can do in hardware, LED_PROC_CAP_ flags, 0 when nothing
+ *
+ *	 @param led_enter_critical
+ *	 	OPTIONAL, may be left NULL.  Used when LED_PROC_HAS_ATOMIC_CAS is 0, to make the read-modify-write of
+ *	 	an LED state atomic, and around LEDs that must change together, such as the channels of an RGB LED.  Should
+ *	 	mask whatever can preempt the caller, such as interrupts or the scheduler, and return a key for
+ *	 	led_exit_critical.  Kept as short as possible, it is only held for a few HAL calls at most
+ *
+ *	 @param led_exit_critical
+ *	 	OPTIONAL, may be left NULL.  Restores what led_enter_critical masked, using the key it returned
+ *
+ *	 @param led_trace
+ *	 	OPTIONAL, may be left NULL.  Called every time led_proc drives an LED, with the place of the LED in led_array
+ *	 	and what it was driven to, the led_output_state_t of an output or the counts of the period a PWM LED is lit
+ *	 	for.  Meant for feeding a led_trace_t.  Called from whichever context drove the LED, interrupts included
+ *
  *	 @param led_array
- *	 	a reference to array of led_t types
+ *	 	a reference to array of led_t types, owned by this instance
+ *
+ *	 @param num_leds
+ *	 	the number of LEDs in led_array, set by init_led_proc
  *
  *	 @param led_typedef
  *	 	the actual typedef of the GPIO, for instance GPIO_Typedef
  *
+ *	 @param led_tick
+ *	 	OPTIONAL, may be left NULL unless the instance is registered with register_led_proc.  Called from
+ *	 	dispatch_led_proc_tick every led_tick_period_ms, for the patterns and scheduling of this instance
+ *
+ *	 @param led_tick_period_ms
+ *	 	how often led_tick is called, should be a multiple of the elapsed time passed to dispatch_led_proc_tick
+ *
+ *	 @param led_tick_countdown_ms
+ *	 	time left until the next led_tick, maintained by dispatch_led_proc_tick
+ *
+ *	 @param led_tick_idle
+ *	 	set while led_tick has nothing due, see set_led_proc_tick_idle and wake_led_proc_tick
+ *
+ *	 @param led_tick_stats
+ *	 	ticks dispatched to this instance, and those that called led_tick or drove a blink edge, maintained by
+ *	 	dispatch_led_proc_tick
+ *
+ *	 @param led_blinks
+ *	 	blinks run from the tick, maintained by blink_led and stop_led_blink
+ *
+ *	 @param led_num_blinks
+ *	 	entries of led_blinks in use
+ *
+ *	 @param led_master_dim
+ *	 	LED_PROC_LEVEL_FULL less the master level, maintained by set_led_proc_master_level.  The levels are kept as
+ *	 	what is taken off, so a zeroed instance is at full brightness
+ *
+ *	 @param led_group_dim
+ *	 	LED_PROC_LEVEL_FULL less the level of each group, maintained by set_led_proc_group_level
+ *
+ *	 @param led_scale_dim
+ *	 	LED_PROC_LEVEL_FULL less the master level times the level of each group, what is applied to the PWM LEDs
+ *	 	of the group when their duty cycle or brightness is written
+ *
+ *	 @param led_levels_dirty
+ *	 	a bit per group whose PWM LEDs have not been rewritten since its level changed, see commit_led_proc_levels
+ *
+ *	 @param led_handle_tag
+ *	 	set by init_led_proc_fast, so handles issued before an init, or by another instance, are told apart
+ *
+ *	 @param led_context
+ *	 	OPTIONAL, may be left NULL.  Application and HAL state of this instance, such as pattern counters or PWM
+ *	 	channel info, so that several instances can run side by side without any globals
+ *
  *
  *
  *
@@ -104,10 +338,109 @@ typedef struct led_proc_t {
 	led_proc_error_type (*led_set_duty_cycle)(led_t*, int);
 	led_proc_error_type (*led_get_state)(led_t*, int*);
 	led_proc_error_type (*led_deinit)(led_t*);
+	led_proc_error_type (*led_init_outputs)(led_t*, int);
+	led_proc_error_type (*led_verify_outputs)(led_t*, int, unsigned int*);
+	led_proc_error_type (*led_set_outputs)(led_t*, int, unsigned int);
+	led_proc_error_type (*led_set_compare)(led_t*, unsigned int);
+	led_proc_error_type (*led_set_cycles)(led_t*, unsigned int);
+	led_proc_error_type (*led_set_frame_irq)(led_t*, int);
+	void (*led_set_tick_irq)(int);
+	led_proc_error_type (*led_set_blink)(led_t*, unsigned int, unsigned int);
+	unsigned int led_caps;
+	unsigned int (*led_enter_critical)(void);
+	void (*led_exit_critical)(unsigned int);
+	void (*led_trace)(struct led_proc_t*, int, unsigned int);
 	led_t *led_array;
+	int num_leds;
 	void *led_typedef;
+	void (*led_tick)(struct led_proc_t*);
+	unsigned int led_tick_period_ms;
+	int led_tick_countdown_ms;
+	volatile unsigned char led_tick_idle;
+	led_irq_stats_t led_tick_stats;
+	led_blink_t led_blinks[LED_PROC_MAX_BLINKS];
+	int led_num_blinks;
+	unsigned int led_master_dim;
+	unsigned int led_group_dim[LED_PROC_MAX_GROUPS];
+	unsigned int led_scale_dim[LED_PROC_MAX_GROUPS];
+	volatile unsigned int led_levels_dirty;
+	unsigned char led_handle_tag;
+	void *led_context;
 }led_proc_t;
 
+#ifndef LED_PROC_MAX_INSTANCES
+#define LED_PROC_MAX_INSTANCES		4		// size of the dispatch table of register_led_proc
+#endif
+
+
+/**************************************************************/
+/**\name	led_proc_dispatch_t		                          */
+/**************************************************************/
+/*!
+ *	@brief This struct is a table of instances that share one tick, see run_led_proc_dispatch.  register_led_proc
+ *	and dispatch_led_proc_tick use one that led_proc keeps for the board.  Code that runs several boards in one
+ *	process, such as a host simulation, gives each board its own so the boards never see each other
+ *
+ *	 All of the fields are maintained by the dispatch functions and should not be touched, a zeroed
+ *	 led_proc_dispatch_t is empty
+ *
+*/
+typedef struct led_proc_dispatch_t {
+	struct led_proc_t * dispatch_instances[LED_PROC_MAX_INSTANCES];
+	volatile int dispatch_num_instances;
+}led_proc_dispatch_t;
+
+#define LED_SNAPSHOT_MAGIC			0x534C	// "LS"
+#define LED_SNAPSHOT_VERSION		2		// bumped whenever led_snapshot_t changes
+#define LED_SNAPSHOT_MAX_LEDS		32		// one bit each in snap_outputs
+
+#ifndef LED_SNAPSHOT_MAX_PWM
+#define LED_SNAPSHOT_MAX_PWM		4		// PWM LEDs of an instance that a snapshot can hold
+#endif
+
+#ifndef LED_SNAPSHOT_APP_SIZE
+#define LED_SNAPSHOT_APP_SIZE		160		// bytes of application state, keep it a multiple of 4
+#endif
+
+// what a PWM LED needs to come back at the same period and level, taken in the order the PWM LEDs are in the array
+typedef struct led_pwm_snapshot_t {
+	unsigned int pwm_hertz;				// achieved frequency, so a retune is kept
+	unsigned short pwm_brightness;
+	unsigned char pwm_duty_cycle;
+	unsigned char pwm_dithering;
+}led_pwm_snapshot_t;
+
+
+
+/**************************************************************/
+/**\name	led_snapshot_t   		                          */
+/**************************************************************/
+/*!
+ *	@brief This struct holds the runtime state of an instance across a deep sleep that keeps retention RAM, see
+ *	save_led_proc_snapshot and restore_led_proc_snapshot.  It has no pointers, so it stays valid when everything else
+ *	in RAM is lost, and it is checked with a version and a checksum, so RAM that was never written or was left by
+ *	other firmware is never resumed
+ *
+ *	 All of the fields are maintained by the snapshot functions and should not be touched.  The application keeps
+ *	 its own state, such as pattern positions and fade progress, in snap_app through the same functions
+ *
+*/
+typedef struct led_snapshot_t {
+	unsigned short snap_magic;
+	unsigned char snap_version;
+	unsigned char snap_num_leds;
+	unsigned int snap_outputs;								// led_output_state of each LED, bit n is LED n
+	unsigned int snap_master_dim;
+	unsigned int snap_group_dim[LED_PROC_MAX_GROUPS];
+	led_pwm_snapshot_t snap_pwm[LED_SNAPSHOT_MAX_PWM];
+	led_blink_t snap_blinks[LED_PROC_MAX_BLINKS];			// blinks run from the tick
+	unsigned char snap_num_blinks;
+	unsigned char snap_app_version;
+	unsigned short snap_app_len;
+	unsigned char snap_app[LED_SNAPSHOT_APP_SIZE];
+	unsigned int snap_check;								// last, covers every byte before it
+}led_snapshot_t;
+
 
 
 /**************************************************************/
@@ -133,6 +466,56 @@ led_proc_error_type init_led_proc(struct led_proc_t * led_proc, led_t leds[], in
 
 
 
+/**************************************************************/
+/**\name	init_led_proc_fast		                          */
+/**************************************************************/
+/*!
+ *	@brief This function is the first half of init_led_proc for a fast boot.  Only the LED_TYPE_OUTPUT LEDs are
+ *		initialized, through led_init_outputs when it is set, so a status LED can be shown as early as possible.
+ *		init_led_proc_deferred must be called afterwards to initialize the rest of the LEDs
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param leds - an array of LEDs in the typedef for the MCU SDK
+ *	 @param int - the number of LEDs in the array
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - results of LED initializations
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type init_led_proc_fast(struct led_proc_t * led_proc, led_t leds[], int num_leds);
+
+
+
+/**************************************************************/
+/**\name	init_led_proc_deferred	                          */
+/**************************************************************/
+/*!
+ *	@brief This function is the second half of init_led_proc for a fast boot.  Every LED that is not a
+ *		LED_TYPE_OUTPUT, such as PWM LEDs, is initialized through led_init.  A PWM LED that already has a
+ *		brightness, such as one put back by restore_led_proc_snapshot, is dithered at it again
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param leds - an array of LEDs in the typedef for the MCU SDK
+ *	 @param int - the number of LEDs in the array
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - results of LED initializations
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type init_led_proc_deferred(struct led_proc_t * led_proc, led_t leds[], int num_leds);
+
+
+
 /**************************************************************/
 /**\name	turn_led_on			                              */
 /**************************************************************/
@@ -192,6 +575,8 @@ led_proc_error_type turn_leds_on(struct led_proc_t * led_proc, led_t * leds[], i
  *	 @param led_proc_t structure pointer.
  *	 @param int - the place in the LED array that is to be turned on
  *
+ *	@note Returns LED_PROC_ERROR_TYPE_WRONG_TYPE without touching the LED if it is not a LED_TYPE_OUTPUT
+ *
  *
  *
  *
@@ -217,6 +602,9 @@ led_proc_error_type turn_led_num_on(struct led_proc_t * led_proc, int led_num_in
  *	 @param int - the place in the LED array that is to be turned on
  *	 @param int - the number of LEDs in the array
  *
+ *	@note LEDs are turned on in order and it stops at the first error, the LEDs after it are left untouched.  The
+ *		led_output_state of the LED that failed is still set to LED_ON, even when it failed for being the wrong type
+ *
  *
  *
  *
@@ -290,6 +678,8 @@ led_proc_error_type turn_leds_off(struct led_proc_t * led_proc, led_t * leds[],
  *	 @param led_proc_t structure pointer.
  *	 @param int - the place in the LED array that is to be turned on
  *
+ *	@note Unlike turn_led_num_on, the type of the LED is not checked
+ *
  *
  *
  *
@@ -339,8 +729,12 @@ led_proc_error_type turn_leds_nums_off(struct led_proc_t * led_proc, int led_num
  *	 @param led_proc_t structure pointer.
  *	 @param led_t
  *
+ *	@note The results of the HAL calls are OR'd together, and LED_PROC_ERROR_TYPE_NONE is 1, so an error can come
+ *		back as a different code than the HAL returned.  Only compare the result against LED_PROC_ERROR_TYPE_NONE
  *
- *
+ *	@note The pin is driven and read back up to LED_PROC_ENSURE_READS times.  The toggle took when the pin reads
+ *		back its new state, or when another context has changed the LED since.  Only a pin that still disagrees
+ *		after every read is driven and read back once more
  *
  *
  *	@return led_proc_error_type - result of toggling LED
@@ -388,6 +782,8 @@ led_proc_error_type toggle_leds_ensure(struct led_proc_t * led_proc, led_t * led
  *	 @param led_proc_t structure pointer.
  *	 @param int - the place in the LED array that is to be toggled
  *
+ *	@note The result of toggle_led_ensure is OR'd with the result of reading back the state, see toggle_led_ensure
+ *
  *
  *
  *
@@ -428,127 +824,306 @@ led_proc_error_type toggle_leds_nums_ensure(struct led_proc_t * led_proc, int le
 
 
 /**************************************************************/
-/**\name	set_led_pwm_duty_cycle 		                              */
+/**\name	turn_leds_mask_on								*/
 /**************************************************************/
 /*!
- *	@brief This function is to set the PWM Duty Cycle of an LED
+ *	@brief This function turns on every LED selected in a mask in one pass.  Unlike the calls that take an
+ *		array of places, an LED that fails does not stop the rest, it is reported in the failed mask.  The LEDs are
+ *		driven through led_set_outputs, 32 at a time, when it is set
  *
  *	 @param led_proc_t structure pointer.
- *	 @param int - led number in array needed to get state
- *	 @param reference to uint8_t to pass the state of the LED
+ *	 @param unsigned int array - mask of the LEDs, see LED_PROC_MASK_BIT
+ *	 @param unsigned int array - OPTIONAL, may be NULL.  Cleared, then has the bit of every LED that failed set
+ *	 @param int - the number of words in each mask
  *
  *
  *
  *
- *	@return led_proc_error_type - result of getting LED state
+ *	@return led_proc_error_type - result of the first LED that failed
  *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_WRONG_TYPE -> a selected LED is not a LED_TYPE_OUTPUT LED
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> a selected bit is past the LED array
  *	@retval all else -> Error (see descriptions above
  *
  *
 */
-led_proc_error_type set_led_pwm_duty_cycle(struct led_proc_t * led_proc, led_t * led, int pwm_dc);
+led_proc_error_type turn_leds_mask_on(struct led_proc_t * led_proc, const unsigned int mask[], unsigned int failed[], int num_words);
+
 
+/**************************************************************/
+/**\name	turn_leds_mask_off								*/
+/**************************************************************/
+/*!
+ *	@brief This function turns off every LED selected in a mask in one pass, see turn_leds_mask_on
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param unsigned int array - mask of the LEDs, see LED_PROC_MASK_BIT
+ *	 @param unsigned int array - OPTIONAL, may be NULL.  Cleared, then has the bit of every LED that failed set
+ *	 @param int - the number of words in each mask
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of the first LED that failed
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_WRONG_TYPE -> a selected LED is not a LED_TYPE_OUTPUT LED
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> a selected bit is past the LED array
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type turn_leds_mask_off(struct led_proc_t * led_proc, const unsigned int mask[], unsigned int failed[], int num_words);
 
 
 /**************************************************************/
-/**\name	set_leds_pwm_duty_cycle 		                              */
+/**\name	toggle_leds_mask								*/
 /**************************************************************/
 /*!
- *	@brief This function is to set the PWM Duty Cycle of multiple LEDs
+ *	@brief This function toggles every LED selected in a mask in one pass, see turn_leds_mask_on.  The pins are not
+ *		read back, verify_led_outputs checks them all at once
  *
  *	 @param led_proc_t structure pointer.
- *	 @param array of led_t - led number in array needed to get state
- *	 @param reference to uint8_t to pass the state of the LED
- *	 @param int - the number of LEDs in the array
+ *	 @param unsigned int array - mask of the LEDs, see LED_PROC_MASK_BIT
+ *	 @param unsigned int array - OPTIONAL, may be NULL.  Cleared, then has the bit of every LED that failed set
+ *	 @param int - the number of words in each mask
  *
  *
  *
  *
- *	@return led_proc_error_type - result of getting LED state
+ *	@return led_proc_error_type - result of the first LED that failed
  *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_WRONG_TYPE -> a selected LED is not a LED_TYPE_OUTPUT LED
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> a selected bit is past the LED array
  *	@retval all else -> Error (see descriptions above
  *
  *
 */
-led_proc_error_type set_leds_pwm_duty_cycle(struct led_proc_t * led_proc, led_t * leds[], int pwm_dc, int num_leds);
+led_proc_error_type toggle_leds_mask(struct led_proc_t * led_proc, const unsigned int mask[], unsigned int failed[], int num_words);
+
 
+/**************************************************************/
+/**\name	set_leds_mask_pwm_duty_cycle					*/
+/**************************************************************/
+/*!
+ *	@brief This function sets the duty cycle of every LED selected in a mask in one pass, see
+ *		turn_leds_mask_on
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param unsigned int array - mask of the LEDs, see LED_PROC_MASK_BIT
+ *	 @param int - duty cycle, 0 - LED_PWM_DUTY_MAX
+ *	 @param unsigned int array - OPTIONAL, may be NULL.  Cleared, then has the bit of every LED that failed set
+ *	 @param int - the number of words in each mask
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of the first LED that failed
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_WRONG_TYPE -> a selected LED is not a LED_TYPE_PWM LED
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> a selected bit is past the LED array
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type set_leds_mask_pwm_duty_cycle(struct led_proc_t * led_proc, const unsigned int mask[], int pwm_dc, unsigned int failed[], int num_words);
 
 
 /**************************************************************/
-/**\name	set_led_num_pwm_duty_cycle 		                              */
+/**\name	verify_led_outputs 		                          */
 /**************************************************************/
 /*!
- *	@brief This function is to set the PWM Duty Cycle of an LED by the number associated with LED in the array
+ *	@brief This function checks every LED_TYPE_OUTPUT LED of the instance against the hardware in one batch,
+ *		through led_verify_outputs, which reads each port once.  An LED that another context is changing at the
+ *		same time can show as a mismatch, so a mismatch should be checked again before it is acted on
  *
  *	 @param led_proc_t structure pointer.
- *	 @param int - led number in array needed to get state
- *	 @param reference to uint8_t to pass the state of the LED
+ *	 @param unsigned int array - the mask, bit n % 32 of word n / 32 is set for LED n when its pin disagrees
+ *	 @param int - the number of words in the mask, at least (num_leds + 31) / 32
  *
  *
  *
  *
- *	@return led_proc_error_type - result of getting LED state
+ *	@return led_proc_error_type - result of the check
+ *	@retval 1 -> Success, every output LED is where led_output_state says
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> at least one LED disagrees, or the mask is too short
+ *	@retval LED_PROC_ERROR_TYPE_NULL -> led_verify_outputs is not set
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type verify_led_outputs(struct led_proc_t * led_proc, unsigned int mismatch[], int num_words);
+
+
+/**************************************************************/
+/**\name	get_led_output_handle							*/
+/**************************************************************/
+/*!
+ *	@brief This function issues the handle of an LED_TYPE_OUTPUT LED, the place and type are checked here once
+ *		so the calls that take the handle need no checks.  Handles are valid until the instance is initialized again
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param int - the place in the LED array
+ *	 @param reference to led_output_handle_t to pass the handle
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of issuing the handle
  *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> not a place in the LED array
+ *	@retval LED_PROC_ERROR_TYPE_WRONG_TYPE -> not a LED_TYPE_OUTPUT LED
  *	@retval all else -> Error (see descriptions above
  *
  *
 */
-led_proc_error_type set_led_num_pwm_duty_cycle(struct led_proc_t * led_proc, int led_num_in_array, int pwm_dc);
+led_proc_error_type get_led_output_handle(struct led_proc_t * led_proc, int led_num_in_array, led_output_handle_t * handle);
+
 
+/**************************************************************/
+/**\name	get_led_pwm_handle								*/
+/**************************************************************/
+/*!
+ *	@brief This function issues the handle of an LED_TYPE_PWM LED, see get_led_output_handle
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param int - the place in the LED array
+ *	 @param reference to led_pwm_handle_t to pass the handle
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of issuing the handle
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> not a place in the LED array
+ *	@retval LED_PROC_ERROR_TYPE_WRONG_TYPE -> not a LED_TYPE_PWM LED
+ *	@retval LED_PROC_ERROR_TYPE_NULL -> the LED has no led_pwm_state
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type get_led_pwm_handle(struct led_proc_t * led_proc, int led_num_in_array, led_pwm_handle_t * handle);
 
 
 /**************************************************************/
-/**\name	set_led_nums_pwm_duty_cycle 		                              */
+/**\name	turn_led_handle_on								*/
 /**************************************************************/
 /*!
- *	@brief This function is to set the PWM Duty Cycle of multiple LEDs by the number associated with LED in the array
+ *	@brief This function is turn_led_on for the LED of a handle, with no checks unless LED_PROC_CHECK_HANDLES
  *
  *	 @param led_proc_t structure pointer.
- *	 @param int - led number in array needed to get state
- *	 @param reference to uint8_t to pass the state of the LED
- *	 @param int - the number of LEDs in the array
+ *	 @param led_output_handle_t - from get_led_output_handle
  *
  *
  *
  *
- *	@return led_proc_error_type - result of getting LED state
+ *	@return led_proc_error_type - result of turning on LED
  *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> with LED_PROC_CHECK_HANDLES, a stale or forged handle
  *	@retval all else -> Error (see descriptions above
  *
  *
 */
-led_proc_error_type set_led_nums_pwm_duty_cycle(struct led_proc_t * led_proc, int led_nums_in_array[], int pwm_dc, int num_leds);
+led_proc_error_type turn_led_handle_on(struct led_proc_t * led_proc, led_output_handle_t handle);
 
 
+/**************************************************************/
+/**\name	turn_led_handle_off							*/
+/**************************************************************/
+/*!
+ *	@brief This function is turn_led_off for the LED of a handle, with no checks unless LED_PROC_CHECK_HANDLES
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param led_output_handle_t - from get_led_output_handle
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of turning off LED
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> with LED_PROC_CHECK_HANDLES, a stale or forged handle
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type turn_led_handle_off(struct led_proc_t * led_proc, led_output_handle_t handle);
+
 
 /**************************************************************/
-/**\name	get_led_state 		                              */
+/**\name	toggle_led_handle								*/
 /**************************************************************/
 /*!
- *	@brief This function is to get the state of a specific LED
+ *	@brief This function toggles the LED of a handle without reading it back, with no checks unless
+ *		LED_PROC_CHECK_HANDLES.  Two contexts toggling the same LED both take effect, as with toggle_led_ensure
  *
  *	 @param led_proc_t structure pointer.
- *	 @param led_t needed to get state
- *	 @param reference to uint8_t to pass the state of the LED
+ *	 @param led_output_handle_t - from get_led_output_handle
  *
  *
  *
  *
- *	@return led_proc_error_type - result of getting LED state
+ *	@return led_proc_error_type - result of toggling LED
  *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> with LED_PROC_CHECK_HANDLES, a stale or forged handle
  *	@retval all else -> Error (see descriptions above
  *
  *
 */
-led_proc_error_type get_led_state(struct led_proc_t * led_proc, led_t * led, int * led_state);
+led_proc_error_type toggle_led_handle(struct led_proc_t * led_proc, led_output_handle_t handle);
+
+
+/**************************************************************/
+/**\name	set_led_handle_duty_cycle						*/
+/**************************************************************/
+/*!
+ *	@brief This function is set_led_pwm_duty_cycle for the LED of a handle, with no checks unless
+ *		LED_PROC_CHECK_HANDLES
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param led_pwm_handle_t - from get_led_pwm_handle
+ *	 @param int - duty cycle, 0 - LED_PWM_DUTY_MAX
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of setting the duty cycle
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> with LED_PROC_CHECK_HANDLES, a stale or forged handle
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type set_led_handle_duty_cycle(struct led_proc_t * led_proc, led_pwm_handle_t handle, int pwm_dc);
+
 
+/**************************************************************/
+/**\name	set_led_handle_brightness						*/
+/**************************************************************/
+/*!
+ *	@brief This function is set_led_pwm_brightness for the LED of a handle, the LED is not checked again
+ *		unless LED_PROC_CHECK_HANDLES
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param led_pwm_handle_t - from get_led_pwm_handle
+ *	 @param unsigned short - brightness, 0 is off and LED_PWM_BRIGHTNESS_MAX is fully on
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of setting the brightness
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> with LED_PROC_CHECK_HANDLES, a stale or forged handle
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type set_led_handle_brightness(struct led_proc_t * led_proc, led_pwm_handle_t handle, unsigned short brightness);
 
 
 /**************************************************************/
-/**\name	get_led_state 		                              */
+/**\name	set_led_pwm_duty_cycle 		                              */
 /**************************************************************/
 /*!
- *	@brief This function is to get the state of a specific LED
+ *	@brief This function is to set the PWM Duty Cycle of an LED
  *
  *	 @param led_proc_t structure pointer.
  *	 @param int - led number in array needed to get state
@@ -559,10 +1134,732 @@ led_proc_error_type get_led_state(struct led_proc_t * led_proc, led_t * led, int
  *
  *	@return led_proc_error_type - result of getting LED state
  *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_WRONG_TYPE -> not a LED_TYPE_PWM LED
+ *	@retval LED_PROC_ERROR_TYPE_NULL -> the LED has no led_pwm_state
  *	@retval all else -> Error (see descriptions above
  *
  *
 */
-led_proc_error_type get_led_num_state(struct led_proc_t * led_proc, int led_num_in_array, int * led_state);
+led_proc_error_type set_led_pwm_duty_cycle(struct led_proc_t * led_proc, led_t * led, int pwm_dc);
+
+
+
+/**************************************************************/
+/**\name	set_leds_pwm_duty_cycle 		                              */
+/**************************************************************/
+/*!
+ *	@brief This function is to set the PWM Duty Cycle of multiple LEDs
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param array of led_t - led number in array needed to get state
+ *	 @param reference to uint8_t to pass the state of the LED
+ *	 @param int - the number of LEDs in the array
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of getting LED state
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type set_leds_pwm_duty_cycle(struct led_proc_t * led_proc, led_t * leds[], int pwm_dc, int num_leds);
+
+
+
+/**************************************************************/
+/**\name	set_led_num_pwm_duty_cycle 		                              */
+/**************************************************************/
+/*!
+ *	@brief This function is to set the PWM Duty Cycle of an LED by the number associated with LED in the array
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param int - led number in array needed to get state
+ *	 @param reference to uint8_t to pass the state of the LED
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of getting LED state
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type set_led_num_pwm_duty_cycle(struct led_proc_t * led_proc, int led_num_in_array, int pwm_dc);
+
+
+
+/**************************************************************/
+/**\name	set_led_nums_pwm_duty_cycle 		                              */
+/**************************************************************/
+/*!
+ *	@brief This function is to set the PWM Duty Cycle of multiple LEDs by the number associated with LED in the array
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param int - led number in array needed to get state
+ *	 @param reference to uint8_t to pass the state of the LED
+ *	 @param int - the number of LEDs in the array
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of getting LED state
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type set_led_nums_pwm_duty_cycle(struct led_proc_t * led_proc, int led_nums_in_array[], int pwm_dc, int num_leds);
+
+
+
+/**************************************************************/
+/**\name	set_led_pwm_brightness 		                      */
+/**************************************************************/
+/*!
+ *	@brief This function is to set a 16 bit brightness of a PWM LED, finer than the compare value of one PWM frame
+ *		can give.  The brightness is temporally dithered, run_led_pwm_frame must be called from the PWM frame
+ *		interrupt, and alternates between the two nearest compare values so the average over the frames is exact.
+ *		Setting a duty cycle stops the dithering
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param led_t
+ *	 @param unsigned short - brightness, 0 is off and LED_PWM_BRIGHTNESS_MAX is fully on
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of setting the brightness
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type set_led_pwm_brightness(struct led_proc_t * led_proc, led_t * led, unsigned short brightness);
+
+
+
+/**************************************************************/
+/**\name	set_led_num_pwm_brightness 		                  */
+/**************************************************************/
+/*!
+ *	@brief This function is to set a 16 bit brightness of a PWM LED by the number associated with LED in the array,
+ *		see set_led_pwm_brightness
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param int - the place in the LED array
+ *	 @param unsigned short - brightness, 0 is off and LED_PWM_BRIGHTNESS_MAX is fully on
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of setting the brightness
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type set_led_num_pwm_brightness(struct led_proc_t * led_proc, int led_num_in_array, unsigned short brightness);
+
+
+
+/**************************************************************/
+/**\name	get_led_pwm_timing 		                          */
+/**************************************************************/
+/*!
+ *	@brief This function works out the timing of a PWM channel for a frequency.  It is the only place with a
+ *		divide, so it is meant to be called when a channel is set up or retuned, not per frame.  The timing is
+ *		always filled in, even on an error, so the caller can see what resolution the frequency can give
+ *
+ *	 @param unsigned int - the PWM clock in Hz
+ *	 @param unsigned int - the frequency wanted in Hz
+ *	 @param unsigned int - the least number of steps per frame wanted, 0 for no minimum
+ *	 @param reference to led_pwm_timing_t to pass the timing
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of working out the timing
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> frequency of 0, period longer than LED_PWM_MAX_CYCLES, or fewer
+ *		steps per frame than asked for
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type get_led_pwm_timing(unsigned int clock_hz, unsigned int hertz, unsigned int min_steps, led_pwm_timing_t * timing);
+
+
+
+/**************************************************************/
+/**\name	get_led_pwm_duty_cycles 	                      */
+/**************************************************************/
+/*!
+ *	@brief This function turns a duty cycle into PWM counts with the reciprocal in the timing, for HALs to use
+ *		in led_set_duty_cycle.  No divide, a multiply and a shift
+ *
+ *	 @param led_pwm_timing_t structure pointer.
+ *	 @param int - duty cycle, 0 - LED_PWM_DUTY_MAX, clamped to that range
+ *
+ *
+ *
+ *
+ *	@return unsigned int - counts of the period, 0 - cycles
+ *
+ *
+*/
+unsigned int get_led_pwm_duty_cycles(led_pwm_timing_t * timing, int pwm_dc);
+
+
+
+/**************************************************************/
+/**\name	retune_led_pwm 		                              */
+/**************************************************************/
+/*!
+ *	@brief This function changes the frequency of a running PWM LED without a glitch.  The new timing waits until
+ *		run_led_pwm_frame is next called from the PWM frame interrupt, which writes the new period and the
+ *		duty cycle or brightness scaled to it together, so no frame ever mixes the old and new timing
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param led_t
+ *	 @param led_pwm_timing_t - the new timing, from get_led_pwm_timing
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of queueing the retune
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type retune_led_pwm(struct led_proc_t * led_proc, led_t * led, led_pwm_timing_t * timing);
+
+
+
+/**************************************************************/
+/**\name	retune_led_num_pwm 		                          */
+/**************************************************************/
+/*!
+ *	@brief This function is retune_led_pwm by the number associated with LED in the array
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param int - the place in the LED array
+ *	 @param led_pwm_timing_t - the new timing, from get_led_pwm_timing
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of queueing the retune
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type retune_led_num_pwm(struct led_proc_t * led_proc, int led_num_in_array, led_pwm_timing_t * timing);
+
+
+
+/**************************************************************/
+/**\name	run_led_pwm_frame 		                          */
+/**************************************************************/
+/*!
+ *	@brief This function is to be called from the PWM frame interrupt of a PWM LED.  It applies a pending retune,
+ *		then for a dithered LED adds the fractional compare count to an accumulator and writes the next compare
+ *		value, a constant amount of integer work
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param led_t
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of writing the compare value
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type run_led_pwm_frame(struct led_proc_t * led_proc, led_t * led);
+
+
+
+/**************************************************************/
+/**\name	run_led_num_pwm_frame 		                      */
+/**************************************************************/
+/*!
+ *	@brief This function is run_led_pwm_frame by the number associated with LED in the array
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param int - the place in the LED array
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of writing the compare value
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type run_led_num_pwm_frame(struct led_proc_t * led_proc, int led_num_in_array);
+
+
+
+/**************************************************************/
+/**\name	get_led_state 		                              */
+/**************************************************************/
+/*!
+ *	@brief This function is to get the state of a specific LED
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param led_t needed to get state
+ *	 @param reference to uint8_t to pass the state of the LED
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of getting LED state
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type get_led_state(struct led_proc_t * led_proc, led_t * led, int * led_state);
+
+
+
+/**************************************************************/
+/**\name	get_led_state 		                              */
+/**************************************************************/
+/*!
+ *	@brief This function is to get the state of a specific LED
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param int - led number in array needed to get state
+ *	 @param reference to uint8_t to pass the state of the LED
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of getting LED state
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type get_led_num_state(struct led_proc_t * led_proc, int led_num_in_array, int * led_state);
+
+
+
+
+/**************************************************************/
+/**\name	blink_led 		                                  */
+/**************************************************************/
+/*!
+ *	@brief This function blinks an LED on for on_ms of every period_ms, starting with the on time.  When the HAL
+ *		advertises LED_PROC_CAP_HW_BLINK and can blink this LED it is set up once in hardware and takes no further
+ *		interrupts.  Otherwise an LED_TYPE_OUTPUT LED is blinked from dispatch_led_proc_tick, which needs the
+ *		instance registered, and the times are rounded to the elapsed time it is called with.  Blinking an LED that
+ *		is already blinking changes its timing.  Turning the LED on or off does not stop the blink, see stop_led_blink
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param led_t
+ *	 @param unsigned int - period in ms
+ *	 @param unsigned int - on time in ms, 0 keeps the LED off and period_ms or more keeps it on
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of starting the blink
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_WRONG_TYPE -> not an LED_TYPE_OUTPUT LED, and not one the HAL can blink
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> period_ms is 0, the LED is not in the led_array, or LED_PROC_MAX_BLINKS
+ *		LEDs already blink from the tick
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type blink_led(struct led_proc_t * led_proc, led_t * led, unsigned int period_ms, unsigned int on_ms);
+
+
+
+/**************************************************************/
+/**\name	blink_led_num 		                              */
+/**************************************************************/
+/*!
+ *	@brief This function is the same as blink_led, for the LED at a position in the led_array
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param int - position of the LED in the led_array
+ *	 @param unsigned int - period in ms
+ *	 @param unsigned int - on time in ms
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of starting the blink
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type blink_led_num(struct led_proc_t * led_proc, int led_num_in_array, unsigned int period_ms, unsigned int on_ms);
+
+
+
+/**************************************************************/
+/**\name	stop_led_blink 		                              */
+/**************************************************************/
+/*!
+ *	@brief This function stops the blink of an LED, in hardware or from the tick.  The LED is left where the blink
+ *		was, turn it on or off afterwards
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param led_t
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of stopping the blink
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type stop_led_blink(struct led_proc_t * led_proc, led_t * led);
+
+
+
+/**************************************************************/
+/**\name	stop_led_num_blink 		                          */
+/**************************************************************/
+/*!
+ *	@brief This function is the same as stop_led_blink, for the LED at a position in the led_array
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param int - position of the LED in the led_array
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of stopping the blink
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type stop_led_num_blink(struct led_proc_t * led_proc, int led_num_in_array);
+
+
+
+/**************************************************************/
+/**\name	register_led_proc 		                          */
+/**************************************************************/
+/*!
+ *	@brief This function is to add an instance to the table serviced by dispatch_led_proc_tick.  Each instance
+ *		keeps its own led_tick_period_ms, so banks of LEDs can be updated at different rates from one interrupt.
+ *		Must not run while dispatch_led_proc_tick can, the critical section hooks of the instance are used for that
+ *
+ *	 @param led_proc_t structure pointer.
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of registering the instance
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> the table already holds LED_PROC_MAX_INSTANCES
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type register_led_proc(struct led_proc_t * led_proc);
+
+
+
+/**************************************************************/
+/**\name	unregister_led_proc 		                      */
+/**************************************************************/
+/*!
+ *	@brief This function is to remove an instance from the table serviced by dispatch_led_proc_tick
+ *
+ *	 @param led_proc_t structure pointer.
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of removing the instance
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type unregister_led_proc(struct led_proc_t * led_proc);
+
+
+
+/**************************************************************/
+/**\name	dispatch_led_proc_tick 		                      */
+/**************************************************************/
+/*!
+ *	@brief This function is to be called from a periodic timer interrupt.  It counts down every registered
+ *		instance and calls led_tick of the ones that are due
+ *
+ *	 @param unsigned int - the time in milliseconds since the last call, normally the period of the timer
+ *
+ *
+ *
+ *
+ *	@return none
+ *
+ *
+*/
+void dispatch_led_proc_tick(unsigned int elapsed_ms);
+
+
+
+/**************************************************************/
+/**\name	register_led_proc_dispatch 		                  */
+/**************************************************************/
+/*!
+ *	@brief This function is the same as register_led_proc, for the table of a led_proc_dispatch_t
+ *
+ *	 @param led_proc_dispatch_t structure pointer.
+ *	 @param led_proc_t structure pointer.
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of registering the instance
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> the table already holds LED_PROC_MAX_INSTANCES
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type register_led_proc_dispatch(struct led_proc_dispatch_t * dispatch, struct led_proc_t * led_proc);
+
+
+
+/**************************************************************/
+/**\name	unregister_led_proc_dispatch 		              */
+/**************************************************************/
+/*!
+ *	@brief This function is the same as unregister_led_proc, for the table of a led_proc_dispatch_t
+ *
+ *	 @param led_proc_dispatch_t structure pointer.
+ *	 @param led_proc_t structure pointer.
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of removing the instance
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type unregister_led_proc_dispatch(struct led_proc_dispatch_t * dispatch, struct led_proc_t * led_proc);
+
+
+
+/**************************************************************/
+/**\name	run_led_proc_dispatch 		                      */
+/**************************************************************/
+/*!
+ *	@brief This function is the same as dispatch_led_proc_tick, for the table of a led_proc_dispatch_t.  Tables
+ *		share nothing, so different tables can be run from different threads at once
+ *
+ *	 @param led_proc_dispatch_t structure pointer.
+ *	 @param unsigned int - the time in milliseconds since the last call
+ *
+ *
+ *
+ *
+ *	@return none
+ *
+ *
+*/
+void run_led_proc_dispatch(struct led_proc_dispatch_t * dispatch, unsigned int elapsed_ms);
+
+
+
+/**************************************************************/
+/**\name	set_led_proc_tick_idle 		                      */
+/**************************************************************/
+/*!
+ *	@brief This function marks an instance as having nothing due, so dispatch_led_proc_tick skips it and, once every
+ *		registered instance is idle, stops the tick interrupt through led_set_tick_irq.  Meant to be called from
+ *		led_tick, such as when a pattern has ended or every coroutine waits on an event
+ *
+ *	 @param led_proc_t structure pointer.
+ *
+ *
+ *
+ *
+ *	@return none
+ *
+ *
+*/
+void set_led_proc_tick_idle(struct led_proc_t * led_proc);
+
+
+
+/**************************************************************/
+/**\name	wake_led_proc_tick 		                          */
+/**************************************************************/
+/*!
+ *	@brief This function gives an idle instance its led_tick again, one led_tick_period_ms from now, and starts the
+ *		tick interrupt through led_set_tick_irq if it was stopped.  Safe to call from any context
+ *
+ *	 @param led_proc_t structure pointer.
+ *
+ *
+ *
+ *
+ *	@return none
+ *
+ *
+*/
+void wake_led_proc_tick(struct led_proc_t * led_proc);
+
+
+
+/**************************************************************/
+/**\name	set_led_proc_master_level 	                      */
+/**************************************************************/
+/*!
+ *	@brief This function sets a master level that every PWM LED of the instance is scaled by, such as for a night
+ *		mode or an ambient light sensor.  It is applied with a single multiply wherever a duty cycle or brightness
+ *		is written, so the LEDs can keep being set and faded at full scale and the dimmer never races them.  The
+ *		change itself is constant time, the PWM LEDs are rewritten by the next dispatch_led_proc_tick, which is
+ *		started through led_set_tick_irq if it was stopped, or by commit_led_proc_levels.  LED_TYPE_OUTPUT LEDs
+ *		are on or off and are not scaled
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param unsigned int - level, 0 is off and LED_PROC_LEVEL_FULL, the default, is unscaled
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of setting the level
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> level above LED_PROC_LEVEL_FULL
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type set_led_proc_master_level(struct led_proc_t * led_proc, unsigned int level);
+
+
+
+/**************************************************************/
+/**\name	set_led_proc_group_level 	                      */
+/**************************************************************/
+/*!
+ *	@brief This function sets the level of one group of PWM LEDs, see led_group in led_pwm_state_t, on top of the
+ *		master level.  Only the PWM LEDs of that group are rewritten, see set_led_proc_master_level
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param int - group, 0 - LED_PROC_MAX_GROUPS - 1
+ *	 @param unsigned int - level, 0 is off and LED_PROC_LEVEL_FULL, the default, is unscaled
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of setting the level
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> no such group, or level above LED_PROC_LEVEL_FULL
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type set_led_proc_group_level(struct led_proc_t * led_proc, int group, unsigned int level);
+
+
+
+/**************************************************************/
+/**\name	commit_led_proc_levels 		                      */
+/**************************************************************/
+/*!
+ *	@brief This function rewrites the PWM LEDs of every group whose level changed since the last commit, at their
+ *		last duty cycle or brightness.  Called by dispatch_led_proc_tick for registered instances, and can be
+ *		called directly for the change to land straight away.  Every dirty LED is rewritten even after an error
+ *
+ *	 @param led_proc_t structure pointer.
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of rewriting the LEDs
+ *	@retval 1 -> Success
+ *	@retval all else -> the first error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type commit_led_proc_levels(struct led_proc_t * led_proc);
+
+
+
+/**************************************************************/
+/**\name	save_led_proc_snapshot 		                      */
+/**************************************************************/
+/*!
+ *	@brief This function takes a snapshot of an instance, meant to be kept in retention RAM and called right before
+ *		a deep sleep that keeps it.  The output state, PWM levels and blinks from the tick are taken inside
+ *		led_enter_critical, so they are consistent with each other.  Blinks done in hardware are not kept
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param led_snapshot_t structure pointer.
+ *	 @param unsigned char - version of the application state, restore_led_proc_snapshot must be given the same
+ *	 @param const void pointer - application state to keep with it, may be NULL when app_len is 0
+ *	 @param unsigned int - size of the application state in bytes
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of taking the snapshot, on an error the snapshot is left invalid
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> more than LED_SNAPSHOT_MAX_LEDS LEDs, more than LED_SNAPSHOT_MAX_PWM
+ *		PWM LEDs, or more than LED_SNAPSHOT_APP_SIZE bytes of application state
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type save_led_proc_snapshot(struct led_proc_t * led_proc, led_snapshot_t * snap, unsigned char app_version, const void * app_state, unsigned int app_len);
+
+
+
+/**************************************************************/
+/**\name	restore_led_proc_snapshot 	                      */
+/**************************************************************/
+/*!
+ *	@brief This function puts a snapshot back into an array of LEDs before it is initialized, so the resume costs
+ *		no more than a boot.  init_led_proc_fast then drives the outputs to their saved state, batched per port by
+ *		led_init_outputs, and init_led_proc_deferred starts each PWM LED at its saved period and level.  The array
+ *		must be set up as for init_led_proc, with each PWM LED pointing at its led_pwm_state_t.  A snapshot is only
+ *		resumed once, it is invalidated here whether or not it was valid
+ *
+ *	 @param led_proc_t structure pointer.
+ *	 @param leds - the array of LEDs that will be passed to init_led_proc
+ *	 @param int - the number of LEDs in the array
+ *	 @param led_snapshot_t structure pointer.
+ *	 @param unsigned char - version of the application state, as given to save_led_proc_snapshot
+ *	 @param void pointer - where the application state is copied back to, may be NULL when app_len is 0
+ *	 @param unsigned int - size of the application state in bytes, as given to save_led_proc_snapshot
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of restoring the snapshot, on an error nothing is changed, boot as normal
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> no valid snapshot, or one taken of another array or application state
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type restore_led_proc_snapshot(struct led_proc_t * led_proc, led_t leds[], int num_leds, led_snapshot_t * snap, unsigned char app_version, void * app_state, unsigned int app_len);
 
 #endif /* VENDOR_TEL_TEST_LIB_LED_PROC_H_ */
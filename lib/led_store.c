@@ -0,0 +1,271 @@
+/*
+ * led_store.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+#include "led_store.h"
+
+#ifndef NULL
+#define NULL   ((void *) 0)
+#endif
+
+#define LED_STORE_RECORD_SIZE	((unsigned int)sizeof(led_store_record_t))
+#define LED_STORE_CHECK_OFFSET	1			// check follows the key in led_store_record_t
+#define LED_STORE_SCAN_RECORDS	16			// records read per flash access while scanning
+#define LED_STORE_ALL_KEYS		((1u << LED_STORE_MAX_KEYS) - 1)
+
+static unsigned char led_store_check(unsigned char key, unsigned short value)
+{
+	// CRC-8 over the key and value, enough to reject a record torn by a reset while it was being programmed
+	unsigned char bytes[3] = { key, (unsigned char)(value & 0xFF), (unsigned char)(value >> 8) };
+	unsigned char crc = 0xFF;
+
+	for (int i = 0; i < 3; i++)
+	{
+		crc ^= bytes[i];
+		for (int b = 0; b < 8; b++)
+			crc = (crc & 0x80) ? (unsigned char)((crc << 1) ^ 0x07) : (unsigned char)(crc << 1);
+	}
+
+	// an erased check byte is never valid, so a record whose check was not programmed yet is always rejected
+	return (crc == 0xFF) ? 0x7F : crc;
+}
+
+static int led_store_record_is_empty(led_store_record_t * record)
+{
+	return (record->key == 0xFF && record->check == 0xFF && record->value == 0xFFFF);
+}
+
+static int led_store_record_is_valid(led_store_record_t * record)
+{
+	return (record->check == led_store_check(record->key, record->value));
+}
+
+static unsigned int led_store_sector_addr(struct led_store_t * led_store, int sector)
+{
+	return led_store->store_base_addr + (unsigned int)sector * led_store->store_sector_size;
+}
+
+static led_proc_error_type write_led_store_record(struct led_store_t * led_store, int sector, unsigned int offset, unsigned char key, unsigned short value)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+	unsigned int addr = led_store_sector_addr(led_store, sector) + offset;
+	led_store_record_t record;
+
+	record.key = key;
+	record.check = 0xFF;		// left erased, it is programmed on its own once the rest of the record is
+	record.value = value;
+
+	status = led_store->store_write(addr, (unsigned char *)&record, LED_STORE_RECORD_SIZE);
+	if (status != LED_PROC_ERROR_TYPE_NONE)
+		return status;
+
+	// the check commits the record, a reset before it leaves a record that is never valid however much of the key
+	// and value made it, and a reset part way through it cannot leave the check of another value
+	record.check = led_store_check(key, value);
+	return led_store->store_write(addr + LED_STORE_CHECK_OFFSET, &record.check, 1);
+}
+
+static led_proc_error_type format_led_store(struct led_store_t * led_store)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+
+	status = led_store->store_erase(led_store_sector_addr(led_store, 0));
+	if (status != LED_PROC_ERROR_TYPE_NONE)
+		return status;
+
+	status = write_led_store_record(led_store, 0, 0, LED_STORE_KEY_HEADER, 0);
+	if (status != LED_PROC_ERROR_TYPE_NONE)
+		return status;
+
+	led_store->active_sector = 0;
+	led_store->sector_seq = 0;
+	led_store->write_offset = LED_STORE_RECORD_SIZE;
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type compact_led_store(struct led_store_t * led_store)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+	int next_sector = (led_store->active_sector + 1) % led_store->store_num_sectors;
+	unsigned int offset = LED_STORE_RECORD_SIZE;
+
+	status = led_store->store_erase(led_store_sector_addr(led_store, next_sector));
+	if (status != LED_PROC_ERROR_TYPE_NONE)
+		return status;
+
+	for (int key = 0; key < LED_STORE_MAX_KEYS; key++)
+	{
+		if ((led_store->valid_mask & (1u << key)) == 0)
+			continue;
+
+		status = write_led_store_record(led_store, next_sector, offset, (unsigned char)key, led_store->values[key]);
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+			return status;
+		offset += LED_STORE_RECORD_SIZE;
+	}
+
+	// the header goes in last, so a reset part way through leaves the old sector as the active one
+	status = write_led_store_record(led_store, next_sector, 0, LED_STORE_KEY_HEADER, (unsigned short)(led_store->sector_seq + 1));
+	if (status != LED_PROC_ERROR_TYPE_NONE)
+		return status;
+
+	led_store->active_sector = next_sector;
+	led_store->sector_seq++;
+	led_store->write_offset = offset;
+	led_store->dirty_mask = 0;
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type init_led_store(struct led_store_t * led_store)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+	led_store_record_t records[LED_STORE_SCAN_RECORDS];
+	unsigned int sector_addr;
+	unsigned int offset;
+
+	// NULL checks
+	if (led_store == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (led_store->store_read == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (led_store->store_write == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (led_store->store_erase == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (led_store->store_num_sectors < 2)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	if (led_store->store_sector_size < (LED_STORE_MAX_KEYS + 1) * LED_STORE_RECORD_SIZE)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	led_store->active_sector = -1;
+	led_store->valid_mask = 0;
+	led_store->dirty_mask = 0;
+	led_store->last_write = 0;
+
+	// the active sector is the one with the newest header, sequence numbers are compared so they can wrap
+	for (int sector = 0; sector < led_store->store_num_sectors; sector++)
+	{
+		status = led_store->store_read(led_store_sector_addr(led_store, sector), (unsigned char *)&records[0], LED_STORE_RECORD_SIZE);
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+			return status;
+
+		if (records[0].key != LED_STORE_KEY_HEADER || !led_store_record_is_valid(&records[0]))
+			continue;
+
+		if (led_store->active_sector < 0 || (short)(records[0].value - led_store->sector_seq) > 0)
+		{
+			led_store->active_sector = sector;
+			led_store->sector_seq = records[0].value;
+		}
+	}
+
+	if (led_store->active_sector < 0)
+		return format_led_store(led_store);
+
+	// single backwards scan: skip the erased tail to find the write offset, then the first record seen
+	// for each key on the way back towards the header is its newest value
+	sector_addr = led_store_sector_addr(led_store, led_store->active_sector);
+	offset = led_store->store_sector_size;
+	led_store->write_offset = 0;
+
+	while (offset > LED_STORE_RECORD_SIZE && led_store->valid_mask != LED_STORE_ALL_KEYS)
+	{
+		int num_records = (int)((offset - LED_STORE_RECORD_SIZE) / LED_STORE_RECORD_SIZE);
+		if (num_records > LED_STORE_SCAN_RECORDS)
+			num_records = LED_STORE_SCAN_RECORDS;
+		offset -= (unsigned int)num_records * LED_STORE_RECORD_SIZE;
+
+		status = led_store->store_read(sector_addr + offset, (unsigned char *)records, (unsigned int)num_records * LED_STORE_RECORD_SIZE);
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+			return status;
+
+		for (int i = num_records - 1; i >= 0; i--)
+		{
+			if (led_store->write_offset == 0)
+			{
+				if (led_store_record_is_empty(&records[i]))
+					continue;
+				led_store->write_offset = offset + (unsigned int)(i + 1) * LED_STORE_RECORD_SIZE;
+			}
+
+			if (records[i].key >= LED_STORE_MAX_KEYS || !led_store_record_is_valid(&records[i]))
+				continue;
+			if (led_store->valid_mask & (1u << records[i].key))
+				continue;
+
+			led_store->values[records[i].key] = records[i].value;
+			led_store->valid_mask |= (1u << records[i].key);
+		}
+	}
+
+	if (led_store->write_offset == 0)
+		led_store->write_offset = LED_STORE_RECORD_SIZE;
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type get_led_store_value(struct led_store_t * led_store, int key, unsigned short * value)
+{
+	if (key < 0 || key >= LED_STORE_MAX_KEYS)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	if ((led_store->valid_mask & (1u << key)) == 0)
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	*value = led_store->values[key];
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type set_led_store_value(struct led_store_t * led_store, int key, unsigned short value)
+{
+	if (key < 0 || key >= LED_STORE_MAX_KEYS)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	if ((led_store->valid_mask & (1u << key)) && led_store->values[key] == value)
+		return LED_PROC_ERROR_TYPE_NONE;
+
+	led_store->values[key] = value;
+	led_store->valid_mask |= (1u << key);
+	led_store->dirty_mask |= (1u << key);
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type process_led_store(struct led_store_t * led_store, unsigned int now)
+{
+	if (led_store->dirty_mask == 0)
+		return LED_PROC_ERROR_TYPE_NONE;
+	if ((unsigned int)(now - led_store->last_write) < led_store->store_holdoff)
+		return LED_PROC_ERROR_TYPE_NONE;
+
+	led_store->last_write = now;
+
+	return flush_led_store(led_store);
+}
+
+led_proc_error_type flush_led_store(struct led_store_t * led_store)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+
+	for (int key = 0; key < LED_STORE_MAX_KEYS && led_store->dirty_mask != 0; key++)
+	{
+		if ((led_store->dirty_mask & (1u << key)) == 0)
+			continue;
+
+		// sector is full, compaction writes the latest value of every key so nothing is left dirty
+		if (led_store->write_offset + LED_STORE_RECORD_SIZE > led_store->store_sector_size)
+			return compact_led_store(led_store);
+
+		status = write_led_store_record(led_store, led_store->active_sector, led_store->write_offset, (unsigned char)key, led_store->values[key]);
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+			return status;
+
+		led_store->write_offset += LED_STORE_RECORD_SIZE;
+		led_store->dirty_mask &= ~(1u << key);
+	}
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
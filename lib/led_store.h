@@ -0,0 +1,192 @@
+/*
+ * led_store.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef VENDOR_TEL_TEST_LIB_LED_STORE_H_
+#define VENDOR_TEL_TEST_LIB_LED_STORE_H_
+
+#include "led_proc.h"
+
+#define LED_STORE_MAX_KEYS		8			// keys are 0 .. LED_STORE_MAX_KEYS - 1, defined by the application
+#define LED_STORE_KEY_HEADER	0xFE		// reserved key, first record of every valid sector
+#define LED_STORE_EMPTY_WORD	0xFFFFFFFF	// erased flash reads back as all 1s
+
+typedef struct led_store_record_t {
+	unsigned char key;
+	unsigned char check;
+	unsigned short value;
+}led_store_record_t;
+
+
+
+/**************************************************************/
+/**\name	led_store_t   			                          */
+/**************************************************************/
+/*!
+ *	@brief This struct keeps the LED store generic in the same way as led_proc_t.  Values are kept
+ *	in an append-only log of 4 byte records spread over a ring of erase sectors.  Only the newest
+ *	record of a key is valid, so a value change costs one record write instead of a sector erase.
+ *	When the active sector fills up, the next sector in the ring is erased and the latest value of
+ *	every key is copied into it, which levels the erase cycles across all of the sectors.
+ *
+ *	 @param store_read
+ *	 	reads len bytes of flash at the absolute address into the buffer
+ *
+ *	 @param store_write
+ *	 	programs len bytes of flash at the absolute address.  The area is always erased before it is written
+ *
+ *	 @param store_erase
+ *	 	erases the sector starting at the absolute address
+ *
+ *	 @param store_base_addr
+ *	 	flash address of the first sector of the ring
+ *
+ *	 @param store_sector_size
+ *	 	size of an erase sector in bytes
+ *
+ *	 @param store_num_sectors
+ *	 	number of sectors in the ring, must be at least 2
+ *
+ *	 @param store_holdoff
+ *	 	minimum time between two log writes, in the same time base as the now passed to process_led_store.
+ *	 	Changes made within the holdoff are coalesced and only the latest value is written
+ *
+ *	 The remaining fields are maintained by the store and should not be touched by the application
+ *
+*/
+typedef struct led_store_t {
+	led_proc_error_type (*store_read)(unsigned int, unsigned char*, unsigned int);
+	led_proc_error_type (*store_write)(unsigned int, unsigned char*, unsigned int);
+	led_proc_error_type (*store_erase)(unsigned int);
+	unsigned int store_base_addr;
+	unsigned int store_sector_size;
+	int store_num_sectors;
+	unsigned int store_holdoff;
+
+	int active_sector;
+	unsigned short sector_seq;
+	unsigned int write_offset;
+	unsigned int last_write;
+	unsigned int valid_mask;
+	unsigned int dirty_mask;
+	unsigned short values[LED_STORE_MAX_KEYS];
+}led_store_t;
+
+
+
+/**************************************************************/
+/**\name	init_led_store			                          */
+/**************************************************************/
+/*!
+ *	@brief This function finds the active sector and restores the latest value of every key with a single
+ *		backwards scan from the end of the log.  If no valid sector is found the first sector is formatted
+ *
+ *	 @param led_store_t structure pointer.
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - results of the restore
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type init_led_store(struct led_store_t * led_store);
+
+
+
+/**************************************************************/
+/**\name	get_led_store_value		                          */
+/**************************************************************/
+/*!
+ *	@brief This function gets the latest value of a key, including values not yet written to flash
+ *
+ *	 @param led_store_t structure pointer.
+ *	 @param int - the key
+ *	 @param reference to unsigned short to pass the value
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of getting the value
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_NULL -> nothing has been stored for the key
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type get_led_store_value(struct led_store_t * led_store, int key, unsigned short * value);
+
+
+
+/**************************************************************/
+/**\name	set_led_store_value		                          */
+/**************************************************************/
+/*!
+ *	@brief This function sets the value of a key.  Nothing is written to flash here, the key is only marked
+ *		dirty when the value changes, so it is cheap enough to call on every change.  Not meant to be called
+ *		from an interrupt
+ *
+ *	 @param led_store_t structure pointer.
+ *	 @param int - the key
+ *	 @param unsigned short - the value
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of setting the value
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type set_led_store_value(struct led_store_t * led_store, int key, unsigned short value);
+
+
+
+/**************************************************************/
+/**\name	process_led_store		                          */
+/**************************************************************/
+/*!
+ *	@brief This function appends the dirty keys to the log once the holdoff has passed since the last write.
+ *		Meant to be called from the main loop
+ *
+ *	 @param led_store_t structure pointer.
+ *	 @param unsigned int - the current time, in the same time base as store_holdoff
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of writing the log
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type process_led_store(struct led_store_t * led_store, unsigned int now);
+
+
+
+/**************************************************************/
+/**\name	flush_led_store			                          */
+/**************************************************************/
+/*!
+ *	@brief This function appends all dirty keys to the log right away, ignoring the holdoff
+ *
+ *	 @param led_store_t structure pointer.
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of writing the log
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type flush_led_store(struct led_store_t * led_store);
+
+#endif /* VENDOR_TEL_TEST_LIB_LED_STORE_H_ */
@@ -0,0 +1,263 @@
+/*
+ * led_trace.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+#include "led_trace.h"
+
+#ifndef NULL
+#define NULL   ((void *) 0)
+#endif
+
+#define LED_TRACE_VCD_ID_FIRST	'!'		// VCD identifiers are the printable characters from here on
+
+led_proc_error_type flush_led_trace(struct led_trace_t * trace)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+
+	if (trace == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (trace->trace_buf_len == 0)
+		return LED_PROC_ERROR_TYPE_NONE;
+
+	status = trace->trace_write(trace->trace_context, trace->trace_buf, trace->trace_buf_len);
+	trace->trace_stats.trace_flushes++;
+	if (status == LED_PROC_ERROR_TYPE_NONE)
+		trace->trace_stats.trace_bytes += trace->trace_buf_len;
+	else
+		trace->trace_stats.trace_write_errors++;
+
+	// dropped on an error as well, a trace that stops being written must not stop the LEDs
+	trace->trace_buf_len = 0;
+	return status;
+}
+
+static void put_led_trace_char(struct led_trace_t * trace, char c)
+{
+	if (trace->trace_buf_len >= LED_TRACE_BUF_SIZE)
+		flush_led_trace(trace);
+	trace->trace_buf[trace->trace_buf_len++] = (unsigned char)c;
+}
+
+static void put_led_trace_text(struct led_trace_t * trace, const char * text)
+{
+	while (*text != '\0')
+		put_led_trace_char(trace, *text++);
+}
+
+static void put_led_trace_number(struct led_trace_t * trace, unsigned long long number, int min_digits)
+{
+	char digits[20];
+	int len = 0;
+
+	do
+	{
+		digits[len++] = (char)('0' + number % 10);
+		number /= 10;
+	} while (number != 0 || len < min_digits);
+
+	while (len > 0)
+		put_led_trace_char(trace, digits[--len]);
+}
+
+static void put_led_trace_binary(struct led_trace_t * trace, unsigned int value, int bits)
+{
+	int bit = bits - 1;
+
+	// VCD drops leading zeros of a vector
+	while (bit > 0 && !(value & (1u << bit)))
+		bit--;
+	for (; bit >= 0; bit--)
+		put_led_trace_char(trace, (value & (1u << bit)) ? '1' : '0');
+}
+
+static void put_led_trace_vcd_value(struct led_trace_t * trace, int track, int known)
+{
+	led_trace_track_t * entry = &trace->trace_tracks[track];
+
+	if (entry->track_bits == 1)
+	{
+		put_led_trace_char(trace, !known ? 'x' : (entry->track_value ? '1' : '0'));
+	}
+	else
+	{
+		put_led_trace_char(trace, 'b');
+		if (known)
+			put_led_trace_binary(trace, entry->track_value, entry->track_bits);
+		else
+			put_led_trace_char(trace, 'x');
+		put_led_trace_char(trace, ' ');
+	}
+	put_led_trace_char(trace, (char)(LED_TRACE_VCD_ID_FIRST + track));
+	put_led_trace_char(trace, '\n');
+}
+
+static void put_led_trace_json_value(struct led_trace_t * trace, int track, unsigned long long time_ps)
+{
+	led_trace_track_t * entry = &trace->trace_tracks[track];
+
+	// a counter event per change, Perfetto gives every counter name a track of its own.  ts is in microseconds
+	put_led_trace_text(trace, ",\n{\"name\":\"");
+	put_led_trace_text(trace, entry->track_name);
+	put_led_trace_text(trace, "\",\"ph\":\"C\",\"pid\":1,\"ts\":");
+	put_led_trace_number(trace, time_ps / 1000000, 1);
+	put_led_trace_char(trace, '.');
+	put_led_trace_number(trace, (time_ps / 1000) % 1000, 3);
+	put_led_trace_text(trace, ",\"args\":{\"value\":");
+	put_led_trace_number(trace, entry->track_value, 1);
+	put_led_trace_text(trace, "}}");
+}
+
+led_proc_error_type init_led_trace(struct led_trace_t * trace, led_trace_format format, unsigned int tick_hz,
+		led_proc_error_type (*write)(void *, const unsigned char *, unsigned int), void * context)
+{
+	if (trace == NULL || write == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (tick_hz == 0)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	trace->trace_write = write;
+	trace->trace_clock = NULL;
+	trace->trace_context = context;
+	trace->trace_format = format;
+	// the only divide, rounded to the nearest picosecond, which is well under a part per million for any MCU clock
+	trace->trace_tick_ps = (unsigned int)((1000000000000ULL + tick_hz / 2) / tick_hz);
+	trace->trace_started = 0;
+	trace->trace_num_tracks = 0;
+	trace->trace_buf_len = 0;
+	trace->trace_stats.trace_events = 0;
+	trace->trace_stats.trace_changes = 0;
+	trace->trace_stats.trace_bytes = 0;
+	trace->trace_stats.trace_flushes = 0;
+	trace->trace_stats.trace_write_errors = 0;
+	trace->trace_stats.trace_ticks = 0;
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type add_led_trace_track(struct led_trace_t * trace, const char * name, int bits)
+{
+	led_trace_track_t * entry;
+
+	if (trace == NULL || name == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (trace->trace_started || trace->trace_num_tracks >= LED_TRACE_MAX_TRACKS || bits < 1 || bits > 32)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	entry = &trace->trace_tracks[trace->trace_num_tracks++];
+	entry->track_name = name;
+	entry->track_bits = (unsigned char)bits;
+	entry->track_logged = 0;
+	entry->track_value = 0;
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type start_led_trace(struct led_trace_t * trace, unsigned int tick)
+{
+	if (trace == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (trace->trace_started)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	trace->trace_last_tick = tick;
+	trace->trace_ticks_total = 0;
+	trace->trace_time_written = 0;
+	for (int i = 0; i < trace->trace_num_tracks; i++)
+		trace->trace_tracks[i].track_logged = 0;
+
+	if (trace->trace_format == LED_TRACE_FORMAT_VCD)
+	{
+		put_led_trace_text(trace, "$timescale 1 ps $end\n$scope module leds $end\n");
+		for (int i = 0; i < trace->trace_num_tracks; i++)
+		{
+			put_led_trace_text(trace, "$var wire ");
+			put_led_trace_number(trace, trace->trace_tracks[i].track_bits, 1);
+			put_led_trace_char(trace, ' ');
+			put_led_trace_char(trace, (char)(LED_TRACE_VCD_ID_FIRST + i));
+			put_led_trace_char(trace, ' ');
+			put_led_trace_text(trace, trace->trace_tracks[i].track_name);
+			put_led_trace_text(trace, " $end\n");
+		}
+		put_led_trace_text(trace, "$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n");
+		for (int i = 0; i < trace->trace_num_tracks; i++)
+			put_led_trace_vcd_value(trace, i, 0);
+		put_led_trace_text(trace, "$end\n");
+	}
+	else
+	{
+		// the array is left open by a trace cut short, which the trace viewers accept
+		put_led_trace_text(trace, "[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"leds\"}}");
+	}
+
+	trace->trace_started = 1;
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type log_led_trace(struct led_trace_t * trace, int track, unsigned int tick, unsigned int value)
+{
+	led_trace_track_t * entry;
+	unsigned int clock_start = 0;
+	unsigned long long time_ps;
+
+	if (trace == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (!trace->trace_started || track < 0 || track >= trace->trace_num_tracks)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+
+	if (trace->trace_clock != NULL)
+		clock_start = trace->trace_clock();
+	trace->trace_stats.trace_events++;
+
+	// extended to 64 bits from the difference, so the tick may wrap any number of times between changes
+	if ((int)(tick - trace->trace_last_tick) > 0)
+	{
+		trace->trace_ticks_total += tick - trace->trace_last_tick;
+		trace->trace_last_tick = tick;
+	}
+
+	entry = &trace->trace_tracks[track];
+	if (entry->track_bits < 32)
+		value &= (1u << entry->track_bits) - 1;
+
+	if (!entry->track_logged || entry->track_value != value)
+	{
+		entry->track_logged = 1;
+		entry->track_value = value;
+		trace->trace_stats.trace_changes++;
+		time_ps = trace->trace_ticks_total * trace->trace_tick_ps;
+
+		if (trace->trace_format == LED_TRACE_FORMAT_VCD)
+		{
+			if (time_ps != trace->trace_time_written)
+			{
+				put_led_trace_char(trace, '#');
+				put_led_trace_number(trace, time_ps, 1);
+				put_led_trace_char(trace, '\n');
+				trace->trace_time_written = time_ps;
+			}
+			put_led_trace_vcd_value(trace, track, 1);
+		}
+		else
+		{
+			put_led_trace_json_value(trace, track, time_ps);
+		}
+	}
+
+	if (trace->trace_clock != NULL)
+		trace->trace_stats.trace_ticks += trace->trace_clock() - clock_start;
+
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+led_proc_error_type end_led_trace(struct led_trace_t * trace)
+{
+	if (trace == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+
+	if (trace->trace_started && trace->trace_format == LED_TRACE_FORMAT_JSON)
+		put_led_trace_text(trace, "\n]\n");
+	trace->trace_started = 0;
+
+	return flush_led_trace(trace);
+}
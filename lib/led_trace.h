@@ -0,0 +1,231 @@
+/*
+ * led_trace.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef VENDOR_TEL_TEST_LIB_LED_TRACE_H_
+#define VENDOR_TEL_TEST_LIB_LED_TRACE_H_
+
+#include "led_proc.h"
+
+#ifndef LED_TRACE_MAX_TRACKS
+#define LED_TRACE_MAX_TRACKS		32		// at most 94, a VCD identifier is a single printable character
+#endif
+
+#ifndef LED_TRACE_BUF_SIZE
+#define LED_TRACE_BUF_SIZE			256		// bytes gathered before trace_write is called
+#endif
+
+typedef enum LED_TRACE_FORMATS {
+	LED_TRACE_FORMAT_VCD,			// Value Change Dump, for GTKWave
+	LED_TRACE_FORMAT_JSON			// Chrome trace event JSON, for Perfetto or chrome://tracing
+}led_trace_format;
+
+// a signal of the trace, such as an LED pin, a PWM compare or an interrupt being serviced
+typedef struct led_trace_track_t {
+	const char * track_name;
+	unsigned char track_bits;		// 1 for a pin or an interrupt, up to 32 for a level
+	unsigned char track_logged;		// a value has been written since start_led_trace
+	unsigned int track_value;		// last value written
+}led_trace_track_t;
+
+// what a trace has cost, read from trace_stats at any time
+typedef struct led_trace_stats_t {
+	unsigned int trace_events;			// calls to log_led_trace
+	unsigned int trace_changes;			// of those, the ones that changed a value and were written out
+	unsigned int trace_bytes;			// bytes handed to trace_write
+	unsigned int trace_flushes;			// calls to trace_write
+	unsigned int trace_write_errors;	// calls to trace_write that failed, their bytes are lost
+	unsigned int trace_ticks;			// time spent in log_led_trace, in trace_clock ticks, 0 without trace_clock
+}led_trace_stats_t;
+
+
+
+/**************************************************************/
+/**\name	led_trace_t   			                          */
+/**************************************************************/
+/*!
+ *	@brief This struct streams a timeline of LED and interrupt activity out through trace_write as it is logged,
+ *	so a trace as long as a whole simulated hour never has to be held in memory.  Only changes are written, and
+ *	they are gathered in trace_buf so trace_write is called once per LED_TRACE_BUF_SIZE bytes
+ *
+ *	 @param trace_write
+ *	 	for writing out a block of the trace, such as to a file on a host or to a UART.  Called from log_led_trace,
+ *	 	flush_led_trace and end_led_trace
+ *
+ *	 @param trace_clock
+ *	 	OPTIONAL, may be left NULL.  A free running clock, read on the way in and out of log_led_trace to add up what
+ *	 	the trace costs in trace_ticks
+ *
+ *	 @param trace_context
+ *	 	OPTIONAL, may be left NULL.  Passed to trace_write, such as the file being written
+ *
+ *	 All of the other fields are maintained by the trace functions and should not be touched.  A trace is not
+ *	 reentrant, the caller must keep log_led_trace from interrupting itself, such as by masking interrupts around it
+ *
+*/
+typedef struct led_trace_t {
+	led_proc_error_type (*trace_write)(void * context, const unsigned char * data, unsigned int len);
+	unsigned int (*trace_clock)(void);
+	void * trace_context;
+	led_trace_format trace_format;
+	unsigned int trace_tick_ps;					// picoseconds per tick of the times given to log_led_trace
+	unsigned int trace_last_tick;
+	unsigned long long trace_ticks_total;		// ticks since start_led_trace, 32 bit ticks wrap within minutes
+	unsigned long long trace_time_written;		// time of the last VCD timestamp written
+	unsigned char trace_started;
+	unsigned char trace_num_tracks;
+	led_trace_track_t trace_tracks[LED_TRACE_MAX_TRACKS];
+	led_trace_stats_t trace_stats;
+	unsigned int trace_buf_len;
+	unsigned char trace_buf[LED_TRACE_BUF_SIZE];
+}led_trace_t;
+
+
+
+/**************************************************************/
+/**\name	init_led_trace			                          */
+/**************************************************************/
+/*!
+ *	@brief This function gets a trace ready to have its tracks added
+ *
+ *	 @param led_trace_t structure pointer.
+ *	 @param led_trace_format - format written out
+ *	 @param unsigned int - rate of the ticks given to log_led_trace in Hz, such as 16000000 for clock_time()
+ *	 @param trace_write - function that writes out a block of the trace
+ *	 @param void pointer - passed to trace_write, may be NULL
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of setting up the trace
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> a tick rate of 0
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type init_led_trace(struct led_trace_t * trace, led_trace_format format, unsigned int tick_hz,
+		led_proc_error_type (*write)(void *, const unsigned char *, unsigned int), void * context);
+
+
+
+/**************************************************************/
+/**\name	add_led_trace_track		                          */
+/**************************************************************/
+/*!
+ *	@brief This function adds a track to a trace before it is started.  Tracks are numbered from 0 in the order
+ *		they are added, and that number is passed to log_led_trace
+ *
+ *	 @param led_trace_t structure pointer.
+ *	 @param const char pointer - name of the track, kept by reference, with no spaces, quotes or backslashes
+ *	 @param int - width in bits, 1 - 32
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of adding the track
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> the trace is started, already has LED_TRACE_MAX_TRACKS, or the width
+ *		is out of range
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type add_led_trace_track(struct led_trace_t * trace, const char * name, int bits);
+
+
+
+/**************************************************************/
+/**\name	start_led_trace			                          */
+/**************************************************************/
+/*!
+ *	@brief This function writes the header of the trace and starts its timeline at a tick, every track starts
+ *		out unknown until it is first logged
+ *
+ *	 @param led_trace_t structure pointer.
+ *	 @param unsigned int - tick the timeline starts at
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of starting the trace
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> already started
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type start_led_trace(struct led_trace_t * trace, unsigned int tick);
+
+
+
+/**************************************************************/
+/**\name	log_led_trace			                          */
+/**************************************************************/
+/*!
+ *	@brief This function logs the value of a track at a tick.  Nothing is written when the value has not changed.
+ *		Ticks may wrap, and a tick earlier than the last one, such as from an interrupt that read the clock late,
+ *		is logged at the time of the last one
+ *
+ *	 @param led_trace_t structure pointer.
+ *	 @param int - track number, from add_led_trace_track
+ *	 @param unsigned int - tick of the change
+ *	 @param unsigned int - value, only the low bits of the width of the track are kept
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of logging the value
+ *	@retval 1 -> Success
+ *	@retval LED_PROC_ERROR_TYPE_BAD_STATE -> not started, or no such track
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type log_led_trace(struct led_trace_t * trace, int track, unsigned int tick, unsigned int value);
+
+
+
+/**************************************************************/
+/**\name	flush_led_trace			                          */
+/**************************************************************/
+/*!
+ *	@brief This function writes out whatever is gathered in the buffer
+ *
+ *	 @param led_trace_t structure pointer.
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of trace_write, LED_PROC_ERROR_TYPE_NONE when there was nothing to write
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type flush_led_trace(struct led_trace_t * trace);
+
+
+
+/**************************************************************/
+/**\name	end_led_trace			                          */
+/**************************************************************/
+/*!
+ *	@brief This function closes the trace and flushes it, it can then be started again for a new timeline
+ *
+ *	 @param led_trace_t structure pointer.
+ *
+ *
+ *
+ *
+ *	@return led_proc_error_type - result of the last trace_write
+ *	@retval 1 -> Success
+ *	@retval all else -> Error (see descriptions above
+ *
+ *
+*/
+led_proc_error_type end_led_trace(struct led_trace_t * trace);
+
+#endif /* VENDOR_TEL_TEST_LIB_LED_TRACE_H_ */
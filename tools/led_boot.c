@@ -0,0 +1,113 @@
+/*
+ * led_boot.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host run of init_led_lib on the virtual B85 of tools/sim, to see what the boot costs.  Built from the repository
+ * root:
+ *
+ *	gcc -Itools/sim -Ilib -I. -o led_boot tools/led_boot.c tools/sim/tl_sim.c tools/sim/tl_flash.c lib/led_lib.c \
+ *		lib/led_proc.c lib/led_store.c lib/led_color.c lib/button_proc.c lib/led_coro.c lib/led_pattern.c lib/led_trace.c
+ *	led_boot [-v]
+ *
+ *	-v	print every driver call and register access of the boot
+ *
+ * Prints each boot phase of get_led_boot_timestamp with the driver calls, register accesses and estimated cycles
+ * it took, and when the first LED was driven.  The cycles are the rough costs of tl_sim.h for the driver calls and
+ * register accesses alone, the code of the library between them is not counted, and neither is the time the flash
+ * takes to erase the store sector on the first boot.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "tl_sim.h"
+#include "tl_flash.h"
+#include "led_lib.h"
+#include "led_proc.h"
+
+#define MAX_BOOT_EVENTS		4096
+
+typedef struct boot_event_t {
+	tl_sim_time_t at;
+	unsigned long driver_calls;
+	unsigned long reg_accesses;
+	unsigned long long cycles;
+}boot_event_t;
+
+static boot_event_t boot_events[MAX_BOOT_EVENTS];
+static int num_boot_events;
+static tl_sim_time_t first_led_at;
+static int verbose;
+
+extern struct led_proc_t led_proc;
+void irq_handler(void);
+
+static const char * const boot_phase_names[LED_BOOT_NUM_PHASES] = {
+	[LED_BOOT_PHASE_START] = "start",
+	[LED_BOOT_PHASE_FIRST_FRAME] = "first frame",
+	[LED_BOOT_PHASE_PWM_STARTED] = "pwm started",
+	[LED_BOOT_PHASE_STATE_RESTORED] = "state restored",
+	[LED_BOOT_PHASE_TIMER_STARTED] = "timer started"
+};
+
+static void trace_boot(const char * what)
+{
+	// the event before this one has been done by now, so this is when its pin write shows
+	for (int i = 0; first_led_at == 0 && led_proc.led_array != NULL && i < led_proc.num_leds; i++)
+	{
+		if (led_proc.led_array[i].led_type == LED_TYPE_OUTPUT && tl_sim_output_level(led_proc.led_array[i].led_ptr) >= 0)
+			first_led_at = tl_sim_now;
+	}
+
+	if (verbose)
+		printf("%10.3f us  %s\n", (double)tl_sim_now * 1000000 / TL_SIM_HZ, what);
+	if (num_boot_events == MAX_BOOT_EVENTS)
+		return;
+	boot_events[num_boot_events].at = tl_sim_now;
+	boot_events[num_boot_events].driver_calls = tl_sim_stats.driver_calls;
+	boot_events[num_boot_events].reg_accesses = tl_sim_stats.reg_accesses;
+	boot_events[num_boot_events].cycles = tl_sim_stats.cycles;
+	num_boot_events++;
+}
+
+// the stats as they were at a time of the boot
+static boot_event_t get_boot_event(tl_sim_time_t at)
+{
+	boot_event_t event = { 0 };
+
+	for (int i = 0; i < num_boot_events && boot_events[i].at <= at; i++)
+		event = boot_events[i];
+	return event;
+}
+
+int main(int argc, char ** argv)
+{
+	boot_event_t last;
+
+	verbose = (argc > 1 && strcmp(argv[1], "-v") == 0);
+
+	tl_sim_reset();
+	tl_flash_reset();
+	tl_sim_set_irq_handler(irq_handler);
+	tl_sim_set_trace(trace_boot);
+	// the boot starts a little way in, so a pin driven by the very first access still shows up
+	tl_sim_now = 1;
+	init_led_lib();
+	tl_sim_set_trace(NULL);
+
+	printf("%-16s %10s %8s %8s %8s\n", "phase", "us", "calls", "regs", "cycles");
+	last = get_boot_event(0);
+	for (int phase = 0; phase < LED_BOOT_NUM_PHASES; phase++)
+	{
+		tl_sim_time_t at = (tl_sim_time_t)get_led_boot_timestamp((led_boot_phase)phase) * (TL_SIM_HZ / CLOCK_16M_SYS_TIMER_CLK_1S);
+		boot_event_t event = get_boot_event(at);
+
+		printf("%-16s %10.3f %8lu %8lu %8llu\n", boot_phase_names[phase], (double)at * 1000000 / TL_SIM_HZ,
+				event.driver_calls - last.driver_calls, event.reg_accesses - last.reg_accesses, event.cycles - last.cycles);
+		last = event;
+	}
+	printf("%-16s %10.3f %8lu %8lu %8llu\n", "total", (double)tl_sim_now * 1000000 / TL_SIM_HZ,
+			tl_sim_stats.driver_calls, tl_sim_stats.reg_accesses, tl_sim_stats.cycles);
+	printf("first LED driven at %.3f us\n", (double)first_led_at * 1000000 / TL_SIM_HZ);
+
+	return 0;
+}
@@ -0,0 +1,863 @@
+/*
+ * led_conform.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Differential conformance check of led_proc against a reference model of its documented semantics, built from the
+ * repository root with the led_proc.c to be checked:
+ *
+ *	gcc -O2 -Wno-cpp -Itools/sim -Ilib -o led_conform tools/led_conform.c lib/led_proc.c
+ *	led_conform [-n sequences] [-l ops] [-s seed] [-v]
+ *
+ *	-n	number of random op sequences, 100000 by default
+ *	-l	most ops in a sequence, 100 by default
+ *	-s	seed of the first sequence, each sequence after it uses the next seed
+ *	-v	print every op, to follow a single sequence given with -s and -n 1
+ *
+ * Every sequence sets up a random array of 1 to CONFORM_MAX_LEDS output and PWM LEDs with a HAL that keeps the pins
+ * in memory, some of them with faults: a pin write or read that fails with an error code, a pin that does not follow
+ * what it is driven to, or a duty cycle write that fails.  Then random ops are run on led_proc and on the model, the
+ * by pointer, by number, list, mask and handle calls, and after each op the return codes, the failed bitmaps of the
+ * mask calls, the led_output_state and duty cycle of every LED and every pin and duty cycle the HAL was left with
+ * must be the same.  The first difference is printed with the seed of its sequence and the op, and led_conform
+ * exits with 1.
+ *
+ * The model is written out from the current behaviour, quirks included, so a fast path can only be taken when it
+ * changes nothing a caller can see:
+ *	- LED_PROC_ERROR_TYPE_NONE is 1 and toggle_led_ensure and toggle_led_num_ensure OR codes into a status that
+ *	  started as NONE, so a failed read comes back as the code with bit 0 set, and a BAD_STATE by number as UNKNOWN
+ *	- turn_leds_nums_on leaves every LED it reached at LED_ON, even the one that failed for being the wrong type
+ *	- turn_led_num_off, the by pointer calls and the handle calls do not check the type of the LED
+ *	- the list calls stop at the first error, the mask calls carry on and report every LED that failed
+ * It is single threaded, concurrent toggles are covered by tools/tests/test_led_threads.c.  Build with
+ * -DLED_PROC_HAS_ATOMIC_CAS=0 or -DLED_PROC_CHECK_HANDLES=1 to check those builds, which must not change the results
+ * as only valid handles are used.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "led_proc.h"
+
+#define CONFORM_MAX_LEDS		70		// spans three mask words
+#define CONFORM_MAX_WORDS		(LED_PROC_MASK_WORDS(CONFORM_MAX_LEDS) + 1)		// one past the array, to hit the overflow check
+#define CONFORM_MAX_LIST		8
+
+typedef enum CONFORM_OPS {
+	CONFORM_OP_TURN_ON,
+	CONFORM_OP_TURN_OFF,
+	CONFORM_OP_TURNS_ON,
+	CONFORM_OP_TURNS_OFF,
+	CONFORM_OP_NUM_ON,
+	CONFORM_OP_NUM_OFF,
+	CONFORM_OP_NUMS_ON,
+	CONFORM_OP_NUMS_OFF,
+	CONFORM_OP_TOGGLE,
+	CONFORM_OP_TOGGLES,
+	CONFORM_OP_NUM_TOGGLE,
+	CONFORM_OP_NUMS_TOGGLE,
+	CONFORM_OP_MASK_ON,
+	CONFORM_OP_MASK_OFF,
+	CONFORM_OP_MASK_TOGGLE,
+	CONFORM_OP_MASK_DUTY,
+	CONFORM_OP_DUTY,
+	CONFORM_OP_NUM_DUTY,
+	CONFORM_OP_NUMS_DUTY,
+	CONFORM_OP_GET_STATE,
+	CONFORM_OP_OUTPUT_HANDLE,
+	CONFORM_OP_PWM_HANDLE,
+	CONFORM_OP_HANDLE_ON,
+	CONFORM_OP_HANDLE_OFF,
+	CONFORM_OP_HANDLE_TOGGLE,
+	CONFORM_OP_HANDLE_DUTY,
+	CONFORM_OP_FAULT,
+	CONFORM_NUM_OPS
+}conform_op_type;
+
+static const char * const conform_op_names[CONFORM_NUM_OPS] = {
+	[CONFORM_OP_TURN_ON] = "turn_led_on",
+	[CONFORM_OP_TURN_OFF] = "turn_led_off",
+	[CONFORM_OP_TURNS_ON] = "turn_leds_on",
+	[CONFORM_OP_TURNS_OFF] = "turn_leds_off",
+	[CONFORM_OP_NUM_ON] = "turn_led_num_on",
+	[CONFORM_OP_NUM_OFF] = "turn_led_num_off",
+	[CONFORM_OP_NUMS_ON] = "turn_leds_nums_on",
+	[CONFORM_OP_NUMS_OFF] = "turn_leds_nums_off",
+	[CONFORM_OP_TOGGLE] = "toggle_led_ensure",
+	[CONFORM_OP_TOGGLES] = "toggle_leds_ensure",
+	[CONFORM_OP_NUM_TOGGLE] = "toggle_led_num_ensure",
+	[CONFORM_OP_NUMS_TOGGLE] = "toggle_leds_nums_ensure",
+	[CONFORM_OP_MASK_ON] = "turn_leds_mask_on",
+	[CONFORM_OP_MASK_OFF] = "turn_leds_mask_off",
+	[CONFORM_OP_MASK_TOGGLE] = "toggle_leds_mask",
+	[CONFORM_OP_MASK_DUTY] = "set_leds_mask_pwm_duty_cycle",
+	[CONFORM_OP_DUTY] = "set_led_pwm_duty_cycle",
+	[CONFORM_OP_NUM_DUTY] = "set_led_num_pwm_duty_cycle",
+	[CONFORM_OP_NUMS_DUTY] = "set_led_nums_pwm_duty_cycle",
+	[CONFORM_OP_GET_STATE] = "get_led_num_state",
+	[CONFORM_OP_OUTPUT_HANDLE] = "get_led_output_handle",
+	[CONFORM_OP_PWM_HANDLE] = "get_led_pwm_handle",
+	[CONFORM_OP_HANDLE_ON] = "turn_led_handle_on",
+	[CONFORM_OP_HANDLE_OFF] = "turn_led_handle_off",
+	[CONFORM_OP_HANDLE_TOGGLE] = "toggle_led_handle",
+	[CONFORM_OP_HANDLE_DUTY] = "set_led_handle_duty_cycle",
+	[CONFORM_OP_FAULT] = "fault"
+};
+
+// what the HAL does wrong for an LED, the same for both sides
+typedef struct conform_fault_t {
+	unsigned char set_fault;		// error code led_set_polarity and led_set_outputs return, 0 for none
+	unsigned char get_fault;		// error code led_get_state returns
+	unsigned char duty_fault;		// error code led_set_duty_cycle returns
+	unsigned char stuck;			// the pin keeps its level whatever it is driven to
+}conform_fault_t;
+
+typedef struct conform_op_t {
+	conform_op_type type;
+	int num;						// the LED, or the LED a handle is asked for
+	int list[CONFORM_MAX_LIST];
+	int list_len;
+	unsigned int mask[CONFORM_MAX_WORDS];
+	int num_words;
+	int with_failed;				// pass a failed bitmap to the mask calls
+	int pwm_dc;
+	conform_fault_t fault;
+}conform_op_t;
+
+typedef struct conform_result_t {
+	led_proc_error_type status;
+	unsigned int failed[CONFORM_MAX_WORDS];
+	int state;						// pin read by CONFORM_OP_GET_STATE
+}conform_result_t;
+
+// the LEDs as the model sees them, and the pins and duty cycles its HAL was left with
+typedef struct model_led_t {
+	int type;
+	int state;
+	int duty_cycle;
+	int pin;
+	int hal_duty;
+}model_led_t;
+
+static conform_fault_t conform_faults[CONFORM_MAX_LEDS];
+static int conform_num_leds;
+static int conform_batched;			// led_set_outputs is set, so the mask calls drive a word at a time
+static int conform_critical_depth;
+static int conform_verbose;
+
+static led_t real_leds[CONFORM_MAX_LEDS];
+static led_pwm_state_t real_pwm_states[CONFORM_MAX_LEDS];
+static struct led_proc_t real_proc;
+static int real_pins[CONFORM_MAX_LEDS];
+static int real_duty[CONFORM_MAX_LEDS];
+
+static model_led_t model_leds[CONFORM_MAX_LEDS];
+
+static unsigned int conform_rand_state;
+
+static unsigned int conform_rand(void)
+{
+	// xorshift32, the same sequence on every host for a seed
+	conform_rand_state ^= conform_rand_state << 13;
+	conform_rand_state ^= conform_rand_state >> 17;
+	conform_rand_state ^= conform_rand_state << 5;
+	return conform_rand_state;
+}
+
+static int conform_rand_below(int n)
+{
+	return (int)(conform_rand() % (unsigned int)n);
+}
+
+// an error code, never LED_PROC_ERROR_TYPE_NONE
+static unsigned char conform_rand_error(void)
+{
+	return (unsigned char)(LED_PROC_ERROR_TYPE_WRONG_TYPE + conform_rand_below(LED_PROC_ERROR_TYPE_UNKNOWN - LED_PROC_ERROR_TYPE_WRONG_TYPE + 1));
+}
+
+/*
+ * The HAL of led_proc, the pins are indexed by led_ptr, which is the place of the LED
+ */
+static led_proc_error_type init_real_led(led_t * led)
+{
+	if (conform_faults[led->led_ptr].set_fault)
+		return (led_proc_error_type)conform_faults[led->led_ptr].set_fault;
+	if (led->led_type == LED_TYPE_OUTPUT)
+		real_pins[led->led_ptr] = LED_OFF;
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type set_real_polarity(led_t * led, led_output_state_t state)
+{
+	if (conform_faults[led->led_ptr].set_fault)
+		return (led_proc_error_type)conform_faults[led->led_ptr].set_fault;
+	if (!conform_faults[led->led_ptr].stuck)
+		real_pins[led->led_ptr] = state;
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type set_real_duty_cycle(led_t * led, int pwm_dc)
+{
+	if (conform_faults[led->led_ptr].duty_fault)
+		return (led_proc_error_type)conform_faults[led->led_ptr].duty_fault;
+	real_duty[led->led_ptr] = pwm_dc;
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type get_real_state(led_t * led, int * state)
+{
+	if (conform_faults[led->led_ptr].get_fault)
+		return (led_proc_error_type)conform_faults[led->led_ptr].get_fault;
+	*state = real_pins[led->led_ptr];
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+// one port write, so a fault on any of the LEDs fails all of them
+static led_proc_error_type set_real_outputs(led_t * leds, int num_leds, unsigned int bits)
+{
+	for (int bit = 0; bit < num_leds; bit++)
+	{
+		if ((bits & (1u << bit)) && conform_faults[leds[bit].led_ptr].set_fault)
+			return (led_proc_error_type)conform_faults[leds[bit].led_ptr].set_fault;
+	}
+	for (int bit = 0; bit < num_leds; bit++)
+	{
+		if ((bits & (1u << bit)) && !conform_faults[leds[bit].led_ptr].stuck)
+			real_pins[leds[bit].led_ptr] = leds[bit].led_output_state;
+	}
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static unsigned int enter_real_critical(void)
+{
+	conform_critical_depth++;
+	return 0;
+}
+
+static void exit_real_critical(unsigned int key)
+{
+	conform_critical_depth--;
+}
+
+/*
+ * The reference model, single threaded, see the top of the file for the quirks it keeps
+ */
+static led_proc_error_type set_model_polarity(int led_num, int state)
+{
+	if (conform_faults[led_num].set_fault)
+		return (led_proc_error_type)conform_faults[led_num].set_fault;
+	if (!conform_faults[led_num].stuck)
+		model_leds[led_num].pin = state;
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type get_model_state(int led_num, int * state)
+{
+	if (conform_faults[led_num].get_fault)
+		return (led_proc_error_type)conform_faults[led_num].get_fault;
+	*state = model_leds[led_num].pin;
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type init_model(int with_pwm_state[])
+{
+	// outputs first, then the rest once the first frame is out
+	for (int i = 0; i < conform_num_leds; i++)
+	{
+		if (model_leds[i].type != LED_TYPE_OUTPUT)
+			continue;
+		if (conform_faults[i].set_fault)
+			return (led_proc_error_type)conform_faults[i].set_fault;
+		model_leds[i].pin = LED_OFF;
+	}
+	for (int i = 0; i < conform_num_leds; i++)
+	{
+		if (model_leds[i].type == LED_TYPE_OUTPUT)
+			continue;
+		if (!with_pwm_state[i])
+			return LED_PROC_ERROR_TYPE_NULL;
+		if (conform_faults[i].set_fault)
+			return (led_proc_error_type)conform_faults[i].set_fault;
+	}
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type turn_model(int led_num, int state)
+{
+	model_leds[led_num].state = state;
+	return set_model_polarity(led_num, state);
+}
+
+static led_proc_error_type turn_model_num_on(int led_num)
+{
+	if (model_leds[led_num].type != LED_TYPE_OUTPUT)
+		return LED_PROC_ERROR_TYPE_WRONG_TYPE;
+	return turn_model(led_num, LED_ON);
+}
+
+static led_proc_error_type toggle_model(int led_num)
+{
+	int curr_state = 0;
+	int new_state;
+	led_proc_error_type status;
+
+	status = (led_proc_error_type)(LED_PROC_ERROR_TYPE_NONE | get_model_state(led_num, &curr_state));
+	if (status != LED_PROC_ERROR_TYPE_NONE)
+		return status;
+
+	new_state = !model_leds[led_num].state;
+	model_leds[led_num].state = new_state;
+	status = set_model_polarity(led_num, new_state);
+	status |= get_model_state(led_num, &curr_state);
+	// a pin that did not follow is driven once more before it counts
+	if (status == LED_PROC_ERROR_TYPE_NONE && curr_state != new_state)
+	{
+		status = set_model_polarity(led_num, new_state);
+		status |= get_model_state(led_num, &curr_state);
+	}
+
+	if (status == LED_PROC_ERROR_TYPE_NONE && curr_state == new_state)
+		return LED_PROC_ERROR_TYPE_NONE;
+	if (curr_state != new_state)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	return status;
+}
+
+static led_proc_error_type toggle_model_num(int led_num)
+{
+	int state;
+	led_proc_error_type status = toggle_model(led_num);
+
+	return status | get_model_state(led_num, &state);
+}
+
+static led_proc_error_type set_model_duty_cycle(int led_num, int pwm_dc)
+{
+	if (model_leds[led_num].type != LED_TYPE_PWM)
+		return LED_PROC_ERROR_TYPE_WRONG_TYPE;
+
+	// kept even when the HAL fails, and the HAL gets it unscaled as the levels are all at full
+	model_leds[led_num].duty_cycle = pwm_dc;
+	if (conform_faults[led_num].duty_fault)
+		return (led_proc_error_type)conform_faults[led_num].duty_fault;
+	model_leds[led_num].hal_duty = pwm_dc;
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type apply_model_mask(conform_op_t * op, unsigned int failed[])
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+
+	for (int word = 0; word < op->num_words; word++)
+	{
+		unsigned int bad = 0;
+		unsigned int driven = 0;
+
+		// the LEDs past the array fail before any LED of their word is looked at
+		for (int bit = 0; bit < 32; bit++)
+		{
+			if ((op->mask[word] & (1u << bit)) && word * 32 + bit >= conform_num_leds)
+				bad |= 1u << bit;
+		}
+		if (bad != 0 && status == LED_PROC_ERROR_TYPE_NONE)
+			status = LED_PROC_ERROR_TYPE_BAD_STATE;
+
+		for (int bit = 0; bit < 32 && word * 32 + bit < conform_num_leds; bit++)
+		{
+			int led_num = word * 32 + bit;
+			led_proc_error_type led_status = LED_PROC_ERROR_TYPE_NONE;
+
+			if (!(op->mask[word] & (1u << bit)))
+				continue;
+
+			if (op->type == CONFORM_OP_MASK_DUTY)
+				led_status = set_model_duty_cycle(led_num, op->pwm_dc);
+			else if (model_leds[led_num].type != LED_TYPE_OUTPUT)
+				led_status = LED_PROC_ERROR_TYPE_WRONG_TYPE;
+			else
+			{
+				if (op->type == CONFORM_OP_MASK_TOGGLE)
+					model_leds[led_num].state = !model_leds[led_num].state;
+				else
+					model_leds[led_num].state = (op->type == CONFORM_OP_MASK_ON) ? LED_ON : LED_OFF;
+
+				if (conform_batched)
+					driven |= 1u << bit;
+				else
+					led_status = set_model_polarity(led_num, model_leds[led_num].state);
+			}
+
+			if (led_status != LED_PROC_ERROR_TYPE_NONE)
+			{
+				bad |= 1u << bit;
+				if (status == LED_PROC_ERROR_TYPE_NONE)
+					status = led_status;
+			}
+		}
+
+		// the word is written at once, a fault on any of its LEDs fails them all
+		if (driven != 0)
+		{
+			led_proc_error_type led_status = LED_PROC_ERROR_TYPE_NONE;
+
+			for (int bit = 0; bit < 32 && led_status == LED_PROC_ERROR_TYPE_NONE; bit++)
+			{
+				if ((driven & (1u << bit)) && conform_faults[word * 32 + bit].set_fault)
+					led_status = (led_proc_error_type)conform_faults[word * 32 + bit].set_fault;
+			}
+			if (led_status != LED_PROC_ERROR_TYPE_NONE)
+			{
+				bad |= driven;
+				if (status == LED_PROC_ERROR_TYPE_NONE)
+					status = led_status;
+			}
+			else
+			{
+				for (int bit = 0; bit < 32; bit++)
+				{
+					if ((driven & (1u << bit)) && !conform_faults[word * 32 + bit].stuck)
+						model_leds[word * 32 + bit].pin = model_leds[word * 32 + bit].state;
+				}
+			}
+		}
+
+		if (failed != NULL)
+			failed[word] = bad;
+	}
+
+	return status;
+}
+
+static led_proc_error_type run_model_op(conform_op_t * op, conform_result_t * result)
+{
+	led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+
+	switch (op->type)
+	{
+	case CONFORM_OP_TURN_ON:
+	case CONFORM_OP_HANDLE_ON:
+		return turn_model(op->num, LED_ON);
+	case CONFORM_OP_TURN_OFF:
+	case CONFORM_OP_NUM_OFF:
+	case CONFORM_OP_HANDLE_OFF:
+		return turn_model(op->num, LED_OFF);
+	case CONFORM_OP_TURNS_ON:
+	case CONFORM_OP_TURNS_OFF:
+	case CONFORM_OP_NUMS_OFF:
+		for (int i = 0; i < op->list_len && status == LED_PROC_ERROR_TYPE_NONE; i++)
+			status = turn_model(op->list[i], (op->type == CONFORM_OP_TURNS_ON) ? LED_ON : LED_OFF);
+		return status;
+	case CONFORM_OP_NUM_ON:
+		return turn_model_num_on(op->num);
+	case CONFORM_OP_NUMS_ON:
+		for (int i = 0; i < op->list_len && status == LED_PROC_ERROR_TYPE_NONE; i++)
+		{
+			status = turn_model_num_on(op->list[i]);
+			model_leds[op->list[i]].state = LED_ON;
+		}
+		return status;
+	case CONFORM_OP_TOGGLE:
+		return toggle_model(op->num);
+	case CONFORM_OP_TOGGLES:
+		for (int i = 0; i < op->list_len && status == LED_PROC_ERROR_TYPE_NONE; i++)
+			status = toggle_model(op->list[i]);
+		return status;
+	case CONFORM_OP_NUM_TOGGLE:
+		return toggle_model_num(op->num);
+	case CONFORM_OP_NUMS_TOGGLE:
+		for (int i = 0; i < op->list_len && status == LED_PROC_ERROR_TYPE_NONE; i++)
+			status = toggle_model_num(op->list[i]);
+		return status;
+	case CONFORM_OP_MASK_ON:
+	case CONFORM_OP_MASK_OFF:
+	case CONFORM_OP_MASK_TOGGLE:
+	case CONFORM_OP_MASK_DUTY:
+		return apply_model_mask(op, op->with_failed ? result->failed : NULL);
+	case CONFORM_OP_DUTY:
+	case CONFORM_OP_NUM_DUTY:
+	case CONFORM_OP_HANDLE_DUTY:
+		return set_model_duty_cycle(op->num, op->pwm_dc);
+	case CONFORM_OP_NUMS_DUTY:
+		for (int i = 0; i < op->list_len && status == LED_PROC_ERROR_TYPE_NONE; i++)
+			status = set_model_duty_cycle(op->list[i], op->pwm_dc);
+		return status;
+	case CONFORM_OP_GET_STATE:
+		return get_model_state(op->num, &result->state);
+	case CONFORM_OP_OUTPUT_HANDLE:
+	case CONFORM_OP_PWM_HANDLE:
+		if (op->num < 0 || op->num >= conform_num_leds)
+			return LED_PROC_ERROR_TYPE_BAD_STATE;
+		if (model_leds[op->num].type != ((op->type == CONFORM_OP_OUTPUT_HANDLE) ? LED_TYPE_OUTPUT : LED_TYPE_PWM))
+			return LED_PROC_ERROR_TYPE_WRONG_TYPE;
+		return LED_PROC_ERROR_TYPE_NONE;
+	case CONFORM_OP_HANDLE_TOGGLE:
+		return turn_model(op->num, !model_leds[op->num].state);
+	case CONFORM_OP_FAULT:
+	default:
+		return LED_PROC_ERROR_TYPE_NONE;
+	}
+}
+
+static led_proc_error_type run_real_op(conform_op_t * op, conform_result_t * result)
+{
+	led_t * leds[CONFORM_MAX_LIST];
+	led_output_handle_t output_handle;
+	led_pwm_handle_t pwm_handle;
+	led_proc_error_type status;
+
+	for (int i = 0; i < op->list_len; i++)
+		leds[i] = &real_leds[op->list[i]];
+
+	switch (op->type)
+	{
+	case CONFORM_OP_TURN_ON:			return turn_led_on(&real_proc, &real_leds[op->num]);
+	case CONFORM_OP_TURN_OFF:			return turn_led_off(&real_proc, &real_leds[op->num]);
+	case CONFORM_OP_TURNS_ON:			return turn_leds_on(&real_proc, leds, op->list_len);
+	case CONFORM_OP_TURNS_OFF:			return turn_leds_off(&real_proc, leds, op->list_len);
+	case CONFORM_OP_NUM_ON:				return turn_led_num_on(&real_proc, op->num);
+	case CONFORM_OP_NUM_OFF:			return turn_led_num_off(&real_proc, op->num);
+	case CONFORM_OP_NUMS_ON:			return turn_leds_nums_on(&real_proc, op->list, op->list_len);
+	case CONFORM_OP_NUMS_OFF:			return turn_leds_nums_off(&real_proc, op->list, op->list_len);
+	case CONFORM_OP_TOGGLE:				return toggle_led_ensure(&real_proc, &real_leds[op->num]);
+	case CONFORM_OP_TOGGLES:			return toggle_leds_ensure(&real_proc, leds, op->list_len);
+	case CONFORM_OP_NUM_TOGGLE:			return toggle_led_num_ensure(&real_proc, op->num);
+	case CONFORM_OP_NUMS_TOGGLE:		return toggle_leds_nums_ensure(&real_proc, op->list, op->list_len);
+	case CONFORM_OP_MASK_ON:			return turn_leds_mask_on(&real_proc, op->mask, op->with_failed ? result->failed : NULL, op->num_words);
+	case CONFORM_OP_MASK_OFF:			return turn_leds_mask_off(&real_proc, op->mask, op->with_failed ? result->failed : NULL, op->num_words);
+	case CONFORM_OP_MASK_TOGGLE:		return toggle_leds_mask(&real_proc, op->mask, op->with_failed ? result->failed : NULL, op->num_words);
+	case CONFORM_OP_MASK_DUTY:			return set_leds_mask_pwm_duty_cycle(&real_proc, op->mask, op->pwm_dc, op->with_failed ? result->failed : NULL, op->num_words);
+	case CONFORM_OP_DUTY:				return set_led_pwm_duty_cycle(&real_proc, &real_leds[op->num], op->pwm_dc);
+	case CONFORM_OP_NUM_DUTY:			return set_led_num_pwm_duty_cycle(&real_proc, op->num, op->pwm_dc);
+	case CONFORM_OP_NUMS_DUTY:			return set_led_nums_pwm_duty_cycle(&real_proc, op->list, op->pwm_dc, op->list_len);
+	case CONFORM_OP_GET_STATE:			return get_led_num_state(&real_proc, op->num, &result->state);
+	case CONFORM_OP_OUTPUT_HANDLE:		return get_led_output_handle(&real_proc, op->num, &output_handle);
+	case CONFORM_OP_PWM_HANDLE:			return get_led_pwm_handle(&real_proc, op->num, &pwm_handle);
+	case CONFORM_OP_HANDLE_ON:
+	case CONFORM_OP_HANDLE_OFF:
+	case CONFORM_OP_HANDLE_TOGGLE:
+		status = get_led_output_handle(&real_proc, op->num, &output_handle);
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+			return status;
+		if (op->type == CONFORM_OP_HANDLE_ON)
+			return turn_led_handle_on(&real_proc, output_handle);
+		if (op->type == CONFORM_OP_HANDLE_OFF)
+			return turn_led_handle_off(&real_proc, output_handle);
+		return toggle_led_handle(&real_proc, output_handle);
+	case CONFORM_OP_HANDLE_DUTY:
+		status = get_led_pwm_handle(&real_proc, op->num, &pwm_handle);
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+			return status;
+		return set_led_handle_duty_cycle(&real_proc, pwm_handle, op->pwm_dc);
+	case CONFORM_OP_FAULT:
+	default:
+		return LED_PROC_ERROR_TYPE_NONE;
+	}
+}
+
+static int pick_led_of_type(int type)
+{
+	int start = conform_rand_below(conform_num_leds);
+
+	for (int i = 0; i < conform_num_leds; i++)
+	{
+		int led_num = (start + i) % conform_num_leds;
+		if (model_leds[led_num].type == type)
+			return led_num;
+	}
+	return -1;
+}
+
+static void make_rand_fault(conform_fault_t * fault)
+{
+	memset(fault, 0, sizeof(*fault));
+	switch (conform_rand_below(6))
+	{
+	case 0:		fault->set_fault = conform_rand_error();	break;
+	case 1:		fault->get_fault = conform_rand_error();	break;
+	case 2:		fault->duty_fault = conform_rand_error();	break;
+	case 3:		fault->stuck = 1;							break;
+	default:	break;		// heals the LED
+	}
+}
+
+static void make_rand_op(conform_op_t * op)
+{
+	int density = conform_rand_below(4);
+
+	memset(op, 0, sizeof(*op));
+	op->type = (conform_op_type)conform_rand_below(CONFORM_NUM_OPS);
+	op->num = conform_rand_below(conform_num_leds);
+	op->list_len = 1 + conform_rand_below(CONFORM_MAX_LIST);
+	for (int i = 0; i < op->list_len; i++)
+		op->list[i] = conform_rand_below(conform_num_leds);
+	// mostly within range, now and then past the end
+	op->pwm_dc = conform_rand_below(LED_PWM_DUTY_MAX + 11) - 5;
+
+	// the words of the array, sometimes one more, from a few bits set to every one
+	op->num_words = LED_PROC_MASK_WORDS(conform_num_leds) + (conform_rand_below(8) == 0);
+	for (int word = 0; word < op->num_words; word++)
+	{
+		for (int bit = 0; bit < 32; bit++)
+		{
+			if (density == 3 || (unsigned int)conform_rand_below(32) < (unsigned int)(1 << (density * 2)))
+				op->mask[word] |= 1u << bit;
+		}
+		// the bits past the array only with the extra word, which is the overflow being tested
+		if (op->num_words == LED_PROC_MASK_WORDS(conform_num_leds) && word == op->num_words - 1 && conform_num_leds % 32 != 0)
+			op->mask[word] &= (1u << (conform_num_leds % 32)) - 1;
+	}
+	op->with_failed = conform_rand_below(4) != 0;
+
+	switch (op->type)
+	{
+	case CONFORM_OP_OUTPUT_HANDLE:
+	case CONFORM_OP_PWM_HANDLE:
+		// a place off either end now and then
+		if (conform_rand_below(8) == 0)
+			op->num = conform_rand_below(2) ? -1 - conform_rand_below(4) : conform_num_leds + conform_rand_below(4);
+		break;
+	case CONFORM_OP_HANDLE_ON:
+	case CONFORM_OP_HANDLE_OFF:
+	case CONFORM_OP_HANDLE_TOGGLE:
+		op->num = pick_led_of_type(LED_TYPE_OUTPUT);
+		break;
+	case CONFORM_OP_HANDLE_DUTY:
+		op->num = pick_led_of_type(LED_TYPE_PWM);
+		break;
+	case CONFORM_OP_FAULT:
+		make_rand_fault(&op->fault);
+		break;
+	default:
+		break;
+	}
+
+	// only valid handles are used, without an LED of the type the op does nothing
+	if (op->num < 0 && op->type >= CONFORM_OP_HANDLE_ON && op->type <= CONFORM_OP_HANDLE_DUTY)
+		op->type = CONFORM_OP_FAULT;
+}
+
+static void print_conform_op(conform_op_t * op)
+{
+	printf("  %s", conform_op_names[op->type]);
+	switch (op->type)
+	{
+	case CONFORM_OP_TURNS_ON:
+	case CONFORM_OP_TURNS_OFF:
+	case CONFORM_OP_NUMS_ON:
+	case CONFORM_OP_NUMS_OFF:
+	case CONFORM_OP_TOGGLES:
+	case CONFORM_OP_NUMS_TOGGLE:
+	case CONFORM_OP_NUMS_DUTY:
+		printf(" {");
+		for (int i = 0; i < op->list_len; i++)
+			printf(i ? ", %d" : "%d", op->list[i]);
+		printf("}");
+		break;
+	case CONFORM_OP_MASK_ON:
+	case CONFORM_OP_MASK_OFF:
+	case CONFORM_OP_MASK_TOGGLE:
+	case CONFORM_OP_MASK_DUTY:
+		printf(" {");
+		for (int word = 0; word < op->num_words; word++)
+			printf(word ? ", 0x%08X" : "0x%08X", op->mask[word]);
+		printf("}%s", op->with_failed ? "" : " no failed bitmap");
+		break;
+	case CONFORM_OP_FAULT:
+		printf(" %d set %d get %d duty %d stuck %d", op->num, op->fault.set_fault, op->fault.get_fault, op->fault.duty_fault, op->fault.stuck);
+		break;
+	default:
+		printf(" %d", op->num);
+		break;
+	}
+	if (op->type == CONFORM_OP_DUTY || op->type == CONFORM_OP_NUM_DUTY || op->type == CONFORM_OP_NUMS_DUTY
+			|| op->type == CONFORM_OP_MASK_DUTY || op->type == CONFORM_OP_HANDLE_DUTY)
+		printf(" duty %d", op->pwm_dc);
+	printf("\n");
+}
+
+// prints what differs between led_proc and the model, returns 0 when nothing does
+static int compare_conform(conform_op_t * op, conform_result_t * real, conform_result_t * model)
+{
+	int diffs = 0;
+
+	if (real->status != model->status)
+	{
+		printf("  returned %d, the model %d\n", real->status, model->status);
+		diffs++;
+	}
+	if (op->type == CONFORM_OP_GET_STATE && model->status == LED_PROC_ERROR_TYPE_NONE && real->state != model->state)
+	{
+		printf("  read %d, the model %d\n", real->state, model->state);
+		diffs++;
+	}
+	for (int word = 0; op->with_failed && op->type >= CONFORM_OP_MASK_ON && op->type <= CONFORM_OP_MASK_DUTY && word < op->num_words; word++)
+	{
+		if (real->failed[word] != model->failed[word])
+		{
+			printf("  failed word %d 0x%08X, the model 0x%08X\n", word, real->failed[word], model->failed[word]);
+			diffs++;
+		}
+	}
+	if (conform_critical_depth != 0)
+	{
+		printf("  left %d critical sections open\n", conform_critical_depth);
+		diffs++;
+	}
+
+	for (int i = 0; i < conform_num_leds; i++)
+	{
+		model_led_t * model_led = &model_leds[i];
+
+		if (real_leds[i].led_output_state != model_led->state || real_pins[i] != model_led->pin)
+		{
+			printf("  LED %d state %d pin %d, the model state %d pin %d\n", i, real_leds[i].led_output_state, real_pins[i],
+					model_led->state, model_led->pin);
+			diffs++;
+		}
+		if (model_led->type == LED_TYPE_PWM && (real_pwm_states[i].led_duty_cycle != model_led->duty_cycle || real_duty[i] != model_led->hal_duty))
+		{
+			printf("  LED %d duty cycle %d driven %d, the model duty cycle %d driven %d\n", i, real_pwm_states[i].led_duty_cycle,
+					real_duty[i], model_led->duty_cycle, model_led->hal_duty);
+			diffs++;
+		}
+	}
+
+	return diffs;
+}
+
+static void init_conform_proc(void)
+{
+	memset(&real_proc, 0, sizeof(real_proc));
+	real_proc.led_init = init_real_led;
+	real_proc.led_set_polarity = set_real_polarity;
+	real_proc.led_set_duty_cycle = set_real_duty_cycle;
+	real_proc.led_get_state = get_real_state;
+	real_proc.led_set_outputs = conform_batched ? set_real_outputs : NULL;
+	real_proc.led_enter_critical = enter_real_critical;
+	real_proc.led_exit_critical = exit_real_critical;
+}
+
+// one random LED array and op sequence, returns 0 once led_proc and the model differ
+static int run_conform_sequence(unsigned int seed, int max_ops, unsigned long * num_ops, unsigned long * num_errors)
+{
+	int with_pwm_state[CONFORM_MAX_LEDS];
+	int init_faults;
+	int ops;
+	conform_op_t op;
+	conform_result_t real;
+	conform_result_t model;
+
+	conform_rand_state = seed * 2654435761u + 1;
+	conform_num_leds = 1 + conform_rand_below(CONFORM_MAX_LEDS);
+	conform_batched = conform_rand_below(2);
+	// now and then the HAL is faulty from the start, or a PWM LED has no side table, to check init
+	init_faults = conform_rand_below(16) == 0;
+
+	memset(conform_faults, 0, sizeof(conform_faults));
+	memset(real_leds, 0, sizeof(real_leds));
+	memset(real_pwm_states, 0, sizeof(real_pwm_states));
+	memset(model_leds, 0, sizeof(model_leds));
+	for (int i = 0; i < conform_num_leds; i++)
+	{
+		real_pins[i] = model_leds[i].pin = conform_rand_below(2);
+		real_duty[i] = model_leds[i].hal_duty = 0;
+		model_leds[i].type = (conform_rand_below(4) == 0) ? LED_TYPE_PWM : LED_TYPE_OUTPUT;
+		with_pwm_state[i] = !(init_faults && conform_rand_below(conform_num_leds) == 0);
+		if (init_faults && conform_rand_below(conform_num_leds) == 0)
+			conform_faults[i].set_fault = conform_rand_error();
+
+		real_leds[i].led_ptr = (GPIO_PinTypeDef)i;
+		real_leds[i].led_type = (unsigned char)model_leds[i].type;
+		if (model_leds[i].type == LED_TYPE_PWM && with_pwm_state[i])
+			real_leds[i].led_pwm_state = &real_pwm_states[i];
+	}
+
+	init_conform_proc();
+	memset(&op, 0, sizeof(op));
+	real.status = init_led_proc(&real_proc, real_leds, conform_num_leds);
+	model.status = init_model(with_pwm_state);
+	if (conform_verbose)
+		printf("seed %u: %d LEDs%s, init returned %d\n", seed, conform_num_leds, conform_batched ? " batched" : "", real.status);
+	if (compare_conform(&op, &real, &model) != 0)
+	{
+		printf("seed %u: init of %d LEDs differs from the model\n", seed, conform_num_leds);
+		return 0;
+	}
+	if (real.status != LED_PROC_ERROR_TYPE_NONE)
+		return 1;
+
+	// a few LEDs go wrong from the start, the fault ops change them as the sequence runs
+	for (int i = 0; i < conform_num_leds; i++)
+	{
+		if (conform_rand_below(16) == 0)
+			make_rand_fault(&conform_faults[i]);
+	}
+
+	ops = 1 + conform_rand_below(max_ops);
+	for (int n = 0; n < ops; n++)
+	{
+		make_rand_op(&op);
+		if (op.type == CONFORM_OP_FAULT && op.num >= 0)
+			conform_faults[op.num] = op.fault;
+		if (conform_verbose)
+			print_conform_op(&op);
+
+		// the failed bitmaps start different, so a word that is not written shows up
+		memset(&real, 0xA5, sizeof(real));
+		memset(&model, 0xA5, sizeof(model));
+		real.status = run_real_op(&op, &real);
+		model.status = run_model_op(&op, &model);
+		(*num_ops)++;
+		if (real.status != LED_PROC_ERROR_TYPE_NONE)
+			(*num_errors)++;
+
+		if (compare_conform(&op, &real, &model) != 0)
+		{
+			printf("seed %u: op %d of %d LEDs%s differs from the model\n", seed, n, conform_num_leds, conform_batched ? " batched" : "");
+			print_conform_op(&op);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+int main(int argc, char ** argv)
+{
+	unsigned long sequences = 100000;
+	int max_ops = 100;
+	unsigned int seed = 1;
+	unsigned long num_ops = 0;
+	unsigned long num_errors = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			sequences = strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+			max_ops = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+			seed = (unsigned int)strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "-v") == 0)
+			conform_verbose = 1;
+		else
+		{
+			fprintf(stderr, "usage: led_conform [-n sequences] [-l ops] [-s seed] [-v]\n");
+			return 2;
+		}
+	}
+	if (max_ops < 1)
+		max_ops = 1;
+
+	for (unsigned long n = 0; n < sequences; n++)
+	{
+		if (!run_conform_sequence(seed + (unsigned int)n, max_ops, &num_ops, &num_errors))
+		{
+			printf("replay with: led_conform -s %u -n 1 -l %d -v\n", seed + (unsigned int)n, max_ops);
+			return 1;
+		}
+	}
+
+	printf("led_conform: %lu sequences, %lu ops, %lu returned an error, no differences from the model\n", sequences,
+			num_ops, num_errors);
+	return 0;
+}
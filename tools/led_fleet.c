@@ -0,0 +1,884 @@
+/*
+ * led_fleet.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Fleet run of many virtual boards of led_proc, each one a reentrant instance with a HAL of its own, spread over a
+ * pool of threads.  Built from the repository root:
+ *
+ *	gcc -O2 -pthread -Wno-cpp -Itools/sim -Ilib -o led_fleet tools/led_fleet.c lib/led_proc.c lib/led_pattern.c \
+ *		lib/led_coro.c
+ *	led_fleet [-n boards] [-d seconds] [-t threads] [-s seed] [-b]
+ *
+ *	-n	number of boards, 5400 when not given, spread evenly over the FLEET_NUM_CONFIGS configs
+ *	-d	virtual time each board runs for, 10 seconds when not given
+ *	-t	threads of the pool, the online CPUs when not given
+ *	-s	seed of the first board, each board after it uses the next seed
+ *	-b	run the fleet on 1, 2, 4 and so on up to the -t threads and print the speedup of each
+ *
+ * Every config is a number of LEDs, every fourth of them PWM, a PWM frequency, a PWM clock and a behaviour: blinks
+ * from the tick, a brightness fade, a chase from a pattern blob or a chase from a coroutine.  A board owns its
+ * led_proc_t, LED array, PWM side table, led_proc_dispatch_t and pins, so no two boards share anything and a board
+ * runs the same on any thread.  Its clock jumps from one PWM frame or tick interrupt to the next, and jumps
+ * straight to the end while led_proc has both turned off, so 10 seconds of a board take well under a ms of CPU.  At every
+ * interrupt the invariants are checked:
+ *
+ *	- every output LED pin is at the level of its led_output_state, and every PWM compare is the led_compare
+ *	  led_proc last wrote and within the period, and every second verify_led_outputs finds no mismatch
+ *	- a blinking LED is lit for the on time of each period from when its blink was started
+ *	- the compare counts of a fading LED, summed over the frames between two ticks, are within one count of its
+ *	  dithered brightness
+ *	- a chase lights exactly one LED at a time, in order, each for the same number of ticks
+ *	- at the end, led_proc counted every frame and tick interrupt the board took
+ *
+ * Each thread of the pool owns a deque of board numbers, it runs boards from the front of its own and, once it is
+ * empty, steals the back half of the fullest deque of another thread.  The boards of a config are interleaved over
+ * the board numbers so a slow config is not left to one thread.  The time of each board is taken from the CPU clock
+ * of its thread, and the pass, fail and timing statistics are printed per config.  The results do not depend on the
+ * number of threads, with -b every run must come to the same checksum.  The speedup can be no better than the
+ * number of CPUs, which is printed with it.  Exits 1 if any board failed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "led_proc.h"
+#include "led_pattern.h"
+#include "led_pattern_format.h"
+#include "led_coro.h"
+
+#define FLEET_MAX_LEDS			64
+#define FLEET_MAX_THREADS		64
+#define FLEET_TICK_MS			10
+#define FLEET_VERIFY_MS			1000
+#define FLEET_CHASE_LEDS		8			// LEDs of a chase, at most LED_PATTERN_MAX_LEDS
+#define FLEET_PATTERN_SIZE		(LED_PATTERN_HEADER_SIZE + 6 * FLEET_CHASE_LEDS + 1)
+
+typedef enum FLEET_BEHAVIORS {
+	FLEET_BLINK,
+	FLEET_FADE,
+	FLEET_PATTERN,
+	FLEET_CORO,
+	FLEET_NUM_BEHAVIORS
+}fleet_behavior_t;
+
+static const char * const fleet_behavior_names[FLEET_NUM_BEHAVIORS] = { "blink", "fade", "pattern", "coro" };
+static const int fleet_num_leds[] = { 4, 16, 64 };
+static const unsigned int fleet_pwm_hertz[] = { 500, 1000, 2000 };
+static const unsigned int fleet_clock_hz[] = { 12000000, 24000000, 32000000 };
+
+#define FLEET_COUNT(a)			((int)(sizeof(a) / sizeof((a)[0])))
+#define FLEET_NUM_CONFIGS		(FLEET_COUNT(fleet_num_leds) * FLEET_COUNT(fleet_pwm_hertz) * FLEET_COUNT(fleet_clock_hz) * FLEET_NUM_BEHAVIORS)
+
+typedef struct fleet_config_t {
+	int num_leds;
+	unsigned int pwm_hertz;
+	unsigned int clock_hz;
+	fleet_behavior_t behavior;
+}fleet_config_t;
+
+// what is kept of a board once it has run, all a thread writes is the entry of each board it ran
+typedef struct fleet_result_t {
+	int config;
+	int passed;
+	const char * failure;		// the first invariant that failed
+	unsigned int failed_ms;
+	unsigned int frame_irqs;
+	unsigned int tick_irqs;
+	unsigned long long ns;		// CPU time of the thread spent on the board
+	unsigned int checksum;		// of the pins and compares at every tick, the same whichever thread ran it
+}fleet_result_t;
+
+typedef struct fleet_chase_coro_t {
+	led_coro_t coro;			// first, so the led_coro_t is the fleet_chase_coro_t
+	struct fleet_board_t * board;
+	int led_num;
+}fleet_chase_coro_t;
+
+typedef struct fleet_board_t {
+	fleet_config_t config;
+	fleet_result_t * result;
+	unsigned int random;
+	struct led_proc_t proc;
+	led_proc_dispatch_t dispatch;
+	led_t leds[FLEET_MAX_LEDS];					// led_ptr is the number of the LED, the HAL finds the board from it
+	led_pwm_state_t pwm_states[FLEET_MAX_LEDS / 4];
+	unsigned char pins[FLEET_MAX_LEDS];
+	unsigned int compare[FLEET_MAX_LEDS];
+	unsigned char frame_irq[FLEET_MAX_LEDS];
+	int num_frame_irqs;							// PWM LEDs with their frame interrupt on
+	int tick_irq;
+	unsigned int now_ms;
+
+	// blink
+	unsigned int blink_period_ms[FLEET_MAX_LEDS];	// 0 when the LED does not blink
+	unsigned int blink_on_ms[FLEET_MAX_LEDS];
+
+	// fade
+	unsigned int fade_ticks;
+	unsigned int fade_phase[FLEET_MAX_LEDS];
+	unsigned int fade_tick;
+	unsigned long long fade_sum[FLEET_MAX_LEDS];	// compare counts since the last tick
+	unsigned int fade_frames[FLEET_MAX_LEDS];
+
+	// chase
+	int chase_leds;
+	unsigned int chase_ticks;						// ticks each LED is lit for
+	int chase_lit;									// -1 before the first tick
+	unsigned int chase_run;							// ticks chase_lit has been lit for
+	int chase_runs;
+	unsigned char pattern_blob[FLEET_PATTERN_SIZE];
+	led_pattern_t pattern;
+	led_coro_sched_t sched;
+	fleet_chase_coro_t chase_coro;
+
+	unsigned int frame_irqs[FLEET_MAX_LEDS];
+	unsigned int tick_irqs;
+}fleet_board_t;
+
+typedef struct fleet_deque_t {
+	pthread_mutex_t lock;
+	unsigned int head;			// next board the owner runs
+	unsigned int tail;			// one past the last board, thieves take from here
+}fleet_deque_t;
+
+typedef struct fleet_pool_t {
+	int num_threads;
+	unsigned int num_boards;
+	unsigned int seed;
+	unsigned int seconds;
+	fleet_result_t * results;
+	fleet_deque_t deques[FLEET_MAX_THREADS];
+	unsigned int steals[FLEET_MAX_THREADS];
+}fleet_pool_t;
+
+typedef struct fleet_worker_t {
+	fleet_pool_t * pool;
+	int id;
+}fleet_worker_t;
+
+// the tick interrupt hook has no argument, so each thread keeps the board whose call is in progress
+static __thread fleet_board_t * fleet_tick_board;
+
+static unsigned int next_fleet_random(unsigned int * random)
+{
+	*random = *random * 1103515245u + 12345u;
+	return *random >> 8;
+}
+
+static void get_fleet_config(int config, fleet_config_t * out)
+{
+	out->behavior = (fleet_behavior_t)(config % FLEET_NUM_BEHAVIORS);
+	config /= FLEET_NUM_BEHAVIORS;
+	out->clock_hz = fleet_clock_hz[config % FLEET_COUNT(fleet_clock_hz)];
+	config /= FLEET_COUNT(fleet_clock_hz);
+	out->pwm_hertz = fleet_pwm_hertz[config % FLEET_COUNT(fleet_pwm_hertz)];
+	config /= FLEET_COUNT(fleet_pwm_hertz);
+	out->num_leds = fleet_num_leds[config];
+}
+
+static unsigned long long get_fleet_ns(clockid_t clock)
+{
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+}
+
+/**************************************************************/
+/**\name	board HAL			                              */
+/**************************************************************/
+
+static fleet_board_t * find_fleet_board(led_t * led)
+{
+	return (fleet_board_t *)((char *)(led - (int)led->led_ptr) - offsetof(fleet_board_t, leds));
+}
+
+static void fail_fleet_board(fleet_board_t * board, const char * failure)
+{
+	if (!board->result->passed)
+		return;
+	board->result->passed = 0;
+	board->result->failure = failure;
+	board->result->failed_ms = board->now_ms;
+}
+
+static led_proc_error_type init_fleet_led(led_t * led)
+{
+	fleet_board_t * board = find_fleet_board(led);
+
+	if (led->led_type != LED_TYPE_PWM)
+		return LED_PROC_ERROR_TYPE_NONE;
+	led->led_pwm_state->led_pwm_hertz = (int)board->config.pwm_hertz;
+	return get_led_pwm_timing(board->config.clock_hz, board->config.pwm_hertz, 0, &led->led_pwm_state->led_pwm_timing);
+}
+
+static led_proc_error_type set_fleet_polarity(led_t * led, led_output_state_t state)
+{
+	find_fleet_board(led)->pins[led->led_ptr] = (state == LED_ON);
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type set_fleet_duty_cycle(led_t * led, int pwm_dc)
+{
+	led_pwm_state_t * pwm_state = led->led_pwm_state;
+
+	find_fleet_board(led)->compare[led->led_ptr] = get_led_pwm_duty_cycles(&pwm_state->led_pwm_timing, pwm_dc);
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type get_fleet_state(led_t * led, int * state)
+{
+	*state = find_fleet_board(led)->pins[led->led_ptr] ? LED_ON : LED_OFF;
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type verify_fleet_outputs(led_t * leds, int num_leds, unsigned int * mismatch)
+{
+	fleet_board_t * board = find_fleet_board(leds);
+
+	for (int i = 0; i < num_leds; i++)
+	{
+		if (leds[i].led_type == LED_TYPE_OUTPUT && board->pins[i] != (leds[i].led_output_state == LED_ON))
+			mismatch[LED_PROC_MASK_WORD(i)] |= LED_PROC_MASK_BIT(i);
+	}
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type set_fleet_compare(led_t * led, unsigned int on_cycles)
+{
+	find_fleet_board(led)->compare[led->led_ptr] = on_cycles;
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type set_fleet_frame_irq(led_t * led, int enable)
+{
+	fleet_board_t * board = find_fleet_board(led);
+
+	enable = (enable != 0);
+	board->num_frame_irqs += enable - board->frame_irq[led->led_ptr];
+	board->frame_irq[led->led_ptr] = (unsigned char)enable;
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static void set_fleet_tick_irq(int enable)
+{
+	if (fleet_tick_board != NULL)
+		fleet_tick_board->tick_irq = enable;
+}
+
+/**************************************************************/
+/**\name	behaviours			                              */
+/**************************************************************/
+
+static int is_fleet_led_lit(fleet_board_t * board, int led_num)
+{
+	led_t * led = &board->leds[led_num];
+
+	if (led->led_type == LED_TYPE_PWM)
+		return led->led_pwm_state->led_brightness != 0;
+	return led->led_output_state == LED_ON;
+}
+
+static void light_fleet_led(fleet_board_t * board, int led_num, int lit)
+{
+	led_proc_error_type status;
+
+	if (board->leds[led_num].led_type == LED_TYPE_PWM)
+		status = set_led_num_pwm_brightness(&board->proc, led_num, lit ? LED_PWM_BRIGHTNESS_MAX : 0);
+	else if (lit)
+		status = turn_led_num_on(&board->proc, led_num);
+	else
+		status = turn_led_num_off(&board->proc, led_num);
+	if (status != LED_PROC_ERROR_TYPE_NONE)
+		fail_fleet_board(board, "chase LED could not be driven");
+}
+
+static led_coro_state run_fleet_chase_coro(led_coro_sched_t * sched, led_coro_t * coro)
+{
+	fleet_chase_coro_t * chase = (fleet_chase_coro_t *)coro;
+	fleet_board_t * board = chase->board;
+
+	LED_CORO_BEGIN(coro);
+	for (chase->led_num = 0; ; chase->led_num = (chase->led_num + 1) % board->chase_leds)
+	{
+		light_fleet_led(board, chase->led_num, 1);
+		LED_AWAIT_MS(sched, coro, board->chase_ticks * FLEET_TICK_MS);
+		light_fleet_led(board, chase->led_num, 0);
+	}
+	LED_CORO_END(coro);
+}
+
+// the same chase as the coroutine, as a blob: SET L 255, WAIT, SET L 0 for every LED, then RESTART
+static void make_fleet_pattern(fleet_board_t * board)
+{
+	unsigned char * op = board->pattern_blob;
+
+	*op++ = 'L';
+	*op++ = 'P';
+	*op++ = LED_PATTERN_VERSION;
+	*op++ = (unsigned char)board->chase_leds;
+	*op++ = FLEET_TICK_MS & 0xFF;
+	*op++ = FLEET_TICK_MS >> 8;
+	for (int i = 0; i < board->chase_leds; i++)
+	{
+		*op++ = (unsigned char)(LED_PATTERN_OP_SET | i);
+		*op++ = 255;
+		*op++ = LED_PATTERN_OP_WAIT;
+		*op++ = (unsigned char)board->chase_ticks;
+		*op++ = (unsigned char)(LED_PATTERN_OP_SET | i);
+		*op++ = 0;
+	}
+	*op++ = LED_PATTERN_OP_RESTART;
+}
+
+static void run_fleet_tick(struct led_proc_t * led_proc)
+{
+	fleet_board_t * board = (fleet_board_t *)led_proc->led_context;
+
+	switch (board->config.behavior)
+	{
+	case FLEET_BLINK:
+		set_led_proc_tick_idle(led_proc);
+		break;
+	case FLEET_FADE:
+		board->fade_tick++;
+		for (int i = 0; i < board->config.num_leds; i++)
+		{
+			unsigned int phase;
+
+			if (board->leds[i].led_type != LED_TYPE_PWM)
+				continue;
+			phase = (board->fade_tick + board->fade_phase[i]) % (2 * board->fade_ticks);
+			if (phase > board->fade_ticks)
+				phase = 2 * board->fade_ticks - phase;
+			if (set_led_num_pwm_brightness(led_proc, i, (unsigned short)(phase * LED_PWM_BRIGHTNESS_MAX / board->fade_ticks))
+					!= LED_PROC_ERROR_TYPE_NONE)
+				fail_fleet_board(board, "fade brightness refused");
+		}
+		break;
+	case FLEET_PATTERN:
+		if (run_led_pattern(&board->pattern) != LED_PROC_ERROR_TYPE_NONE)
+			fail_fleet_board(board, "pattern stopped");
+		break;
+	case FLEET_CORO:
+		run_led_coros(&board->sched, FLEET_TICK_MS);
+		break;
+	default:
+		break;
+	}
+}
+
+/**************************************************************/
+/**\name	checks				                              */
+/**************************************************************/
+
+static void check_fleet_chase(fleet_board_t * board)
+{
+	int lit = -1;
+
+	for (int i = 0; i < board->chase_leds; i++)
+	{
+		if (!is_fleet_led_lit(board, i))
+			continue;
+		if (lit >= 0)
+		{
+			fail_fleet_board(board, "chase lit two LEDs");
+			return;
+		}
+		lit = i;
+	}
+	if (lit < 0)
+	{
+		fail_fleet_board(board, "chase lit no LED");
+		return;
+	}
+
+	if (lit == board->chase_lit)
+	{
+		board->chase_run++;
+		if (board->chase_run > board->chase_ticks)
+			fail_fleet_board(board, "chase LED lit too long");
+		return;
+	}
+	if (board->chase_lit >= 0)
+	{
+		// the first LED may have been lit before the first tick
+		if (lit != (board->chase_lit + 1) % board->chase_leds)
+			fail_fleet_board(board, "chase out of order");
+		else if (board->chase_runs > 0 && board->chase_run != board->chase_ticks)
+			fail_fleet_board(board, "chase LED lit too short");
+		board->chase_runs++;
+	}
+	board->chase_lit = lit;
+	board->chase_run = 1;
+}
+
+// after each tick, what every LED shows against what the behaviour asked for
+static void check_fleet_tick(fleet_board_t * board)
+{
+	unsigned int checksum = board->result->checksum;
+
+	for (int i = 0; i < board->config.num_leds; i++)
+	{
+		led_t * led = &board->leds[i];
+
+		if (led->led_type == LED_TYPE_OUTPUT && board->pins[i] != (led->led_output_state == LED_ON))
+			fail_fleet_board(board, "pin differs from led_output_state");
+		if (board->blink_period_ms[i] != 0
+				&& board->pins[i] != (board->now_ms % board->blink_period_ms[i] < board->blink_on_ms[i]))
+			fail_fleet_board(board, "blink out of phase");
+		checksum = (checksum * 31u) ^ board->pins[i] ^ (board->compare[i] << 1);
+	}
+	board->result->checksum = checksum;
+
+	if (board->config.behavior == FLEET_PATTERN || board->config.behavior == FLEET_CORO)
+		check_fleet_chase(board);
+}
+
+// before each tick, the compare counts of the frames since the last one against the brightness they dithered
+static void check_fleet_fade(fleet_board_t * board)
+{
+	for (int i = 0; i < board->config.num_leds; i++)
+	{
+		led_pwm_state_t * pwm_state = board->leds[i].led_pwm_state;
+		unsigned long long expected;
+
+		if (board->leds[i].led_type != LED_TYPE_PWM || board->fade_frames[i] == 0)
+			continue;
+		expected = ((unsigned long long)board->fade_frames[i] * pwm_state->led_dither_target + 0x8000) >> 16;
+		if (board->fade_sum[i] + 1 < expected || board->fade_sum[i] > expected + 1)
+			fail_fleet_board(board, "dithered compare off the brightness");
+		board->fade_sum[i] = 0;
+		board->fade_frames[i] = 0;
+	}
+}
+
+static void run_fleet_frame(fleet_board_t * board)
+{
+	for (int i = 0; i < board->config.num_leds; i++)
+	{
+		led_pwm_state_t * pwm_state = board->leds[i].led_pwm_state;
+
+		if (!board->frame_irq[i])
+			continue;
+		board->frame_irqs[i]++;
+		run_led_num_pwm_frame(&board->proc, i);
+		if (board->compare[i] != pwm_state->led_compare || board->compare[i] > pwm_state->led_pwm_timing.cycles)
+			fail_fleet_board(board, "compare not written as led_compare");
+		board->fade_sum[i] += board->compare[i];
+		board->fade_frames[i]++;
+	}
+}
+
+/**************************************************************/
+/**\name	board				                              */
+/**************************************************************/
+
+static void init_fleet_board(fleet_board_t * board, int config, unsigned int seed, fleet_result_t * result)
+{
+	int num_pwm = 0;
+	int blinks = 0;
+
+	memset(board, 0, sizeof(*board));
+	memset(result, 0, sizeof(*result));
+	get_fleet_config(config, &board->config);
+	board->result = result;
+	board->random = seed;
+	result->config = config;
+	result->passed = 1;
+
+	board->proc.led_init = init_fleet_led;
+	board->proc.led_set_polarity = set_fleet_polarity;
+	board->proc.led_set_duty_cycle = set_fleet_duty_cycle;
+	board->proc.led_get_state = get_fleet_state;
+	board->proc.led_verify_outputs = verify_fleet_outputs;
+	board->proc.led_set_compare = set_fleet_compare;
+	board->proc.led_set_frame_irq = set_fleet_frame_irq;
+	board->proc.led_set_tick_irq = set_fleet_tick_irq;
+	board->proc.led_tick = run_fleet_tick;
+	board->proc.led_tick_period_ms = FLEET_TICK_MS;
+	board->proc.led_context = board;
+	for (int i = 0; i < board->config.num_leds; i++)
+	{
+		board->leds[i].led_ptr = (GPIO_PinTypeDef)i;
+		if (i % 4 == 0)
+		{
+			board->leds[i].led_type = LED_TYPE_PWM;
+			board->leds[i].led_pwm_state = &board->pwm_states[num_pwm++];
+		}
+		else
+			board->leds[i].led_type = LED_TYPE_OUTPUT;
+	}
+
+	// on until led_proc turns them off, as at reset
+	board->tick_irq = 1;
+	fleet_tick_board = board;
+	if (init_led_proc(&board->proc, board->leds, board->config.num_leds) != LED_PROC_ERROR_TYPE_NONE)
+		fail_fleet_board(board, "init_led_proc failed");
+	if (register_led_proc_dispatch(&board->dispatch, &board->proc) != LED_PROC_ERROR_TYPE_NONE)
+		fail_fleet_board(board, "register_led_proc_dispatch failed");
+
+	board->chase_leds = board->config.num_leds < FLEET_CHASE_LEDS ? board->config.num_leds : FLEET_CHASE_LEDS;
+	board->chase_ticks = 1 + next_fleet_random(&board->random) % 15;
+	board->chase_lit = -1;
+	switch (board->config.behavior)
+	{
+	case FLEET_BLINK:
+		for (int i = 0; i < board->config.num_leds && blinks < LED_PROC_MAX_BLINKS; i++)
+		{
+			unsigned int period_ticks = 2 + next_fleet_random(&board->random) % 100;
+
+			if (board->leds[i].led_type != LED_TYPE_OUTPUT)
+				continue;
+			board->blink_period_ms[i] = period_ticks * FLEET_TICK_MS;
+			board->blink_on_ms[i] = (1 + next_fleet_random(&board->random) % (period_ticks - 1)) * FLEET_TICK_MS;
+			if (blink_led_num(&board->proc, i, board->blink_period_ms[i], board->blink_on_ms[i]) != LED_PROC_ERROR_TYPE_NONE)
+				fail_fleet_board(board, "blink_led_num failed");
+			blinks++;
+		}
+		for (int i = 0; i < board->config.num_leds; i++)
+		{
+			if (board->leds[i].led_type == LED_TYPE_PWM)
+				set_led_num_pwm_duty_cycle(&board->proc, i, (int)(next_fleet_random(&board->random) % (LED_PWM_DUTY_MAX + 1)));
+			else if (board->blink_period_ms[i] == 0 && next_fleet_random(&board->random) % 2)
+				turn_led_num_on(&board->proc, i);
+		}
+		break;
+	case FLEET_FADE:
+		board->fade_ticks = 20 + next_fleet_random(&board->random) % 180;
+		for (int i = 0; i < board->config.num_leds; i++)
+			board->fade_phase[i] = next_fleet_random(&board->random) % (2 * board->fade_ticks);
+		break;
+	case FLEET_PATTERN:
+		make_fleet_pattern(board);
+		if (init_led_pattern(&board->pattern, &board->proc, board->pattern_blob, sizeof(board->pattern_blob), FLEET_TICK_MS)
+				!= LED_PROC_ERROR_TYPE_NONE)
+			fail_fleet_board(board, "init_led_pattern failed");
+		break;
+	case FLEET_CORO:
+		board->chase_coro.board = board;
+		if (init_led_coro_sched(&board->sched, &board->proc) != LED_PROC_ERROR_TYPE_NONE
+				|| start_led_coro(&board->sched, &board->chase_coro.coro, run_fleet_chase_coro) != LED_PROC_ERROR_TYPE_NONE)
+			fail_fleet_board(board, "start_led_coro failed");
+		break;
+	default:
+		break;
+	}
+	fleet_tick_board = NULL;
+}
+
+// runs a board in virtual time, from one interrupt to the next, and keeps only its result
+static void run_fleet_board(fleet_board_t * board, int config, unsigned int seed, unsigned int seconds, fleet_result_t * result)
+{
+	unsigned long long end_us = (unsigned long long)seconds * 1000000ull;
+	unsigned long long now_us = 0;
+	unsigned long long start_ns = get_fleet_ns(CLOCK_THREAD_CPUTIME_ID);
+	unsigned int hertz;
+	unsigned int mismatch[LED_PROC_MASK_WORDS(FLEET_MAX_LEDS)];
+
+	init_fleet_board(board, config, seed, result);
+	hertz = board->pwm_states[0].led_pwm_timing.hertz;
+
+	while (now_us < end_us)
+	{
+		unsigned long long next_us = end_us;
+		unsigned long long frame_us = (now_us * hertz / 1000000ull + 1) * 1000000ull / hertz;
+		unsigned long long tick_us = (now_us / (FLEET_TICK_MS * 1000) + 1) * (FLEET_TICK_MS * 1000);
+
+		// a frame lands on a whole us, its period is rounded to one, which the checks do not depend on
+		if (board->num_frame_irqs > 0 && frame_us < next_us)
+			next_us = frame_us;
+		if (board->tick_irq && tick_us < next_us)
+			next_us = tick_us;
+		if (next_us > end_us)
+			break;
+		now_us = next_us;
+		board->now_ms = (unsigned int)(now_us / 1000);
+
+		if (now_us == frame_us && board->num_frame_irqs > 0)
+			run_fleet_frame(board);
+		if (now_us == tick_us && board->tick_irq)
+		{
+			if (board->config.behavior == FLEET_FADE)
+				check_fleet_fade(board);
+			board->tick_irqs++;
+			fleet_tick_board = board;
+			run_led_proc_dispatch(&board->dispatch, FLEET_TICK_MS);
+			fleet_tick_board = NULL;
+			check_fleet_tick(board);
+		}
+		if (now_us % (FLEET_VERIFY_MS * 1000) == 0
+				&& verify_led_outputs(&board->proc, mismatch, LED_PROC_MASK_WORDS(FLEET_MAX_LEDS)) != LED_PROC_ERROR_TYPE_NONE)
+			fail_fleet_board(board, "verify_led_outputs found a mismatch");
+		if (!result->passed)
+			break;
+	}
+
+	board->now_ms = seconds * 1000;
+	if (result->passed && board->proc.led_tick_stats.irq_taken != board->tick_irqs)
+		fail_fleet_board(board, "tick interrupts not all counted");
+	for (int i = 0; i < board->config.num_leds && result->passed; i++)
+	{
+		if (board->leds[i].led_type == LED_TYPE_PWM && board->leds[i].led_pwm_state->led_frame_stats.irq_taken != board->frame_irqs[i])
+			fail_fleet_board(board, "frame interrupts not all counted");
+		result->frame_irqs += board->frame_irqs[i];
+	}
+	result->tick_irqs = board->tick_irqs;
+	result->ns = get_fleet_ns(CLOCK_THREAD_CPUTIME_ID) - start_ns;
+}
+
+/**************************************************************/
+/**\name	pool				                              */
+/**************************************************************/
+
+// the front of the thread's own deque, or the back half of the fullest deque of another
+static int take_fleet_board(fleet_pool_t * pool, int id, unsigned int * board_num)
+{
+	fleet_deque_t * own = &pool->deques[id];
+	fleet_deque_t * victim = NULL;
+	unsigned int most = 0;
+	unsigned int head;
+	unsigned int tail;
+
+	pthread_mutex_lock(&own->lock);
+	if (own->head < own->tail)
+	{
+		*board_num = own->head++;
+		pthread_mutex_unlock(&own->lock);
+		return 1;
+	}
+	pthread_mutex_unlock(&own->lock);
+
+	// only ever one lock held at a time, so two threads stealing from each other cannot deadlock
+	for (int n = 1; n < pool->num_threads; n++)
+	{
+		fleet_deque_t * other = &pool->deques[(id + n) % pool->num_threads];
+		unsigned int left;
+
+		pthread_mutex_lock(&other->lock);
+		left = other->tail - other->head;
+		pthread_mutex_unlock(&other->lock);
+		if (left > most)
+		{
+			most = left;
+			victim = other;
+		}
+	}
+	if (victim == NULL)
+		return 0;
+
+	pthread_mutex_lock(&victim->lock);
+	tail = victim->tail;
+	head = tail - (victim->tail - victim->head + 1) / 2;
+	victim->tail = head;
+	pthread_mutex_unlock(&victim->lock);
+	if (head == tail)
+		return take_fleet_board(pool, id, board_num);
+
+	pool->steals[id]++;
+	*board_num = head;
+	pthread_mutex_lock(&own->lock);
+	own->head = head + 1;
+	own->tail = tail;
+	pthread_mutex_unlock(&own->lock);
+	return 1;
+}
+
+static void * run_fleet_worker(void * arg)
+{
+	fleet_worker_t * worker = (fleet_worker_t *)arg;
+	fleet_pool_t * pool = worker->pool;
+	fleet_board_t * board = malloc(sizeof(fleet_board_t));
+	unsigned int board_num;
+
+	if (board == NULL)
+		return NULL;
+	while (take_fleet_board(pool, worker->id, &board_num))
+	{
+		run_fleet_board(board, (int)(board_num % FLEET_NUM_CONFIGS), pool->seed + board_num, pool->seconds,
+				&pool->results[board_num]);
+	}
+	free(board);
+	return NULL;
+}
+
+// runs every board on num_threads threads, returns the wall time in ns
+static unsigned long long run_fleet_pool(fleet_pool_t * pool, int num_threads)
+{
+	pthread_t threads[FLEET_MAX_THREADS];
+	fleet_worker_t workers[FLEET_MAX_THREADS];
+	unsigned long long start_ns;
+
+	pool->num_threads = num_threads;
+	for (int t = 0; t < num_threads; t++)
+	{
+		pthread_mutex_init(&pool->deques[t].lock, NULL);
+		pool->deques[t].head = (unsigned int)((unsigned long long)pool->num_boards * (unsigned int)t / (unsigned int)num_threads);
+		pool->deques[t].tail = (unsigned int)((unsigned long long)pool->num_boards * (unsigned int)(t + 1) / (unsigned int)num_threads);
+		pool->steals[t] = 0;
+		workers[t].pool = pool;
+		workers[t].id = t;
+	}
+
+	start_ns = get_fleet_ns(CLOCK_MONOTONIC);
+	for (int t = 0; t < num_threads; t++)
+		pthread_create(&threads[t], NULL, run_fleet_worker, &workers[t]);
+	for (int t = 0; t < num_threads; t++)
+		pthread_join(threads[t], NULL);
+	start_ns = get_fleet_ns(CLOCK_MONOTONIC) - start_ns;
+
+	for (int t = 0; t < num_threads; t++)
+		pthread_mutex_destroy(&pool->deques[t].lock);
+	return start_ns;
+}
+
+static unsigned int get_fleet_checksum(fleet_pool_t * pool)
+{
+	unsigned int checksum = 0;
+
+	for (unsigned int n = 0; n < pool->num_boards; n++)
+		checksum = checksum * 33u + pool->results[n].checksum + (unsigned int)pool->results[n].passed;
+	return checksum;
+}
+
+/**************************************************************/
+/**\name	report				                              */
+/**************************************************************/
+
+// per config pass and fail, interrupts per virtual second, and CPU time per board, returns the boards that failed
+static unsigned int print_fleet_results(fleet_pool_t * pool)
+{
+	unsigned int failed = 0;
+	unsigned int printed = 0;
+
+	printf("%5s %6s %9s %-8s %7s %5s %10s %10s %10s %10s\n", "leds", "hz", "clock", "config", "boards", "fail",
+			"frames/s", "ticks/s", "us/board", "max us");
+	for (int c = 0; c < FLEET_NUM_CONFIGS; c++)
+	{
+		fleet_config_t config;
+		unsigned int boards = 0;
+		unsigned int fails = 0;
+		unsigned long long frames = 0;
+		unsigned long long ticks = 0;
+		unsigned long long ns = 0;
+		unsigned long long max_ns = 0;
+
+		get_fleet_config(c, &config);
+		for (unsigned int n = (unsigned int)c; n < pool->num_boards; n += FLEET_NUM_CONFIGS)
+		{
+			fleet_result_t * result = &pool->results[n];
+
+			boards++;
+			fails += !result->passed;
+			frames += result->frame_irqs;
+			ticks += result->tick_irqs;
+			ns += result->ns;
+			if (result->ns > max_ns)
+				max_ns = result->ns;
+		}
+		if (boards == 0)
+			continue;
+		printf("%5d %6u %7uM %-8s %7u %5u %10.1f %10.1f %10.1f %10.1f\n", config.num_leds, config.pwm_hertz,
+				config.clock_hz / 1000000, fleet_behavior_names[config.behavior], boards, fails,
+				(double)frames / ((double)boards * pool->seconds), (double)ticks / ((double)boards * pool->seconds),
+				(double)ns / boards / 1000.0, (double)max_ns / 1000.0);
+		failed += fails;
+	}
+
+	for (unsigned int n = 0; n < pool->num_boards && printed < 10; n++)
+	{
+		fleet_result_t * result = &pool->results[n];
+
+		if (result->passed)
+			continue;
+		printf("board %u, seed %u: %s at %u ms\n", n, pool->seed + n, result->failure, result->failed_ms);
+		printed++;
+	}
+	return failed;
+}
+
+int main(int argc, char ** argv)
+{
+	static fleet_pool_t pool;
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int num_threads = cpus > 0 ? (int)cpus : 1;
+	int scaling = 0;
+	unsigned long long ns;
+	unsigned long long board_ns = 0;
+	unsigned int failed;
+
+	pool.num_boards = 50 * FLEET_NUM_CONFIGS;
+	pool.seconds = 10;
+	pool.seed = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			pool.num_boards = (unsigned int)strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+			pool.seconds = (unsigned int)strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			num_threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+			pool.seed = (unsigned int)strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "-b") == 0)
+			scaling = 1;
+		else
+		{
+			fprintf(stderr, "usage: led_fleet [-n boards] [-d seconds] [-t threads] [-s seed] [-b]\n");
+			return 2;
+		}
+	}
+	if (num_threads < 1)
+		num_threads = 1;
+	if (num_threads > FLEET_MAX_THREADS)
+		num_threads = FLEET_MAX_THREADS;
+	if (pool.seconds < 1)
+		pool.seconds = 1;
+	pool.results = calloc(pool.num_boards > 0 ? pool.num_boards : 1, sizeof(fleet_result_t));
+	if (pool.results == NULL)
+		return 2;
+
+	if (scaling)
+	{
+		unsigned long long one_ns = 0;
+		unsigned int checksum = 0;
+
+		printf("%ld CPUs online, the speedup can be no more than that\n", cpus);
+		printf("%8s %10s %12s %10s %10s %8s\n", "threads", "wall s", "boards/s", "speedup", "efficiency", "steals");
+		for (int t = 1; t <= num_threads; t = (t * 2 > num_threads && t < num_threads) ? num_threads : t * 2)
+		{
+			unsigned int steals = 0;
+
+			ns = run_fleet_pool(&pool, t);
+			for (int w = 0; w < t; w++)
+				steals += pool.steals[w];
+			if (t == 1)
+			{
+				one_ns = ns;
+				checksum = get_fleet_checksum(&pool);
+			}
+			else if (get_fleet_checksum(&pool) != checksum)
+			{
+				printf("%d threads: the results differ from 1 thread\n", t);
+				return 1;
+			}
+			printf("%8d %10.3f %12.1f %10.2f %9.0f%% %8u\n", t, ns / 1e9, pool.num_boards / (ns / 1e9),
+					(double)one_ns / ns, 100.0 * one_ns / ns / t, steals);
+		}
+		printf("\n");
+	}
+
+	ns = run_fleet_pool(&pool, num_threads);
+	failed = print_fleet_results(&pool);
+	for (unsigned int n = 0; n < pool.num_boards; n++)
+		board_ns += pool.results[n].ns;
+	printf("led_fleet: %u boards of %u s on %d threads, %u failed, %.3f s wall, %.0f times real time per CPU\n",
+			pool.num_boards, pool.seconds, num_threads, failed, ns / 1e9,
+			board_ns > 0 ? (double)pool.num_boards * pool.seconds * 1e9 / board_ns : 0.0);
+	free(pool.results);
+	return failed != 0;
+}
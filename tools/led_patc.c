@@ -0,0 +1,537 @@
+/*
+ * led_patc.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host side compiler for led_pattern blobs, see lib/led_pattern.h for the encoding.  Built on its own with any C
+ * compiler for the host, it does not use the SDK:
+ *
+ *	gcc -o led_patc tools/led_patc.c
+ *	led_patc [-o blob.bin] [-c name] [-d] pattern.txt
+ *
+ *	-o	write the blob to a file
+ *	-c	print the blob as a C array called name, to build into the firmware so it is played from flash
+ *	-d	print the ops of the blob
+ *
+ * A pattern is one statement per line, # starts a comment.  Times are in ms and must be whole ticks:
+ *
+ *	tick 500			the LED_TIMER_MS the pattern is played at, must come first
+ *	leds 4				number of LEDs used
+ *	set 0 255			set LED 0 to level 255, 0 - 255, output LEDs are on from 128
+ *	fade 1 255 2000		fade LED 1 to level 255 over 2000ms
+ *	wait 500			wait 500ms
+ *	loop 3 {			run the statements up to the matching } 3 times
+ *	}
+ *	forever				start again from the top, must be the last statement
+ *
+ * Runs of repeated statements are found and replaced with a REPEAT, so they take no more room than a loop.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../lib/led_pattern_format.h"
+
+#define PATC_MAX_LINE		256
+#define PATC_MAX_RUN_UNITS	8		// longest run of statements looked for when compressing
+#define PATC_MAX_LEDS		16		// the LED is the low nibble of SET and FADE
+#define PATC_MAX_CHECK_OPS	10000000UL
+
+typedef struct patc_buf_t {
+	unsigned char * data;
+	size_t len;
+	size_t cap;
+	int nest;		// REPEATs nested inside, a loop with a loop in it is 2
+}patc_buf_t;
+
+// a unit is a statement or a whole loop, the smallest thing that can be compressed as a run
+typedef struct patc_units_t {
+	patc_buf_t * units;
+	size_t len;
+	size_t cap;
+}patc_units_t;
+
+static const char * patc_file;
+static int patc_line;
+static unsigned int patc_tick_ms;
+static unsigned int patc_num_leds;
+static int patc_has_wait;
+
+static void patc_fail(const char * msg, const char * detail)
+{
+	fprintf(stderr, "%s:%d: %s%s%s\n", patc_file, patc_line, msg, detail ? " " : "", detail ? detail : "");
+	exit(1);
+}
+
+static void patc_put(patc_buf_t * buf, const unsigned char * data, size_t len)
+{
+	if (buf->len + len > buf->cap)
+	{
+		buf->cap = (buf->len + len) * 2 + 16;
+		buf->data = realloc(buf->data, buf->cap);
+		if (buf->data == NULL)
+			patc_fail("out of memory", NULL);
+	}
+	memcpy(buf->data + buf->len, data, len);
+	buf->len += len;
+}
+
+static void patc_put_byte(patc_buf_t * buf, unsigned char byte)
+{
+	patc_put(buf, &byte, 1);
+}
+
+static void patc_put_number(patc_buf_t * buf, unsigned int value)
+{
+	do
+	{
+		unsigned char byte = value & 0x7F;
+		value >>= 7;
+		if (value)
+			byte |= 0x80;
+		patc_put_byte(buf, byte);
+	} while (value);
+}
+
+static void patc_add_unit(patc_units_t * units, patc_buf_t * unit)
+{
+	if (units->len == units->cap)
+	{
+		units->cap = units->cap * 2 + 8;
+		units->units = realloc(units->units, units->cap * sizeof(patc_buf_t));
+		if (units->units == NULL)
+			patc_fail("out of memory", NULL);
+	}
+	units->units[units->len++] = *unit;
+}
+
+static unsigned int patc_ticks(const char * text, int allow_zero)
+{
+	char * end;
+	unsigned long ms = strtoul(text, &end, 0);
+
+	if (*end != '\0')
+		patc_fail("not a number:", text);
+	if (ms % patc_tick_ms != 0)
+		patc_fail("time is not a whole number of ticks:", text);
+	if (ms == 0 && !allow_zero)
+		patc_fail("time must be at least one tick:", text);
+
+	return (unsigned int)(ms / patc_tick_ms);
+}
+
+static unsigned int patc_number(const char * text, unsigned int max)
+{
+	char * end;
+	unsigned long value = strtoul(text, &end, 0);
+
+	if (*end != '\0' || value > max)
+		patc_fail("number out of range:", text);
+
+	return (unsigned int)value;
+}
+
+static void patc_put_repeat(patc_buf_t * buf, size_t back, unsigned int count)
+{
+	patc_put_byte(buf, LED_PATTERN_OP_REPEAT);
+	patc_put_number(buf, (unsigned int)back);
+	patc_put_number(buf, count);
+}
+
+static int patc_units_equal(patc_units_t * units, size_t a, size_t b, size_t num)
+{
+	for (size_t i = 0; i < num; i++)
+	{
+		patc_buf_t * x = &units->units[a + i];
+		patc_buf_t * y = &units->units[b + i];
+		if (x->len != y->len || memcmp(x->data, y->data, x->len) != 0)
+			return 0;
+	}
+
+	return 1;
+}
+
+// lays the units of a block inside depth loops out one after another, replacing runs of the same units with one
+// copy and a REPEAT as long as that stays inside LED_PATTERN_MAX_DEPTH, and frees the units
+static void patc_flatten(patc_units_t * units, int depth, patc_buf_t * out)
+{
+	size_t i = 0;
+
+	while (i < units->len)
+	{
+		size_t best_num = 0;
+		unsigned int best_count = 0;
+		long best_saved = 0;
+
+		for (size_t num = 1; num <= PATC_MAX_RUN_UNITS && i + 2 * num <= units->len; num++)
+		{
+			size_t body = 0;
+			int nest = 0;
+			unsigned int count = 1;
+			patc_buf_t repeat = { 0 };
+
+			for (size_t k = 0; k < num; k++)
+			{
+				if (units->units[i + k].nest > nest)
+					nest = units->units[i + k].nest;
+			}
+			if (depth + 1 + nest > LED_PATTERN_MAX_DEPTH)
+				continue;
+
+			while (i + (count + 1) * num <= units->len && patc_units_equal(units, i, i + count * num, num))
+				count++;
+			if (count < 2)
+				continue;
+
+			for (size_t k = 0; k < num; k++)
+				body += units->units[i + k].len;
+			patc_put_repeat(&repeat, body, count - 1);
+			long saved = (long)(body * (count - 1)) - (long)repeat.len;
+			free(repeat.data);
+
+			if (saved > best_saved)
+			{
+				best_saved = saved;
+				best_num = num;
+				best_count = count;
+			}
+		}
+
+		if (best_num == 0)
+		{
+			patc_put(out, units->units[i].data, units->units[i].len);
+			if (units->units[i].nest > out->nest)
+				out->nest = units->units[i].nest;
+			i++;
+			continue;
+		}
+
+		size_t start = out->len;
+		for (size_t k = 0; k < best_num; k++)
+		{
+			patc_put(out, units->units[i + k].data, units->units[i + k].len);
+			if (units->units[i + k].nest + 1 > out->nest)
+				out->nest = units->units[i + k].nest + 1;
+		}
+		patc_put_repeat(out, out->len - start, best_count - 1);
+		i += best_num * best_count;
+	}
+
+	for (i = 0; i < units->len; i++)
+		free(units->units[i].data);
+	free(units->units);
+}
+
+// compiles statements up to the end of the file or the } closing the block, returns 1 when forever was seen
+static int patc_block(FILE * in, int depth, patc_buf_t * out)
+{
+	patc_units_t units = { 0 };
+	char line[PATC_MAX_LINE];
+	int forever = 0;
+
+	while (fgets(line, sizeof(line), in) != NULL)
+	{
+		char * argv[5];
+		int argc = 0;
+		patc_buf_t unit = { 0 };
+
+		patc_line++;
+		char * hash = strchr(line, '#');
+		if (hash != NULL)
+			*hash = '\0';
+		for (char * word = strtok(line, " \t\r\n"); word != NULL && argc < 5; word = strtok(NULL, " \t\r\n"))
+			argv[argc++] = word;
+		if (argc == 0)
+			continue;
+
+		if (forever)
+			patc_fail("forever must be the last statement", NULL);
+
+		if (strcmp(argv[0], "}") == 0)
+		{
+			if (depth == 0)
+				patc_fail("} without a loop", NULL);
+			patc_flatten(&units, depth, out);
+			return 0;
+		}
+
+		if (strcmp(argv[0], "tick") == 0 && argc == 2)
+		{
+			if (patc_tick_ms != 0)
+				patc_fail("tick given twice", NULL);
+			patc_tick_ms = patc_number(argv[1], 0xFFFF);
+			if (patc_tick_ms == 0)
+				patc_fail("tick must be at least 1ms", NULL);
+			continue;
+		}
+		if (patc_tick_ms == 0)
+			patc_fail("tick must come before any other statement", NULL);
+
+		if (strcmp(argv[0], "leds") == 0 && argc == 2)
+		{
+			patc_num_leds = patc_number(argv[1], PATC_MAX_LEDS);
+		}
+		else if (strcmp(argv[0], "set") == 0 && argc == 3)
+		{
+			unsigned int led = patc_number(argv[1], 15);
+			if (led >= patc_num_leds)
+				patc_fail("LED is not below leds:", argv[1]);
+			patc_put_byte(&unit, (unsigned char)(LED_PATTERN_OP_SET | led));
+			patc_put_byte(&unit, (unsigned char)patc_number(argv[2], 255));
+		}
+		else if (strcmp(argv[0], "fade") == 0 && argc == 4)
+		{
+			unsigned int led = patc_number(argv[1], 15);
+			if (led >= patc_num_leds)
+				patc_fail("LED is not below leds:", argv[1]);
+			patc_put_byte(&unit, (unsigned char)(LED_PATTERN_OP_FADE | led));
+			patc_put_byte(&unit, (unsigned char)patc_number(argv[2], 255));
+			patc_put_number(&unit, patc_ticks(argv[3], 0));
+		}
+		else if (strcmp(argv[0], "wait") == 0 && argc == 2)
+		{
+			unsigned int ticks = patc_ticks(argv[1], 0);
+			if (ticks < 16)
+			{
+				patc_put_byte(&unit, (unsigned char)(LED_PATTERN_OP_WAIT | ticks));
+			}
+			else
+			{
+				patc_put_byte(&unit, LED_PATTERN_OP_WAIT);
+				patc_put_number(&unit, ticks);
+			}
+			patc_has_wait = 1;
+		}
+		else if (strcmp(argv[0], "loop") == 0 && argc == 3 && strcmp(argv[2], "{") == 0)
+		{
+			unsigned int count = patc_number(argv[1], 0x0FFFFFFF);
+			if (count == 0)
+				patc_fail("loop count must be at least 1", NULL);
+			if (depth + 1 > LED_PATTERN_MAX_DEPTH)
+				patc_fail("loops are nested too deep", NULL);
+			patc_block(in, depth + 1, &unit);
+			if (unit.len == 0)
+				patc_fail("loop is empty", NULL);
+			if (count > 1)
+			{
+				patc_put_repeat(&unit, unit.len, count - 1);
+				unit.nest++;
+			}
+		}
+		else if (strcmp(argv[0], "forever") == 0 && argc == 1)
+		{
+			if (depth != 0)
+				patc_fail("forever cannot be inside a loop", NULL);
+			forever = 1;
+		}
+		else
+		{
+			patc_fail("unknown statement:", argv[0]);
+		}
+
+		if (unit.len > 0)
+			patc_add_unit(&units, &unit);
+	}
+
+	if (depth != 0)
+		patc_fail("loop is missing its }", NULL);
+
+	patc_flatten(&units, depth, out);
+	return forever;
+}
+
+typedef struct patc_op_t {
+	unsigned char op;
+	unsigned char level;
+	unsigned int values[2];		// ticks of a FADE or WAIT, or back and count of a REPEAT
+}patc_op_t;
+
+// decodes the op at pc, returns the offset of the next one
+static size_t patc_decode(patc_buf_t * blob, size_t pc, patc_op_t * op)
+{
+	op->op = blob->data[pc++];
+	op->level = 0;
+	op->values[0] = op->values[1] = 0;
+
+	// the op decides what follows it
+	int numbers = ((op->op & 0xF0) == LED_PATTERN_OP_FADE) ? 1 : ((op->op & 0xF0) == LED_PATTERN_OP_REPEAT) ? 2 : (op->op == LED_PATTERN_OP_WAIT) ? 1 : 0;
+	if ((op->op & 0xF0) == LED_PATTERN_OP_SET || (op->op & 0xF0) == LED_PATTERN_OP_FADE)
+		op->level = blob->data[pc++];
+	for (int n = 0; n < numbers; n++)
+	{
+		int shift = 0;
+		unsigned char byte;
+		do
+		{
+			byte = blob->data[pc++];
+			op->values[n] |= (unsigned int)(byte & 0x7F) << shift;
+			shift += 7;
+		} while (byte & 0x80);
+	}
+	if ((op->op & 0xF0) == LED_PATTERN_OP_WAIT && op->op != LED_PATTERN_OP_WAIT)
+		op->values[0] = op->op & 0x0F;
+
+	return pc;
+}
+
+// runs the ops the way the player does, without the LEDs, to check no tick runs more than LED_PATTERN_MAX_OPS of
+// them.  One pass is enough, plus the ops after a RESTART up to the first wait as they share a tick
+static void patc_check_ticks(patc_buf_t * blob)
+{
+	size_t loop_at[LED_PATTERN_MAX_DEPTH];
+	unsigned int loop_left[LED_PATTERN_MAX_DEPTH];
+	size_t pc = LED_PATTERN_HEADER_SIZE;
+	int restarted = 0;
+	int depth = 0;
+	int ops = 0;
+
+	for (unsigned long total = 0; total < PATC_MAX_CHECK_OPS; total++)
+	{
+		patc_op_t op;
+		size_t at = pc;
+
+		pc = patc_decode(blob, pc, &op);
+		if (++ops > LED_PATTERN_MAX_OPS)
+			patc_fail("more ops than LED_PATTERN_MAX_OPS run in one tick, add a wait", NULL);
+
+		switch (op.op & 0xF0)
+		{
+		case 0x00:
+			if (op.op == LED_PATTERN_OP_END || restarted)
+				return;
+			restarted = 1;
+			pc = LED_PATTERN_HEADER_SIZE;
+			depth = 0;
+			break;
+		case LED_PATTERN_OP_WAIT:
+			if (restarted)
+				return;
+			ops = 0;
+			break;
+		case LED_PATTERN_OP_REPEAT:
+			if (depth > 0 && loop_at[depth - 1] == at)
+			{
+				if (--loop_left[depth - 1] == 0)
+				{
+					depth--;
+					break;
+				}
+			}
+			else
+			{
+				loop_at[depth] = at;
+				loop_left[depth] = op.values[1];
+				depth++;
+			}
+			pc = at - op.values[0];
+			break;
+		default:
+			break;
+		}
+	}
+
+	fprintf(stderr, "%s: pattern is too long to check every tick, only the first %lu ops were\n", patc_file, PATC_MAX_CHECK_OPS);
+}
+
+static void patc_dump(patc_buf_t * blob)
+{
+	size_t pc = LED_PATTERN_HEADER_SIZE;
+
+	printf("version %u, %u LEDs, tick %ums\n", blob->data[2], blob->data[3], blob->data[4] | (blob->data[5] << 8));
+	while (pc < blob->len)
+	{
+		patc_op_t op;
+		size_t at = pc;
+
+		pc = patc_decode(blob, pc, &op);
+		printf("%5zu  ", at);
+		switch (op.op & 0xF0)
+		{
+		case 0x00:					printf("%s\n", op.op == LED_PATTERN_OP_END ? "end" : "restart");						break;
+		case LED_PATTERN_OP_SET:	printf("set %u %u\n", op.op & 0x0F, op.level);										break;
+		case LED_PATTERN_OP_FADE:	printf("fade %u %u %u ticks\n", op.op & 0x0F, op.level, op.values[0]);				break;
+		case LED_PATTERN_OP_WAIT:	printf("wait %u ticks\n", op.values[0]);												break;
+		default:					printf("repeat back to %zu, %u more times\n", at - op.values[0], op.values[1]);		break;
+		}
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	const char * out_file = NULL;
+	const char * c_name = NULL;
+	int dump = 0;
+	patc_buf_t blob = { 0 };
+	FILE * in;
+	int opt;
+
+	for (opt = 1; opt < argc - 1; opt++)
+	{
+		if (strcmp(argv[opt], "-o") == 0 && opt + 1 < argc - 1)
+			out_file = argv[++opt];
+		else if (strcmp(argv[opt], "-c") == 0 && opt + 1 < argc - 1)
+			c_name = argv[++opt];
+		else if (strcmp(argv[opt], "-d") == 0)
+			dump = 1;
+		else
+			break;
+	}
+	if (opt != argc - 1)
+	{
+		fprintf(stderr, "usage: %s [-o blob.bin] [-c name] [-d] pattern.txt\n", argv[0]);
+		return 2;
+	}
+
+	patc_file = argv[opt];
+	in = fopen(patc_file, "r");
+	if (in == NULL)
+	{
+		perror(patc_file);
+		return 1;
+	}
+
+	// the header is filled in once the tick and LEDs are known
+	patc_put(&blob, (const unsigned char *)"LP\0\0\0\0", LED_PATTERN_HEADER_SIZE);
+	int forever = patc_block(in, 0, &blob);
+	fclose(in);
+
+	if (patc_tick_ms == 0)
+		patc_fail("no tick given", NULL);
+	if (forever && !patc_has_wait)
+		patc_fail("a forever pattern needs at least one wait", NULL);
+	patc_put_byte(&blob, forever ? LED_PATTERN_OP_RESTART : LED_PATTERN_OP_END);
+	if (blob.len > 0xFFFF)
+		patc_fail("pattern is larger than 64KB", NULL);
+	patc_check_ticks(&blob);
+
+	blob.data[2] = LED_PATTERN_VERSION;
+	blob.data[3] = (unsigned char)patc_num_leds;
+	blob.data[4] = (unsigned char)(patc_tick_ms & 0xFF);
+	blob.data[5] = (unsigned char)(patc_tick_ms >> 8);
+
+	if (out_file != NULL)
+	{
+		FILE * out = fopen(out_file, "wb");
+		if (out == NULL || fwrite(blob.data, 1, blob.len, out) != blob.len)
+		{
+			perror(out_file);
+			return 1;
+		}
+		fclose(out);
+	}
+
+	if (c_name != NULL)
+	{
+		printf("// made by tools/led_patc.c from %s, do not edit\n", patc_file);
+		printf("const unsigned char %s[%zu] = {", c_name, blob.len);
+		for (size_t i = 0; i < blob.len; i++)
+			printf("%s0x%02X%s", (i % 12) ? " " : "\n\t", blob.data[i], (i + 1 < blob.len) ? "," : "");
+		printf("\n};\n");
+	}
+
+	if (dump)
+		patc_dump(&blob);
+
+	fprintf(stderr, "%s: %zu bytes, tick %ums, %u LEDs\n", patc_file, blob.len, patc_tick_ms, patc_num_leds);
+	free(blob.data);
+	return 0;
+}
@@ -0,0 +1,364 @@
+/*
+ * led_soak.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Soak run of the whole firmware, user_init, main_loop and irq_handler from app.c, on the virtual B85 of tools/sim.
+ * Built from the repository root:
+ *
+ *	gcc -O2 -Wno-cpp -Itools/sim -Ilib -I. -o led_soak tools/led_soak.c app.c tools/sim/tl_sim.c tools/sim/tl_flash.c \
+ *		lib/led_lib.c lib/led_proc.c lib/led_store.c lib/led_color.c lib/button_proc.c lib/led_coro.c \
+ *		lib/led_pattern.c lib/led_trace.c
+ *	led_soak [-d days] [-p minutes] [-c ms] [-s seed] [-v file.vcd | -j file.json]
+ *
+ *	-d	device time to run, 1 day when not given
+ *	-p	mean time between presses of SW1, 10 minutes when not given, 0 for none
+ *	-c	time between invariant checks, 100ms when not given
+ *	-s	seed of the presses
+ *	-v	stream the LEDs, interrupts and main loop of the run to a VCD file for GTKWave
+ *	-j	the same as Chrome trace JSON for Perfetto
+ *
+ * Add -DLED_BEHAVIOR=1 to 5 to soak another behaviour of led_lib.c.  The clock jumps straight from one interrupt
+ * to the next, with the main loop polled every LED_FADE_TICK_MS, so a day of device time passes in about 20s on a PC
+ * and a week in a little over 2 minutes.  SW1 is pressed at random as clicks, double clicks and long presses,
+ * bouncing as a real switch does.  Between main loop steps the invariants are checked:
+ *
+ *	- every output LED pin is at the level of its led_output_state, read from the chip and with verify_led_outputs
+ *	- no interrupt ran into the next frame or Timer0 period, and none was left pending by its handler
+ *	- Timer0 expired once per LED_TIMER_MS while the tick ran, no more, and no fewer while it never idled
+ *	- the white LED fade kept moving
+ *	- no button event was dropped, SW1 is seen as released once it has been let go, and the white LED is at
+ *	  the rate the double clicks switched it to
+ *
+ * At the end the erases of the store sectors must be spread evenly.  Exits 1 if any invariant failed.
+ *
+ * A trace needs -DLED_TRACE_ENABLE=1 as well, led_soak exits 2 when asked for one without it.  Every PWM frame is
+ * two changes of pwm2_irq and often one of the white compare, some 4MB of VCD or 13MB of JSON a minute of device
+ * time, so keep traced runs short: -d 0.01 is a quarter of an hour.  Writing the VCD runs the soak at about 60% of
+ * its untraced speed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tl_sim.h"
+#include "tl_flash.h"
+#include "led_lib.h"
+#include "led_proc.h"
+#include "led_store.h"
+#include "button_proc.h"
+#include "led_trace.h"
+
+#define SOAK_MAX_FAILURES		10			// failures printed, the rest are only counted
+#define SOAK_BOUNCES			3			// most bounces at each change of SW1
+#define SOAK_BOUNCE_TICKS		(3 * TL_SIM_TICKS_PER_MS)
+#define SOAK_CLICK_TICKS		(100 * TL_SIM_TICKS_PER_MS)
+#define SOAK_LONG_PRESS_TICKS	((SOAK_LONG_PRESS_MS + 400) * TL_SIM_TICKS_PER_MS)
+#define SOAK_CAMERA_TICKS		(60 * TL_SIM_TICKS_PER_SEC)		// longest the white LED stays at LED_PWM_CAMERA_HERTZ
+
+// bsp.h defines the LEDs and buttons, it is only included by led_lib.c
+#define SOAK_BUTTON_PIN			GPIO_PB2
+#define SOAK_FADE_TICK_MS		5
+#define SOAK_LONG_PRESS_MS		800
+#define SOAK_MULTI_CLICK_MS		300
+#define SOAK_MAX_LEDS			32
+#define SOAK_TIMER_MS			500
+#define SOAK_PWM_HERTZ			1000
+#define SOAK_CAMERA_HERTZ		25000
+#define SOAK_STORE_ADDR			0x70000
+#define SOAK_STORE_SECTORS		4
+
+extern struct led_proc_t led_proc;
+extern struct button_proc_t button_proc;
+extern volatile unsigned char led_tick_running;
+extern int pwm_up;
+void irq_handler(void);
+void user_init(void);
+void main_loop(void);
+
+typedef enum SOAK_PRESSES {
+	SOAK_PRESS_CLICK,
+	SOAK_PRESS_DOUBLE_CLICK,
+	SOAK_PRESS_LONG,
+	SOAK_NUM_PRESSES
+}soak_press;
+
+static tl_sim_time_t soak_press_mean;
+static tl_sim_time_t soak_next_press;		// nothing is queued on SW1 after this
+static tl_sim_time_t soak_camera_until;		// the white LED is at LED_PWM_CAMERA_HERTZ until a double click this soon
+static unsigned long soak_presses[SOAK_NUM_PRESSES];
+static tl_sim_time_t soak_last_check;
+static tl_sim_time_t soak_tick_start;
+static int soak_tick_always;				// the tick has never been seen idle
+static unsigned short soak_last_brightness;
+static int soak_last_up;
+static unsigned int soak_overruns;			// failures already counted
+static unsigned long soak_storms;
+static unsigned int soak_dropped;
+static unsigned long soak_checks;
+static unsigned long soak_failures;
+static FILE * soak_trace_file;				// NULL when the run is not traced
+static led_trace_format soak_trace_format;
+static struct led_trace_t soak_trace;
+
+static void fail_soak(const char * what)
+{
+	soak_failures++;
+	if (soak_failures <= SOAK_MAX_FAILURES)
+		printf("%14.3f s  %s\n", (double)tl_sim_now / TL_SIM_TICKS_PER_SEC, what);
+}
+
+// one change of SW1, which is active low, and the bounces after it
+static tl_sim_time_t drive_soak_change(tl_sim_time_t at, int level)
+{
+	int bounces = rand() % (SOAK_BOUNCES + 1);
+
+	tl_sim_drive_input(at, SOAK_BUTTON_PIN, level);
+	for (int i = 0; i < bounces; i++)
+	{
+		at += 1 + (tl_sim_time_t)rand() % (SOAK_BOUNCE_TICKS / (2 * SOAK_BOUNCES));
+		tl_sim_drive_input(at, SOAK_BUTTON_PIN, !level);
+		at += 1 + (tl_sim_time_t)rand() % (SOAK_BOUNCE_TICKS / (2 * SOAK_BOUNCES));
+		tl_sim_drive_input(at, SOAK_BUTTON_PIN, level);
+	}
+	return at;
+}
+
+static tl_sim_time_t drive_soak_press(tl_sim_time_t at, tl_sim_time_t held)
+{
+	drive_soak_change(at, 0);
+	return drive_soak_change(at + held, 1);
+}
+
+// queues the next press once the last has been played, a double click away from the camera rate comes sooner
+static void script_soak_presses(void)
+{
+	tl_sim_time_t at;
+	soak_press press;
+
+	if (soak_press_mean == 0 || tl_sim_now < soak_next_press)
+		return;
+
+	if (soak_camera_until != 0)
+	{
+		at = tl_sim_now + (tl_sim_time_t)rand() % soak_camera_until;
+		press = SOAK_PRESS_DOUBLE_CLICK;
+	}
+	else
+	{
+		at = tl_sim_now + (tl_sim_time_t)((double)rand() / RAND_MAX * 2 * (double)soak_press_mean);
+		press = (soak_press)(rand() % SOAK_NUM_PRESSES);
+	}
+
+	if (press == SOAK_PRESS_CLICK)
+		soak_next_press = drive_soak_press(at, SOAK_CLICK_TICKS);
+	else if (press == SOAK_PRESS_DOUBLE_CLICK)
+	{
+		at = drive_soak_press(at, SOAK_CLICK_TICKS);
+		soak_next_press = drive_soak_press(at + SOAK_CLICK_TICKS, SOAK_CLICK_TICKS);
+		soak_camera_until = (soak_camera_until != 0) ? 0 : SOAK_CAMERA_TICKS;
+	}
+	else
+		soak_next_press = drive_soak_press(at, SOAK_LONG_PRESS_TICKS);
+	soak_presses[press]++;
+	// the multi click is only decided once it has gone quiet, and a retune waits for the next frame
+	soak_next_press += (SOAK_MULTI_CLICK_MS + 2 * SOAK_FADE_TICK_MS) * TL_SIM_TICKS_PER_MS;
+}
+
+static led_proc_error_type write_soak_trace(void * context, const unsigned char * data, unsigned int len)
+{
+	if (fwrite(data, 1, len, (FILE *)context) != len)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+// the trace starts once led_lib is set up, as it would be from the end of user_init on the chip
+static void init_soak(void)
+{
+	user_init();
+	if (soak_trace_file == NULL)
+		return;
+	init_led_trace(&soak_trace, soak_trace_format, CLOCK_16M_SYS_TIMER_CLK_1S, write_soak_trace, soak_trace_file);
+	if (start_led_lib_trace(&soak_trace) != LED_PROC_ERROR_TYPE_NONE)
+	{
+		printf("no trace, led_lib is built without LED_TRACE_ENABLE\n");
+		exit(2);
+	}
+}
+
+static void check_soak(void)
+{
+	unsigned int mismatch[LED_PROC_MASK_WORDS(SOAK_MAX_LEDS)] = { 0 };
+	led_isr_stats_t isr_stats;
+	tl_sim_time_t tick_time = tl_sim_now - soak_tick_start;
+	unsigned long ticks_due = (unsigned long)(tick_time / (SOAK_TIMER_MS * TL_SIM_TICKS_PER_MS));
+	led_pwm_state_t * white = NULL;
+	unsigned short brightness = 0;
+	char what[96];
+
+	soak_checks++;
+	for (int i = 0; i < led_proc.num_leds; i++)
+	{
+		led_t * led = &led_proc.led_array[i];
+
+		if (led->led_type == LED_TYPE_OUTPUT && tl_sim_output_level(led->led_ptr) != (led->led_output_state == LED_ON))
+		{
+			snprintf(what, sizeof(what), "LED %d pin at %d, led_output_state %d", i, tl_sim_output_level(led->led_ptr),
+					led->led_output_state);
+			fail_soak(what);
+		}
+		if (led->led_type == LED_TYPE_PWM)
+			white = led->led_pwm_state;
+	}
+	if (white != NULL)
+		brightness = white->led_brightness;
+	if (verify_led_outputs(&led_proc, mismatch, LED_PROC_MASK_WORDS(SOAK_MAX_LEDS)) != LED_PROC_ERROR_TYPE_NONE)
+		fail_soak("verify_led_outputs failed");
+	for (int i = 0; i < LED_PROC_MASK_WORDS(SOAK_MAX_LEDS); i++)
+	{
+		if (mismatch[i] != 0)
+		{
+			snprintf(what, sizeof(what), "verify_led_outputs mismatch 0x%08X in word %d", mismatch[i], i);
+			fail_soak(what);
+		}
+	}
+
+	get_led_isr_stats(&isr_stats);
+	if (isr_stats.isr_overruns != soak_overruns || tl_sim_stats.irq_storms != soak_storms)
+	{
+		snprintf(what, sizeof(what), "%u interrupt overruns, %lu storms", isr_stats.isr_overruns, tl_sim_stats.irq_storms);
+		fail_soak(what);
+		soak_overruns = isr_stats.isr_overruns;
+		soak_storms = tl_sim_stats.irq_storms;
+	}
+
+	if (!led_tick_running)
+		soak_tick_always = 0;
+	if (tl_sim_stats.timer0_expiries > ticks_due + 1 || (soak_tick_always && tl_sim_stats.timer0_expiries + 1 < ticks_due))
+	{
+		snprintf(what, sizeof(what), "Timer0 expired %lu times, %lu due", tl_sim_stats.timer0_expiries, ticks_due);
+		fail_soak(what);
+		soak_tick_start = tl_sim_now - (tl_sim_time_t)tl_sim_stats.timer0_expiries * SOAK_TIMER_MS * TL_SIM_TICKS_PER_MS;
+	}
+
+	// a fade that turned round between checks can come back to the same brightness
+	if (tl_sim_now - soak_last_check >= 2 * SOAK_FADE_TICK_MS * TL_SIM_TICKS_PER_MS && brightness == soak_last_brightness
+			&& pwm_up == soak_last_up)
+		fail_soak("the white LED fade has stopped");
+	soak_last_brightness = brightness;
+	soak_last_up = pwm_up;
+	soak_last_check = tl_sim_now;
+
+	// once the last press has been played SW1 is released, and the white LED is at the rate the double clicks asked
+	// for.  An edge that was lost leaves it pressed, or turns a double click into clicks
+	if (tl_sim_now >= soak_next_press && (button_proc.button_array[0].button_pressed || button_proc.button_array[0].button_raw != 1))
+		fail_soak("SW1 is released but button_proc has it pressed");
+	if (tl_sim_now >= soak_next_press && white != NULL
+			&& white->led_pwm_timing.hertz != ((soak_camera_until != 0) ? SOAK_CAMERA_HERTZ : SOAK_PWM_HERTZ))
+	{
+		snprintf(what, sizeof(what), "the white LED is at %u Hz after %lu double clicks", white->led_pwm_timing.hertz,
+				soak_presses[SOAK_PRESS_DOUBLE_CLICK]);
+		fail_soak(what);
+		soak_camera_until = (white->led_pwm_timing.hertz == SOAK_CAMERA_HERTZ) ? SOAK_CAMERA_TICKS : 0;
+	}
+
+	if (button_proc.button_events_dropped != soak_dropped)
+	{
+		fail_soak("button events dropped");
+		soak_dropped = button_proc.button_events_dropped;
+	}
+
+	script_soak_presses();
+}
+
+int main(int argc, char ** argv)
+{
+	double days = 1;
+	double press_minutes = 10;
+	double check_ms = 100;
+	unsigned int seed = 35;
+	tl_sim_time_t duration;
+	tl_sim_time_t ran;
+	struct timespec start;
+	struct timespec end;
+	double seconds;
+	led_isr_stats_t isr_stats;
+	led_pwm_state_t * pwm_state = NULL;
+	unsigned int erases_min;
+	unsigned int erases_max;
+	const char * trace_name = NULL;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "-d") == 0)
+			days = atof(argv[i + 1]);
+		else if (strcmp(argv[i], "-p") == 0)
+			press_minutes = atof(argv[i + 1]);
+		else if (strcmp(argv[i], "-c") == 0)
+			check_ms = atof(argv[i + 1]);
+		else if (strcmp(argv[i], "-s") == 0)
+			seed = (unsigned int)strtoul(argv[i + 1], NULL, 0);
+		else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "-j") == 0)
+		{
+			trace_name = argv[i + 1];
+			soak_trace_format = (argv[i][1] == 'v') ? LED_TRACE_FORMAT_VCD : LED_TRACE_FORMAT_JSON;
+		}
+	}
+	if (trace_name != NULL && (soak_trace_file = fopen(trace_name, "wb")) == NULL)
+	{
+		printf("cannot write %s\n", trace_name);
+		return 2;
+	}
+	duration = (tl_sim_time_t)(days * 86400 * TL_SIM_TICKS_PER_SEC);
+	soak_press_mean = (tl_sim_time_t)(press_minutes * 60 * TL_SIM_TICKS_PER_SEC);
+	srand(seed);
+
+	tl_sim_reset();
+	tl_flash_reset();
+	tl_sim_set_irq_handler(irq_handler);
+	tl_sim_set_poll(SOAK_FADE_TICK_MS * TL_SIM_TICKS_PER_MS);
+	tl_sim_set_check(check_soak, (tl_sim_time_t)(check_ms * TL_SIM_TICKS_PER_MS));
+	soak_tick_always = 1;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	ran = tl_sim_run(init_soak, main_loop, duration);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if (soak_trace_file != NULL)
+	{
+		if (stop_led_lib_trace() != LED_PROC_ERROR_TYPE_NONE || soak_trace.trace_stats.trace_write_errors != 0)
+			fail_soak("trace not written in full");
+		fclose(soak_trace_file);
+	}
+	seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+	tl_flash_erase_spread(SOAK_STORE_ADDR, SOAK_STORE_SECTORS, &erases_min, &erases_max);
+	if (erases_max > erases_min + 1)
+		fail_soak("store sector erases are not spread evenly");
+
+	get_led_isr_stats(&isr_stats);
+	for (int i = 0; i < led_proc.num_leds; i++)
+	{
+		if (led_proc.led_array[i].led_type == LED_TYPE_PWM)
+			pwm_state = led_proc.led_array[i].led_pwm_state;
+	}
+
+	printf("device time      %.1f days in %.2f s, %.0f times real time\n", (double)ran / TL_SIM_TICKS_PER_SEC / 86400,
+			seconds, (double)ran / TL_SIM_TICKS_PER_SEC / seconds);
+	printf("main loop        %lu polls, %lu invariant checks\n", tl_sim_stats.polls, soak_checks);
+	printf("interrupts       %lu, longest %.1f us, %u overruns\n", tl_sim_stats.irqs,
+			(double)isr_stats.isr_max_ticks / (CLOCK_16M_SYS_TIMER_CLK_1S / 1000000), isr_stats.isr_overruns);
+	printf("Timer0           %lu expiries, tick %s\n", tl_sim_stats.timer0_expiries, soak_tick_always ? "never idled" : "idled");
+	if (pwm_state != NULL)
+		printf("white frames     %u taken, %u useful\n", pwm_state->led_frame_stats.irq_taken, pwm_state->led_frame_stats.irq_useful);
+	printf("SW1              %lu clicks, %lu double clicks, %lu long presses\n", soak_presses[SOAK_PRESS_CLICK],
+			soak_presses[SOAK_PRESS_DOUBLE_CLICK], soak_presses[SOAK_PRESS_LONG]);
+	printf("store            %lu bytes written, %lu sector erases, %u to %u per sector\n", tl_flash_stats.bytes_written,
+			tl_flash_stats.sectors_erased, erases_min, erases_max);
+	if (soak_trace_file != NULL)
+		printf("trace            %s, %u events, %u changes, %u bytes in %u writes\n", trace_name,
+				soak_trace.trace_stats.trace_events, soak_trace.trace_stats.trace_changes,
+				soak_trace.trace_stats.trace_bytes, soak_trace.trace_stats.trace_flushes);
+	printf("%lu invariant failures\n", soak_failures);
+
+	return soak_failures != 0;
+}
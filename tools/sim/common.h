@@ -0,0 +1,14 @@
+/*
+ * common.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host stand-in for the common.h of the Telink SDK, see driver.h
+ */
+
+#ifndef TOOLS_SIM_COMMON_H_
+#define TOOLS_SIM_COMMON_H_
+
+#include "driver.h"
+
+#endif /* TOOLS_SIM_COMMON_H_ */
@@ -0,0 +1,179 @@
+/*
+ * driver.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host stand-in for the driver.h of the Telink SDK, so the LED library builds on a PC for the host tests under
+ * tools/.  Only what the library uses is here.  The registers and driver calls are in tl_sim.c, which acts on them
+ * the way the B85 does against a virtual clock, see tl_sim.h.  The flash calls are in tl_flash.c, which can be built
+ * on its own for tests that only need flash.
+ */
+
+#ifndef TOOLS_SIM_DRIVER_H_
+#define TOOLS_SIM_DRIVER_H_
+
+typedef unsigned char u8;
+typedef unsigned short u16;
+typedef unsigned int u32;
+
+#define BIT(n)				(1 << (n))
+#define BM_SET(x, m)		((x) |= (m))
+#define BM_CLR(x, m)		((x) &= ~(m))
+
+#define _attribute_ram_code_
+#define _attribute_ram_code_sec_noinline_	__attribute__((noinline))
+#define _attribute_data_retention_
+
+// the port in the upper byte and the pin mask in the lower byte, the same as the SDK
+typedef enum {
+	GPIO_PA0 = 0x000 | BIT(0), GPIO_PA1 = 0x000 | BIT(1), GPIO_PA2 = 0x000 | BIT(2), GPIO_PA3 = 0x000 | BIT(3),
+	GPIO_PA4 = 0x000 | BIT(4), GPIO_PA5 = 0x000 | BIT(5), GPIO_PA6 = 0x000 | BIT(6), GPIO_PA7 = 0x000 | BIT(7),
+	GPIO_PB0 = 0x100 | BIT(0), GPIO_PB1 = 0x100 | BIT(1), GPIO_PB2 = 0x100 | BIT(2), GPIO_PB3 = 0x100 | BIT(3),
+	GPIO_PB4 = 0x100 | BIT(4), GPIO_PB5 = 0x100 | BIT(5), GPIO_PB6 = 0x100 | BIT(6), GPIO_PB7 = 0x100 | BIT(7),
+	GPIO_PC0 = 0x200 | BIT(0), GPIO_PC1 = 0x200 | BIT(1), GPIO_PC2 = 0x200 | BIT(2), GPIO_PC3 = 0x200 | BIT(3),
+	GPIO_PC4 = 0x200 | BIT(4), GPIO_PC5 = 0x200 | BIT(5), GPIO_PC6 = 0x200 | BIT(6), GPIO_PC7 = 0x200 | BIT(7),
+	GPIO_PD0 = 0x300 | BIT(0), GPIO_PD1 = 0x300 | BIT(1), GPIO_PD2 = 0x300 | BIT(2), GPIO_PD3 = 0x300 | BIT(3),
+	GPIO_PD4 = 0x300 | BIT(4), GPIO_PD5 = 0x300 | BIT(5), GPIO_PD6 = 0x300 | BIT(6), GPIO_PD7 = 0x300 | BIT(7),
+	GPIO_PE0 = 0x400 | BIT(0), GPIO_PE1 = 0x400 | BIT(1), GPIO_PE2 = 0x400 | BIT(2), GPIO_PE3 = 0x400 | BIT(3),
+}GPIO_PinTypeDef;
+
+typedef enum {
+	AS_GPIO,
+	AS_PWM0, AS_PWM1, AS_PWM2, AS_PWM3, AS_PWM4, AS_PWM5,
+	AS_PWM0_N, AS_PWM1_N, AS_PWM2_N, AS_PWM3_N, AS_PWM4_N, AS_PWM5_N,
+}GPIO_FuncTypeDef;
+
+typedef enum {
+	POL_RISING = 0,
+	POL_FALLING = 1,
+}GPIO_PolTypeDef;
+
+#define PM_PIN_UP_DOWN_FLOAT	0
+#define PM_PIN_PULLUP_1M		1
+#define PM_PIN_PULLDOWN_100K	2
+#define PM_PIN_PULLUP_10K		3
+
+typedef enum {
+	PWM0_ID, PWM1_ID, PWM2_ID, PWM3_ID, PWM4_ID, PWM5_ID,
+}pwm_id;
+
+typedef enum {
+	PWM_NORMAL_MODE = 0x00,
+	PWM_COUNT_MODE = 0x01,
+	PWM_IR_MODE = 0x03,
+}pwm_mode;
+
+// frame status bits, PWM_IRQ_PWMn_FRAME is BIT(n + 2) in the SDK
+typedef enum {
+	PWM_IRQ_PWM0_PNUM = BIT(0),
+	PWM_IRQ_PWM0_IR_DMA_FIFO_DONE = BIT(1),
+	PWM_IRQ_PWM0_FRAME = BIT(2),
+	PWM_IRQ_PWM1_FRAME = BIT(3),
+	PWM_IRQ_PWM2_FRAME = BIT(4),
+	PWM_IRQ_PWM3_FRAME = BIT(5),
+	PWM_IRQ_PWM4_FRAME = BIT(6),
+	PWM_IRQ_PWM5_FRAME = BIT(7),
+}PWM_IRQ;
+
+typedef enum {
+	TIMER0, TIMER1, TIMER2,
+}TIMER_TypeDef;
+
+typedef enum {
+	TIMER_MODE_SYSCLK,
+	TIMER_MODE_GPIO_TRIGGER,
+	TIMER_MODE_GPIO_WIDTH,
+	TIMER_MODE_TICK,
+}TIMER_ModeTypeDef;
+
+typedef enum {
+	TMR_STA_TMR0 = BIT(0),
+	TMR_STA_TMR1 = BIT(1),
+	TMR_STA_TMR2 = BIT(2),
+}TIMER_StatusTypeDef;
+
+// reg_irq_mask and reg_irq_src bits
+enum {
+	FLD_IRQ_TMR0_EN = BIT(0),
+	FLD_IRQ_TMR1_EN = BIT(1),
+	FLD_IRQ_TMR2_EN = BIT(2),
+	FLD_IRQ_SW_PWM_EN = BIT(14),
+	FLD_IRQ_GPIO_EN = BIT(18),
+};
+
+#define CLOCK_16M_SYS_TIMER_CLK_1S		16000000
+#define CLOCK_16M_SYS_TIMER_CLK_1MS		16000
+#define CLOCK_16M_SYS_TIMER_CLK_1US		16
+
+// the registers are reached through tl_sim.c, which counts every access and charges it to virtual time
+typedef enum {
+	TL_SIM_REG_GPIO_IN,			// level on the pin, only read back while its input buffer is enabled
+	TL_SIM_REG_GPIO_IE,
+	TL_SIM_REG_GPIO_OEN,		// active low output enable
+	TL_SIM_REG_GPIO_OUT,
+	TL_SIM_NUM_GPIO_REGS
+}tl_sim_gpio_reg;
+
+unsigned char * tl_sim_gpio_reg_addr(unsigned int pin, tl_sim_gpio_reg reg);
+unsigned int * tl_sim_irq_src_addr(void);
+unsigned int * tl_sim_irq_mask_addr(void);
+unsigned int tl_sim_read_tmr1_tick(void);
+
+#define reg_gpio_in(i)		(*tl_sim_gpio_reg_addr((i), TL_SIM_REG_GPIO_IN))
+#define reg_gpio_ie(i)		(*tl_sim_gpio_reg_addr((i), TL_SIM_REG_GPIO_IE))
+#define reg_gpio_oen(i)		(*tl_sim_gpio_reg_addr((i), TL_SIM_REG_GPIO_OEN))
+#define reg_gpio_out(i)		(*tl_sim_gpio_reg_addr((i), TL_SIM_REG_GPIO_OUT))
+#define reg_irq_mask		(*tl_sim_irq_mask_addr())
+// write 1 to clear on the chip, which a variable cannot do, so the simulator clears the GPIO source once the
+// interrupt it raised has been handled
+#define reg_irq_src			(*tl_sim_irq_src_addr())
+// reading the tick is where the main loop polls, so it is what moves virtual time along
+#define reg_tmr1_tick		tl_sim_read_tmr1_tick()
+#define reg_system_tick		clock_time()
+
+void gpio_set_func(GPIO_PinTypeDef pin, GPIO_FuncTypeDef func);
+void gpio_set_output_en(GPIO_PinTypeDef pin, unsigned int value);
+void gpio_set_input_en(GPIO_PinTypeDef pin, unsigned int value);
+void gpio_write(GPIO_PinTypeDef pin, unsigned int value);
+unsigned int gpio_read(GPIO_PinTypeDef pin);
+void gpio_setup_up_down_resistor(GPIO_PinTypeDef pin, int up_down);
+void gpio_set_interrupt(GPIO_PinTypeDef pin, GPIO_PolTypeDef falling);
+void gpio_set_interrupt_pol(GPIO_PinTypeDef pin, GPIO_PolTypeDef falling);
+
+void pwm_set_clk(int system_clock_hz, int pwm_clk);
+void pwm_set_mode(pwm_id id, pwm_mode mode);
+void pwm_set_cycle(pwm_id id, unsigned short cycle_tick);
+void pwm_set_cmp(pwm_id id, unsigned short cmp_tick);
+void pwm_set_cycle_and_duty(pwm_id id, unsigned short cycle_tick, unsigned short cmp_tick);
+void pwm_start(pwm_id id);
+void pwm_stop(pwm_id id);
+void pwm_set_interrupt_enable(PWM_IRQ irq);
+void pwm_set_interrupt_disable(PWM_IRQ irq);
+int pwm_get_interrupt_status(PWM_IRQ irq);
+void pwm_clear_interrupt_status(PWM_IRQ irq);
+
+void timer0_set_mode(TIMER_ModeTypeDef mode, unsigned int init_tick, unsigned int cap_tick);
+void timer1_set_mode(TIMER_ModeTypeDef mode, unsigned int init_tick, unsigned int cap_tick);
+void timer_start(TIMER_TypeDef type);
+void timer_stop(TIMER_TypeDef type);
+int timer_get_interrupt_status(TIMER_StatusTypeDef status);
+void timer_clear_interrupt_status(TIMER_StatusTypeDef status);
+
+unsigned char irq_enable(void);
+unsigned char irq_disable(void);
+void irq_restore(unsigned char en);
+void irq_enable_type(unsigned int mask);
+void irq_disable_type(unsigned int mask);
+
+unsigned int clock_time(void);
+unsigned int clock_time_exceed(unsigned int ref, unsigned int us);
+void sleep_us(unsigned long us);
+#define sleep_ms(ms)		sleep_us((ms) * 1000)
+
+int pm_is_MCU_deepRetentionWakeup(void);
+
+void flash_read_page(unsigned long addr, unsigned long len, unsigned char * buf);
+void flash_write_page(unsigned long addr, unsigned long len, unsigned char * buf);
+void flash_erase_sector(unsigned long addr);
+
+#endif /* TOOLS_SIM_DRIVER_H_ */
@@ -0,0 +1,16 @@
+/*
+ * sys_clock.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host stand-in for the sys_clock.h of the Telink SDK, see driver.h.  CLOCK_SYS_CLOCK_HZ comes from app_config.h
+ */
+
+#ifndef TOOLS_SIM_SYS_CLOCK_H_
+#define TOOLS_SIM_SYS_CLOCK_H_
+
+#define CLOCK_SYS_CLOCK_1S		(CLOCK_SYS_CLOCK_HZ)
+#define CLOCK_SYS_CLOCK_1MS		(CLOCK_SYS_CLOCK_1S / 1000)
+#define CLOCK_SYS_CLOCK_1US		(CLOCK_SYS_CLOCK_1S / 1000000)
+
+#endif /* TOOLS_SIM_SYS_CLOCK_H_ */
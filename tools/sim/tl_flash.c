@@ -0,0 +1,122 @@
+/*
+ * tl_flash.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * RAM flash with power cut injection, see tl_flash.h
+ */
+#include <string.h>
+#include "driver.h"
+#include "tl_flash.h"
+
+unsigned char tl_flash[TL_FLASH_SIZE];
+tl_flash_stats_t tl_flash_stats;
+
+static long tl_flash_ops_left = -1;		// ops until the power is cut, negative for never
+static int tl_flash_power = 1;
+static unsigned int tl_flash_seed = 1;
+
+// the bits a torn op leaves programmed or erased are picked at random, repeatably for the same cut
+static unsigned int tl_flash_random(void)
+{
+	tl_flash_seed = tl_flash_seed * 1103515245u + 12345u;
+	return tl_flash_seed >> 16;
+}
+
+// 0 when the power is off, or is cut by this op, which is then left to the caller to tear
+static int tl_flash_take_op(void)
+{
+	if (!tl_flash_power)
+		return 0;
+
+	tl_flash_stats.ops++;
+	if (tl_flash_ops_left >= 0 && tl_flash_ops_left-- == 0)
+	{
+		tl_flash_power = 0;
+		return 0;
+	}
+	return 1;
+}
+
+void tl_flash_reset(void)
+{
+	memset(tl_flash, 0xFF, sizeof(tl_flash));
+	memset(&tl_flash_stats, 0, sizeof(tl_flash_stats));
+	tl_flash_ops_left = -1;
+	tl_flash_power = 1;
+}
+
+void tl_flash_cut_after(long ops)
+{
+	tl_flash_ops_left = ops;
+	tl_flash_seed = (unsigned int)ops + 1;
+}
+
+void tl_flash_power_on(void)
+{
+	tl_flash_ops_left = -1;
+	tl_flash_power = 1;
+}
+
+int tl_flash_powered(void)
+{
+	return tl_flash_power;
+}
+
+void tl_flash_erase_spread(unsigned long addr, int num_sectors, unsigned int * min, unsigned int * max)
+{
+	int first = (int)(addr / TL_FLASH_SECTOR_SIZE);
+
+	*min = *max = tl_flash_stats.sector_erases[first];
+	for (int i = first + 1; i < first + num_sectors; i++)
+	{
+		if (tl_flash_stats.sector_erases[i] < *min)
+			*min = tl_flash_stats.sector_erases[i];
+		if (tl_flash_stats.sector_erases[i] > *max)
+			*max = tl_flash_stats.sector_erases[i];
+	}
+}
+
+void flash_read_page(unsigned long addr, unsigned long len, unsigned char * buf)
+{
+	if (addr >= TL_FLASH_SIZE || len > TL_FLASH_SIZE - addr)
+		return;
+	memcpy(buf, &tl_flash[addr], len);
+}
+
+void flash_write_page(unsigned long addr, unsigned long len, unsigned char * buf)
+{
+	if (addr >= TL_FLASH_SIZE || len > TL_FLASH_SIZE - addr)
+		return;
+
+	for (unsigned long i = 0; i < len; i++)
+	{
+		if (!tl_flash_power)
+			return;
+		if (!tl_flash_take_op())
+		{
+			// some of the bits the byte was clearing made it
+			tl_flash[addr + i] &= (unsigned char)(buf[i] | tl_flash_random());
+			return;
+		}
+		tl_flash[addr + i] &= buf[i];
+		tl_flash_stats.bytes_written++;
+	}
+}
+
+void flash_erase_sector(unsigned long addr)
+{
+	addr &= ~(unsigned long)(TL_FLASH_SECTOR_SIZE - 1);
+	if (addr >= TL_FLASH_SIZE || !tl_flash_power)
+		return;
+
+	if (!tl_flash_take_op())
+	{
+		// the erase got part of the way through the sector
+		memset(&tl_flash[addr], 0xFF, tl_flash_random() % TL_FLASH_SECTOR_SIZE);
+		return;
+	}
+	memset(&tl_flash[addr], 0xFF, TL_FLASH_SECTOR_SIZE);
+	tl_flash_stats.sectors_erased++;
+	tl_flash_stats.sector_erases[addr / TL_FLASH_SECTOR_SIZE]++;
+}
@@ -0,0 +1,44 @@
+/*
+ * tl_flash.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * RAM flash behind the flash calls of driver.h.  It is NOR flash: a write can only clear bits and an erase sets a
+ * whole sector back to 0xFF.  Every programmed byte and every erase is an op, and the power can be cut after any
+ * number of ops.  The op the power is cut in is left torn, a write with its last byte partly programmed and an
+ * erase with only part of the sector erased, and nothing reaches the flash after it until the power comes back.
+ */
+
+#ifndef TOOLS_SIM_TL_FLASH_H_
+#define TOOLS_SIM_TL_FLASH_H_
+
+#define TL_FLASH_SIZE			0x80000		// TLSR8258F512
+#define TL_FLASH_SECTOR_SIZE	4096
+#define TL_FLASH_NUM_SECTORS	(TL_FLASH_SIZE / TL_FLASH_SECTOR_SIZE)
+
+typedef struct tl_flash_stats_t {
+	unsigned long ops;						// bytes programmed and sectors erased since tl_flash_reset
+	unsigned long bytes_written;
+	unsigned long sectors_erased;
+	unsigned int sector_erases[TL_FLASH_NUM_SECTORS];
+}tl_flash_stats_t;
+
+extern unsigned char tl_flash[TL_FLASH_SIZE];
+extern tl_flash_stats_t tl_flash_stats;
+
+// erases the whole flash, clears the stats and turns the power on with no cut set
+void tl_flash_reset(void);
+
+// cuts the power once ops more ops have been done, a negative ops never cuts it
+void tl_flash_cut_after(long ops);
+
+// turns the power back on after a cut, the flash keeps whatever the cut left in it
+void tl_flash_power_on(void);
+
+// 0 once the power has been cut
+int tl_flash_powered(void);
+
+// lowest and highest erase count of the sectors from addr, to check the wear is spread over them
+void tl_flash_erase_spread(unsigned long addr, int num_sectors, unsigned int * min, unsigned int * max);
+
+#endif /* TOOLS_SIM_TL_FLASH_H_ */
@@ -0,0 +1,801 @@
+/*
+ * tl_sim.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Virtual B85 behind driver.h, see tl_sim.h
+ */
+#include <setjmp.h>
+#include <string.h>
+#include "tl_sim.h"
+
+#ifndef NULL
+#define NULL   ((void *) 0)
+#endif
+
+#define TL_SIM_NUM_GPIO_PORTS	5
+#define TL_SIM_MAX_INPUTS		64
+#define TL_SIM_TICKS_PER_CYCLE	(TL_SIM_HZ / TL_SIM_SYS_CLOCK_HZ)
+#define TL_SIM_TICKS_PER_TIMER	(TL_SIM_HZ / CLOCK_16M_SYS_TIMER_CLK_1S)	// clock_time() runs at 16MHz
+#define TL_SIM_NEVER			(~(tl_sim_time_t)0)
+
+typedef struct tl_sim_port_t {
+	unsigned char regs[TL_SIM_NUM_GPIO_REGS];
+	unsigned char gpio;				// pins working as GPIO rather than for a peripheral
+	unsigned char irq;				// pins with their GPIO interrupt enabled
+	unsigned char falling;			// of those, the ones interrupting on the falling edge
+	unsigned char pullup;
+	unsigned char ext_driven;		// pins driven from outside by tl_sim_drive_input
+	unsigned char ext_level;
+	unsigned char stuck;			// output data bits stuck by tl_sim_set_stuck_output
+	unsigned char stuck_level;
+}tl_sim_port_t;
+
+typedef struct tl_sim_pwm_t {
+	int running;
+	unsigned short cycles;			// registers, latched at the start of the next frame
+	unsigned short cmp;
+	unsigned short frame_cycles;	// the frame running now
+	unsigned short frame_cmp;
+	tl_sim_time_t frame_start;
+}tl_sim_pwm_t;
+
+typedef struct tl_sim_input_t {
+	tl_sim_time_t at;
+	unsigned int pin;
+	int level;
+}tl_sim_input_t;
+
+tl_sim_time_t tl_sim_now;
+tl_sim_stats_t tl_sim_stats;
+
+static tl_sim_port_t tl_sim_ports[TL_SIM_NUM_GPIO_PORTS];
+static tl_sim_pwm_t tl_sim_pwm[TL_SIM_NUM_PWM];
+static unsigned int tl_sim_pwm_div;				// system clocks per PWM clock
+static unsigned int tl_sim_pwm_irq_mask;
+static unsigned int tl_sim_pwm_irq_sta;
+static tl_sim_time_t tl_sim_pwm_due;			// no running frame ends before this, 0 to look again
+
+static int tl_sim_timer0_running;
+static unsigned int tl_sim_timer0_cap;
+static tl_sim_time_t tl_sim_timer0_next;
+static int tl_sim_timer1_running;
+static tl_sim_time_t tl_sim_timer1_start;
+static unsigned int tl_sim_timer1_stopped;
+static unsigned int tl_sim_tmr_sta;
+
+static unsigned int tl_sim_irq_mask;
+static unsigned int tl_sim_irq_src;
+static int tl_sim_irq_on;
+static int tl_sim_in_irq;
+static int tl_sim_gpio_edge_in_irq;		// a GPIO edge latched while the handler ran
+static int tl_sim_retention_wake;
+
+static void (*tl_sim_irq_handler)(void);
+static tl_sim_time_t tl_sim_poll = TL_SIM_TICKS_PER_MS;
+static void (*tl_sim_check)(void);
+static tl_sim_time_t tl_sim_check_period;
+static tl_sim_time_t tl_sim_next_check;
+static void (*tl_sim_trace)(const char * what);
+
+static tl_sim_input_t tl_sim_inputs[TL_SIM_MAX_INPUTS];
+static int tl_sim_num_inputs;
+
+static int tl_sim_running;
+static int tl_sim_stopping;
+static tl_sim_time_t tl_sim_end;
+static jmp_buf tl_sim_exit;
+
+static void tl_sim_charge(const char * what, unsigned int regs, unsigned int cycles)
+{
+	tl_sim_stats.reg_accesses += regs;
+	tl_sim_stats.cycles += cycles;
+	tl_sim_now += (tl_sim_time_t)cycles * TL_SIM_TICKS_PER_CYCLE;
+	if (tl_sim_trace != NULL)
+		tl_sim_trace(what);
+}
+
+static void tl_sim_call(const char * what, unsigned int regs)
+{
+	tl_sim_stats.driver_calls++;
+	tl_sim_charge(what, regs, TL_SIM_CYCLES_CALL + regs * TL_SIM_CYCLES_REG);
+}
+
+static tl_sim_port_t * tl_sim_port(unsigned int pin)
+{
+	return &tl_sim_ports[(pin >> 8) % TL_SIM_NUM_GPIO_PORTS];
+}
+
+// a write through reg_gpio_out lands after its address is taken, so a stuck bit is put back on every access
+static void tl_sim_hold_stuck(tl_sim_port_t * port)
+{
+	port->regs[TL_SIM_REG_GPIO_OUT] = (unsigned char)((port->regs[TL_SIM_REG_GPIO_OUT] & ~port->stuck) | port->stuck_level);
+}
+
+static int tl_sim_pad_level(tl_sim_port_t * port, unsigned char bit)
+{
+	tl_sim_hold_stuck(port);
+	if ((port->gpio & bit) && !(port->regs[TL_SIM_REG_GPIO_OEN] & bit))
+		return (port->regs[TL_SIM_REG_GPIO_OUT] & bit) != 0;
+	if (port->ext_driven & bit)
+		return (port->ext_level & bit) != 0;
+	return (port->pullup & bit) != 0;
+}
+
+static void tl_sim_apply_input(tl_sim_input_t * input)
+{
+	tl_sim_port_t * port = tl_sim_port(input->pin);
+	unsigned char bit = (unsigned char)(input->pin & 0xFF);
+	int was = tl_sim_pad_level(port, bit);
+	int now;
+
+	port->ext_driven |= bit;
+	if (input->level)
+		port->ext_level |= bit;
+	else
+		port->ext_level &= (unsigned char)~bit;
+	now = tl_sim_pad_level(port, bit);
+
+	if ((port->irq & bit) && was != now && ((port->falling & bit) ? !now : now))
+	{
+		tl_sim_irq_src |= FLD_IRQ_GPIO_EN;
+		tl_sim_gpio_edge_in_irq |= tl_sim_in_irq;
+	}
+}
+
+static tl_sim_time_t tl_sim_pwm_frame_ticks(unsigned short cycles)
+{
+	return (tl_sim_time_t)cycles * tl_sim_pwm_div * TL_SIM_TICKS_PER_CYCLE;
+}
+
+static void tl_sim_count_pwm_frames(int id, unsigned long long frames)
+{
+	tl_sim_pwm_t * pwm = &tl_sim_pwm[id];
+	unsigned int high = (pwm->frame_cmp < pwm->frame_cycles) ? pwm->frame_cmp : pwm->frame_cycles;
+
+	tl_sim_stats.pwm_frames[id] += frames;
+	tl_sim_stats.pwm_ticks[id] += frames * pwm->frame_cycles;
+	tl_sim_stats.pwm_high_ticks[id] += frames * high;
+}
+
+static void tl_sim_catch_up_pwm(int id)
+{
+	tl_sim_pwm_t * pwm = &tl_sim_pwm[id];
+	tl_sim_time_t frame;
+	unsigned long long frames;
+
+	if (!pwm->running || pwm->frame_cycles == 0)
+		return;
+	frame = tl_sim_pwm_frame_ticks(pwm->frame_cycles);
+	if (tl_sim_now < pwm->frame_start + frame)
+		return;
+
+	// the frame that was running ends, and the registers written during it take over
+	tl_sim_count_pwm_frames(id, 1);
+	pwm->frame_start += frame;
+	pwm->frame_cycles = pwm->cycles;
+	pwm->frame_cmp = pwm->cmp;
+	tl_sim_pwm_irq_sta |= (unsigned int)PWM_IRQ_PWM0_FRAME << id;
+	if (pwm->frame_cycles == 0)
+		return;
+
+	// nothing changes from one frame to the next after that, so the rest are counted in one go
+	frame = tl_sim_pwm_frame_ticks(pwm->frame_cycles);
+	frames = (tl_sim_now - pwm->frame_start) / frame;
+	tl_sim_count_pwm_frames(id, frames);
+	pwm->frame_start += frames * frame;
+}
+
+// catches up every channel, and notes when the next running frame ends
+static void tl_sim_catch_up_pwms(void)
+{
+	tl_sim_pwm_due = TL_SIM_NEVER;
+	for (int id = 0; id < TL_SIM_NUM_PWM; id++)
+	{
+		tl_sim_pwm_t * pwm = &tl_sim_pwm[id];
+		tl_sim_time_t frame_end;
+
+		tl_sim_catch_up_pwm(id);
+		if (!pwm->running || pwm->frame_cycles == 0)
+			continue;
+		frame_end = pwm->frame_start + tl_sim_pwm_frame_ticks(pwm->frame_cycles);
+		if (frame_end < tl_sim_pwm_due)
+			tl_sim_pwm_due = frame_end;
+	}
+}
+
+static void tl_sim_catch_up(void)
+{
+	// inputs are applied in time order, and are the only thing that can come before the rest
+	while (tl_sim_num_inputs > 0 && tl_sim_inputs[0].at <= tl_sim_now)
+	{
+		tl_sim_apply_input(&tl_sim_inputs[0]);
+		memmove(&tl_sim_inputs[0], &tl_sim_inputs[1], (size_t)(--tl_sim_num_inputs) * sizeof(tl_sim_inputs[0]));
+	}
+
+	if (tl_sim_timer0_running && tl_sim_timer0_cap != 0 && tl_sim_now >= tl_sim_timer0_next)
+	{
+		tl_sim_time_t period = (tl_sim_time_t)tl_sim_timer0_cap * TL_SIM_TICKS_PER_CYCLE;
+		unsigned long long expiries = (tl_sim_now - tl_sim_timer0_next) / period + 1;
+
+		tl_sim_stats.timer0_expiries += (unsigned long)expiries;
+		tl_sim_timer0_next += expiries * period;
+		tl_sim_tmr_sta |= TMR_STA_TMR0;
+	}
+
+	// an interrupt reads the registers several times, and nothing has ended on most of those reads.  A channel caught
+	// up on its own, by a register write, only ends its frame later, so an early tl_sim_pwm_due costs one more walk
+	if (tl_sim_now >= tl_sim_pwm_due)
+		tl_sim_catch_up_pwms();
+}
+
+static int tl_sim_irq_pending(void)
+{
+	return ((tl_sim_tmr_sta & TMR_STA_TMR0) && (tl_sim_irq_mask & FLD_IRQ_TMR0_EN))
+			|| ((tl_sim_pwm_irq_sta & tl_sim_pwm_irq_mask) && (tl_sim_irq_mask & FLD_IRQ_SW_PWM_EN))
+			|| ((tl_sim_irq_src & FLD_IRQ_GPIO_EN) && (tl_sim_irq_mask & FLD_IRQ_GPIO_EN));
+}
+
+// the time of the next thing that can raise an interrupt, a masked source is left to latch when it is read
+static tl_sim_time_t tl_sim_next_event(void)
+{
+	tl_sim_time_t next = TL_SIM_NEVER;
+
+	if (tl_sim_num_inputs > 0)
+		next = tl_sim_inputs[0].at;
+	if (tl_sim_timer0_running && tl_sim_timer0_cap != 0 && (tl_sim_irq_mask & FLD_IRQ_TMR0_EN) && tl_sim_timer0_next < next)
+		next = tl_sim_timer0_next;
+
+	for (int id = 0; id < TL_SIM_NUM_PWM; id++)
+	{
+		tl_sim_pwm_t * pwm = &tl_sim_pwm[id];
+		tl_sim_time_t frame_end;
+
+		if (!pwm->running || pwm->frame_cycles == 0 || !(tl_sim_pwm_irq_mask & ((unsigned int)PWM_IRQ_PWM0_FRAME << id)))
+			continue;
+		frame_end = pwm->frame_start + tl_sim_pwm_frame_ticks(pwm->frame_cycles);
+		if (frame_end < next)
+			next = frame_end;
+	}
+
+	return next;
+}
+
+// runs the handler for as long as an interrupt is pending, the CPU masks interrupts while it is in it
+static void tl_sim_deliver_irqs(void)
+{
+	int runs = 0;
+
+	if (!tl_sim_irq_on || tl_sim_in_irq || tl_sim_irq_handler == NULL)
+		return;
+
+	tl_sim_catch_up();
+	while (tl_sim_irq_pending())
+	{
+		if (runs++ == TL_SIM_MAX_IRQ_RUNS)
+		{
+			tl_sim_stats.irq_storms++;
+			return;
+		}
+
+		tl_sim_charge("irq", 0, TL_SIM_CYCLES_IRQ);
+		// reg_irq_src is write 1 to clear, which a plain variable cannot be, so the edge the handler was entered
+		// for is cleared once it returns.  An edge that came in while it ran, caught up by a register read, stays
+		// pending for the next run
+		tl_sim_gpio_edge_in_irq = 0;
+		tl_sim_in_irq = 1;
+		tl_sim_irq_on = 0;
+		tl_sim_irq_handler();
+		tl_sim_irq_on = 1;
+		tl_sim_in_irq = 0;
+		if (!tl_sim_gpio_edge_in_irq)
+			tl_sim_irq_src &= ~(unsigned int)FLD_IRQ_GPIO_EN;
+		tl_sim_stats.irqs++;
+		tl_sim_catch_up();
+	}
+}
+
+static void tl_sim_step(tl_sim_time_t target)
+{
+	tl_sim_time_t next;
+
+	tl_sim_deliver_irqs();
+	while ((next = tl_sim_next_event()) <= target)
+	{
+		if (next > tl_sim_now)
+			tl_sim_now = next;
+		tl_sim_catch_up();
+		tl_sim_deliver_irqs();
+	}
+
+	if (target > tl_sim_now)
+		tl_sim_now = target;
+	tl_sim_catch_up();
+	tl_sim_deliver_irqs();
+}
+
+void tl_sim_reset(void)
+{
+	memset(tl_sim_ports, 0, sizeof(tl_sim_ports));
+	for (int i = 0; i < TL_SIM_NUM_GPIO_PORTS; i++)
+	{
+		tl_sim_ports[i].gpio = 0xFF;
+		tl_sim_ports[i].regs[TL_SIM_REG_GPIO_IE] = 0xFF;
+		tl_sim_ports[i].regs[TL_SIM_REG_GPIO_OEN] = 0xFF;
+	}
+	memset(tl_sim_pwm, 0, sizeof(tl_sim_pwm));
+	tl_sim_pwm_div = 1;
+	tl_sim_pwm_due = 0;
+	tl_sim_pwm_irq_mask = 0;
+	tl_sim_pwm_irq_sta = 0;
+
+	tl_sim_timer0_running = 0;
+	tl_sim_timer0_cap = 0;
+	tl_sim_timer1_running = 0;
+	tl_sim_timer1_stopped = 0;
+	tl_sim_tmr_sta = 0;
+
+	tl_sim_irq_mask = 0;
+	tl_sim_irq_src = 0;
+	tl_sim_irq_on = 0;
+	tl_sim_in_irq = 0;
+	tl_sim_num_inputs = 0;
+
+	tl_sim_now = 0;
+	tl_sim_next_check = tl_sim_check_period;
+	memset(&tl_sim_stats, 0, sizeof(tl_sim_stats));
+}
+
+void tl_sim_set_irq_handler(void (*handler)(void))
+{
+	tl_sim_irq_handler = handler;
+}
+
+void tl_sim_set_poll(tl_sim_time_t ticks)
+{
+	tl_sim_poll = ticks;
+}
+
+void tl_sim_set_check(void (*check)(void), tl_sim_time_t period)
+{
+	tl_sim_check = check;
+	tl_sim_check_period = period;
+	tl_sim_next_check = tl_sim_now + period;
+}
+
+void tl_sim_set_trace(void (*trace)(const char * what))
+{
+	tl_sim_trace = trace;
+}
+
+void tl_sim_set_retention_wake(int wake)
+{
+	tl_sim_retention_wake = wake;
+}
+
+int tl_sim_drive_input(tl_sim_time_t at, GPIO_PinTypeDef pin, int level)
+{
+	int i;
+
+	if (tl_sim_num_inputs == TL_SIM_MAX_INPUTS)
+		return 0;
+
+	for (i = tl_sim_num_inputs; i > 0 && tl_sim_inputs[i - 1].at > at; i--)
+		tl_sim_inputs[i] = tl_sim_inputs[i - 1];
+	tl_sim_inputs[i].at = at;
+	tl_sim_inputs[i].pin = pin;
+	tl_sim_inputs[i].level = level;
+	tl_sim_num_inputs++;
+
+	return 1;
+}
+
+int tl_sim_output_level(GPIO_PinTypeDef pin)
+{
+	tl_sim_port_t * port = tl_sim_port(pin);
+	unsigned char bit = (unsigned char)(pin & 0xFF);
+	tl_sim_hold_stuck(port);
+
+	if (!(port->gpio & bit) || (port->regs[TL_SIM_REG_GPIO_OEN] & bit))
+		return -1;
+	return (port->regs[TL_SIM_REG_GPIO_OUT] & bit) != 0;
+}
+
+void tl_sim_set_stuck_output(GPIO_PinTypeDef pin, int level)
+{
+	tl_sim_port_t * port = tl_sim_port(pin);
+	unsigned char bit = (unsigned char)(pin & 0xFF);
+
+	port->stuck = (unsigned char)((level < 0) ? (port->stuck & ~bit) : (port->stuck | bit));
+	port->stuck_level = (unsigned char)((level > 0) ? (port->stuck_level | bit) : (port->stuck_level & ~bit));
+	tl_sim_hold_stuck(port);
+}
+
+void tl_sim_advance(tl_sim_time_t ticks)
+{
+	tl_sim_step(tl_sim_now + ticks);
+}
+
+tl_sim_time_t tl_sim_run(void (*user_init)(void), void (*main_loop)(void), tl_sim_time_t duration)
+{
+	tl_sim_time_t start = tl_sim_now;
+
+	tl_sim_end = start + duration;
+	tl_sim_stopping = 0;
+	tl_sim_running = 1;
+	if (setjmp(tl_sim_exit) == 0)
+	{
+		user_init();
+		while (1)
+			main_loop();
+	}
+	tl_sim_running = 0;
+
+	return tl_sim_now - start;
+}
+
+void tl_sim_stop(void)
+{
+	tl_sim_stopping = 1;
+}
+
+unsigned char * tl_sim_gpio_reg_addr(unsigned int pin, tl_sim_gpio_reg reg)
+{
+	tl_sim_port_t * port = tl_sim_port(pin);
+
+	tl_sim_charge("reg_gpio", 1, TL_SIM_CYCLES_REG);
+	tl_sim_hold_stuck(port);
+	if (reg == TL_SIM_REG_GPIO_IN)
+	{
+		unsigned char in = 0;
+		for (int b = 0; b < 8; b++)
+		{
+			if ((port->regs[TL_SIM_REG_GPIO_IE] & (1 << b)) && tl_sim_pad_level(port, (unsigned char)(1 << b)))
+				in |= (unsigned char)(1 << b);
+		}
+		port->regs[TL_SIM_REG_GPIO_IN] = in;
+	}
+	return &port->regs[reg];
+}
+
+unsigned int * tl_sim_irq_src_addr(void)
+{
+	tl_sim_charge("reg_irq_src", 1, TL_SIM_CYCLES_REG);
+	return &tl_sim_irq_src;
+}
+
+unsigned int * tl_sim_irq_mask_addr(void)
+{
+	tl_sim_charge("reg_irq_mask", 1, TL_SIM_CYCLES_REG);
+	return &tl_sim_irq_mask;
+}
+
+unsigned int tl_sim_read_tmr1_tick(void)
+{
+	tl_sim_charge("reg_tmr1_tick", 1, TL_SIM_CYCLES_REG);
+
+	// a poll from the main loop, the only place the clock jumps
+	if (!tl_sim_in_irq)
+	{
+		tl_sim_time_t target = tl_sim_now + tl_sim_poll;
+
+		tl_sim_stats.polls++;
+		if (tl_sim_running && (tl_sim_stopping || tl_sim_now >= tl_sim_end))
+			longjmp(tl_sim_exit, 1);
+		if (tl_sim_running && target > tl_sim_end)
+			target = tl_sim_end;
+		tl_sim_step(target);
+
+		if (tl_sim_check != NULL && tl_sim_now >= tl_sim_next_check)
+		{
+			tl_sim_next_check = tl_sim_now + tl_sim_check_period;
+			tl_sim_check();
+		}
+	}
+
+	if (!tl_sim_timer1_running)
+		return tl_sim_timer1_stopped;
+	return (unsigned int)((tl_sim_now - tl_sim_timer1_start) / TL_SIM_TICKS_PER_CYCLE);
+}
+
+void gpio_set_func(GPIO_PinTypeDef pin, GPIO_FuncTypeDef func)
+{
+	tl_sim_port_t * port = tl_sim_port(pin);
+
+	tl_sim_call("gpio_set_func", 2);
+	if (func == AS_GPIO)
+		port->gpio |= (unsigned char)(pin & 0xFF);
+	else
+		port->gpio &= (unsigned char)~(pin & 0xFF);
+}
+
+void gpio_set_output_en(GPIO_PinTypeDef pin, unsigned int value)
+{
+	tl_sim_port_t * port = tl_sim_port(pin);
+
+	tl_sim_call("gpio_set_output_en", 2);
+	if (value)
+		port->regs[TL_SIM_REG_GPIO_OEN] &= (unsigned char)~(pin & 0xFF);
+	else
+		port->regs[TL_SIM_REG_GPIO_OEN] |= (unsigned char)(pin & 0xFF);
+}
+
+void gpio_set_input_en(GPIO_PinTypeDef pin, unsigned int value)
+{
+	tl_sim_port_t * port = tl_sim_port(pin);
+
+	tl_sim_call("gpio_set_input_en", 2);
+	if (value)
+		port->regs[TL_SIM_REG_GPIO_IE] |= (unsigned char)(pin & 0xFF);
+	else
+		port->regs[TL_SIM_REG_GPIO_IE] &= (unsigned char)~(pin & 0xFF);
+}
+
+void gpio_write(GPIO_PinTypeDef pin, unsigned int value)
+{
+	tl_sim_port_t * port = tl_sim_port(pin);
+
+	tl_sim_call("gpio_write", 2);
+	if (value)
+		port->regs[TL_SIM_REG_GPIO_OUT] |= (unsigned char)(pin & 0xFF);
+	else
+		port->regs[TL_SIM_REG_GPIO_OUT] &= (unsigned char)~(pin & 0xFF);
+	tl_sim_hold_stuck(port);
+}
+
+unsigned int gpio_read(GPIO_PinTypeDef pin)
+{
+	tl_sim_port_t * port = tl_sim_port(pin);
+	unsigned char bit = (unsigned char)(pin & 0xFF);
+
+	tl_sim_call("gpio_read", 1);
+	// the input register, so a pin with its input buffer off reads 0 whatever it is driven to
+	if (!(port->regs[TL_SIM_REG_GPIO_IE] & bit))
+		return 0;
+	return tl_sim_pad_level(port, bit) ? bit : 0;
+}
+
+void gpio_setup_up_down_resistor(GPIO_PinTypeDef pin, int up_down)
+{
+	tl_sim_port_t * port = tl_sim_port(pin);
+
+	tl_sim_call("gpio_setup_up_down_resistor", 2);
+	if (up_down == PM_PIN_PULLUP_1M || up_down == PM_PIN_PULLUP_10K)
+		port->pullup |= (unsigned char)(pin & 0xFF);
+	else
+		port->pullup &= (unsigned char)~(pin & 0xFF);
+}
+
+void gpio_set_interrupt(GPIO_PinTypeDef pin, GPIO_PolTypeDef falling)
+{
+	tl_sim_port_t * port = tl_sim_port(pin);
+
+	tl_sim_call("gpio_set_interrupt", 4);
+	port->irq |= (unsigned char)(pin & 0xFF);
+	if (falling)
+		port->falling |= (unsigned char)(pin & 0xFF);
+	else
+		port->falling &= (unsigned char)~(pin & 0xFF);
+}
+
+void gpio_set_interrupt_pol(GPIO_PinTypeDef pin, GPIO_PolTypeDef falling)
+{
+	tl_sim_port_t * port = tl_sim_port(pin);
+
+	tl_sim_call("gpio_set_interrupt_pol", 2);
+	if (falling)
+		port->falling |= (unsigned char)(pin & 0xFF);
+	else
+		port->falling &= (unsigned char)~(pin & 0xFF);
+}
+
+void pwm_set_clk(int system_clock_hz, int pwm_clk)
+{
+	tl_sim_call("pwm_set_clk", 1);
+	for (int id = 0; id < TL_SIM_NUM_PWM; id++)
+		tl_sim_catch_up_pwm(id);
+	tl_sim_pwm_div = (pwm_clk > 0 && system_clock_hz >= pwm_clk) ? (unsigned int)(system_clock_hz / pwm_clk) : 1;
+	tl_sim_pwm_due = 0;
+}
+
+void pwm_set_mode(pwm_id id, pwm_mode mode)
+{
+	tl_sim_call("pwm_set_mode", 2);
+}
+
+void pwm_set_cycle(pwm_id id, unsigned short cycle_tick)
+{
+	tl_sim_call("pwm_set_cycle", 1);
+	tl_sim_catch_up_pwm(id);
+	tl_sim_pwm[id].cycles = cycle_tick;
+}
+
+void pwm_set_cmp(pwm_id id, unsigned short cmp_tick)
+{
+	tl_sim_call("pwm_set_cmp", 1);
+	tl_sim_catch_up_pwm(id);
+	tl_sim_pwm[id].cmp = cmp_tick;
+}
+
+void pwm_set_cycle_and_duty(pwm_id id, unsigned short cycle_tick, unsigned short cmp_tick)
+{
+	tl_sim_call("pwm_set_cycle_and_duty", 1);
+	tl_sim_catch_up_pwm(id);
+	tl_sim_pwm[id].cycles = cycle_tick;
+	tl_sim_pwm[id].cmp = cmp_tick;
+}
+
+void pwm_start(pwm_id id)
+{
+	tl_sim_pwm_t * pwm = &tl_sim_pwm[id];
+
+	tl_sim_call("pwm_start", 2);
+	if (pwm->running)
+		return;
+	pwm->running = 1;
+	pwm->frame_start = tl_sim_now;
+	pwm->frame_cycles = pwm->cycles;
+	pwm->frame_cmp = pwm->cmp;
+	tl_sim_pwm_due = 0;
+}
+
+void pwm_stop(pwm_id id)
+{
+	tl_sim_call("pwm_stop", 2);
+	tl_sim_catch_up_pwm(id);
+	tl_sim_pwm[id].running = 0;
+}
+
+void pwm_set_interrupt_enable(PWM_IRQ irq)
+{
+	// the PWM line of reg_irq_mask is unmasked along with the channel, as in the SDK examples
+	tl_sim_call("pwm_set_interrupt_enable", 4);
+	tl_sim_pwm_irq_mask |= irq;
+	tl_sim_irq_mask |= FLD_IRQ_SW_PWM_EN;
+	tl_sim_deliver_irqs();
+}
+
+void pwm_set_interrupt_disable(PWM_IRQ irq)
+{
+	tl_sim_call("pwm_set_interrupt_disable", 2);
+	tl_sim_pwm_irq_mask &= ~(unsigned int)irq;
+}
+
+int pwm_get_interrupt_status(PWM_IRQ irq)
+{
+	tl_sim_call("pwm_get_interrupt_status", 1);
+	tl_sim_catch_up();
+	return (int)(tl_sim_pwm_irq_sta & irq);
+}
+
+void pwm_clear_interrupt_status(PWM_IRQ irq)
+{
+	tl_sim_call("pwm_clear_interrupt_status", 1);
+	tl_sim_catch_up();
+	tl_sim_pwm_irq_sta &= ~(unsigned int)irq;
+}
+
+void timer0_set_mode(TIMER_ModeTypeDef mode, unsigned int init_tick, unsigned int cap_tick)
+{
+	// the SDK unmasks the Timer0 interrupt here
+	tl_sim_call("timer0_set_mode", 4);
+	tl_sim_timer0_cap = cap_tick;
+	tl_sim_irq_mask |= FLD_IRQ_TMR0_EN;
+}
+
+void timer1_set_mode(TIMER_ModeTypeDef mode, unsigned int init_tick, unsigned int cap_tick)
+{
+	tl_sim_call("timer1_set_mode", 4);
+	tl_sim_timer1_stopped = init_tick;
+}
+
+void timer_start(TIMER_TypeDef type)
+{
+	tl_sim_call("timer_start", 2);
+	if (type == TIMER0)
+	{
+		tl_sim_timer0_running = 1;
+		tl_sim_timer0_next = tl_sim_now + (tl_sim_time_t)tl_sim_timer0_cap * TL_SIM_TICKS_PER_CYCLE;
+	}
+	else if (type == TIMER1 && !tl_sim_timer1_running)
+	{
+		tl_sim_timer1_running = 1;
+		tl_sim_timer1_start = tl_sim_now - (tl_sim_time_t)tl_sim_timer1_stopped * TL_SIM_TICKS_PER_CYCLE;
+	}
+}
+
+void timer_stop(TIMER_TypeDef type)
+{
+	tl_sim_call("timer_stop", 2);
+	if (type == TIMER0)
+	{
+		tl_sim_catch_up();
+		tl_sim_timer0_running = 0;
+	}
+	else if (type == TIMER1 && tl_sim_timer1_running)
+	{
+		tl_sim_timer1_stopped = (unsigned int)((tl_sim_now - tl_sim_timer1_start) / TL_SIM_TICKS_PER_CYCLE);
+		tl_sim_timer1_running = 0;
+	}
+}
+
+int timer_get_interrupt_status(TIMER_StatusTypeDef status)
+{
+	tl_sim_call("timer_get_interrupt_status", 1);
+	tl_sim_catch_up();
+	return (int)(tl_sim_tmr_sta & status);
+}
+
+void timer_clear_interrupt_status(TIMER_StatusTypeDef status)
+{
+	tl_sim_call("timer_clear_interrupt_status", 1);
+	tl_sim_catch_up();
+	tl_sim_tmr_sta &= ~(unsigned int)status;
+}
+
+unsigned char irq_enable(void)
+{
+	unsigned char r = (unsigned char)tl_sim_irq_on;
+
+	tl_sim_call("irq_enable", 1);
+	tl_sim_irq_on = 1;
+	if (!r)
+		tl_sim_deliver_irqs();
+	return r;
+}
+
+unsigned char irq_disable(void)
+{
+	unsigned char r = (unsigned char)tl_sim_irq_on;
+
+	tl_sim_call("irq_disable", 1);
+	tl_sim_irq_on = 0;
+	return r;
+}
+
+void irq_restore(unsigned char en)
+{
+	tl_sim_call("irq_restore", 1);
+	tl_sim_irq_on = (en != 0);
+	if (en)
+		tl_sim_deliver_irqs();
+}
+
+void irq_enable_type(unsigned int mask)
+{
+	tl_sim_call("irq_enable_type", 2);
+	tl_sim_irq_mask |= mask;
+	tl_sim_deliver_irqs();
+}
+
+void irq_disable_type(unsigned int mask)
+{
+	tl_sim_call("irq_disable_type", 2);
+	tl_sim_irq_mask &= ~mask;
+}
+
+unsigned int clock_time(void)
+{
+	tl_sim_call("clock_time", 1);
+	return (unsigned int)(tl_sim_now / TL_SIM_TICKS_PER_TIMER);
+}
+
+unsigned int clock_time_exceed(unsigned int ref, unsigned int us)
+{
+	return (clock_time() - ref) > us * CLOCK_16M_SYS_TIMER_CLK_1US;
+}
+
+void sleep_us(unsigned long us)
+{
+	tl_sim_call("sleep_us", 1);
+	if (tl_sim_in_irq)
+		tl_sim_now += (tl_sim_time_t)us * (TL_SIM_HZ / 1000000);
+	else
+		tl_sim_step(tl_sim_now + (tl_sim_time_t)us * (TL_SIM_HZ / 1000000));
+}
+
+int pm_is_MCU_deepRetentionWakeup(void)
+{
+	tl_sim_call("pm_is_MCU_deepRetentionWakeup", 1);
+	return tl_sim_retention_wake;
+}
@@ -0,0 +1,90 @@
+/*
+ * tl_sim.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Virtual B85 behind the registers and driver calls of driver.h: the GPIO ports, the PWM channels, Timer0, Timer1,
+ * the system timer and the interrupt controller, run against a virtual clock.
+ *
+ * The peripherals are worked out from the clock whenever they are read, so nothing is stepped that nobody looks
+ * at.  The clock only moves when the firmware polls reg_tmr1_tick, as run_led_loop does, or a test calls
+ * tl_sim_advance.  Then it jumps straight to the next interrupt, runs the handler, and so on up to the end of the
+ * poll.  Every driver call and register access is also counted and charged to the clock at a rough cycle cost, so
+ * code that runs between polls, such as init or an interrupt handler, takes time as it would on the chip.
+ */
+
+#ifndef TOOLS_SIM_TL_SIM_H_
+#define TOOLS_SIM_TL_SIM_H_
+
+#include "driver.h"
+
+#define TL_SIM_HZ				48000000ULL		// virtual time base, a multiple of the 24MHz system clock and the 16MHz system timer
+#define TL_SIM_TICKS_PER_MS		(TL_SIM_HZ / 1000)
+#define TL_SIM_TICKS_PER_SEC	TL_SIM_HZ
+#define TL_SIM_SYS_CLOCK_HZ		24000000		// CPU, Timer0, Timer1 and the undivided PWM clock
+#define TL_SIM_NUM_PWM			6
+
+// rough TC32 costs at the system clock, for estimates rather than cycle counts
+#define TL_SIM_CYCLES_CALL		16		// call, return and argument setup of a driver function
+#define TL_SIM_CYCLES_REG		4		// one access to a peripheral register
+#define TL_SIM_CYCLES_IRQ		40		// interrupt entry and exit, including saving the registers
+
+#define TL_SIM_MAX_IRQ_RUNS		16		// handler runs in a row that still leave an interrupt pending before it is given up
+
+typedef unsigned long long tl_sim_time_t;
+
+typedef struct tl_sim_stats_t {
+	unsigned long driver_calls;
+	unsigned long reg_accesses;
+	unsigned long long cycles;				// estimated cycles of the driver calls, register accesses and interrupt entries
+	unsigned long polls;					// reads of reg_tmr1_tick from the main loop
+	unsigned long irqs;						// handler runs
+	unsigned long irq_storms;				// times an interrupt was still pending after TL_SIM_MAX_IRQ_RUNS handler runs
+	unsigned long timer0_expiries;
+	unsigned long long pwm_frames[TL_SIM_NUM_PWM];
+	unsigned long long pwm_high_ticks[TL_SIM_NUM_PWM];	// time the channel output was high, in PWM clocks
+	unsigned long long pwm_ticks[TL_SIM_NUM_PWM];		// time the channel ran, in PWM clocks
+}tl_sim_stats_t;
+
+extern tl_sim_time_t tl_sim_now;
+extern tl_sim_stats_t tl_sim_stats;
+
+// powers the chip up, every register back to its reset value, the clock at 0 and the stats cleared
+void tl_sim_reset(void);
+
+// the interrupt handler, irq_handler in the firmware
+void tl_sim_set_irq_handler(void (*handler)(void));
+
+// the most one poll of reg_tmr1_tick moves the clock on, the main loop does nothing in less than its period
+void tl_sim_set_poll(tl_sim_time_t ticks);
+
+// called from a poll at least period ticks apart, to check the state of the firmware between its steps
+void tl_sim_set_check(void (*check)(void), tl_sim_time_t period);
+
+// called with the name of every driver call and register access, for tools that want to see them
+void tl_sim_set_trace(void (*trace)(const char * what));
+
+// what pm_is_MCU_deepRetentionWakeup returns
+void tl_sim_set_retention_wake(int wake);
+
+// drives an input pin from outside at the time given, raising its GPIO interrupt if it is set for the edge.
+// Returns 0 if too many are queued
+int tl_sim_drive_input(tl_sim_time_t at, GPIO_PinTypeDef pin, int level);
+
+// level the pin is driven to as a GPIO output, -1 when it is not one
+int tl_sim_output_level(GPIO_PinTypeDef pin);
+
+// holds the output data bit of a pin at level whatever is written to it, as a latch fault or another writer of the
+// port would, so it reads back wrong.  -1 frees it
+void tl_sim_set_stuck_output(GPIO_PinTypeDef pin, int level);
+
+// moves the clock on, running every interrupt due on the way, for tests without a main loop
+void tl_sim_advance(tl_sim_time_t ticks);
+
+// runs user_init then main_loop over and over until the clock has moved on by duration, returns the ticks it ran
+tl_sim_time_t tl_sim_run(void (*user_init)(void), void (*main_loop)(void), tl_sim_time_t duration);
+
+// ends tl_sim_run at the next poll
+void tl_sim_stop(void);
+
+#endif /* TOOLS_SIM_TL_SIM_H_ */
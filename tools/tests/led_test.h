@@ -0,0 +1,239 @@
+/*
+ * led_test.h
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Checks and a fake HAL shared by the host tests in tools/tests.  Each test is one program that exits non zero when
+ * a check failed, built from the repository root against the SDK stand-in in tools/sim, see the top of each test
+ */
+
+#ifndef TOOLS_TESTS_LED_TEST_H_
+#define TOOLS_TESTS_LED_TEST_H_
+
+#include <stdio.h>
+#include <time.h>
+
+#define LED_TEST_MAX_REPORTS	20		// failures printed, sweeps can fail the same way many times over
+
+static int led_test_checks;
+static int led_test_failures;
+
+static inline int led_test_check(int ok, const char * file, int line, const char * expr)
+{
+	led_test_checks++;
+	if (ok)
+		return 1;
+
+	if (led_test_failures++ < LED_TEST_MAX_REPORTS)
+		printf("%s:%d: check failed: %s\n", file, line, expr);
+	return 0;
+}
+
+static inline int led_test_check_eq(long got, long want, const char * file, int line, const char * expr)
+{
+	led_test_checks++;
+	if (got == want)
+		return 1;
+
+	if (led_test_failures++ < LED_TEST_MAX_REPORTS)
+		printf("%s:%d: check failed: %s is %ld, expected %ld\n", file, line, expr, got, want);
+	return 0;
+}
+
+// both evaluate to 1 when the check passed, so a sweep can stop at its first failure
+#define LED_CHECK(cond)				led_test_check((cond) != 0, __FILE__, __LINE__, #cond)
+#define LED_CHECK_EQ(got, want)		led_test_check_eq((long)(got), (long)(want), __FILE__, __LINE__, #got)
+
+// prints the totals, the return value is the exit code of the test
+static inline int led_test_summary(const char * name)
+{
+	printf("%s: %d checks, %d failed\n", name, led_test_checks, led_test_failures);
+	return led_test_failures != 0;
+}
+
+// the same sequence on every run, so a failure comes back when the test is run again
+static inline unsigned int next_test_random(unsigned int * random)
+{
+	*random = *random * 1103515245u + 12345u;
+	return *random >> 16;
+}
+
+static inline double get_test_seconds(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+#ifdef LED_TEST_BOARD_LEDS
+// a fake HAL that keeps the pins and PWM registers of a board of LEDs in memory, for the tests that define
+// LED_TEST_BOARD_LEDS as the most LEDs a board of theirs has.  The HAL does not get the instance, so the board of an
+// LED is found from the led_t among those set up.  A test with more to its HAL wraps these hooks, or sets its own
+// after setup_led_test_board
+#include <string.h>
+#include "led_proc.h"
+
+#ifndef LED_TEST_MAX_BOARDS
+#define LED_TEST_MAX_BOARDS		8
+#endif
+
+typedef struct led_test_board_t {
+	struct led_proc_t proc;
+	led_t leds[LED_TEST_BOARD_LEDS];
+	led_pwm_state_t pwm_states[LED_TEST_BOARD_LEDS];	// a test may pack the side table at the front
+	int num_leds;
+	int pins[LED_TEST_BOARD_LEDS];						// 1 for a pin driven on
+	int duty[LED_TEST_BOARD_LEDS];						// as written, an inverted pin is lit for the rest
+	unsigned int compare[LED_TEST_BOARD_LEDS];
+	unsigned int cycles[LED_TEST_BOARD_LEDS];
+	unsigned int duty_writes[LED_TEST_BOARD_LEDS];
+	led_proc_error_type fail[LED_TEST_BOARD_LEDS];		// what the pin and duty cycle writes of an LED fail with, 0 for none
+	unsigned int pin_writes;
+	unsigned int hal_writes;							// pin and PWM register writes, failed ones too
+	int frame_irq;
+	int tick_irq;
+}led_test_board_t;
+
+static led_test_board_t * led_test_boards[LED_TEST_MAX_BOARDS];
+static int led_test_num_boards;
+// the tick interrupt hook gets no led_t, it records into the board a test points this at, such as the one whose
+// call is in progress
+static led_test_board_t * led_test_tick_board;
+
+static inline led_test_board_t * find_led_test_board(led_t * led)
+{
+	for (int i = 0; i < led_test_num_boards; i++)
+	{
+		if (led >= led_test_boards[i]->leds && led < led_test_boards[i]->leds + led_test_boards[i]->num_leds)
+			return led_test_boards[i];
+	}
+	return NULL;
+}
+
+static inline led_proc_error_type init_led_test_led(led_t * led)
+{
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static inline led_proc_error_type set_led_test_polarity(led_t * led, led_output_state_t state)
+{
+	led_test_board_t * board = find_led_test_board(led);
+	int led_num;
+
+	if (board == NULL)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	led_num = (int)(led - board->leds);
+	board->pin_writes++;
+	board->hal_writes++;
+	if (board->fail[led_num] != 0)
+		return board->fail[led_num];
+	board->pins[led_num] = (state == LED_ON);
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static inline led_proc_error_type set_led_test_duty_cycle(led_t * led, int pwm_dc)
+{
+	led_test_board_t * board = find_led_test_board(led);
+	int led_num;
+
+	if (board == NULL)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	led_num = (int)(led - board->leds);
+	board->duty_writes[led_num]++;
+	board->hal_writes++;
+	if (board->fail[led_num] != 0)
+		return board->fail[led_num];
+	board->duty[led_num] = pwm_dc;
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+// for a channel whose duty cycle register is its compare register, as on the TLS8258
+static inline led_proc_error_type set_led_test_duty_compare(led_t * led, int pwm_dc)
+{
+	led_test_board_t * board = find_led_test_board(led);
+
+	if (board != NULL && led->led_pwm_state != NULL)
+		board->compare[led - board->leds] = get_led_pwm_duty_cycles(&led->led_pwm_state->led_pwm_timing, pwm_dc);
+	return set_led_test_duty_cycle(led, pwm_dc);
+}
+
+static inline led_proc_error_type get_led_test_state(led_t * led, int * state)
+{
+	led_test_board_t * board = find_led_test_board(led);
+
+	if (board == NULL)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	*state = board->pins[led - board->leds] ? LED_ON : LED_OFF;
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static inline led_proc_error_type set_led_test_compare(led_t * led, unsigned int on_cycles)
+{
+	led_test_board_t * board = find_led_test_board(led);
+
+	if (board == NULL)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	board->compare[led - board->leds] = on_cycles;
+	board->hal_writes++;
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static inline led_proc_error_type set_led_test_cycles(led_t * led, unsigned int cycles)
+{
+	led_test_board_t * board = find_led_test_board(led);
+
+	if (board == NULL)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	board->cycles[led - board->leds] = cycles;
+	board->hal_writes++;
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static inline led_proc_error_type set_led_test_frame_irq(led_t * led, int enable)
+{
+	led_test_board_t * board = find_led_test_board(led);
+
+	if (board == NULL)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	board->frame_irq = enable;
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static inline void set_led_test_tick_irq(int enable)
+{
+	if (led_test_tick_board != NULL)
+		led_test_tick_board->tick_irq = enable;
+}
+
+// clears the board and points led_init, led_set_polarity, led_set_duty_cycle and led_get_state at the HAL here,
+// with every LED an output.  The test adds the other hooks it wants, makes its PWM LEDs and calls init_led_proc
+static inline void setup_led_test_board(led_test_board_t * board, int num_leds)
+{
+	int known = 0;
+
+	memset(board, 0, sizeof(*board));
+	board->num_leds = num_leds;
+	board->proc.led_init = init_led_test_led;
+	board->proc.led_set_polarity = set_led_test_polarity;
+	board->proc.led_set_duty_cycle = set_led_test_duty_cycle;
+	board->proc.led_get_state = get_led_test_state;
+	for (int i = 0; i < num_leds; i++)
+		board->leds[i].led_type = LED_TYPE_OUTPUT;
+
+	for (int i = 0; i < led_test_num_boards; i++)
+		known |= (led_test_boards[i] == board);
+	if (!known && led_test_num_boards < LED_TEST_MAX_BOARDS)
+		led_test_boards[led_test_num_boards++] = board;
+}
+
+// makes an LED a PWM LED on the side table entry given, at 1kHz from the 24MHz clock of the TLS8258
+static inline void set_led_test_pwm(led_test_board_t * board, int led_num, led_pwm_state_t * pwm_state)
+{
+	board->leds[led_num].led_type = LED_TYPE_PWM;
+	board->leds[led_num].led_pwm_state = pwm_state;
+	get_led_pwm_timing(24000000, 1000, 0, &pwm_state->led_pwm_timing);
+}
+#endif
+
+#endif /* TOOLS_TESTS_LED_TEST_H_ */
@@ -0,0 +1,403 @@
+/*
+ * test_button_proc.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of button_proc against a bouncing button, built from the repository root:
+ *
+ *	gcc -O2 -Wno-cpp -Itools/sim -Ilib -o test_button_proc tools/tests/test_button_proc.c lib/button_proc.c
+ *	./test_button_proc [-b]
+ *
+ *	-b	also compare the cost per event with a polling debouncer
+ *
+ * A script of presses is turned into the edges of a pin that bounces for up to TEST_BOUNCE_US after every change.
+ * The edges are delivered as the chip would, handle_button_edge runs when the pin leaves the level its edge was
+ * armed for, including when it already has by the time it is armed, and process_button_proc runs every
+ * LED_FADE_TICK_MS as run_led_loop calls it.  The events must be the ones the clean presses give, at the times
+ * they give, whatever the bounces.  Times are in us, the button is active low as SW1 is.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "button_proc.h"
+#include "led_test.h"
+
+#define TEST_DEBOUNCE_US		20000
+#define TEST_LONG_PRESS_US		800000
+#define TEST_MULTI_CLICK_US		300000
+#define TEST_PROCESS_US			5000		// LED_FADE_TICK_MS
+#define TEST_BOUNCE_US			5000		// longest a change bounces for
+#define TEST_MAX_EDGES			8192
+#define TEST_MAX_EVENTS			1024
+#define TEST_MAX_PRESSES		256
+
+typedef struct test_edge_t {
+	unsigned int at;
+	int level;
+}test_edge_t;
+
+typedef struct test_press_t {
+	unsigned int at;
+	unsigned int held;
+}test_press_t;
+
+static test_edge_t test_edges[TEST_MAX_EDGES];
+static int test_num_edges;
+static button_event_t test_events[TEST_MAX_EVENTS];
+static int test_num_events;
+
+static button_t test_buttons[1];
+static button_proc_t test_proc;
+static int test_pin;
+static int test_armed_level;		// the edge interrupt fires when the pin leaves this level
+static int test_irq_pending;
+static unsigned long test_reads;
+static unsigned long test_irqs;
+
+static led_proc_error_type init_test_button(button_t * button)
+{
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type read_test_button(button_t * button, int * level)
+{
+	test_reads++;
+	*level = test_pin;
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type set_test_edge(button_t * button, int level)
+{
+	test_armed_level = level;
+	// the edge detector latches a pin that has already moved
+	test_irq_pending = (test_pin != level);
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static void handle_test_event(struct button_proc_t * button_proc, button_event_t * event)
+{
+	if (test_num_events < TEST_MAX_EVENTS)
+		test_events[test_num_events++] = *event;
+}
+
+static void init_test_proc(int with_handler)
+{
+	memset(&test_proc, 0, sizeof(test_proc));
+	memset(test_buttons, 0, sizeof(test_buttons));
+	test_proc.button_init = init_test_button;
+	test_proc.button_read = read_test_button;
+	test_proc.button_set_edge = set_test_edge;
+	test_proc.button_event_handler = with_handler ? handle_test_event : NULL;
+	test_proc.button_debounce_time = TEST_DEBOUNCE_US;
+	test_proc.button_long_press_time = TEST_LONG_PRESS_US;
+	test_proc.button_multi_click_time = TEST_MULTI_CLICK_US;
+	test_buttons[0].button_active_level = 0;
+
+	test_pin = 1;
+	test_irq_pending = 0;
+	test_num_events = 0;
+	test_reads = 0;
+	test_irqs = 0;
+	init_button_proc(&test_proc, test_buttons, 1);
+}
+
+static void add_test_edge(unsigned int at, int level)
+{
+	if (test_num_edges < TEST_MAX_EDGES)
+	{
+		test_edges[test_num_edges].at = at;
+		test_edges[test_num_edges].level = level;
+		test_num_edges++;
+	}
+}
+
+// the clean change, then bounces that end on the new level within TEST_BOUNCE_US
+static void add_test_change(unsigned int at, int level, int bounces)
+{
+	unsigned int t = at;
+
+	add_test_edge(at, level);
+	for (int i = 0; i < bounces; i++)
+	{
+		t += 1 + (unsigned int)rand() % (TEST_BOUNCE_US / (2 * bounces + 1));
+		add_test_edge(t, !level);
+		t += 1 + (unsigned int)rand() % (TEST_BOUNCE_US / (2 * bounces + 1));
+		add_test_edge(t, level);
+	}
+}
+
+static void make_test_edges(test_press_t presses[], int num_presses, int max_bounces)
+{
+	test_num_edges = 0;
+	for (int i = 0; i < num_presses; i++)
+	{
+		add_test_change(presses[i].at, 0, max_bounces ? rand() % (max_bounces + 1) : 0);
+		add_test_change(presses[i].at + presses[i].held, 1, max_bounces ? rand() % (max_bounces + 1) : 0);
+	}
+}
+
+// runs the edges and the process calls in time order until the time given
+static void run_test_edges(unsigned int until)
+{
+	int edge = 0;
+	unsigned int next_process = TEST_PROCESS_US;
+
+	while (1)
+	{
+		unsigned int now;
+
+		if (edge < test_num_edges && test_edges[edge].at < next_process)
+		{
+			now = test_edges[edge].at;
+			test_pin = test_edges[edge].level;
+			if (test_pin != test_armed_level)
+				test_irq_pending = 1;
+			edge++;
+			// the handler arms the next edge, which may already be pending
+			while (test_irq_pending)
+			{
+				test_irq_pending = 0;
+				test_irqs++;
+				handle_button_edges(&test_proc, now);
+			}
+			continue;
+		}
+
+		if (next_process > until)
+			break;
+		process_button_proc(&test_proc, next_process);
+		next_process += TEST_PROCESS_US;
+	}
+}
+
+// the events the clean presses give, with the latest time each can come at
+static int make_test_expected(test_press_t presses[], int num_presses, button_event_t expected[], unsigned int latest[])
+{
+	int num = 0;
+	int clicks = 0;
+
+	for (int i = 0; i < num_presses; i++)
+	{
+		unsigned int release = presses[i].at + presses[i].held;
+
+		expected[num].event_type = BUTTON_EVENT_PRESS;
+		expected[num].timestamp = presses[i].at;
+		latest[num++] = presses[i].at;
+		if (presses[i].held >= TEST_LONG_PRESS_US)
+		{
+			// a long press ends the clicks before it, without a multi click
+			clicks = 0;
+			expected[num].event_type = BUTTON_EVENT_LONG_PRESS;
+			expected[num].timestamp = presses[i].at + TEST_LONG_PRESS_US;
+			latest[num++] = presses[i].at + TEST_LONG_PRESS_US + TEST_PROCESS_US;
+		}
+		else
+			clicks++;
+		expected[num].event_type = BUTTON_EVENT_RELEASE;
+		expected[num].timestamp = release;
+		latest[num++] = release;
+
+		if (clicks != 0 && (i == num_presses - 1 || presses[i + 1].at - release >= TEST_MULTI_CLICK_US))
+		{
+			expected[num].event_type = BUTTON_EVENT_MULTI_CLICK;
+			expected[num].button_clicks = (unsigned char)clicks;
+			expected[num].timestamp = release + TEST_MULTI_CLICK_US;
+			latest[num++] = release + TEST_MULTI_CLICK_US + TEST_PROCESS_US;
+			clicks = 0;
+		}
+	}
+	return num;
+}
+
+static int check_test_events(test_press_t presses[], int num_presses)
+{
+	static button_event_t expected[TEST_MAX_EVENTS];
+	static unsigned int latest[TEST_MAX_EVENTS];
+	int num = make_test_expected(presses, num_presses, expected, latest);
+
+	if (!LED_CHECK_EQ(test_num_events, num))
+		return 0;
+	for (int i = 0; i < num; i++)
+	{
+		if (!LED_CHECK_EQ(test_events[i].event_type, expected[i].event_type)
+				|| !LED_CHECK(test_events[i].timestamp >= expected[i].timestamp && test_events[i].timestamp <= latest[i])
+				|| !LED_CHECK_EQ(test_events[i].button_clicks, (expected[i].event_type == BUTTON_EVENT_MULTI_CLICK) ? expected[i].button_clicks : 0))
+		{
+			printf("event %d: type %d at %u, expected type %d from %u to %u\n", i, test_events[i].event_type,
+					test_events[i].timestamp, expected[i].event_type, expected[i].timestamp, latest[i]);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static void run_test_script(test_press_t presses[], int num_presses, int max_bounces)
+{
+	init_test_proc(1);
+	make_test_edges(presses, num_presses, max_bounces);
+	run_test_edges(presses[num_presses - 1].at + presses[num_presses - 1].held + TEST_LONG_PRESS_US + TEST_MULTI_CLICK_US);
+	check_test_events(presses, num_presses);
+	LED_CHECK_EQ(test_proc.button_events_dropped, 0);
+}
+
+static void test_button_scripts(void)
+{
+	test_press_t single[] = { { 100000, 120000 } };
+	test_press_t triple[] = { { 100000, 80000 }, { 300000, 60000 }, { 500000, 100000 } };
+	test_press_t long_press[] = { { 100000, 80000 }, { 250000, 1200000 }, { 1600000, 50000 } };
+
+	run_test_script(single, 1, 0);
+	run_test_script(single, 1, 8);
+	run_test_script(triple, 3, 8);
+	run_test_script(long_press, 3, 8);
+}
+
+// random presses and gaps, kept clear of the long press and multi click times by more than a process period
+static void test_button_random(void)
+{
+	static test_press_t presses[TEST_MAX_PRESSES];
+
+	srand(34);
+	for (int run = 0; run < 200; run++)
+	{
+		unsigned int at = 50000;
+		int num_presses = 1 + rand() % 40;
+
+		for (int i = 0; i < num_presses; i++)
+		{
+			unsigned int held = (rand() % 8 == 0) ? 850000 + (unsigned int)rand() % 400000 : 40000 + (unsigned int)rand() % 700000;
+			unsigned int gap = (rand() % 2) ? 40000 + (unsigned int)rand() % 210000 : 350000 + (unsigned int)rand() % 500000;
+
+			presses[i].at = at;
+			presses[i].held = held;
+			at += held + gap;
+		}
+
+		init_test_proc(1);
+		make_test_edges(presses, num_presses, 10);
+		run_test_edges(at + TEST_LONG_PRESS_US + TEST_MULTI_CLICK_US);
+		if (!check_test_events(presses, num_presses) || !LED_CHECK_EQ(test_proc.button_events_dropped, 0))
+		{
+			printf("random run %d of %d presses\n", run, num_presses);
+			break;
+		}
+	}
+}
+
+// with nobody taking them the queue keeps the first BUTTON_PROC_QUEUE_SIZE and counts the rest
+static void test_button_queue(void)
+{
+	test_press_t presses[8];
+	button_event_t event;
+	int taken = 0;
+
+	for (int i = 0; i < 8; i++)
+	{
+		presses[i].at = 100000 + (unsigned int)i * 100000;
+		presses[i].held = 50000;
+	}
+	init_test_proc(0);
+	make_test_edges(presses, 8, 4);
+	run_test_edges(presses[7].at + 50000 + TEST_MULTI_CLICK_US + TEST_PROCESS_US);
+
+	while (get_button_event(&test_proc, &event) == LED_PROC_ERROR_TYPE_NONE)
+	{
+		LED_CHECK_EQ(event.event_type, (taken & 1) ? BUTTON_EVENT_RELEASE : BUTTON_EVENT_PRESS);
+		taken++;
+	}
+	LED_CHECK_EQ(taken, BUTTON_PROC_QUEUE_SIZE);
+	// 8 presses and releases and the multi click of 8
+	LED_CHECK_EQ(test_proc.button_events_dropped, 8 * 2 + 1 - BUTTON_PROC_QUEUE_SIZE);
+}
+
+// a button held through a reset gives no press and no long press, only its release
+static void test_button_held_at_init(void)
+{
+	init_test_proc(1);
+	test_pin = 0;
+	init_button_proc(&test_proc, test_buttons, 1);
+	test_num_edges = 0;
+	add_test_change(1000000, 1, 4);
+	run_test_edges(2000000);
+
+	LED_CHECK_EQ(test_num_events, 1);
+	LED_CHECK_EQ(test_events[0].event_type, BUTTON_EVENT_RELEASE);
+}
+
+// the polling debouncer this replaces, the pin read every ms and a change taken once it held for the debounce time
+typedef struct test_poller_t {
+	int stable;
+	int count;
+	unsigned long events;
+}test_poller_t;
+
+static void poll_test_button(test_poller_t * poller)
+{
+	int level;
+
+	read_test_button(&test_buttons[0], &level);
+	if (level == poller->stable)
+		poller->count = 0;
+	else if (++poller->count >= TEST_DEBOUNCE_US / 1000)
+	{
+		poller->stable = level;
+		poller->count = 0;
+		poller->events++;
+	}
+}
+
+static void bench_button_proc(void)
+{
+	static test_press_t presses[TEST_MAX_PRESSES];
+	test_poller_t poller = { 1, 0, 0 };
+	unsigned int at = 50000;
+	unsigned long reads;
+	double start;
+	double irq_seconds;
+	double poll_seconds;
+	int edge = 0;
+
+	srand(341);
+	for (int i = 0; i < TEST_MAX_PRESSES; i++)
+	{
+		presses[i].at = at;
+		presses[i].held = 40000 + (unsigned int)rand() % 300000;
+		at += presses[i].held + 40000 + (unsigned int)rand() % 600000;
+	}
+
+	init_test_proc(1);
+	make_test_edges(presses, TEST_MAX_PRESSES, 10);
+	start = get_test_seconds();
+	run_test_edges(at);
+	irq_seconds = get_test_seconds() - start;
+	reads = test_reads;
+
+	test_reads = 0;
+	test_pin = 1;
+	start = get_test_seconds();
+	for (unsigned int now = 0; now < at; now += 1000)
+	{
+		while (edge < test_num_edges && test_edges[edge].at <= now)
+			test_pin = test_edges[edge++].level;
+		poll_test_button(&poller);
+	}
+	poll_seconds = get_test_seconds() - start;
+
+	printf("%-24s %10s %14s %14s\n", "", "events", "reads/event", "ns/event");
+	printf("%-24s %10d %14.1f %14.1f\n", "edge interrupts", test_num_events, (double)reads / test_num_events,
+			irq_seconds * 1e9 / test_num_events);
+	printf("%-24s %10lu %14.1f %14.1f\n", "polled every 1ms", poller.events, (double)test_reads / poller.events,
+			poll_seconds * 1e9 / poller.events);
+	printf("%lu edge interrupts for %d edges, %.1f s of presses\n", test_irqs, test_num_edges, at / 1e6);
+}
+
+int main(int argc, char ** argv)
+{
+	test_button_scripts();
+	test_button_random();
+	test_button_queue();
+	test_button_held_at_init();
+	if (argc > 1 && strcmp(argv[1], "-b") == 0)
+		bench_button_proc();
+
+	return led_test_summary("test_button_proc");
+}
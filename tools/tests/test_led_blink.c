@@ -0,0 +1,216 @@
+/*
+ * test_led_blink.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host simulation of blink_led in hardware and from the tick, built from the repository root:
+ *
+ *	gcc -O2 -Wno-cpp -Itools/sim -Ilib -o test_led_blink tools/tests/test_led_blink.c lib/led_proc.c
+ *	./test_led_blink
+ *
+ * Three boards blink the same LEDs side by side, ms by ms, with a TEST_TICK_MS tick interrupt that calls the
+ * dispatch.  One has no LED_PROC_CAP_HW_BLINK, so every blink runs from the tick.  One has a HAL that makes any
+ * blink in hardware, and one a HAL that turns down LED 3 and periods over TEST_HW_MAX_PERIOD_MS so those fall back
+ * to the tick.  The pins of the three must be the same every ms, and the tick interrupts per hour are reported.
+ */
+#include <string.h>
+#include "led_proc.h"
+
+#define TEST_NUM_LEDS			4
+#define LED_TEST_BOARD_LEDS		TEST_NUM_LEDS
+#include "led_test.h"
+
+#define TEST_NUM_BOARDS			3
+#define TEST_TICK_MS			50
+#define TEST_HOUR_MS			(60 * 60 * 1000)
+#define TEST_HW_MAX_PERIOD_MS	1500
+#define TEST_HW_LED_REJECTED	3
+
+typedef enum TEST_BOARDS {
+	TEST_BOARD_TICK,
+	TEST_BOARD_HW,
+	TEST_BOARD_MIXED
+}test_board_kind_t;
+
+static const char * const test_board_names[TEST_NUM_BOARDS] = { "tick", "hardware", "mixed" };
+
+typedef struct test_board_t {
+	led_test_board_t hal;
+	led_proc_dispatch_t dispatch;
+	unsigned int hw_period_ms[TEST_NUM_LEDS];	// 0 when the hardware is not blinking the LED
+	unsigned int hw_on_ms[TEST_NUM_LEDS];
+	unsigned int hw_start_ms[TEST_NUM_LEDS];
+	unsigned int tick_irqs;
+}test_board_t;
+
+static test_board_t test_boards[TEST_NUM_BOARDS];
+static unsigned int test_now;
+
+// a timer output compare per LED, the mixed board has none on LED 3 and cannot count past its longest period
+static led_proc_error_type set_test_blink(led_t * led, unsigned int period_ms, unsigned int on_ms)
+{
+	test_board_t * board = (test_board_t *)find_led_test_board(led);
+	int led_num = (int)(led - board->hal.leds);
+
+	if (period_ms != 0 && board == &test_boards[TEST_BOARD_MIXED])
+	{
+		if (led_num == TEST_HW_LED_REJECTED)
+			return LED_PROC_ERROR_TYPE_WRONG_TYPE;
+		if (period_ms > TEST_HW_MAX_PERIOD_MS)
+			return LED_PROC_ERROR_TYPE_BAD_STATE;
+	}
+	board->hw_period_ms[led_num] = period_ms;
+	board->hw_on_ms[led_num] = on_ms;
+	board->hw_start_ms[led_num] = test_now;
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static void run_test_tick(struct led_proc_t * led_proc)
+{
+	set_led_proc_tick_idle(led_proc);
+}
+
+static void init_test_boards(void)
+{
+	memset(test_boards, 0, sizeof(test_boards));
+	test_now = 0;
+	for (int b = 0; b < TEST_NUM_BOARDS; b++)
+	{
+		test_board_t * board = &test_boards[b];
+
+		setup_led_test_board(&board->hal, TEST_NUM_LEDS);
+		board->hal.proc.led_set_tick_irq = set_led_test_tick_irq;
+		board->hal.proc.led_tick = run_test_tick;
+		board->hal.proc.led_tick_period_ms = TEST_TICK_MS;
+		if (b != TEST_BOARD_TICK)
+		{
+			board->hal.proc.led_caps = LED_PROC_CAP_HW_BLINK;
+			board->hal.proc.led_set_blink = set_test_blink;
+		}
+		board->hal.tick_irq = 1;
+		LED_CHECK_EQ(init_led_proc(&board->hal.proc, board->hal.leds, TEST_NUM_LEDS), LED_PROC_ERROR_TYPE_NONE);
+		LED_CHECK_EQ(register_led_proc_dispatch(&board->dispatch, &board->hal.proc), LED_PROC_ERROR_TYPE_NONE);
+	}
+}
+
+// the same call on every board, with its hooks pointed at it
+static void blink_test_boards(int led_num, unsigned int period_ms, unsigned int on_ms)
+{
+	for (int b = 0; b < TEST_NUM_BOARDS; b++)
+	{
+		led_test_tick_board = &test_boards[b].hal;
+		if (period_ms == 0)
+			LED_CHECK_EQ(stop_led_num_blink(&test_boards[b].hal.proc, led_num), LED_PROC_ERROR_TYPE_NONE);
+		else
+			LED_CHECK_EQ(blink_led_num(&test_boards[b].hal.proc, led_num, period_ms, on_ms), LED_PROC_ERROR_TYPE_NONE);
+	}
+	led_test_tick_board = NULL;
+}
+
+// runs every board for ms, returns 1 if their pins stayed the same
+static int run_test_boards(unsigned int ms)
+{
+	for (unsigned int end = test_now + ms; test_now < end; )
+	{
+		test_now++;
+		for (int b = 0; b < TEST_NUM_BOARDS; b++)
+		{
+			test_board_t * board = &test_boards[b];
+
+			for (int i = 0; i < TEST_NUM_LEDS; i++)
+			{
+				if (board->hw_period_ms[i] != 0)
+					board->hal.pins[i] = (test_now - board->hw_start_ms[i]) % board->hw_period_ms[i] < board->hw_on_ms[i];
+			}
+			if (board->hal.tick_irq && test_now % TEST_TICK_MS == 0)
+			{
+				board->tick_irqs++;
+				led_test_tick_board = &board->hal;
+				run_led_proc_dispatch(&board->dispatch, TEST_TICK_MS);
+				led_test_tick_board = NULL;
+			}
+		}
+		for (int b = 1; b < TEST_NUM_BOARDS; b++)
+		{
+			if (!LED_CHECK(memcmp(test_boards[b].hal.pins, test_boards[0].hal.pins, sizeof(test_boards[0].hal.pins)) == 0))
+			{
+				printf("%s board differs at %u ms\n", test_board_names[b], test_now);
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+// an hour of steady blinks, in hardware the tick is stopped for all of it
+static void test_blink_hour(void)
+{
+	unsigned int tick_irqs[TEST_NUM_BOARDS];
+
+	init_test_boards();
+	run_test_boards(TEST_TICK_MS);
+	blink_test_boards(0, 1000, 250);
+	blink_test_boards(1, 600, 300);
+	blink_test_boards(2, 1500, 100);
+	blink_test_boards(3, 1000, 500);
+	for (int b = 0; b < TEST_NUM_BOARDS; b++)
+		test_boards[b].tick_irqs = 0;
+	run_test_boards(TEST_HOUR_MS);
+
+	printf("%-10s %20s %20s\n", "blinks in", "tick irqs per hour", "useful");
+	for (int b = 0; b < TEST_NUM_BOARDS; b++)
+	{
+		tick_irqs[b] = test_boards[b].tick_irqs;
+		printf("%-10s %20u %20u\n", test_board_names[b], tick_irqs[b], test_boards[b].hal.proc.led_tick_stats.irq_useful);
+	}
+	LED_CHECK_EQ(tick_irqs[TEST_BOARD_TICK], TEST_HOUR_MS / TEST_TICK_MS);
+	LED_CHECK_EQ(tick_irqs[TEST_BOARD_HW], 0);
+	LED_CHECK_EQ(tick_irqs[TEST_BOARD_MIXED], TEST_HOUR_MS / TEST_TICK_MS);
+
+	// the tick of the mixed board only has LED 3, so far fewer of its ticks drive an edge
+	LED_CHECK(test_boards[TEST_BOARD_MIXED].hal.proc.led_tick_stats.irq_useful < test_boards[TEST_BOARD_TICK].hal.proc.led_tick_stats.irq_useful);
+}
+
+// blinks moving between the hardware and the tick, and stopping, leave nothing blinking where it should not
+static void test_blink_changes(void)
+{
+	init_test_boards();
+	run_test_boards(TEST_TICK_MS);
+	blink_test_boards(0, 1000, 250);
+	blink_test_boards(1, 600, 300);
+	run_test_boards(10 * 1000);
+
+	// too long for the mixed board, which must stop its hardware blink and take it on the tick
+	blink_test_boards(1, 3000, 1500);
+	LED_CHECK_EQ(test_boards[TEST_BOARD_MIXED].hw_period_ms[1], 0);
+	LED_CHECK(test_boards[TEST_BOARD_MIXED].hal.tick_irq);
+	run_test_boards(10 * 1000);
+
+	// and back into hardware, where the tick entry must not fight it
+	blink_test_boards(1, 400, 100);
+	LED_CHECK_EQ(test_boards[TEST_BOARD_MIXED].hw_period_ms[1], 400);
+	LED_CHECK_EQ(test_boards[TEST_BOARD_MIXED].hal.proc.led_num_blinks, 0);
+	run_test_boards(10 * 1000);
+
+	// stopped where they are, and then no tick is needed on any board but the one that has only the tick
+	blink_test_boards(0, 0, 0);
+	blink_test_boards(1, 0, 0);
+	for (int b = 0; b < TEST_NUM_BOARDS; b++)
+	{
+		LED_CHECK_EQ(test_boards[b].hw_period_ms[0], 0);
+		LED_CHECK_EQ(test_boards[b].hw_period_ms[1], 0);
+		LED_CHECK_EQ(test_boards[b].hal.proc.led_num_blinks, 0);
+		test_boards[b].tick_irqs = 0;
+	}
+	run_test_boards(10 * 1000);
+	for (int b = 0; b < TEST_NUM_BOARDS; b++)
+		LED_CHECK(test_boards[b].tick_irqs <= 1);
+}
+
+int main(int argc, char ** argv)
+{
+	test_blink_hour();
+	test_blink_changes();
+
+	return led_test_summary("test_led_blink");
+}
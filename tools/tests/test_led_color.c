@@ -0,0 +1,312 @@
+/*
+ * test_led_color.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of the fixed point colour pipeline of led_color.c against a float reference, built from the repository
+ * root:
+ *
+ *	gcc -O2 -Wno-cpp -Itools/sim -Ilib -o test_led_color tools/tests/test_led_color.c lib/led_color.c lib/led_proc.c -lm
+ *	./test_led_color [-b]
+ *
+ *	-b	also time led_hsv_to_rgb and led_rgb_to_duty_cycles
+ *
+ * The conversions are swept over a grid of colours, calibrations and brightnesses and must stay within a couple of
+ * counts of the float maths.  set_led_rgb_group is run on an RGB group of two PWM LEDs and an output LED with a HAL
+ * that records what it is given, to check that the three channels are committed inside one critical section.
+ */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "led_color.h"
+
+#define LED_TEST_BOARD_LEDS		LED_COLOR_NUM_CHANNELS
+#include "led_test.h"
+
+#define TEST_HSV_ERROR_MAX		2		// counts of 255 the integer HSV conversion may be off the float one
+#define TEST_LEVEL_ERROR_MAX	1		// counts of 255 a calibrated level may be off
+#define TEST_DUTY_ERROR_MAX		1		// duty cycle steps a channel may be off
+#define TEST_BENCH_COLORS		10000000
+
+static led_test_board_t test_board;
+static int test_critical_depth;
+static int test_critical_entries;
+static int test_writes_outside;
+
+// a channel written outside the critical section could light a mix of the old and the new color
+static led_proc_error_type set_test_polarity(led_t * led, led_output_state_t state)
+{
+	test_writes_outside += (test_critical_depth == 0);
+	return set_led_test_polarity(led, state);
+}
+
+static led_proc_error_type set_test_duty_cycle(led_t * led, int pwm_dc)
+{
+	test_writes_outside += (test_critical_depth == 0);
+	return set_led_test_duty_cycle(led, pwm_dc);
+}
+
+static unsigned int enter_test_critical(void)
+{
+	test_critical_depth++;
+	test_critical_entries++;
+	return 0;
+}
+
+static void exit_test_critical(unsigned int key)
+{
+	test_critical_depth--;
+}
+
+// red and green are PWM, blue a plain output as on a board with too few PWM channels
+static void init_test_proc(void)
+{
+	setup_led_test_board(&test_board, LED_COLOR_NUM_CHANNELS);
+	test_board.proc.led_set_polarity = set_test_polarity;
+	test_board.proc.led_set_duty_cycle = set_test_duty_cycle;
+	test_board.proc.led_enter_critical = enter_test_critical;
+	test_board.proc.led_exit_critical = exit_test_critical;
+	test_board.leds[LED_COLOR_RED].led_type = LED_TYPE_PWM;
+	test_board.leds[LED_COLOR_RED].led_pwm_state = &test_board.pwm_states[LED_COLOR_RED];
+	test_board.leds[LED_COLOR_GREEN].led_type = LED_TYPE_PWM;
+	test_board.leds[LED_COLOR_GREEN].led_pwm_state = &test_board.pwm_states[LED_COLOR_GREEN];
+	init_led_proc(&test_board.proc, test_board.leds, LED_COLOR_NUM_CHANNELS);
+}
+
+static void hsv_to_rgb_reference(int hue, int sat, int val, double rgb[])
+{
+	double h = (double)(hue % LED_COLOR_HUE_MAX) / LED_COLOR_HUE_SECTOR;
+	double s = (double)sat / LED_COLOR_MAX;
+	double v = (double)val;
+	int sector = (int)h;
+	double f = h - sector;
+	double p = v * (1 - s);
+	double q = v * (1 - s * f);
+	double t = v * (1 - s * (1 - f));
+
+	switch (sector)
+	{
+	case 0:		rgb[0] = v;	rgb[1] = t;	rgb[2] = p;	break;
+	case 1:		rgb[0] = q;	rgb[1] = v;	rgb[2] = p;	break;
+	case 2:		rgb[0] = p;	rgb[1] = v;	rgb[2] = t;	break;
+	case 3:		rgb[0] = p;	rgb[1] = q;	rgb[2] = v;	break;
+	case 4:		rgb[0] = t;	rgb[1] = p;	rgb[2] = v;	break;
+	default:	rgb[0] = v;	rgb[1] = p;	rgb[2] = q;	break;
+	}
+}
+
+// every hue, and a grid of saturations and values, within TEST_HSV_ERROR_MAX of the float conversion
+static void test_hsv_accuracy(void)
+{
+	int worst = 0;
+
+	for (int hue = 0; hue < LED_COLOR_HUE_MAX; hue++)
+	{
+		for (int sat = 0; sat <= LED_COLOR_MAX; sat += 15)
+		{
+			for (int val = 0; val <= LED_COLOR_MAX; val += 15)
+			{
+				struct led_rgb_t rgb;
+				double want[LED_COLOR_NUM_CHANNELS];
+				int got[LED_COLOR_NUM_CHANNELS];
+
+				led_hsv_to_rgb((unsigned short)hue, (unsigned char)sat, (unsigned char)val, &rgb);
+				hsv_to_rgb_reference(hue, sat, val, want);
+				got[0] = rgb.red;
+				got[1] = rgb.green;
+				got[2] = rgb.blue;
+				for (int c = 0; c < LED_COLOR_NUM_CHANNELS; c++)
+				{
+					int error = (int)lround(fabs((double)got[c] - want[c]));
+					if (error > worst)
+						worst = error;
+				}
+			}
+		}
+	}
+	printf("hsv to rgb: worst error %d of %d\n", worst, LED_COLOR_MAX);
+	LED_CHECK(worst <= TEST_HSV_ERROR_MAX);
+}
+
+// the primaries and greys come out exact, and a hue past the end wraps
+static void test_hsv_exact(void)
+{
+	struct led_rgb_t rgb;
+
+	led_hsv_to_rgb(0, LED_COLOR_MAX, LED_COLOR_MAX, &rgb);
+	LED_CHECK(rgb.red == LED_COLOR_MAX && rgb.green == 0 && rgb.blue == 0);
+	led_hsv_to_rgb(2 * LED_COLOR_HUE_SECTOR, LED_COLOR_MAX, LED_COLOR_MAX, &rgb);
+	LED_CHECK(rgb.red == 0 && rgb.green == LED_COLOR_MAX && rgb.blue == 0);
+	led_hsv_to_rgb(4 * LED_COLOR_HUE_SECTOR, LED_COLOR_MAX, LED_COLOR_MAX, &rgb);
+	LED_CHECK(rgb.red == 0 && rgb.green == 0 && rgb.blue == LED_COLOR_MAX);
+	led_hsv_to_rgb(4 * LED_COLOR_HUE_SECTOR, LED_COLOR_MAX, 0, &rgb);
+	LED_CHECK(rgb.red == 0 && rgb.green == 0 && rgb.blue == 0);
+
+	for (int val = 0; val <= LED_COLOR_MAX; val++)
+	{
+		led_hsv_to_rgb(1000, 0, (unsigned char)val, &rgb);
+		if (!LED_CHECK(rgb.red == val && rgb.green == val && rgb.blue == val))
+			break;
+	}
+
+	led_hsv_to_rgb(LED_COLOR_HUE_MAX + 2 * LED_COLOR_HUE_SECTOR, LED_COLOR_MAX, LED_COLOR_MAX, &rgb);
+	LED_CHECK(rgb.red == 0 && rgb.green == LED_COLOR_MAX && rgb.blue == 0);
+}
+
+// random colours, calibrations and brightnesses through led_rgb_to_duty_cycles against the float maths, for a duty
+// range running either way
+static void test_duty_accuracy(void)
+{
+	struct led_rgb_group_t group;
+	int worst_level = 0;
+	int worst_duty = 0;
+
+	srand(29);
+	for (int n = 0; n < 200000; n++)
+	{
+		struct led_rgb_t rgb = { (unsigned char)(rand() & 0xFF), (unsigned char)(rand() & 0xFF), (unsigned char)(rand() & 0xFF) };
+		int in[LED_COLOR_NUM_CHANNELS] = { rgb.red, rgb.green, rgb.blue };
+		int duty_cycles[LED_COLOR_NUM_CHANNELS];
+		unsigned char levels[LED_COLOR_NUM_CHANNELS];
+		int inverted = n & 1;
+
+		init_led_rgb_group(&group, 0, 1, 2, inverted ? 0 : LED_PWM_DUTY_MAX, inverted ? LED_PWM_DUTY_MAX : 0);
+		group.brightness = (unsigned char)(rand() & 0xFF);
+		// a white balance that mostly cuts the channels, with a little cross talk
+		for (int row = 0; row < LED_COLOR_NUM_CHANNELS; row++)
+		{
+			for (int col = 0; col < LED_COLOR_NUM_CHANNELS; col++)
+				group.calibration[row][col] = (short)((row == col) ? 128 + rand() % 129 : rand() % 32);
+		}
+
+		led_rgb_to_duty_cycles(&group, &rgb, duty_cycles, levels);
+
+		for (int row = 0; row < LED_COLOR_NUM_CHANNELS; row++)
+		{
+			double mixed = 0;
+			double level;
+			double duty;
+
+			for (int col = 0; col < LED_COLOR_NUM_CHANNELS; col++)
+				mixed += (double)group.calibration[row][col] / LED_COLOR_CAL_ONE * in[col];
+			if (mixed > LED_COLOR_MAX)
+				mixed = LED_COLOR_MAX;
+			// the float reference rounds where the integer pipeline does, so only the arithmetic is compared
+			level = floor(mixed + 0.5) * group.brightness / LED_COLOR_MAX;
+			duty = level * LED_PWM_DUTY_MAX / LED_COLOR_MAX;
+			if (inverted)
+				duty = LED_PWM_DUTY_MAX - duty;
+
+			int level_error = (int)lround(fabs(levels[row] - level));
+			int duty_error = (int)lround(fabs(duty_cycles[row] - duty));
+			if (level_error > worst_level)
+				worst_level = level_error;
+			if (duty_error > worst_duty)
+				worst_duty = duty_error;
+		}
+	}
+	printf("rgb to duty cycles: worst level error %d of %d, worst duty error %d of %d\n", worst_level, LED_COLOR_MAX,
+			worst_duty, LED_PWM_DUTY_MAX);
+	LED_CHECK(worst_level <= TEST_LEVEL_ERROR_MAX);
+	LED_CHECK(worst_duty <= TEST_DUTY_ERROR_MAX);
+
+	// past full scale the matrix saturates rather than wrapping
+	struct led_rgb_t white = { LED_COLOR_MAX, LED_COLOR_MAX, LED_COLOR_MAX };
+	int duty_cycles[LED_COLOR_NUM_CHANNELS];
+	unsigned char levels[LED_COLOR_NUM_CHANNELS];
+
+	init_led_rgb_group(&group, 0, 1, 2, LED_PWM_DUTY_MAX, 0);
+	group.calibration[LED_COLOR_RED][LED_COLOR_GREEN] = LED_COLOR_CAL_ONE;
+	group.calibration[LED_COLOR_GREEN][LED_COLOR_GREEN] = -LED_COLOR_CAL_ONE;
+	led_rgb_to_duty_cycles(&group, &white, duty_cycles, levels);
+	LED_CHECK_EQ(levels[LED_COLOR_RED], LED_COLOR_MAX);
+	LED_CHECK_EQ(duty_cycles[LED_COLOR_RED], LED_PWM_DUTY_MAX);
+	LED_CHECK_EQ(levels[LED_COLOR_GREEN], 0);
+	LED_CHECK_EQ(duty_cycles[LED_COLOR_GREEN], 0);
+}
+
+// the group reaches the LEDs in one critical section, the PWM channels with their duty cycles and the output with
+// its level rounded to on or off
+static void test_group_commit(void)
+{
+	struct led_rgb_group_t group;
+	struct led_rgb_t rgb = { LED_COLOR_MAX, 64, 200 };
+
+	init_test_proc();
+	LED_CHECK_EQ(init_led_rgb_group(&group, LED_COLOR_RED, LED_COLOR_GREEN, LED_COLOR_BLUE, 0, LED_PWM_DUTY_MAX), LED_PROC_ERROR_TYPE_NONE);
+
+	test_critical_entries = 0;
+	test_writes_outside = 0;
+	LED_CHECK_EQ(set_led_rgb_group(&test_board.proc, &group, &rgb), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(test_critical_entries, 1);
+	LED_CHECK_EQ(test_critical_depth, 0);
+	LED_CHECK_EQ(test_writes_outside, 0);
+	LED_CHECK_EQ(test_board.duty[LED_COLOR_RED], 0);
+	LED_CHECK_EQ(test_board.duty[LED_COLOR_GREEN], LED_PWM_DUTY_MAX - 25);
+	LED_CHECK_EQ(test_board.leds[LED_COLOR_BLUE].led_output_state, LED_ON);
+	LED_CHECK_EQ(test_board.pins[LED_COLOR_BLUE], LED_ON);
+
+	// half scale is still off for the output channel
+	LED_CHECK_EQ(set_led_rgb_group_hsv(&test_board.proc, &group, 0, LED_COLOR_MAX, LED_COLOR_MAX / 2), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(test_board.leds[LED_COLOR_BLUE].led_output_state, LED_OFF);
+	LED_CHECK_EQ(test_board.pins[LED_COLOR_BLUE], LED_OFF);
+	LED_CHECK_EQ(test_board.duty[LED_COLOR_RED], LED_PWM_DUTY_MAX - 50);
+	LED_CHECK_EQ(test_board.duty[LED_COLOR_GREEN], LED_PWM_DUTY_MAX);
+	LED_CHECK_EQ(test_critical_entries, 2);
+
+	LED_CHECK_EQ(set_led_rgb_group(NULL, &group, &rgb), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(set_led_rgb_group(&test_board.proc, NULL, &rgb), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(set_led_rgb_group(&test_board.proc, &group, NULL), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(init_led_rgb_group(NULL, 0, 1, 2, 0, LED_PWM_DUTY_MAX), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(test_critical_entries, 2);
+}
+
+static void bench_led_color(void)
+{
+	struct led_rgb_group_t group;
+	volatile unsigned int sink = 0;
+	double start;
+	double hsv_time;
+	double duty_time;
+
+	init_led_rgb_group(&group, 0, 1, 2, 0, LED_PWM_DUTY_MAX);
+	group.brightness = 200;
+
+	start = get_test_seconds();
+	for (int n = 0; n < TEST_BENCH_COLORS; n++)
+	{
+		struct led_rgb_t rgb;
+
+		led_hsv_to_rgb((unsigned short)(n % LED_COLOR_HUE_MAX), (unsigned char)n, (unsigned char)(n >> 8), &rgb);
+		sink += rgb.red + rgb.green + rgb.blue;
+	}
+	hsv_time = get_test_seconds() - start;
+
+	start = get_test_seconds();
+	for (int n = 0; n < TEST_BENCH_COLORS; n++)
+	{
+		struct led_rgb_t rgb = { (unsigned char)n, (unsigned char)(n >> 8), (unsigned char)(n >> 16) };
+		int duty_cycles[LED_COLOR_NUM_CHANNELS];
+		unsigned char levels[LED_COLOR_NUM_CHANNELS];
+
+		led_rgb_to_duty_cycles(&group, &rgb, duty_cycles, levels);
+		sink += (unsigned int)duty_cycles[0] + levels[2];
+	}
+	duty_time = get_test_seconds() - start;
+
+	printf("led_hsv_to_rgb          %8.2f M/s\n", TEST_BENCH_COLORS / hsv_time / 1e6);
+	printf("led_rgb_to_duty_cycles  %8.2f M/s\n", TEST_BENCH_COLORS / duty_time / 1e6);
+	(void)sink;
+}
+
+int main(int argc, char ** argv)
+{
+	test_hsv_exact();
+	test_hsv_accuracy();
+	test_duty_accuracy();
+	test_group_commit();
+	if (argc > 1 && strcmp(argv[1], "-b") == 0)
+		bench_led_color();
+
+	return led_test_summary("test_led_color");
+}
@@ -0,0 +1,411 @@
+/*
+ * test_led_compose.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of the layered compositor, built from the repository root:
+ *
+ *	gcc -O2 -Wno-cpp -Itools/sim -Ilib -DLED_COMPOSE_MAX_LEDS=32 -DLED_COMPOSE_MAX_LAYERS=8 -o test_led_compose \
+ *		tools/tests/test_led_compose.c lib/led_compose.c lib/led_proc.c
+ *	./test_led_compose [-b]
+ *
+ *	-b	also time commits over LED and layer counts, against blending and sending every LED every tick
+ *
+ * Random stacks of layers are changed at random and committed, and every LED must come out as the blend of its
+ * layers worked out in floating point, within a count per layer.  Only the LEDs whose output changed may reach
+ * the HAL: an output LED through led_set_polarity, a PWM LED through set_led_pwm_brightness, which marks it as
+ * dithering, so the test clears that flag before each commit to see which were sent.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "led_compose.h"
+
+#define TEST_MAX_LEDS			LED_COMPOSE_MAX_LEDS
+#define LED_TEST_BOARD_LEDS		TEST_MAX_LEDS
+#include "led_test.h"
+
+#define TEST_MAX_LAYERS			LED_COMPOSE_MAX_LAYERS
+#define TEST_ON_LEVEL			0x8000		// output LEDs are on from half scale up
+#define TEST_RUNS				2000
+#define TEST_BENCH_COMMITS		200000
+
+static led_test_board_t test_board;
+static struct led_compositor_t test_compositor;
+static led_layer_t test_layers[TEST_MAX_LAYERS];
+static int test_in_compositor[TEST_MAX_LAYERS];
+static int test_added[TEST_MAX_LAYERS];				// order of adding, to blend layers of the same priority in
+static int test_num_added;
+
+// every other LED is a PWM LED, from the first
+static void init_test_proc(int num_leds)
+{
+	setup_led_test_board(&test_board, num_leds);
+	test_board.proc.led_set_compare = set_led_test_compare;
+	for (int i = 0; i < num_leds; i += 2)
+		set_led_test_pwm(&test_board, i, &test_board.pwm_states[i]);
+	init_led_proc(&test_board.proc, test_board.leds, num_leds);
+	test_num_added = 0;
+	memset(test_in_compositor, 0, sizeof(test_in_compositor));
+}
+
+// the output of an LED as the blend of led_compose.h, in floating point
+static double blend_test_led(int led_num)
+{
+	double out = 0;
+
+	// layers by priority, then in the order they were added
+	for (int p = 0; p < 256; p++)
+	{
+		for (int n = 0; n < test_num_added; n++)
+		{
+			led_layer_t * layer = &test_layers[test_added[n]];
+			double alpha = (layer->layer_alpha + (layer->layer_alpha >> 7)) / 256.0;
+			double value = layer->layer_values[led_num];
+
+			if (!test_in_compositor[test_added[n]] || layer->layer_priority != p || !(layer->layer_mask & (1u << led_num)))
+				continue;
+			if (layer->layer_blend == LED_BLEND_OVERRIDE)
+				out = out * (1 - alpha) + value * alpha;
+			else if (layer->layer_blend == LED_BLEND_MAX)
+				out = (value * alpha > out) ? value * alpha : out;
+			else if (layer->layer_blend == LED_BLEND_ADD)
+				out = (out + value * alpha > LED_COMPOSE_VALUE_MAX) ? LED_COMPOSE_VALUE_MAX : out + value * alpha;
+			else
+				out = out * (LED_COMPOSE_VALUE_MAX * (1 - alpha) + value * alpha) / LED_COMPOSE_VALUE_MAX;
+		}
+	}
+	return out;
+}
+
+static unsigned int get_test_output(int led_num)
+{
+	if (test_board.leds[led_num].led_type == LED_TYPE_PWM)
+		return test_board.pwm_states[led_num].led_brightness;
+	return (test_board.leds[led_num].led_output_state == LED_ON) ? LED_COMPOSE_VALUE_MAX : 0;
+}
+
+// commits, then checks every LED against the floating point blend and that only the changed ones were sent
+static int commit_test_compositor(int num_leds)
+{
+	unsigned int before[TEST_MAX_LEDS];
+	unsigned int sent_before = test_compositor.compose_sent;
+	int changed = 0;
+	int sent;
+	unsigned int pin_writes = test_board.pin_writes;
+
+	for (int i = 0; i < num_leds; i++)
+	{
+		before[i] = get_test_output(i);
+		test_board.pwm_states[i].led_dithering = 0;
+	}
+	if (!LED_CHECK_EQ(commit_led_compositor(&test_compositor), LED_PROC_ERROR_TYPE_NONE))
+		return 0;
+
+	sent = (int)(test_board.pin_writes - pin_writes);
+	for (int i = 0; i < num_leds; i++)
+	{
+		double expected = blend_test_led(i);
+		double tolerance = 1 + test_num_added;
+		unsigned int out = get_test_output(i);
+
+		if (test_board.leds[i].led_type == LED_TYPE_PWM)
+		{
+			sent += test_board.pwm_states[i].led_dithering;
+			if (!LED_CHECK(out >= expected - tolerance && out <= expected + tolerance))
+			{
+				printf("LED %d at %u, expected %.1f\n", i, out, expected);
+				return 0;
+			}
+		}
+		else if (expected < TEST_ON_LEVEL - tolerance || expected > TEST_ON_LEVEL + tolerance)
+		{
+			if (!LED_CHECK_EQ(out, (expected >= TEST_ON_LEVEL) ? LED_COMPOSE_VALUE_MAX : 0))
+			{
+				printf("output LED %d at %u, expected %.1f\n", i, out, expected);
+				return 0;
+			}
+		}
+		// the first output of an LED is always sent, after that only a change
+		changed += (out != before[i] || !(sent_before & (1u << i)));
+	}
+	return LED_CHECK_EQ(sent, changed);
+}
+
+static void add_test_layer(int n)
+{
+	if (add_led_layer(&test_compositor, &test_layers[n]) == LED_PROC_ERROR_TYPE_NONE)
+	{
+		test_in_compositor[n] = 1;
+		for (int i = 0; i < test_num_added; i++)
+		{
+			if (test_added[i] == n)
+			{
+				memmove(&test_added[i], &test_added[i + 1], (size_t)(test_num_added - i - 1) * sizeof(test_added[0]));
+				test_num_added--;
+				break;
+			}
+		}
+		test_added[test_num_added++] = n;
+	}
+}
+
+static void test_compose_random(void)
+{
+	srand(36);
+	for (int run = 0; run < TEST_RUNS; run++)
+	{
+		int num_leds = 1 + rand() % TEST_MAX_LEDS;
+		int num_layers = 1 + rand() % TEST_MAX_LAYERS;
+
+		init_test_proc(num_leds);
+		if (!LED_CHECK_EQ(init_led_compositor(&test_compositor, &test_board.proc), LED_PROC_ERROR_TYPE_NONE))
+			return;
+		for (int n = 0; n < num_layers; n++)
+		{
+			init_led_layer(&test_layers[n], (led_blend_mode)(rand() % 4), (unsigned char)rand(), (unsigned char)(rand() % 4));
+			add_test_layer(n);
+		}
+		if (!commit_test_compositor(num_leds))
+			break;
+
+		for (int step = 0; step < 50; step++)
+		{
+			int ops = 1 + rand() % 4;
+
+			for (int op = 0; op < ops; op++)
+			{
+				int n = rand() % num_layers;
+				int led_num = rand() % num_leds;
+				// values bunched at the ends and the middle, where max, add and the output threshold are decided
+				static const unsigned short edges[] = { 0, 1, 0x7FFF, 0x8000, 0xFFFE, 0xFFFF };
+				unsigned short value = (rand() % 4 == 0) ? edges[rand() % 6] : (unsigned short)rand();
+
+				switch (rand() % 8)
+				{
+				case 0:
+					clear_led_layer_num_value(&test_compositor, &test_layers[n], led_num);
+					break;
+				case 1:
+					set_led_layer_alpha(&test_compositor, &test_layers[n], (rand() % 2) ? (unsigned char)rand() : 255);
+					break;
+				case 2:
+					if (test_in_compositor[n] && remove_led_layer(&test_compositor, &test_layers[n]) == LED_PROC_ERROR_TYPE_NONE)
+						test_in_compositor[n] = 0;
+					else if (!test_in_compositor[n])
+						add_test_layer(n);
+					break;
+				default:
+					set_led_layer_num_value(&test_compositor, &test_layers[n], led_num, value);
+					break;
+				}
+			}
+			if (!commit_test_compositor(num_leds))
+			{
+				printf("run %d step %d\n", run, step);
+				return;
+			}
+		}
+	}
+}
+
+// a commit with nothing changed sends nothing, a value set again marks nothing, and a layer only dirties its LEDs
+static void test_compose_dirty(void)
+{
+	init_test_proc(8);
+	init_led_compositor(&test_compositor, &test_board.proc);
+	init_led_layer(&test_layers[0], LED_BLEND_OVERRIDE, 255, 0);
+	init_led_layer(&test_layers[1], LED_BLEND_ADD, 128, 1);
+	add_test_layer(0);
+	add_test_layer(1);
+	set_led_layer_num_value(&test_compositor, &test_layers[0], 1, 0xFFFF);
+	set_led_layer_num_value(&test_compositor, &test_layers[1], 2, 0x4000);
+	commit_test_compositor(8);
+
+	LED_CHECK_EQ(test_compositor.compose_dirty, 0);
+	commit_test_compositor(8);
+	set_led_layer_num_value(&test_compositor, &test_layers[0], 1, 0xFFFF);
+	LED_CHECK_EQ(test_compositor.compose_dirty, 0);
+	set_led_layer_alpha(&test_compositor, &test_layers[1], 128);
+	LED_CHECK_EQ(test_compositor.compose_dirty, 0);
+	set_led_layer_alpha(&test_compositor, &test_layers[1], 64);
+	LED_CHECK_EQ(test_compositor.compose_dirty, 1u << 2);
+	commit_test_compositor(8);
+
+	// an output LED that stays on the same side of half scale is blended again but not sent
+	set_led_layer_num_value(&test_compositor, &test_layers[0], 1, 0x9000);
+	LED_CHECK_EQ(test_compositor.compose_dirty, 1u << 1);
+	commit_test_compositor(8);
+
+	remove_led_layer(&test_compositor, &test_layers[0]);
+	test_in_compositor[0] = 0;
+	LED_CHECK_EQ(test_compositor.compose_dirty, 1u << 1);
+	commit_test_compositor(8);
+	LED_CHECK_EQ(test_board.leds[1].led_output_state, LED_OFF);
+}
+
+// the ends of the scale come out exact: full alpha replaces, multiplying by full scale changes nothing, and adding
+// saturates at full scale
+static void test_compose_exact(void)
+{
+	init_test_proc(2);
+	init_led_compositor(&test_compositor, &test_board.proc);
+	init_led_layer(&test_layers[0], LED_BLEND_OVERRIDE, 255, 0);
+	init_led_layer(&test_layers[1], LED_BLEND_MULTIPLY, 255, 1);
+	init_led_layer(&test_layers[2], LED_BLEND_ADD, 255, 2);
+	add_test_layer(0);
+	add_test_layer(1);
+	for (unsigned int value = 0; value <= LED_COMPOSE_VALUE_MAX; value += 0x0101)
+	{
+		set_led_layer_num_value(&test_compositor, &test_layers[0], 0, (unsigned short)value);
+		set_led_layer_num_value(&test_compositor, &test_layers[1], 0, LED_COMPOSE_VALUE_MAX);
+		commit_led_compositor(&test_compositor);
+		if (!LED_CHECK_EQ(test_board.pwm_states[0].led_brightness, value))
+			break;
+	}
+	add_test_layer(2);
+	set_led_layer_num_value(&test_compositor, &test_layers[2], 0, 0x8000);
+	commit_led_compositor(&test_compositor);
+	LED_CHECK_EQ(test_board.pwm_states[0].led_brightness, LED_COMPOSE_VALUE_MAX);
+	set_led_layer_num_value(&test_compositor, &test_layers[1], 0, 0);
+	commit_led_compositor(&test_compositor);
+	LED_CHECK_EQ(test_board.pwm_states[0].led_brightness, 0x8000);
+}
+
+// the first error stops the commit, the LEDs not sent stay dirty and go out with the next commit
+static void test_compose_errors(void)
+{
+	led_layer_t extra;
+
+	init_test_proc(4);
+	init_led_compositor(&test_compositor, &test_board.proc);
+	init_led_layer(&test_layers[0], LED_BLEND_OVERRIDE, 255, 0);
+	add_test_layer(0);
+	commit_test_compositor(4);
+	for (int i = 0; i < 4; i++)
+		set_led_layer_num_value(&test_compositor, &test_layers[0], i, 0xFFFF);
+	test_board.fail[1] = LED_PROC_ERROR_TYPE_BAD_STATE;
+	LED_CHECK_EQ(commit_led_compositor(&test_compositor), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(test_compositor.compose_dirty, 0xEu);
+	test_board.fail[1] = 0;
+	// the LED that failed is sent again whatever led_proc left in its led_output_state
+	test_board.pin_writes = 0;
+	test_board.pwm_states[2].led_dithering = 0;
+	LED_CHECK_EQ(commit_led_compositor(&test_compositor), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(test_board.pin_writes, 2);
+	LED_CHECK_EQ(test_board.pwm_states[2].led_dithering, 1);
+	LED_CHECK_EQ(test_board.pwm_states[2].led_brightness, 0xFFFF);
+	LED_CHECK_EQ(test_board.leds[1].led_output_state, LED_ON);
+	LED_CHECK_EQ(test_board.leds[3].led_output_state, LED_ON);
+
+	LED_CHECK_EQ(set_led_layer_num_value(&test_compositor, &test_layers[0], 4, 1), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(clear_led_layer_num_value(&test_compositor, &test_layers[0], -1), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(add_led_layer(&test_compositor, &test_layers[0]), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(remove_led_layer(&test_compositor, &extra), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(init_led_layer(NULL, LED_BLEND_MAX, 0, 0), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(init_led_compositor(NULL, &test_board.proc), LED_PROC_ERROR_TYPE_NULL);
+
+	for (int n = 1; n < TEST_MAX_LAYERS; n++)
+	{
+		init_led_layer(&test_layers[n], LED_BLEND_MAX, 255, 0);
+		LED_CHECK_EQ(add_led_layer(&test_compositor, &test_layers[n]), LED_PROC_ERROR_TYPE_NONE);
+	}
+	init_led_layer(&extra, LED_BLEND_MAX, 255, 0);
+	LED_CHECK_EQ(add_led_layer(&test_compositor, &extra), LED_PROC_ERROR_TYPE_BAD_STATE);
+}
+
+// what the compositor saves: every LED blended through every layer and sent every tick
+static void commit_test_naive(int num_leds)
+{
+	for (int i = 0; i < num_leds; i++)
+	{
+		unsigned int out = 0;
+
+		for (int n = 0; n < test_compositor.num_layers; n++)
+		{
+			led_layer_t * layer = test_compositor.layers[n];
+			unsigned int alpha = layer->layer_alpha + (layer->layer_alpha >> 7);
+
+			if (layer->layer_mask & (1u << i))
+				out = (out * (256 - alpha) + layer->layer_values[i] * alpha) >> 8;
+		}
+		if (test_board.leds[i].led_type == LED_TYPE_PWM)
+			set_led_num_pwm_brightness(&test_board.proc, i, (unsigned short)out);
+		else if (out >= TEST_ON_LEVEL)
+			turn_led_num_on(&test_board.proc, i);
+		else
+			turn_led_num_off(&test_board.proc, i);
+	}
+}
+
+static void bench_led_compose(void)
+{
+	static const int led_counts[] = { 4, 8, 16, 32 };
+	static const int layer_counts[] = { 1, 2, 4, 8 };
+
+	printf("%5s %7s %14s %14s %14s %14s\n", "LEDs", "layers", "idle ns", "one LED ns", "all LEDs ns", "naive ns");
+	for (int l = 0; l < 4; l++)
+	{
+		for (int y = 0; y < 4; y++)
+		{
+			int num_leds = led_counts[l];
+			int num_layers = layer_counts[y];
+			double start;
+			double idle;
+			double one;
+			double all;
+			double naive;
+
+			init_test_proc(num_leds);
+			init_led_compositor(&test_compositor, &test_board.proc);
+			for (int n = 0; n < num_layers; n++)
+			{
+				init_led_layer(&test_layers[n], LED_BLEND_OVERRIDE, 200, (unsigned char)n);
+				add_led_layer(&test_compositor, &test_layers[n]);
+				for (int i = 0; i < num_leds; i++)
+					set_led_layer_num_value(&test_compositor, &test_layers[n], i, (unsigned short)rand());
+			}
+			commit_led_compositor(&test_compositor);
+
+			start = get_test_seconds();
+			for (int c = 0; c < TEST_BENCH_COMMITS; c++)
+				commit_led_compositor(&test_compositor);
+			idle = get_test_seconds() - start;
+
+			start = get_test_seconds();
+			for (int c = 0; c < TEST_BENCH_COMMITS; c++)
+			{
+				set_led_layer_num_value(&test_compositor, &test_layers[num_layers - 1], c % num_leds, (unsigned short)(c * 977));
+				commit_led_compositor(&test_compositor);
+			}
+			one = get_test_seconds() - start;
+
+			start = get_test_seconds();
+			for (int c = 0; c < TEST_BENCH_COMMITS; c++)
+			{
+				set_led_layer_alpha(&test_compositor, &test_layers[0], (unsigned char)(c & 0xFF));
+				commit_led_compositor(&test_compositor);
+			}
+			all = get_test_seconds() - start;
+
+			start = get_test_seconds();
+			for (int c = 0; c < TEST_BENCH_COMMITS; c++)
+				commit_test_naive(num_leds);
+			naive = get_test_seconds() - start;
+
+			printf("%5d %7d %14.1f %14.1f %14.1f %14.1f\n", num_leds, num_layers, idle * 1e9 / TEST_BENCH_COMMITS,
+					one * 1e9 / TEST_BENCH_COMMITS, all * 1e9 / TEST_BENCH_COMMITS, naive * 1e9 / TEST_BENCH_COMMITS);
+		}
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	test_compose_random();
+	test_compose_dirty();
+	test_compose_exact();
+	test_compose_errors();
+	if (argc > 1 && strcmp(argv[1], "-b") == 0)
+		bench_led_compose();
+
+	return led_test_summary("test_led_compose");
+}
@@ -0,0 +1,444 @@
+/*
+ * test_led_coro.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of the led_coro scheduler, built from the repository root:
+ *
+ *	gcc -O2 -Wno-cpp -Itools/sim -Ilib -o test_led_coro tools/tests/test_led_coro.c lib/led_coro.c lib/led_proc.c
+ *	./test_led_coro [-b]
+ *
+ *	-b	also report the memory of a coroutine and the cost of a resume and of a post for up to TEST_BENCH_COROS
+ *
+ * Every coroutine records what it waits on before it waits, so each resume is checked against a model of the
+ * scheduler: it is due or its event was posted, it runs at most once per run_led_coros, after the waits on events
+ * and in the order of its time and then of when it waited, and no wait that fired is left behind after a run.
+ */
+#include <string.h>
+#include "led_coro.h"
+#include "led_test.h"
+
+#define TEST_NUM_COROS		4000
+#define TEST_NUM_RUNS		5000
+#define TEST_MAX_WAIT_MS	50
+#define TEST_MAX_STEP_MS	20
+#define TEST_EVENT_BITS		6		// LED_CORO_EVENT_USER and the bits above it
+#define TEST_EVENT_NEVER	0x80	// the bit above those, never posted
+#define TEST_MAX_ORDER		64
+#define TEST_BENCH_COROS	4096
+#define TEST_BENCH_RUNS		2000
+
+typedef enum TEST_WAITS {
+	TEST_WAIT_MS,
+	TEST_WAIT_EVENT,
+	TEST_WAIT_DONE,			// returned LED_CORO_DONE
+	TEST_WAIT_STOPPED		// stopped by stop_led_coro
+}test_wait_t;
+
+// the led_coro_t comes first, so the coroutine finds the rest from its own pointer
+typedef struct test_coro_t {
+	led_coro_t coro;
+	test_wait_t wait;
+	unsigned int due;				// ms the wait on time fires at
+	unsigned int seq;				// order the waits were made in
+	unsigned char events;
+	unsigned int random;
+	unsigned int last_run;			// run it was last resumed in
+	unsigned int resumes;
+	int next_ms;					// the wait of the order test, -1 for none
+}test_coro_t;
+
+static struct led_proc_t test_proc;
+static led_coro_sched_t test_sched;
+static unsigned int test_now;
+static unsigned int test_seq;
+static unsigned int test_run;
+static unsigned char test_pending;		// posted since the run before
+static unsigned char test_posted;		// posted before the run in progress
+static unsigned int test_run_seq;		// first seq of a wait made during the run in progress
+static int test_timer_resumed;			// a wait on time was resumed in the run in progress
+static unsigned int test_last_due;
+static unsigned int test_last_seq;
+static unsigned int test_bad_resumes;
+static int test_done_rate;				// 1 in test_done_rate resumes finishes the coroutine, 0 for never
+static unsigned int test_order[TEST_MAX_ORDER];	// the random field of the coroutines in the order they resumed
+static int test_num_order;
+
+static void wait_test_ms(test_coro_t * test, unsigned int ms)
+{
+	test->wait = TEST_WAIT_MS;
+	test->due = test_now + ms;
+	test->seq = test_seq++;
+}
+
+static void wait_test_event(test_coro_t * test, unsigned char events)
+{
+	test->wait = TEST_WAIT_EVENT;
+	test->events = events;
+	test->seq = test_seq++;
+}
+
+// checks a resume against what the coroutine waited on, reports only the first few bad ones
+static void check_test_resume(test_coro_t * test)
+{
+	int ok = 1;
+
+	ok &= LED_CHECK(test->last_run != test_run);
+	switch (test->wait)
+	{
+	case TEST_WAIT_MS:
+		ok &= LED_CHECK(test->due <= test_now);
+		ok &= LED_CHECK(test->seq < test_run_seq);
+		// the delta list keeps the due order, and the order of the waits for the same due time
+		if (test_timer_resumed)
+			ok &= LED_CHECK(test->due > test_last_due || (test->due == test_last_due && test->seq > test_last_seq));
+		test_timer_resumed = 1;
+		test_last_due = test->due;
+		test_last_seq = test->seq;
+		break;
+	case TEST_WAIT_EVENT:
+		ok &= LED_CHECK((test->events & test_posted) != 0);
+		ok &= LED_CHECK(test->seq < test_run_seq);
+		ok &= LED_CHECK(!test_timer_resumed);
+		break;
+	default:
+		ok &= LED_CHECK(0);
+		break;
+	}
+
+	test->last_run = test_run;
+	test->resumes++;
+	if (!ok)
+		test_bad_resumes++;
+}
+
+// a random mix of waits on time and on events, with the odd one finishing
+static led_coro_state run_test_coro(struct led_coro_sched_t * sched, struct led_coro_t * coro)
+{
+	test_coro_t * test = (test_coro_t *)coro;
+
+	check_test_resume(test);
+
+	LED_CORO_BEGIN(coro);
+	while (1)
+	{
+		if (test_done_rate != 0 && next_test_random(&test->random) % (unsigned int)test_done_rate == 0)
+			break;
+		if (next_test_random(&test->random) % 4 == 0)
+		{
+			wait_test_event(test, (unsigned char)(LED_CORO_EVENT_USER << (next_test_random(&test->random) % TEST_EVENT_BITS)));
+			LED_AWAIT_EVENT(sched, coro, test->events);
+		}
+		else
+		{
+			wait_test_ms(test, next_test_random(&test->random) % (TEST_MAX_WAIT_MS + 1));
+			LED_AWAIT_MS(sched, coro, test->due - test_now);
+		}
+	}
+	test->wait = TEST_WAIT_DONE;
+	LED_CORO_END(coro);
+}
+
+static void start_test_coro(test_coro_t * test, led_coro_fn fn)
+{
+	LED_CHECK_EQ(start_led_coro(&test_sched, &test->coro, fn), LED_PROC_ERROR_TYPE_NONE);
+	wait_test_ms(test, 0);
+}
+
+static void post_test_event(unsigned char events)
+{
+	post_led_coro_event(&test_sched, events);
+	test_pending |= events;
+}
+
+// one run_led_coros after elapsed ms, with the posted events handed over the way the scheduler takes them
+static int run_test_coros(unsigned int elapsed_ms)
+{
+	test_now += elapsed_ms;
+	test_run++;
+	test_posted = test_pending;
+	test_pending = 0;
+	test_run_seq = test_seq;
+	test_timer_resumed = 0;
+	return run_led_coros(&test_sched, elapsed_ms);
+}
+
+// a wait that fired before the run and was not resumed is a lost wake up
+static int count_test_missed(test_coro_t * tests, int num)
+{
+	int missed = 0;
+
+	for (int i = 0; i < num; i++)
+	{
+		if (tests[i].seq >= test_run_seq || tests[i].last_run == test_run)
+			continue;
+		if (tests[i].wait == TEST_WAIT_MS && tests[i].due <= test_now)
+			missed++;
+		if (tests[i].wait == TEST_WAIT_EVENT && (tests[i].events & test_posted) != 0)
+			missed++;
+	}
+	return missed;
+}
+
+static void init_test_sched(void)
+{
+	memset(&test_proc, 0, sizeof(test_proc));
+	LED_CHECK_EQ(init_led_coro_sched(&test_sched, &test_proc), LED_PROC_ERROR_TYPE_NONE);
+	test_now = 0;
+	test_seq = 0;
+	test_run = 0;
+	test_pending = 0;
+	test_done_rate = 0;
+}
+
+// waits on the order test coroutine's own fixed time, or else on an event that is never posted
+static led_coro_state run_order_coro(struct led_coro_sched_t * sched, struct led_coro_t * coro)
+{
+	test_coro_t * test = (test_coro_t *)coro;
+
+	check_test_resume(test);
+	if (test_num_order < TEST_MAX_ORDER)
+		test_order[test_num_order++] = test->random;
+
+	LED_CORO_BEGIN(coro);
+	while (1)
+	{
+		if (test->next_ms >= 0)
+		{
+			wait_test_ms(test, (unsigned int)test->next_ms);
+			LED_AWAIT_MS(sched, coro, (unsigned int)test->next_ms);
+		}
+		else
+		{
+			wait_test_event(test, TEST_EVENT_NEVER);
+			LED_AWAIT_EVENT(sched, coro, TEST_EVENT_NEVER);
+		}
+	}
+	LED_CORO_END(coro);
+}
+
+// waits on time across the delta list, ties, yields and events that nobody waits on
+static void test_coro_order(void)
+{
+	static const int waits[] = { 30, 10, 20, 10, 0, 20 };
+	static const unsigned int order[] = { 0, 1, 2, 3, 4, 5, 4, 1, 3, 2, 5, 0 };
+	static test_coro_t tests[sizeof(waits) / sizeof(waits[0])];
+	int num = (int)(sizeof(waits) / sizeof(waits[0]));
+
+	init_test_sched();
+	test_bad_resumes = 0;
+	test_num_order = 0;
+	memset(tests, 0, sizeof(tests));
+	for (int i = 0; i < num; i++)
+	{
+		tests[i].random = (unsigned int)i;
+		tests[i].next_ms = waits[i];
+		start_test_coro(&tests[i], run_order_coro);
+	}
+	LED_CHECK_EQ(run_test_coros(0), num);
+	for (int i = 0; i < num; i++)
+		tests[i].next_ms = -1;
+
+	LED_CHECK_EQ(run_test_coros(0), 1);
+	LED_CHECK_EQ(run_test_coros(5), 0);
+	LED_CHECK_EQ(run_test_coros(5), 2);
+	post_test_event(LED_CORO_EVENT_FADE_DONE);
+	LED_CHECK_EQ(run_test_coros(25), 3);
+	LED_CHECK_EQ(count_test_missed(tests, num), 0);
+	LED_CHECK_EQ(run_test_coros(1000), 0);
+	LED_CHECK_EQ(test_num_order, (int)(sizeof(order) / sizeof(order[0])));
+	for (int i = 0; i < test_num_order; i++)
+		LED_CHECK_EQ(test_order[i], order[i]);
+
+	// a coroutine that yields in its resume runs again at the next run, not in the same one
+	tests[4].next_ms = 0;
+	start_test_coro(&tests[4], run_order_coro);
+	for (int i = 0; i < 10; i++)
+		LED_CHECK_EQ(run_test_coros(0), 1);
+
+	// stopped, and then not running
+	LED_CHECK_EQ(stop_led_coro(&test_sched, &tests[4].coro), LED_PROC_ERROR_TYPE_NONE);
+	tests[4].wait = TEST_WAIT_STOPPED;
+	LED_CHECK_EQ(stop_led_coro(&test_sched, &tests[4].coro), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(run_test_coros(100), 0);
+	LED_CHECK_EQ(test_bad_resumes, 0);
+}
+
+// waits on events only wake on one of their own bits, whatever else is posted
+static void test_coro_events(void)
+{
+	static test_coro_t tests[TEST_EVENT_BITS];
+
+	init_test_sched();
+	test_bad_resumes = 0;
+	memset(tests, 0, sizeof(tests));
+	for (int i = 0; i < TEST_EVENT_BITS; i++)
+	{
+		wait_test_event(&tests[i], (unsigned char)(LED_CORO_EVENT_USER << i));
+		tests[i].next_ms = -1;
+		tests[i].coro.coro_fn = run_order_coro;
+		wait_led_coro_event(&test_sched, &tests[i].coro, tests[i].events);
+	}
+
+	LED_CHECK_EQ(run_test_coros(1000), 0);
+	post_test_event(LED_CORO_EVENT_FADE_DONE);
+	LED_CHECK_EQ(run_test_coros(0), 0);
+	for (int i = 0; i < TEST_EVENT_BITS; i++)
+	{
+		// posting twice before a run still resumes once
+		post_test_event((unsigned char)(LED_CORO_EVENT_USER << i));
+		post_test_event((unsigned char)(LED_CORO_EVENT_USER << i));
+		LED_CHECK_EQ(run_test_coros(0), 1);
+		LED_CHECK_EQ(tests[i].resumes, 1);
+		LED_CHECK_EQ(run_test_coros(0), 0);
+		LED_CHECK_EQ(count_test_missed(tests, TEST_EVENT_BITS), 0);
+	}
+	LED_CHECK_EQ(test_bad_resumes, 0);
+}
+
+// thousands of coroutines with random waits, events, stops and restarts, each run checked against the model
+static void test_coro_random(void)
+{
+	static test_coro_t tests[TEST_NUM_COROS];
+	unsigned int random = 37;
+	unsigned long resumes = 0;
+	unsigned long fired = 0;
+	int missed = 0;
+
+	init_test_sched();
+	test_bad_resumes = 0;
+	test_done_rate = 64;
+	memset(tests, 0, sizeof(tests));
+	for (int i = 0; i < TEST_NUM_COROS; i++)
+	{
+		tests[i].random = (unsigned int)i * 2654435761u;
+		start_test_coro(&tests[i], run_test_coro);
+	}
+
+	for (int run = 0; run < TEST_NUM_RUNS; run++)
+	{
+		unsigned int step = next_test_random(&random) % (TEST_MAX_STEP_MS + 1);
+		int resumed;
+
+		if (next_test_random(&random) % 4 == 0)
+			post_test_event((unsigned char)(LED_CORO_EVENT_USER << (next_test_random(&random) % TEST_EVENT_BITS)));
+		for (int n = 0; n < 4; n++)
+		{
+			test_coro_t * test = &tests[next_test_random(&random) % TEST_NUM_COROS];
+			led_proc_error_type result = stop_led_coro(&test_sched, &test->coro);
+
+			if (test->wait == TEST_WAIT_DONE || test->wait == TEST_WAIT_STOPPED)
+				LED_CHECK_EQ(result, LED_PROC_ERROR_TYPE_NULL);
+			else
+				LED_CHECK_EQ(result, LED_PROC_ERROR_TYPE_NONE);
+			test->wait = TEST_WAIT_STOPPED;
+		}
+		for (int i = 0; i < TEST_NUM_COROS; i++)
+		{
+			if (tests[i].wait == TEST_WAIT_MS && tests[i].due <= test_now + step)
+				fired++;
+			else if (tests[i].wait == TEST_WAIT_EVENT && (tests[i].events & test_pending) != 0)
+				fired++;
+		}
+
+		resumed = run_test_coros(step);
+		resumes += (unsigned long)resumed;
+		missed += count_test_missed(tests, TEST_NUM_COROS);
+
+		// what finished or was stopped is started again now and then, so the number running stays up
+		for (int n = 0; n < 8; n++)
+		{
+			test_coro_t * test = &tests[next_test_random(&random) % TEST_NUM_COROS];
+
+			if (test->wait == TEST_WAIT_DONE || test->wait == TEST_WAIT_STOPPED)
+				start_test_coro(test, run_test_coro);
+		}
+	}
+
+	LED_CHECK_EQ(missed, 0);
+	LED_CHECK_EQ(test_bad_resumes, 0);
+	LED_CHECK_EQ(resumes, fired);
+	printf("%d coroutines, %d runs over %u ms, %lu resumes, each of them a wait that fired\n", TEST_NUM_COROS,
+			TEST_NUM_RUNS, test_now, resumes);
+}
+
+typedef struct bench_coro_t {
+	led_coro_t coro;
+	unsigned int period;
+}bench_coro_t;
+
+static led_coro_state run_bench_coro(struct led_coro_sched_t * sched, struct led_coro_t * coro)
+{
+	bench_coro_t * bench = (bench_coro_t *)coro;
+
+	LED_CORO_BEGIN(coro);
+	while (1)
+		LED_AWAIT_MS(sched, coro, bench->period);
+	LED_CORO_END(coro);
+}
+
+static led_coro_state run_bench_waiter(struct led_coro_sched_t * sched, struct led_coro_t * coro)
+{
+	LED_CORO_BEGIN(coro);
+	while (1)
+		LED_AWAIT_EVENT(sched, coro, LED_CORO_EVENT_USER);
+	LED_CORO_END(coro);
+}
+
+// the resume cost includes putting the coroutine back in the delta list, which walks the timers due before it
+static void bench_led_coro(void)
+{
+	static bench_coro_t benches[TEST_BENCH_COROS];
+
+	printf("led_coro_t is %d bytes on the host, a coroutine costs that and its own state, the scheduler %d bytes\n",
+			(int)sizeof(led_coro_t), (int)sizeof(led_coro_sched_t));
+	printf("%10s %12s %14s %14s %16s\n", "coroutines", "memory", "ns per run", "ns per resume", "ns per post");
+	for (int num = 4; num <= TEST_BENCH_COROS; num *= 4)
+	{
+		double start;
+		double run_seconds;
+		double post_seconds;
+		unsigned long resumes = 0;
+
+		init_test_sched();
+		memset(benches, 0, sizeof(benches));
+		for (int i = 0; i < num; i++)
+		{
+			benches[i].period = 10 + (unsigned int)(i * 7) % 100;
+			start_led_coro(&test_sched, &benches[i].coro, run_bench_coro);
+		}
+		run_led_coros(&test_sched, 0);
+		start = get_test_seconds();
+		for (int run = 0; run < TEST_BENCH_RUNS; run++)
+			resumes += (unsigned long)run_led_coros(&test_sched, 1);
+		run_seconds = get_test_seconds() - start;
+
+		// every coroutine waits on an event that is not the one posted, so a post only walks the waiters
+		init_test_sched();
+		for (int i = 0; i < num; i++)
+			start_led_coro(&test_sched, &benches[i].coro, run_bench_waiter);
+		run_led_coros(&test_sched, 0);
+		start = get_test_seconds();
+		for (int run = 0; run < TEST_BENCH_RUNS; run++)
+		{
+			post_led_coro_event(&test_sched, LED_CORO_EVENT_FADE_DONE);
+			run_led_coros(&test_sched, 1);
+		}
+		post_seconds = get_test_seconds() - start;
+
+		printf("%10d %12d %14.1f %14.1f %16.1f\n", num, (int)(num * sizeof(led_coro_t)),
+				run_seconds * 1e9 / TEST_BENCH_RUNS, resumes != 0 ? run_seconds * 1e9 / (double)resumes : 0.0,
+				post_seconds * 1e9 / TEST_BENCH_RUNS);
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	test_coro_order();
+	test_coro_events();
+	test_coro_random();
+	if (argc > 1 && strcmp(argv[1], "-b") == 0)
+		bench_led_coro();
+
+	return led_test_summary("test_led_coro");
+}
@@ -0,0 +1,245 @@
+/*
+ * test_led_dispatch.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of several led_proc instances serviced from one tick through led_proc_dispatch_t, built from the
+ * repository root:
+ *
+ *	gcc -O2 -Wno-cpp -Itools/sim -Ilib -o test_led_dispatch tools/tests/test_led_dispatch.c lib/led_proc.c
+ *	./test_led_dispatch [-b]
+ *
+ *	-b	also time run_led_proc_dispatch for up to TEST_BENCH_TABLES tables of LED_PROC_MAX_INSTANCES instances
+ *
+ * Every instance owns its LEDs and a board of its own in led_context, which its HAL drives, so an instance that
+ * reaches another board shows up as a pin that moved on a board whose tick did not run.
+ */
+#include <string.h>
+#include "led_proc.h"
+
+#define TEST_NUM_LEDS		3
+#define LED_TEST_BOARD_LEDS	TEST_NUM_LEDS
+#include "led_test.h"
+
+#define TEST_BENCH_TABLES	1024
+#define TEST_BENCH_TICKS	2000
+
+typedef struct test_board_t {
+	led_test_board_t hal;
+	unsigned int ticks;
+	int idle_after;				// ticks before led_tick sets the instance idle, 0 to never
+}test_board_t;
+
+static void run_test_tick(struct led_proc_t * led_proc)
+{
+	test_board_t * board = (test_board_t *)led_proc->led_context;
+
+	board->ticks++;
+	toggle_led_num_ensure(led_proc, (int)(board->ticks % TEST_NUM_LEDS));
+	if (board->idle_after != 0 && board->ticks % (unsigned int)board->idle_after == 0)
+		set_led_proc_tick_idle(led_proc);
+}
+
+// the tick interrupt is shared, every instance has the same hook, and it records into led_test_tick_board
+static void init_test_board(test_board_t * board, unsigned int period_ms)
+{
+	memset(board, 0, sizeof(*board));
+	setup_led_test_board(&board->hal, TEST_NUM_LEDS);
+	board->hal.proc.led_set_tick_irq = set_led_test_tick_irq;
+	board->hal.proc.led_tick = run_test_tick;
+	board->hal.proc.led_tick_period_ms = period_ms;
+	board->hal.proc.led_context = board;
+	board->hal.tick_irq = -1;
+	init_led_proc(&board->hal.proc, board->hal.leds, TEST_NUM_LEDS);
+}
+
+// each instance ticks at its own rate from the one dispatch, and only ever drives its own board
+static void test_dispatch_rates(void)
+{
+	static const unsigned int periods[LED_PROC_MAX_INSTANCES] = { 1, 10, 25, 250 };
+	test_board_t boards[LED_PROC_MAX_INSTANCES];
+	test_board_t other;
+	led_proc_dispatch_t dispatch;
+	led_proc_dispatch_t other_dispatch;
+
+	led_test_num_boards = 0;
+	memset(&dispatch, 0, sizeof(dispatch));
+	memset(&other_dispatch, 0, sizeof(other_dispatch));
+	for (int i = 0; i < LED_PROC_MAX_INSTANCES; i++)
+	{
+		init_test_board(&boards[i], periods[i]);
+		LED_CHECK_EQ(register_led_proc_dispatch(&dispatch, &boards[i].hal.proc), LED_PROC_ERROR_TYPE_NONE);
+	}
+	init_test_board(&other, 5);
+	LED_CHECK_EQ(register_led_proc_dispatch(&other_dispatch, &other.hal.proc), LED_PROC_ERROR_TYPE_NONE);
+
+	for (int ms = 0; ms < 1000; ms++)
+		run_led_proc_dispatch(&dispatch, 1);
+	for (int i = 0; i < LED_PROC_MAX_INSTANCES; i++)
+	{
+		LED_CHECK_EQ(boards[i].ticks, 1000 / periods[i]);
+		LED_CHECK_EQ(boards[i].hal.proc.led_tick_stats.irq_taken, 1000);
+		LED_CHECK_EQ(boards[i].hal.proc.led_tick_stats.irq_useful, 1000 / periods[i]);
+		for (int led = 0; led < TEST_NUM_LEDS; led++)
+			LED_CHECK_EQ(boards[i].hal.pins[led], boards[i].hal.leds[led].led_output_state);
+	}
+	// the other table was never run, so its board has not moved
+	LED_CHECK_EQ(other.ticks, 0);
+	for (int led = 0; led < TEST_NUM_LEDS; led++)
+		LED_CHECK_EQ(other.hal.pins[led], LED_OFF);
+
+	// a period that is not a multiple of the elapsed time keeps its rate, the overshoot is carried
+	for (int ms = 0; ms < 1000; ms += 10)
+		run_led_proc_dispatch(&other_dispatch, 10);
+	LED_CHECK_EQ(other.ticks, 100);
+	for (int i = 0; i < LED_PROC_MAX_INSTANCES; i++)
+		LED_CHECK_EQ(boards[i].ticks, 1000 / periods[i]);
+	for (int ms = 0; ms < 1000; ms += 10)
+		run_led_proc_dispatch(&dispatch, 10);
+	LED_CHECK_EQ(boards[2].ticks, 2000 / periods[2]);
+	LED_CHECK_EQ(boards[3].ticks, 2000 / periods[3]);
+	// the 1ms instance gets one tick per dispatch, never a burst to catch up
+	LED_CHECK_EQ(boards[0].ticks, 1000 + 100);
+}
+
+static void test_dispatch_table(void)
+{
+	test_board_t boards[LED_PROC_MAX_INSTANCES + 1];
+	led_proc_dispatch_t dispatch;
+
+	led_test_num_boards = 0;
+	memset(&dispatch, 0, sizeof(dispatch));
+	for (int i = 0; i <= LED_PROC_MAX_INSTANCES; i++)
+		init_test_board(&boards[i], 10);
+
+	for (int i = 0; i < LED_PROC_MAX_INSTANCES; i++)
+		LED_CHECK_EQ(register_led_proc_dispatch(&dispatch, &boards[i].hal.proc), LED_PROC_ERROR_TYPE_NONE);
+	// registering twice is a no op, a full table refuses
+	LED_CHECK_EQ(register_led_proc_dispatch(&dispatch, &boards[0].hal.proc), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(dispatch.dispatch_num_instances, LED_PROC_MAX_INSTANCES);
+	LED_CHECK_EQ(register_led_proc_dispatch(&dispatch, &boards[LED_PROC_MAX_INSTANCES].hal.proc), LED_PROC_ERROR_TYPE_BAD_STATE);
+
+	// a removed instance stops ticking and the rest carry on
+	LED_CHECK_EQ(unregister_led_proc_dispatch(&dispatch, &boards[1].hal.proc), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(dispatch.dispatch_num_instances, LED_PROC_MAX_INSTANCES - 1);
+	LED_CHECK_EQ(register_led_proc_dispatch(&dispatch, &boards[LED_PROC_MAX_INSTANCES].hal.proc), LED_PROC_ERROR_TYPE_NONE);
+	for (int ms = 0; ms < 100; ms++)
+		run_led_proc_dispatch(&dispatch, 1);
+	LED_CHECK_EQ(boards[0].ticks, 10);
+	LED_CHECK_EQ(boards[1].ticks, 0);
+	LED_CHECK_EQ(boards[2].ticks, 10);
+	LED_CHECK_EQ(boards[LED_PROC_MAX_INSTANCES].ticks, 10);
+
+	LED_CHECK_EQ(register_led_proc_dispatch(NULL, &boards[1].hal.proc), LED_PROC_ERROR_TYPE_NULL);
+	boards[1].hal.proc.led_tick = NULL;
+	LED_CHECK_EQ(register_led_proc_dispatch(&dispatch, &boards[1].hal.proc), LED_PROC_ERROR_TYPE_NULL);
+	boards[1].hal.proc.led_tick = run_test_tick;
+	boards[1].hal.proc.led_tick_period_ms = 0;
+	LED_CHECK_EQ(register_led_proc_dispatch(&dispatch, &boards[1].hal.proc), LED_PROC_ERROR_TYPE_BAD_STATE);
+}
+
+// the tick is stopped once every instance is idle, and a wake starts the instance from a full period
+static void test_dispatch_idle(void)
+{
+	test_board_t boards[2];
+	led_proc_dispatch_t dispatch;
+
+	led_test_num_boards = 0;
+	memset(&dispatch, 0, sizeof(dispatch));
+	init_test_board(&boards[0], 10);
+	init_test_board(&boards[1], 20);
+	boards[0].idle_after = 3;
+	boards[1].idle_after = 2;
+	register_led_proc_dispatch(&dispatch, &boards[0].hal.proc);
+	register_led_proc_dispatch(&dispatch, &boards[1].hal.proc);
+	led_test_tick_board = &boards[0].hal;
+
+	for (int ms = 0; ms < 100; ms++)
+		run_led_proc_dispatch(&dispatch, 1);
+	LED_CHECK_EQ(boards[0].ticks, 3);
+	LED_CHECK_EQ(boards[1].ticks, 2);
+	LED_CHECK_EQ(boards[0].hal.tick_irq, 0);
+
+	wake_led_proc_tick(&boards[1].hal.proc);
+	LED_CHECK_EQ(boards[0].hal.tick_irq, 1);
+	LED_CHECK_EQ(boards[1].hal.proc.led_tick_countdown_ms, 20);
+	for (int ms = 0; ms < 19; ms++)
+		run_led_proc_dispatch(&dispatch, 1);
+	LED_CHECK_EQ(boards[1].ticks, 2);
+	run_led_proc_dispatch(&dispatch, 1);
+	LED_CHECK_EQ(boards[1].ticks, 3);
+	LED_CHECK_EQ(boards[0].ticks, 3);
+	led_test_tick_board = NULL;
+}
+
+// register_led_proc and dispatch_led_proc_tick are the table led_proc keeps for the board
+static void test_dispatch_default(void)
+{
+	test_board_t board;
+
+	led_test_num_boards = 0;
+	init_test_board(&board, 5);
+	LED_CHECK_EQ(register_led_proc(&board.hal.proc), LED_PROC_ERROR_TYPE_NONE);
+	for (int ms = 0; ms < 50; ms++)
+		dispatch_led_proc_tick(1);
+	LED_CHECK_EQ(board.ticks, 10);
+	LED_CHECK_EQ(unregister_led_proc(&board.hal.proc), LED_PROC_ERROR_TYPE_NONE);
+	dispatch_led_proc_tick(5);
+	LED_CHECK_EQ(board.ticks, 10);
+}
+
+// a bare led_tick, so the time is the dispatch itself
+static void run_bench_tick(struct led_proc_t * led_proc)
+{
+	(*(unsigned int *)led_proc->led_context)++;
+}
+
+static void bench_led_dispatch(void)
+{
+	static struct led_proc_t procs[TEST_BENCH_TABLES][LED_PROC_MAX_INSTANCES];
+	static led_proc_dispatch_t tables[TEST_BENCH_TABLES];
+	static unsigned int ticks[TEST_BENCH_TABLES][LED_PROC_MAX_INSTANCES];
+
+	printf("%8s %10s %14s %16s\n", "tables", "instances", "ns per tick", "ns per instance");
+	for (int num_tables = 1; num_tables <= TEST_BENCH_TABLES; num_tables *= 4)
+	{
+		double start;
+		double seconds;
+		int instances = num_tables * LED_PROC_MAX_INSTANCES;
+
+		memset(tables, 0, sizeof(tables));
+		for (int t = 0; t < num_tables; t++)
+		{
+			for (int i = 0; i < LED_PROC_MAX_INSTANCES; i++)
+			{
+				memset(&procs[t][i], 0, sizeof(procs[t][i]));
+				procs[t][i].led_tick = run_bench_tick;
+				procs[t][i].led_tick_period_ms = 1u << i;
+				procs[t][i].led_context = &ticks[t][i];
+				register_led_proc_dispatch(&tables[t], &procs[t][i]);
+			}
+		}
+
+		start = get_test_seconds();
+		for (int tick = 0; tick < TEST_BENCH_TICKS; tick++)
+		{
+			for (int t = 0; t < num_tables; t++)
+				run_led_proc_dispatch(&tables[t], 1);
+		}
+		seconds = get_test_seconds() - start;
+		printf("%8d %10d %14.1f %16.2f\n", num_tables, instances, seconds * 1e9 / TEST_BENCH_TICKS,
+				seconds * 1e9 / TEST_BENCH_TICKS / instances);
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	test_dispatch_rates();
+	test_dispatch_table();
+	test_dispatch_idle();
+	test_dispatch_default();
+	if (argc > 1 && strcmp(argv[1], "-b") == 0)
+		bench_led_dispatch();
+
+	return led_test_summary("test_led_dispatch");
+}
@@ -0,0 +1,231 @@
+/*
+ * test_led_dither.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of the temporal dithering of set_led_pwm_brightness, built from the repository root:
+ *
+ *	gcc -O2 -Wno-cpp -Itools/sim -Ilib -I. -o test_led_dither tools/tests/test_led_dither.c tools/sim/tl_sim.c \
+ *		tools/sim/tl_flash.c lib/led_lib.c lib/led_proc.c lib/led_store.c lib/led_color.c lib/button_proc.c \
+ *		lib/led_coro.c lib/led_pattern.c lib/led_trace.c
+ *	./test_led_dither [-b]
+ *
+ *	-b	also time run_led_pwm_frame on the host
+ *
+ * First every 16 bit brightness is run through run_led_pwm_frame with a HAL that adds up the compare values, for
+ * several PWM periods.  Over any run of frames the lit counts must be within one count of the brightness, so the
+ * average over N frames is off by less than 1 / N of a count, well under one 16 bit step.  Then the white LED of
+ * led_lib is dithered on the virtual B85 of tools/sim, at both of its frequencies, and the time its pin is lit is
+ * measured from the PWM channel itself, with the frame latching and interrupt delivery of the chip.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tl_sim.h"
+#include "tl_flash.h"
+#include "led_lib.h"
+#include "led_proc.h"
+
+#define LED_TEST_BOARD_LEDS		1
+#include "led_test.h"
+
+#define TEST_HOST_FRAMES		256		// frames per brightness on the host HAL
+#define TEST_SIM_FRAMES			128		// frames per brightness on the virtual B85, one count is under a 16 bit step from 65536 / cycles frames
+#define TEST_SIM_SETTLE_FRAMES	2		// the first compare is written by the next frame interrupt and latched a frame later
+#define TEST_WHITE_PWM			PWM2_ID	// the white LED is AS_PWM2_N in bsp.h
+#define TEST_BENCH_FRAMES		50000000
+
+extern struct led_proc_t led_proc;
+void irq_handler(void);
+
+static led_test_board_t test_board;
+
+static void init_test_proc(unsigned int cycles)
+{
+	setup_led_test_board(&test_board, 1);
+	test_board.proc.led_set_duty_cycle = set_led_test_duty_compare;
+	test_board.proc.led_set_compare = set_led_test_compare;
+	test_board.proc.led_set_frame_irq = set_led_test_frame_irq;
+	test_board.leds[0].led_type = LED_TYPE_PWM;
+	test_board.leds[0].led_pwm_state = &test_board.pwm_states[0];
+	// a clock of cycles kHz gives exactly that many counts a frame at 1kHz
+	get_led_pwm_timing(cycles * 1000, 1000, 0, &test_board.pwm_states[0].led_pwm_timing);
+	init_led_proc(&test_board.proc, test_board.leds, 1);
+	test_board.frame_irq = 0;
+}
+
+// every brightness, the lit counts of every run of frames from the first within a count of the target
+static void test_host_dither(unsigned int cycles)
+{
+	long long worst = 0;
+
+	init_test_proc(cycles);
+	for (unsigned int brightness = 0; brightness <= LED_PWM_BRIGHTNESS_MAX; brightness++)
+	{
+		unsigned long long lit = 0;
+
+		if (!LED_CHECK_EQ(set_led_pwm_brightness(&test_board.proc, test_board.leds, (unsigned short)brightness), LED_PROC_ERROR_TYPE_NONE))
+			return;
+		for (unsigned long long frame = 1; frame <= TEST_HOST_FRAMES; frame++)
+		{
+			long long error;
+
+			run_led_pwm_frame(&test_board.proc, test_board.leds);
+			lit += test_board.compare[0];
+			// in 1 / 65536 of a count
+			error = (long long)(lit << 16) - (long long)(frame * brightness * cycles);
+			if (error < 0)
+				error = -error;
+			if (error > worst)
+				worst = error;
+		}
+	}
+	printf("host, %5u cycles: worst error over any run of frames %.4f counts\n", cycles, (double)worst / 65536);
+	LED_CHECK(worst < 65536);
+}
+
+// the frame interrupt is only kept on while there is a fraction to dither, and a duty cycle ends the dithering
+static void test_host_frame_irq(void)
+{
+	init_test_proc(256);
+
+	LED_CHECK_EQ(set_led_pwm_brightness(&test_board.proc, test_board.leds, 0x1080), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(test_board.frame_irq, 1);
+	run_led_pwm_frame(&test_board.proc, test_board.leds);
+	LED_CHECK_EQ(test_board.frame_irq, 1);
+
+	// 0x1000 of 256 counts is exactly 16, nothing to carry from frame to frame
+	LED_CHECK_EQ(set_led_pwm_brightness(&test_board.proc, test_board.leds, 0x1000), LED_PROC_ERROR_TYPE_NONE);
+	run_led_pwm_frame(&test_board.proc, test_board.leds);
+	LED_CHECK_EQ(test_board.compare[0], 16);
+	LED_CHECK_EQ(test_board.frame_irq, 0);
+	LED_CHECK_EQ(test_board.pwm_states[0].led_frame_irq_on, 0);
+
+	LED_CHECK_EQ(set_led_pwm_brightness(&test_board.proc, test_board.leds, 0x1080), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(test_board.frame_irq, 1);
+	LED_CHECK_EQ(set_led_pwm_duty_cycle(&test_board.proc, test_board.leds, 50), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(test_board.pwm_states[0].led_dithering, 0);
+	LED_CHECK_EQ(test_board.compare[0], 128);
+	run_led_pwm_frame(&test_board.proc, test_board.leds);
+	LED_CHECK_EQ(test_board.compare[0], 128);
+	LED_CHECK_EQ(test_board.frame_irq, 0);
+
+	test_board.proc.led_set_compare = NULL;
+	LED_CHECK_EQ(set_led_pwm_brightness(&test_board.proc, test_board.leds, 0x1080), LED_PROC_ERROR_TYPE_NULL);
+}
+
+static int find_test_pwm_led(void)
+{
+	for (int i = 0; i < led_proc.num_leds; i++)
+	{
+		if (led_proc.led_array[i].led_type == LED_TYPE_PWM)
+			return i;
+	}
+	return -1;
+}
+
+// the lit time of the white LED pin, measured on the PWM channel, against the brightness.  The channel is
+// inverted, so the LED is lit for the part of the frame the channel is low
+static void test_sim_dither(int led_num, const char * name)
+{
+	led_pwm_state_t * pwm_state = led_proc.led_array[led_num].led_pwm_state;
+	unsigned int cycles = pwm_state->led_pwm_timing.cycles;
+	tl_sim_time_t frame = (tl_sim_time_t)cycles * (TL_SIM_HZ / TL_SIM_SYS_CLOCK_HZ);
+	double worst = 0;
+	unsigned long irqs = tl_sim_stats.irqs;
+	unsigned long long irq_cycles = tl_sim_stats.cycles;
+
+	srand(30);
+	for (int n = 0; n < 512; n++)
+	{
+		// the dimmest brightnesses, where a fade steps most visibly, then random ones
+		unsigned short brightness = (unsigned short)((n < 256) ? n : rand() & 0xFFFF);
+		unsigned long long lit;
+		unsigned long long ticks;
+		double error;
+
+		set_led_num_pwm_brightness(&led_proc, led_num, brightness);
+		tl_sim_advance(TEST_SIM_SETTLE_FRAMES * frame);
+		lit = tl_sim_stats.pwm_high_ticks[TEST_WHITE_PWM];
+		ticks = tl_sim_stats.pwm_ticks[TEST_WHITE_PWM];
+		tl_sim_advance(TEST_SIM_FRAMES * frame);
+		ticks = tl_sim_stats.pwm_ticks[TEST_WHITE_PWM] - ticks;
+		lit = ticks - (tl_sim_stats.pwm_high_ticks[TEST_WHITE_PWM] - lit);
+
+		// the average brightness over the frames, in 16 bit steps
+		error = (double)lit * 65536 / (double)ticks - brightness;
+		if (error < 0)
+			error = -error;
+		if (error > worst)
+			worst = error;
+		if (!LED_CHECK(ticks == (unsigned long long)TEST_SIM_FRAMES * cycles && error < 1.0))
+		{
+			printf("brightness 0x%04X lit %llu of %llu\n", brightness, lit, ticks);
+			break;
+		}
+	}
+	printf("sim, %s, %5u cycles: worst average error over %d frames %.4f of a 16 bit step\n", name, cycles,
+			TEST_SIM_FRAMES, worst);
+
+	irqs = tl_sim_stats.irqs - irqs;
+	if (irqs != 0)
+		printf("sim, %s: %.1f estimated cycles of driver calls and registers per interrupt\n", name,
+				(double)(tl_sim_stats.cycles - irq_cycles) / irqs);
+}
+
+static void test_sim_led_lib(void)
+{
+	int led_num;
+	led_pwm_timing_t timing;
+
+	tl_sim_reset();
+	tl_flash_reset();
+	tl_sim_set_irq_handler(irq_handler);
+	init_led_lib();
+
+	led_num = find_test_pwm_led();
+	if (!LED_CHECK(led_num >= 0))
+		return;
+	test_sim_dither(led_num, "1 kHz");
+
+	// a retune is picked up by the next frame interrupt, and the brightness is rescaled to the new period
+	if (!LED_CHECK_EQ(get_led_pwm_timing(TL_SIM_SYS_CLOCK_HZ, 25000, 256, &timing), LED_PROC_ERROR_TYPE_NONE))
+		return;
+	retune_led_num_pwm(&led_proc, led_num, &timing);
+	tl_sim_advance(TEST_SIM_SETTLE_FRAMES * (tl_sim_time_t)led_proc.led_array[led_num].led_pwm_state->led_pwm_timing.cycles
+			* (TL_SIM_HZ / TL_SIM_SYS_CLOCK_HZ));
+	LED_CHECK_EQ(led_proc.led_array[led_num].led_pwm_state->led_pwm_timing.cycles, timing.cycles);
+	test_sim_dither(led_num, "25 kHz");
+
+	LED_CHECK_EQ(tl_sim_stats.irq_storms, 0);
+}
+
+static void bench_led_dither(void)
+{
+	struct timespec start;
+	struct timespec end;
+	double seconds;
+
+	init_test_proc(24000);
+	set_led_pwm_brightness(&test_board.proc, test_board.leds, 0x1234);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int n = 0; n < TEST_BENCH_FRAMES; n++)
+		run_led_pwm_frame(&test_board.proc, test_board.leds);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+	printf("run_led_pwm_frame  %.2f ns per frame on the host\n", seconds * 1e9 / TEST_BENCH_FRAMES);
+}
+
+int main(int argc, char ** argv)
+{
+	test_host_dither(256);
+	test_host_dither(960);
+	test_host_dither(24000);
+	test_host_dither(LED_PWM_MAX_CYCLES);
+	test_host_frame_irq();
+	test_sim_led_lib();
+	if (argc > 1 && strcmp(argv[1], "-b") == 0)
+		bench_led_dither();
+
+	return led_test_summary("test_led_dither");
+}
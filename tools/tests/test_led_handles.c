@@ -0,0 +1,393 @@
+/*
+ * test_led_handles.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of the LED handles of led_proc, built from the repository root as a debug build, which checks every
+ * handle, and again as a release build, which trusts them:
+ *
+ *	gcc -O2 -Wno-cpp -DLED_PROC_CHECK_HANDLES=1 -Itools/sim -Ilib -o test_led_handles tools/tests/test_led_handles.c lib/led_proc.c
+ *	gcc -O2 -Wno-cpp -Itools/sim -Ilib -o test_led_handles tools/tests/test_led_handles.c lib/led_proc.c
+ *	./test_led_handles [-b]
+ *
+ *	-b	also time an LED call by place with no bounds check, by place checked on every call, and by handle
+ *
+ * Two boards get the same random calls, one by place in the array and one by handle, and must drive the same pins
+ * and duty cycles.  Handles are only issued for an LED in range and of the right type, and the tag in them is never 0,
+ * only comes back after 255 inits and mostly differs between instances.  In a debug build a handle
+ * from before the last init, from the other board, or made up from a real one by changing any of its fields must
+ * be turned down without reaching the HAL, and of a million random handles only the real ones may get through.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "led_proc.h"
+
+#define TEST_NUM_LEDS			24		// every fourth is PWM
+#define LED_TEST_BOARD_LEDS		TEST_NUM_LEDS
+#include "led_test.h"
+
+#define TEST_NUM_BOARDS			2
+#define TEST_OPS				200000
+#define TEST_FORGERIES			1000000
+#define TEST_NUM_INSTANCES		64
+#define TEST_TAG_INITS			1000
+#define TEST_BENCH_CALLS		50000000
+
+typedef enum TEST_BOARDS {
+	TEST_BOARD_NUM,				// driven by place in the array
+	TEST_BOARD_HANDLE			// driven by handle
+}test_board_kind_t;
+
+typedef struct test_board_t {
+	led_test_board_t hal;
+	led_output_handle_t outputs[TEST_NUM_LEDS];		// 0 for a PWM LED
+	led_pwm_handle_t pwms[TEST_NUM_LEDS];			// 0 for an output LED
+}test_board_t;
+
+static test_board_t test_boards[TEST_NUM_BOARDS];
+
+// a new init, which also issues every handle again, and the old ones go stale
+static void init_test_board(test_board_t * board)
+{
+	unsigned char tag = board->hal.proc.led_handle_tag;
+
+	// the same instance inited again, which carries on from its last tag
+	setup_led_test_board(&board->hal, TEST_NUM_LEDS);
+	board->hal.proc.led_handle_tag = tag;
+	board->hal.proc.led_set_compare = set_led_test_compare;
+	for (int i = 3; i < TEST_NUM_LEDS; i += 4)
+		set_led_test_pwm(&board->hal, i, &board->hal.pwm_states[i]);
+	LED_CHECK_EQ(init_led_proc(&board->hal.proc, board->hal.leds, TEST_NUM_LEDS), LED_PROC_ERROR_TYPE_NONE);
+
+	memset(board->outputs, 0, sizeof(board->outputs));
+	memset(board->pwms, 0, sizeof(board->pwms));
+	for (int i = 0; i < TEST_NUM_LEDS; i++)
+	{
+		if (board->hal.leds[i].led_type == LED_TYPE_OUTPUT)
+			LED_CHECK_EQ(get_led_output_handle(&board->hal.proc, i, &board->outputs[i]), LED_PROC_ERROR_TYPE_NONE);
+		else
+			LED_CHECK_EQ(get_led_pwm_handle(&board->hal.proc, i, &board->pwms[i]), LED_PROC_ERROR_TYPE_NONE);
+	}
+	board->hal.hal_writes = 0;
+}
+
+// handles are only issued for an LED that is there and of the type asked for
+static void test_handles_issue(void)
+{
+	test_board_t * board = &test_boards[TEST_BOARD_NUM];
+	led_output_handle_t output;
+	led_pwm_handle_t pwm;
+
+	init_test_board(board);
+	LED_CHECK_EQ(get_led_output_handle(&board->hal.proc, -1, &output), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(get_led_output_handle(&board->hal.proc, TEST_NUM_LEDS, &output), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(get_led_pwm_handle(&board->hal.proc, -1, &pwm), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(get_led_pwm_handle(&board->hal.proc, TEST_NUM_LEDS, &pwm), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(get_led_output_handle(&board->hal.proc, 3, &output), LED_PROC_ERROR_TYPE_WRONG_TYPE);
+	LED_CHECK_EQ(get_led_pwm_handle(&board->hal.proc, 0, &pwm), LED_PROC_ERROR_TYPE_WRONG_TYPE);
+	LED_CHECK_EQ(get_led_output_handle(NULL, 0, &output), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(get_led_output_handle(&board->hal.proc, 0, NULL), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(get_led_pwm_handle(&board->hal.proc, 3, NULL), LED_PROC_ERROR_TYPE_NULL);
+	board->hal.leds[3].led_pwm_state = NULL;
+	LED_CHECK_EQ(get_led_pwm_handle(&board->hal.proc, 3, &pwm), LED_PROC_ERROR_TYPE_NULL);
+	board->hal.leds[3].led_pwm_state = &board->hal.pwm_states[3];
+
+	// every LED has a handle of its own, and none is 0
+	for (int i = 0; i < TEST_NUM_LEDS; i++)
+	{
+		unsigned int handle = board->outputs[i].handle | board->pwms[i].handle;
+
+		LED_CHECK(handle != 0);
+		for (int j = 0; j < i; j++)
+			LED_CHECK(handle != (board->outputs[j].handle | board->pwms[j].handle));
+	}
+	LED_CHECK_EQ(board->hal.hal_writes, 0);
+}
+
+// the tag of an instance is never 0 and only comes back after 255 inits, and instances started from zeroed
+// memory mostly get different tags
+static void test_handles_tags(void)
+{
+	test_board_t * board = &test_boards[TEST_BOARD_NUM];
+	static struct led_proc_t instances[TEST_NUM_INSTANCES];
+	int last_init[256];
+	int shortest = TEST_TAG_INITS;
+	int distinct = 0;
+
+	for (int t = 0; t < 256; t++)
+		last_init[t] = -1;
+	for (int init = 0; init < TEST_TAG_INITS; init++)
+	{
+		unsigned char tag;
+
+		init_test_board(board);
+		tag = board->hal.proc.led_handle_tag;
+		if (!LED_CHECK(tag != 0))
+			return;
+		if (last_init[tag] >= 0 && init - last_init[tag] < shortest)
+			shortest = init - last_init[tag];
+		last_init[tag] = init;
+	}
+	LED_CHECK_EQ(shortest, 255);
+
+	memset(last_init, 0, sizeof(last_init));
+	for (int i = 0; i < TEST_NUM_INSTANCES; i++)
+	{
+		instances[i] = board->hal.proc;
+		instances[i].led_handle_tag = 0;
+		LED_CHECK_EQ(init_led_proc(&instances[i], board->hal.leds, TEST_NUM_LEDS), LED_PROC_ERROR_TYPE_NONE);
+		if (last_init[instances[i].led_handle_tag]++ == 0)
+			distinct++;
+	}
+	LED_CHECK(distinct >= TEST_NUM_INSTANCES / 2);
+	printf("tags       a tag comes back after %d inits at the soonest, %d instances have %d tags\n", shortest,
+			TEST_NUM_INSTANCES, distinct);
+}
+
+// the same calls by place and by handle drive the LEDs the same
+static void test_handles_match(void)
+{
+	test_board_t * by_num = &test_boards[TEST_BOARD_NUM];
+	test_board_t * by_handle = &test_boards[TEST_BOARD_HANDLE];
+	unsigned int random = 47;
+
+	init_test_board(by_num);
+	init_test_board(by_handle);
+	for (int op = 0; op < TEST_OPS; op++)
+	{
+		int led_num = (int)(next_test_random(&random) % TEST_NUM_LEDS);
+		unsigned int choice = next_test_random(&random) % 3;
+		led_proc_error_type num_status;
+		led_proc_error_type handle_status;
+
+		if (by_num->hal.leds[led_num].led_type == LED_TYPE_PWM)
+		{
+			int pwm_dc = (int)(next_test_random(&random) % (LED_PWM_DUTY_MAX + 1));
+
+			if (choice == 0)
+			{
+				unsigned short brightness = (unsigned short)next_test_random(&random);
+
+				num_status = set_led_num_pwm_brightness(&by_num->hal.proc, led_num, brightness);
+				handle_status = set_led_handle_brightness(&by_handle->hal.proc, by_handle->pwms[led_num], brightness);
+				LED_CHECK_EQ(by_handle->hal.pwm_states[led_num].led_dither_target, by_num->hal.pwm_states[led_num].led_dither_target);
+			}
+			else
+			{
+				num_status = set_led_num_pwm_duty_cycle(&by_num->hal.proc, led_num, pwm_dc);
+				handle_status = set_led_handle_duty_cycle(&by_handle->hal.proc, by_handle->pwms[led_num], pwm_dc);
+			}
+		}
+		else if (choice == 0)
+		{
+			num_status = turn_led_num_on(&by_num->hal.proc, led_num);
+			handle_status = turn_led_handle_on(&by_handle->hal.proc, by_handle->outputs[led_num]);
+		}
+		else if (choice == 1)
+		{
+			num_status = turn_led_num_off(&by_num->hal.proc, led_num);
+			handle_status = turn_led_handle_off(&by_handle->hal.proc, by_handle->outputs[led_num]);
+		}
+		else
+		{
+			num_status = toggle_led_ensure(&by_num->hal.proc, &by_num->hal.leds[led_num]);
+			handle_status = toggle_led_handle(&by_handle->hal.proc, by_handle->outputs[led_num]);
+		}
+
+		LED_CHECK_EQ(num_status, LED_PROC_ERROR_TYPE_NONE);
+		LED_CHECK_EQ(handle_status, LED_PROC_ERROR_TYPE_NONE);
+		if (!LED_CHECK(memcmp(by_num->hal.pins, by_handle->hal.pins, sizeof(by_num->hal.pins)) == 0)
+				|| !LED_CHECK(memcmp(by_num->hal.duty, by_handle->hal.duty, sizeof(by_num->hal.duty)) == 0))
+		{
+			printf("the boards differ after op %d on LED %d\n", op, led_num);
+			return;
+		}
+		LED_CHECK_EQ(by_handle->hal.leds[led_num].led_output_state, by_num->hal.leds[led_num].led_output_state);
+	}
+}
+
+#if LED_PROC_CHECK_HANDLES
+// every call that takes a handle turns this one down, and nothing reaches the HAL
+static int check_test_rejected(test_board_t * board, unsigned int handle, const char * what)
+{
+	led_output_handle_t output = { handle };
+	led_pwm_handle_t pwm = { handle };
+	unsigned int hal_calls = board->hal.hal_writes;
+	int rejected = 1;
+
+	rejected &= LED_CHECK(turn_led_handle_on(&board->hal.proc, output) != LED_PROC_ERROR_TYPE_NONE);
+	rejected &= LED_CHECK(turn_led_handle_off(&board->hal.proc, output) != LED_PROC_ERROR_TYPE_NONE);
+	rejected &= LED_CHECK(toggle_led_handle(&board->hal.proc, output) != LED_PROC_ERROR_TYPE_NONE);
+	rejected &= LED_CHECK(set_led_handle_duty_cycle(&board->hal.proc, pwm, 50) != LED_PROC_ERROR_TYPE_NONE);
+	rejected &= LED_CHECK(set_led_handle_brightness(&board->hal.proc, pwm, 0x8000) != LED_PROC_ERROR_TYPE_NONE);
+	rejected &= LED_CHECK_EQ(board->hal.hal_writes, hal_calls);
+	if (!rejected)
+		printf("%s handle 0x%08X was taken\n", what, handle);
+	return rejected;
+}
+
+// a real handle takes the calls of its own type and no others
+static void check_test_accepted(test_board_t * board, int led_num)
+{
+	if (board->hal.leds[led_num].led_type == LED_TYPE_OUTPUT)
+	{
+		led_pwm_handle_t pwm = { board->outputs[led_num].handle };
+
+		LED_CHECK_EQ(toggle_led_handle(&board->hal.proc, board->outputs[led_num]), LED_PROC_ERROR_TYPE_NONE);
+		LED_CHECK_EQ(set_led_handle_duty_cycle(&board->hal.proc, pwm, 50), LED_PROC_ERROR_TYPE_WRONG_TYPE);
+	}
+	else
+	{
+		led_output_handle_t output = { board->pwms[led_num].handle };
+
+		LED_CHECK_EQ(set_led_handle_duty_cycle(&board->hal.proc, board->pwms[led_num], 50), LED_PROC_ERROR_TYPE_NONE);
+		LED_CHECK_EQ(turn_led_handle_on(&board->hal.proc, output), LED_PROC_ERROR_TYPE_WRONG_TYPE);
+	}
+}
+
+// stale, foreign and forged handles are caught by a debug build
+static void test_handles_checked(void)
+{
+	test_board_t * board = &test_boards[TEST_BOARD_NUM];
+	test_board_t * other = &test_boards[TEST_BOARD_HANDLE];
+	unsigned int stale[TEST_NUM_LEDS];
+	unsigned int random = 4747;
+	unsigned int accepted = 0;
+
+	init_test_board(board);
+	init_test_board(other);
+	for (int i = 0; i < TEST_NUM_LEDS; i++)
+	{
+		check_test_accepted(board, i);
+		stale[i] = board->outputs[i].handle | board->pwms[i].handle;
+	}
+
+	// from the other board, and from before an init
+	for (int i = 0; i < TEST_NUM_LEDS; i++)
+		check_test_rejected(board, other->outputs[i].handle | other->pwms[i].handle, "foreign");
+	for (int init = 0; init < 300; init++)
+	{
+		init_test_board(board);
+		for (int i = 0; i < TEST_NUM_LEDS; i++)
+		{
+			// the tag is 8 bits, so one init in a few hundred can bring an old one back
+			if (stale[i] != (board->outputs[i].handle | board->pwms[i].handle) && !check_test_rejected(board, stale[i], "stale"))
+				return;
+		}
+	}
+
+	// a real handle with any one field changed
+	for (int i = 0; i < TEST_NUM_LEDS; i++)
+	{
+		unsigned int handle = board->outputs[i].handle | board->pwms[i].handle;
+
+		for (unsigned int tag = 0; tag < 256; tag++)
+		{
+			if (tag != handle >> 24)
+				check_test_rejected(board, (handle & 0xFFFFFF) | (tag << 24), "retagged");
+		}
+		for (unsigned int type = 0; type < 256; type++)
+		{
+			if (type != ((handle >> 16) & 0xFF))
+				check_test_rejected(board, (handle & 0xFF00FFFF) | (type << 16), "retyped");
+		}
+		for (unsigned int led_num = TEST_NUM_LEDS; led_num <= 0xFFFF; led_num += 97)
+			check_test_rejected(board, (handle & 0xFFFF0000) | led_num, "out of range");
+	}
+	check_test_rejected(board, 0, "zeroed");
+
+	// made up from nothing, only a value that is a real handle gets through
+	for (int f = 0; f < TEST_FORGERIES; f++)
+	{
+		unsigned int handle = next_test_random(&random) | (next_test_random(&random) << 16);
+		int real = 0;
+
+		if (f % 4 == 0)
+			handle = (handle & 0xFF00001F) | ((unsigned int)board->hal.proc.led_handle_tag << 24);
+		for (int i = 0; i < TEST_NUM_LEDS; i++)
+			real |= (handle == (board->outputs[i].handle | board->pwms[i].handle));
+		if (real)
+			accepted++;
+		else if (!check_test_rejected(board, handle, "forged"))
+			return;
+	}
+	printf("forged     %d random handles, %u of them real\n", TEST_FORGERIES, accepted);
+}
+#endif
+
+// an LED call by place with the checks the handles were brought in to save
+static led_proc_error_type turn_test_led_num_on_checked(struct led_proc_t * led_proc, int led_num_in_array)
+{
+	if (led_proc == NULL || led_proc->led_array == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (led_num_in_array < 0 || led_num_in_array >= led_proc->num_leds)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	return turn_led_num_on(led_proc, led_num_in_array);
+}
+
+static led_proc_error_type set_test_led_num_duty_cycle_checked(struct led_proc_t * led_proc, int led_num_in_array, int pwm_dc)
+{
+	if (led_proc == NULL || led_proc->led_array == NULL)
+		return LED_PROC_ERROR_TYPE_NULL;
+	if (led_num_in_array < 0 || led_num_in_array >= led_proc->num_leds)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	return set_led_num_pwm_duty_cycle(led_proc, led_num_in_array, pwm_dc);
+}
+
+static void bench_led_handles(void)
+{
+	test_board_t * board = &test_boards[TEST_BOARD_NUM];
+	unsigned int failed = 0;
+	double start;
+	double times[2][3];
+
+	init_test_board(board);
+	start = get_test_seconds();
+	for (int n = 0; n < TEST_BENCH_CALLS; n++)
+		failed |= (turn_led_num_on(&board->hal.proc, (n & 3) == 3 ? 0 : n & 3) != LED_PROC_ERROR_TYPE_NONE);
+	times[0][0] = get_test_seconds() - start;
+	start = get_test_seconds();
+	for (int n = 0; n < TEST_BENCH_CALLS; n++)
+		failed |= (turn_test_led_num_on_checked(&board->hal.proc, (n & 3) == 3 ? 0 : n & 3) != LED_PROC_ERROR_TYPE_NONE);
+	times[0][1] = get_test_seconds() - start;
+	start = get_test_seconds();
+	for (int n = 0; n < TEST_BENCH_CALLS; n++)
+		failed |= (turn_led_handle_on(&board->hal.proc, board->outputs[(n & 3) == 3 ? 0 : n & 3]) != LED_PROC_ERROR_TYPE_NONE);
+	times[0][2] = get_test_seconds() - start;
+
+	start = get_test_seconds();
+	for (int n = 0; n < TEST_BENCH_CALLS; n++)
+		failed |= (set_led_num_pwm_duty_cycle(&board->hal.proc, 3 + 4 * (n & 3), n & 63) != LED_PROC_ERROR_TYPE_NONE);
+	times[1][0] = get_test_seconds() - start;
+	start = get_test_seconds();
+	for (int n = 0; n < TEST_BENCH_CALLS; n++)
+		failed |= (set_test_led_num_duty_cycle_checked(&board->hal.proc, 3 + 4 * (n & 3), n & 63) != LED_PROC_ERROR_TYPE_NONE);
+	times[1][1] = get_test_seconds() - start;
+	start = get_test_seconds();
+	for (int n = 0; n < TEST_BENCH_CALLS; n++)
+		failed |= (set_led_handle_duty_cycle(&board->hal.proc, board->pwms[3 + 4 * (n & 3)], n & 63) != LED_PROC_ERROR_TYPE_NONE);
+	times[1][2] = get_test_seconds() - start;
+	LED_CHECK_EQ(failed, 0);
+
+	printf("%-24s %12s %12s %12s\n", LED_PROC_CHECK_HANDLES ? "ns, debug build" : "ns, release build",
+			"unchecked", "checked", "handle");
+	printf("%-24s %12.2f %12.2f %12.2f\n", "turn an LED on", times[0][0] * 1e9 / TEST_BENCH_CALLS,
+			times[0][1] * 1e9 / TEST_BENCH_CALLS, times[0][2] * 1e9 / TEST_BENCH_CALLS);
+	printf("%-24s %12.2f %12.2f %12.2f\n", "set a duty cycle", times[1][0] * 1e9 / TEST_BENCH_CALLS,
+			times[1][1] * 1e9 / TEST_BENCH_CALLS, times[1][2] * 1e9 / TEST_BENCH_CALLS);
+}
+
+int main(int argc, char ** argv)
+{
+	test_handles_issue();
+	test_handles_tags();
+	test_handles_match();
+#if LED_PROC_CHECK_HANDLES
+	test_handles_checked();
+#endif
+
+	if (argc > 1 && strcmp(argv[1], "-b") == 0)
+		bench_led_handles();
+
+	return led_test_summary("test_led_handles");
+}
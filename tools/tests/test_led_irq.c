@@ -0,0 +1,213 @@
+/*
+ * test_led_irq.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host simulation of the interrupt governor of led_proc, built from the repository root:
+ *
+ *	gcc -O2 -Wno-cpp -Itools/sim -Ilib -o test_led_irq tools/tests/test_led_irq.c lib/led_proc.c
+ *	./test_led_irq
+ *
+ * A board with a PWM LED and three output LEDs runs idle, blinking and fading for TEST_SECONDS of virtual time, ms
+ * by ms, with a TEST_FRAME_HZ PWM frame interrupt and a TEST_TICK_MS tick interrupt that calls the dispatch.  Each
+ * scenario is run twice: before, with no led_set_frame_irq and led_set_tick_irq so both sources are left enabled as
+ * init_led used to, and after, with the hooks so led_proc turns each source on only while it has work.  The pins
+ * and PWM registers are recorded every ms and must be the same both ways, and the interrupts per second taken and
+ * useful are reported for each.
+ */
+#include <string.h>
+#include "led_proc.h"
+
+#define TEST_NUM_LEDS		4		// LED 0 is PWM, the rest outputs
+#define LED_TEST_BOARD_LEDS	TEST_NUM_LEDS
+#include "led_test.h"
+
+#define TEST_FRAME_HZ		1000
+#define TEST_TICK_MS		10
+#define TEST_SECONDS		60
+#define TEST_MS				(TEST_SECONDS * 1000)
+#define TEST_FADE_TICKS		200		// a fade up or down takes this many ticks
+
+typedef enum TEST_SCENARIOS {
+	TEST_IDLE,
+	TEST_BLINK,
+	TEST_FADE,
+	TEST_NUM_SCENARIOS
+}test_scenario_t;
+
+static const char * const test_scenario_names[TEST_NUM_SCENARIOS] = { "idle", "blinking", "fading" };
+
+// what the hardware holds at the end of a ms
+typedef struct test_regs_t {
+	unsigned short compare;
+	short duty;
+	unsigned char pins;
+}test_regs_t;
+
+typedef struct test_run_t {
+	unsigned int frame_irqs;		// taken by the simulated core
+	unsigned int tick_irqs;
+	led_irq_stats_t frame_stats;	// counted by led_proc
+	led_irq_stats_t tick_stats;
+	unsigned int edges;				// output pin changes
+}test_run_t;
+
+static led_test_board_t test_board;
+static led_proc_dispatch_t test_dispatch;
+static test_regs_t test_timeline[2][TEST_MS];
+static test_scenario_t test_scenario;
+static unsigned int test_fade_tick;
+
+// the board as the timeline keeps it
+static test_regs_t get_test_regs(void)
+{
+	test_regs_t regs;
+
+	memset(&regs, 0, sizeof(regs));
+	regs.compare = (unsigned short)test_board.compare[0];
+	regs.duty = (short)test_board.duty[0];
+	for (int i = 0; i < TEST_NUM_LEDS; i++)
+		regs.pins |= (unsigned char)(test_board.pins[i] << i);
+	return regs;
+}
+
+// the work of each scenario that is timed by the tick, a triangle fade or nothing at all
+static void run_test_tick(struct led_proc_t * led_proc)
+{
+	unsigned int phase;
+
+	if (test_scenario != TEST_FADE)
+	{
+		set_led_proc_tick_idle(led_proc);
+		return;
+	}
+
+	phase = test_fade_tick++ % (2 * TEST_FADE_TICKS);
+	if (phase > TEST_FADE_TICKS)
+		phase = 2 * TEST_FADE_TICKS - phase;
+	set_led_num_pwm_brightness(led_proc, 0, (unsigned short)(phase * LED_PWM_BRIGHTNESS_MAX / TEST_FADE_TICKS));
+}
+
+static void init_test_board(int governed)
+{
+	memset(&test_dispatch, 0, sizeof(test_dispatch));
+	setup_led_test_board(&test_board, TEST_NUM_LEDS);
+	test_board.proc.led_set_compare = set_led_test_compare;
+	test_board.proc.led_tick = run_test_tick;
+	test_board.proc.led_tick_period_ms = TEST_TICK_MS;
+	if (governed)
+	{
+		test_board.proc.led_set_frame_irq = set_led_test_frame_irq;
+		test_board.proc.led_set_tick_irq = set_led_test_tick_irq;
+	}
+	test_board.leds[0].led_type = LED_TYPE_PWM;
+	test_board.leds[0].led_pwm_state = &test_board.pwm_states[0];
+	get_led_pwm_timing(24000000, TEST_FRAME_HZ, 0, &test_board.pwm_states[0].led_pwm_timing);
+	led_test_tick_board = &test_board;
+
+	// left on until led_proc says otherwise, as init_led enabled the frame interrupt and started the timer
+	test_board.frame_irq = 1;
+	test_board.tick_irq = 1;
+	test_fade_tick = 0;
+	LED_CHECK_EQ(init_led_proc(&test_board.proc, test_board.leds, TEST_NUM_LEDS), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(register_led_proc_dispatch(&test_dispatch, &test_board.proc), LED_PROC_ERROR_TYPE_NONE);
+}
+
+static void run_test_scenario(test_scenario_t scenario, int governed, test_run_t * run)
+{
+	unsigned char pins;
+
+	test_scenario = scenario;
+	init_test_board(governed);
+	memset(run, 0, sizeof(*run));
+
+	LED_CHECK_EQ(turn_led_num_on(&test_board.proc, 3), LED_PROC_ERROR_TYPE_NONE);
+	if (scenario == TEST_FADE)
+		LED_CHECK_EQ(set_led_num_pwm_brightness(&test_board.proc, 0, 0), LED_PROC_ERROR_TYPE_NONE);
+	else
+		LED_CHECK_EQ(set_led_num_pwm_duty_cycle(&test_board.proc, 0, 40), LED_PROC_ERROR_TYPE_NONE);
+	if (scenario == TEST_BLINK)
+	{
+		LED_CHECK_EQ(blink_led_num(&test_board.proc, 1, 1000, 250), LED_PROC_ERROR_TYPE_NONE);
+		LED_CHECK_EQ(blink_led_num(&test_board.proc, 2, 600, 300), LED_PROC_ERROR_TYPE_NONE);
+	}
+
+	pins = get_test_regs().pins;
+	for (int ms = 1; ms <= TEST_MS; ms++)
+	{
+		if (test_board.frame_irq && ms % (1000 / TEST_FRAME_HZ) == 0)
+		{
+			run->frame_irqs++;
+			run_led_num_pwm_frame(&test_board.proc, 0);
+		}
+		if (test_board.tick_irq && ms % TEST_TICK_MS == 0)
+		{
+			run->tick_irqs++;
+			run_led_proc_dispatch(&test_dispatch, TEST_TICK_MS);
+		}
+		test_timeline[governed][ms - 1] = get_test_regs();
+		run->edges += (unsigned int)__builtin_popcount((unsigned int)(pins ^ test_timeline[governed][ms - 1].pins));
+		pins = test_timeline[governed][ms - 1].pins;
+	}
+	run->frame_stats = test_board.pwm_states[0].led_frame_stats;
+	run->tick_stats = test_board.proc.led_tick_stats;
+}
+
+static void test_irq_scenarios(void)
+{
+	test_run_t runs[TEST_NUM_SCENARIOS][2];
+
+	printf("%-10s %-8s %12s %12s %12s %12s\n", "scenario", "", "frames/s", "useful", "ticks/s", "useful");
+	for (int scenario = 0; scenario < TEST_NUM_SCENARIOS; scenario++)
+	{
+		for (int governed = 0; governed < 2; governed++)
+		{
+			test_run_t * run = &runs[scenario][governed];
+
+			run_test_scenario((test_scenario_t)scenario, governed, run);
+			LED_CHECK_EQ(run->frame_stats.irq_taken, run->frame_irqs);
+			LED_CHECK_EQ(run->tick_stats.irq_taken, run->tick_irqs);
+			printf("%-10s %-8s %12.1f %12.1f %12.1f %12.1f\n", test_scenario_names[scenario],
+					governed ? "after" : "before", (double)run->frame_irqs / TEST_SECONDS,
+					(double)run->frame_stats.irq_useful / TEST_SECONDS, (double)run->tick_irqs / TEST_SECONDS,
+					(double)run->tick_stats.irq_useful / TEST_SECONDS);
+		}
+
+		// the governor only drops interrupts that had nothing to do, what the LEDs show is the same ms for ms
+		for (int ms = 0; ms < TEST_MS; ms++)
+		{
+			if (!LED_CHECK(memcmp(&test_timeline[0][ms], &test_timeline[1][ms], sizeof(test_regs_t)) == 0))
+			{
+				printf("%s differs at %d ms\n", test_scenario_names[scenario], ms + 1);
+				break;
+			}
+		}
+		LED_CHECK(runs[scenario][1].frame_irqs <= runs[scenario][0].frame_irqs);
+		LED_CHECK(runs[scenario][1].tick_irqs <= runs[scenario][0].tick_irqs);
+		LED_CHECK_EQ(runs[scenario][1].frame_stats.irq_useful, runs[scenario][0].frame_stats.irq_useful);
+		LED_CHECK_EQ(runs[scenario][1].tick_stats.irq_useful, runs[scenario][0].tick_stats.irq_useful);
+	}
+
+	// before, both sources run flat out whatever the LEDs do
+	for (int scenario = 0; scenario < TEST_NUM_SCENARIOS; scenario++)
+	{
+		LED_CHECK_EQ(runs[scenario][0].frame_irqs, TEST_MS * TEST_FRAME_HZ / 1000);
+		LED_CHECK_EQ(runs[scenario][0].tick_irqs, TEST_MS / TEST_TICK_MS);
+	}
+
+	// after, steady LEDs take next to nothing, a blink from the tick keeps only the tick, a fade keeps both
+	LED_CHECK(runs[TEST_IDLE][1].frame_irqs + runs[TEST_IDLE][1].tick_irqs <= 2);
+	LED_CHECK(runs[TEST_BLINK][1].frame_irqs <= 1);
+	LED_CHECK_EQ(runs[TEST_BLINK][1].tick_irqs, TEST_MS / TEST_TICK_MS);
+	LED_CHECK_EQ(runs[TEST_BLINK][1].edges, 2 * TEST_SECONDS + 2 * TEST_MS / 600);
+	LED_CHECK_EQ(runs[TEST_FADE][1].tick_irqs, TEST_MS / TEST_TICK_MS);
+	// a dithered frame that writes the same compare as the one before is taken but not useful
+	LED_CHECK(runs[TEST_FADE][1].frame_stats.irq_useful * 2 >= runs[TEST_FADE][1].frame_irqs);
+}
+
+int main(int argc, char ** argv)
+{
+	test_irq_scenarios();
+
+	return led_test_summary("test_led_irq");
+}
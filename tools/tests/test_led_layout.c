@@ -0,0 +1,281 @@
+/*
+ * test_led_layout.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of the compact led_t, with the PWM state in a side table that only the PWM LEDs point into, built from
+ * the repository root:
+ *
+ *	gcc -O2 -Wno-cpp -Itools/sim -Ilib -o test_led_layout tools/tests/test_led_layout.c lib/led_proc.c
+ *	./test_led_layout [-b]
+ *
+ *	-b	also report the bytes per LED of a TEST_NUM_LEDS panel, and the time to walk it, against the led_t that
+ *		held a union of the output state and the whole led_pwm_state_t
+ *
+ * The panel is mostly output LEDs with a PWM LED every TEST_PWM_EVERY, the way a large panel of indicators with a
+ * few dimmable backlights would be.  Every op is checked against a model of the pins, duty cycles and side table.
+ */
+#include <string.h>
+#include "led_proc.h"
+
+#define TEST_NUM_LEDS		500
+#define LED_TEST_BOARD_LEDS	TEST_NUM_LEDS
+#include "led_test.h"
+
+#define TEST_PWM_EVERY		8
+#define TEST_NUM_PWM		((TEST_NUM_LEDS + TEST_PWM_EVERY - 1) / TEST_PWM_EVERY)
+#define TEST_WORDS			LED_PROC_MASK_WORDS(TEST_NUM_LEDS)
+#define TEST_RUNS			20000
+#define TEST_BENCH_WALKS	20000
+
+// the led_t before the side table, as it first shipped.  Every LED carried the PWM state whether it used it or not,
+// 24 bytes on the TLS8258
+typedef struct test_old_pwm_state_t {
+	int led_pwm_hertz;
+	int led_duty_cycle;
+	void * led_pwm_info;
+}test_old_pwm_state_t;
+
+typedef struct test_old_led_t {
+	GPIO_PinTypeDef led_ptr;
+	led_type_t led_type;
+	union {
+		led_output_state_t led_output_state;
+		test_old_pwm_state_t led_pwm_state;
+	}led_state;
+	int led_pwm_hertz;
+}test_old_led_t;
+
+// the side table is packed at the front of test_board.pwm_states, TEST_NUM_PWM long
+static led_test_board_t test_board;
+static int test_model_on[TEST_NUM_LEDS];
+static int test_model_duty[TEST_NUM_LEDS];
+
+static int is_test_pwm(int led_num)
+{
+	return led_num % TEST_PWM_EVERY == 0;
+}
+
+static led_proc_error_type verify_test_outputs(led_t leds[], int num_leds, unsigned int mismatch[])
+{
+	for (int i = 0; i < num_leds; i++)
+	{
+		if (leds[i].led_type == LED_TYPE_OUTPUT && test_board.pins[i] != (leds[i].led_output_state == LED_ON))
+			mismatch[LED_PROC_MASK_WORD(i)] |= LED_PROC_MASK_BIT(i);
+	}
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static void init_test_panel(void)
+{
+	setup_led_test_board(&test_board, TEST_NUM_LEDS);
+	memset(test_model_on, 0, sizeof(test_model_on));
+	memset(test_model_duty, 0, sizeof(test_model_duty));
+	test_board.proc.led_verify_outputs = verify_test_outputs;
+	for (int i = 0; i < TEST_NUM_LEDS; i++)
+	{
+		test_board.leds[i].led_ptr = (GPIO_PinTypeDef)(((i / 8) << 8) | (1 << (i % 8)));
+		if (is_test_pwm(i))
+			set_led_test_pwm(&test_board, i, &test_board.pwm_states[i / TEST_PWM_EVERY]);
+	}
+	LED_CHECK_EQ(init_led_proc(&test_board.proc, test_board.leds, TEST_NUM_LEDS), LED_PROC_ERROR_TYPE_NONE);
+}
+
+// the pins, duty cycles and side table against the model, and nothing written where it does not belong
+static int check_test_panel(void)
+{
+	unsigned int mismatch[TEST_WORDS];
+
+	for (int i = 0; i < TEST_NUM_LEDS; i++)
+	{
+		if (is_test_pwm(i))
+		{
+			if (!LED_CHECK_EQ(test_board.leds[i].led_pwm_state, &test_board.pwm_states[i / TEST_PWM_EVERY])
+					|| !LED_CHECK_EQ(test_board.pwm_states[i / TEST_PWM_EVERY].led_duty_cycle, test_model_duty[i])
+					|| !LED_CHECK_EQ(test_board.duty[i], test_model_duty[i]) || !LED_CHECK_EQ(test_board.pins[i], 0))
+				return 0;
+		}
+		else
+		{
+			if (!LED_CHECK_EQ(test_board.leds[i].led_pwm_state, NULL) || !LED_CHECK_EQ(test_board.duty[i], 0)
+					|| !LED_CHECK_EQ(test_board.pins[i], test_model_on[i])
+					|| !LED_CHECK_EQ(test_board.leds[i].led_output_state, test_model_on[i] ? LED_ON : LED_OFF))
+				return 0;
+		}
+	}
+	return LED_CHECK_EQ(verify_led_outputs(&test_board.proc, mismatch, TEST_WORDS), LED_PROC_ERROR_TYPE_NONE);
+}
+
+// random single, list and mask ops over the panel, each one checked against the model
+static void test_layout_random(void)
+{
+	unsigned int random = 39;
+
+	init_test_panel();
+	for (int run = 0; run < TEST_RUNS; run++)
+	{
+		int led_num = (int)(next_test_random(&random) % TEST_NUM_LEDS);
+		unsigned int mask[TEST_WORDS];
+		unsigned int failed[TEST_WORDS];
+
+		switch (next_test_random(&random) % 4)
+		{
+		case 0:
+			if (is_test_pwm(led_num))
+			{
+				int pwm_dc = (int)(next_test_random(&random) % (LED_PWM_DUTY_MAX + 1));
+				LED_CHECK_EQ(set_led_num_pwm_duty_cycle(&test_board.proc, led_num, pwm_dc), LED_PROC_ERROR_TYPE_NONE);
+				test_model_duty[led_num] = pwm_dc;
+			}
+			else
+			{
+				LED_CHECK_EQ(set_led_num_pwm_duty_cycle(&test_board.proc, led_num, 50), LED_PROC_ERROR_TYPE_WRONG_TYPE);
+			}
+			break;
+		case 1:
+			if (is_test_pwm(led_num))
+				break;
+			if (next_test_random(&random) % 2)
+				LED_CHECK_EQ(turn_led_num_on(&test_board.proc, led_num), LED_PROC_ERROR_TYPE_NONE);
+			else
+				LED_CHECK_EQ(turn_led_num_off(&test_board.proc, led_num), LED_PROC_ERROR_TYPE_NONE);
+			test_model_on[led_num] = test_board.leds[led_num].led_output_state == LED_ON;
+			break;
+		case 2:
+			if (is_test_pwm(led_num))
+				break;
+			LED_CHECK_EQ(toggle_led_num_ensure(&test_board.proc, led_num), LED_PROC_ERROR_TYPE_NONE);
+			test_model_on[led_num] = !test_model_on[led_num];
+			break;
+		default:
+			// a random mask of the output LEDs
+			for (int w = 0; w < TEST_WORDS; w++)
+			{
+				mask[w] = (next_test_random(&random) << 16) ^ next_test_random(&random);
+				if (w == TEST_WORDS - 1 && TEST_NUM_LEDS % 32 != 0)
+					mask[w] &= (1u << (TEST_NUM_LEDS % 32)) - 1;
+			}
+			for (int i = 0; i < TEST_NUM_LEDS; i++)
+			{
+				if (is_test_pwm(i))
+					mask[LED_PROC_MASK_WORD(i)] &= ~LED_PROC_MASK_BIT(i);
+			}
+			LED_CHECK_EQ(toggle_leds_mask(&test_board.proc, mask, failed, TEST_WORDS), LED_PROC_ERROR_TYPE_NONE);
+			for (int i = 0; i < TEST_NUM_LEDS; i++)
+			{
+				if (mask[LED_PROC_MASK_WORD(i)] & LED_PROC_MASK_BIT(i))
+					test_model_on[i] = !test_model_on[i];
+			}
+			break;
+		}
+		if (!check_test_panel())
+		{
+			printf("after run %d\n", run);
+			return;
+		}
+	}
+}
+
+// an LED that says it is PWM but has no side table entry is turned away before the HAL can reach through it
+static void test_layout_errors(void)
+{
+	led_pwm_state_t * pwm_state;
+
+	init_test_panel();
+	test_board.proc.led_set_compare = set_led_test_compare;
+	LED_CHECK_EQ(set_led_num_pwm_brightness(&test_board.proc, 1, 0x8000), LED_PROC_ERROR_TYPE_WRONG_TYPE);
+	pwm_state = test_board.leds[0].led_pwm_state;
+	test_board.leds[0].led_pwm_state = NULL;
+	LED_CHECK_EQ(set_led_num_pwm_duty_cycle(&test_board.proc, 0, 50), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(set_led_num_pwm_brightness(&test_board.proc, 0, 0x8000), LED_PROC_ERROR_TYPE_NULL);
+	test_board.proc.led_set_compare = NULL;
+	LED_CHECK_EQ(init_led_proc_deferred(&test_board.proc, test_board.leds, TEST_NUM_LEDS), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(test_board.duty[0], 0);
+	test_board.leds[0].led_pwm_state = pwm_state;
+	LED_CHECK_EQ(init_led_proc_deferred(&test_board.proc, test_board.leds, TEST_NUM_LEDS), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(set_led_num_pwm_duty_cycle(&test_board.proc, 1, 50), LED_PROC_ERROR_TYPE_WRONG_TYPE);
+	LED_CHECK_EQ(test_board.duty[1], 0);
+	LED_CHECK(check_test_panel());
+}
+
+static void bench_led_layout(void)
+{
+	static test_old_led_t old_leds[TEST_NUM_LEDS];
+	unsigned int mask[TEST_WORDS];
+	unsigned int failed[TEST_WORDS];
+	volatile unsigned int sink = 0;
+	double start;
+	double old_walk;
+	double new_walk;
+	double toggle;
+	double verify;
+
+	init_test_panel();
+	memset(old_leds, 0, sizeof(old_leds));
+	for (int i = 0; i < TEST_NUM_LEDS; i++)
+	{
+		old_leds[i].led_ptr = test_board.leds[i].led_ptr;
+		old_leds[i].led_type = (led_type_t)test_board.leds[i].led_type;
+		test_board.leds[i].led_output_state = (unsigned char)((i % 3 == 0) ? LED_ON : LED_OFF);
+		if (!is_test_pwm(i))
+			old_leds[i].led_state.led_output_state = (led_output_state_t)test_board.leds[i].led_output_state;
+	}
+
+	// counting the LEDs that are on is the walk every panel wide op makes, the type and state of each LED
+	start = get_test_seconds();
+	for (int walk = 0; walk < TEST_BENCH_WALKS; walk++)
+	{
+		unsigned int on = 0;
+		for (int i = 0; i < TEST_NUM_LEDS; i++)
+			on += (old_leds[i].led_type == LED_TYPE_OUTPUT && old_leds[i].led_state.led_output_state == LED_ON);
+		sink += on;
+	}
+	old_walk = get_test_seconds() - start;
+
+	start = get_test_seconds();
+	for (int walk = 0; walk < TEST_BENCH_WALKS; walk++)
+	{
+		unsigned int on = 0;
+		for (int i = 0; i < TEST_NUM_LEDS; i++)
+			on += (test_board.leds[i].led_type == LED_TYPE_OUTPUT && test_board.leds[i].led_output_state == LED_ON);
+		sink += on;
+	}
+	new_walk = get_test_seconds() - start;
+
+	memset(mask, 0, sizeof(mask));
+	for (int i = 0; i < TEST_NUM_LEDS; i++)
+	{
+		if (!is_test_pwm(i))
+			mask[LED_PROC_MASK_WORD(i)] |= LED_PROC_MASK_BIT(i);
+	}
+	start = get_test_seconds();
+	for (int walk = 0; walk < TEST_BENCH_WALKS; walk++)
+		toggle_leds_mask(&test_board.proc, mask, failed, TEST_WORDS);
+	toggle = get_test_seconds() - start;
+
+	start = get_test_seconds();
+	for (int walk = 0; walk < TEST_BENCH_WALKS; walk++)
+		verify_led_outputs(&test_board.proc, failed, TEST_WORDS);
+	verify = get_test_seconds() - start;
+
+	printf("%d LEDs, %d of them PWM, on this host\n", TEST_NUM_LEDS, TEST_NUM_PWM);
+	printf("%-12s %10s %14s %14s\n", "led_t", "bytes", "bytes per LED", "ns per LED");
+	printf("%-12s %10d %14.1f %14.2f\n", "union", (int)sizeof(old_leds), (double)sizeof(old_leds) / TEST_NUM_LEDS,
+			old_walk * 1e9 / TEST_BENCH_WALKS / TEST_NUM_LEDS);
+	printf("%-12s %10d %14.1f %14.2f\n", "side table", (int)(sizeof(test_board.leds) + TEST_NUM_PWM * sizeof(led_pwm_state_t)),
+			(double)(sizeof(test_board.leds) + TEST_NUM_PWM * sizeof(led_pwm_state_t)) / TEST_NUM_LEDS,
+			new_walk * 1e9 / TEST_BENCH_WALKS / TEST_NUM_LEDS);
+	printf("toggle_leds_mask %.2f ns per LED, verify_led_outputs %.2f ns per LED, through the HAL\n",
+			toggle * 1e9 / TEST_BENCH_WALKS / TEST_NUM_LEDS, verify * 1e9 / TEST_BENCH_WALKS / TEST_NUM_LEDS);
+}
+
+int main(int argc, char ** argv)
+{
+	LED_CHECK(sizeof(led_t) < sizeof(test_old_led_t));
+	test_layout_random();
+	test_layout_errors();
+	if (argc > 1 && strcmp(argv[1], "-b") == 0)
+		bench_led_layout();
+
+	return led_test_summary("test_led_layout");
+}
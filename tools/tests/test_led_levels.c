@@ -0,0 +1,440 @@
+/*
+ * test_led_levels.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of the master and group levels of led_proc, built from the repository root:
+ *
+ *	gcc -O2 -Wno-cpp -Itools/sim -Ilib -o test_led_levels tools/tests/test_led_levels.c lib/led_proc.c
+ *	./test_led_levels [-b]
+ *
+ *	-b	also time a dimmer change against setting every duty cycle, for TEST_BENCH_MIN_LEDS to TEST_MAX_LEDS LEDs
+ *
+ * A board has TEST_NUM_PWM PWM LEDs over the LED_PROC_MAX_GROUPS groups, every third one on an inverted pin that is
+ * lit for LED_PWM_DUTY_MAX less its duty cycle, and output LEDs after them.  Random duty cycles, outputs and master
+ * and group levels are set, and a dispatch tick follows each.  Setting a level must not reach the HAL, the tick must
+ * rewrite only the PWM LEDs of the groups it touched, and the lit part of every duty cycle must then be a model of
+ * the levels applied to the lit part that was set.  Then a fade steps two brightnesses from the main loop while an
+ * ambient light sensor moves the levels, and every frame must light the fade brightness scaled by the levels in
+ * effect, with the fade never seeing its own brightness dimmed.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "led_proc.h"
+
+#define TEST_NUM_PWM			12
+#define TEST_NUM_LEDS			16		// outputs after the PWM LEDs
+#define TEST_MAX_LEDS			4096
+#define LED_TEST_BOARD_LEDS		TEST_MAX_LEDS
+#include "led_test.h"
+
+#define TEST_BENCH_MIN_LEDS		16
+#define TEST_CLOCK_HZ			24000000
+#define TEST_PWM_HERTZ			1000
+#define TEST_RETUNE_HERTZ		2000
+#define TEST_TICK_MS			10
+#define TEST_FADE_MS			5		// a fade step of the main loop, as run_led_loop does
+#define TEST_FADE_STEP			331
+#define TEST_FADE_LEDS			2		// LED 0 and LED 2, which is inverted
+#define TEST_OPS				50000
+#define TEST_FADE_SECONDS		600
+#define TEST_BENCH_ROUNDS		2000
+
+// the compare register holds lit counts, a HAL of an inverted pin writes the rest
+static led_test_board_t test_board;
+static led_proc_dispatch_t test_dispatch;
+
+// the model of the levels, kept as what was set
+static unsigned int test_master;
+static unsigned int test_groups[LED_PROC_MAX_GROUPS];
+
+static void run_test_tick(struct led_proc_t * led_proc)
+{
+	set_led_proc_tick_idle(led_proc);
+}
+
+static void init_test_board(int num_leds, int num_pwm)
+{
+	memset(&test_dispatch, 0, sizeof(test_dispatch));
+	setup_led_test_board(&test_board, num_leds);
+	test_board.proc.led_set_compare = set_led_test_compare;
+	test_board.proc.led_set_cycles = set_led_test_cycles;
+	test_board.proc.led_set_frame_irq = set_led_test_frame_irq;
+	test_board.proc.led_set_tick_irq = set_led_test_tick_irq;
+	test_board.proc.led_tick = run_test_tick;
+	test_board.proc.led_tick_period_ms = TEST_TICK_MS;
+	led_test_tick_board = &test_board;
+	for (int i = 0; i < num_pwm; i++)
+	{
+		set_led_test_pwm(&test_board, i, &test_board.pwm_states[i]);
+		test_board.pwm_states[i].led_group = (unsigned char)(i % LED_PROC_MAX_GROUPS);
+		test_board.pwm_states[i].led_duty_inverted = (i % 3 == 2);
+		get_led_pwm_timing(TEST_CLOCK_HZ, TEST_PWM_HERTZ, 0, &test_board.pwm_states[i].led_pwm_timing);
+	}
+	test_master = LED_PROC_LEVEL_FULL;
+	for (int g = 0; g < LED_PROC_MAX_GROUPS; g++)
+		test_groups[g] = LED_PROC_LEVEL_FULL;
+	LED_CHECK_EQ(init_led_proc(&test_board.proc, test_board.leds, num_leds), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(register_led_proc_dispatch(&test_dispatch, &test_board.proc), LED_PROC_ERROR_TYPE_NONE);
+	memset(test_board.duty_writes, 0, sizeof(test_board.duty_writes));
+	test_board.hal_writes = 0;
+}
+
+static unsigned int get_test_scale(int led_num)
+{
+	return (test_master * test_groups[test_board.pwm_states[led_num].led_group] + LED_PROC_LEVEL_FULL / 2) >> LED_PROC_LEVEL_SHIFT;
+}
+
+static unsigned int scale_test_level(unsigned int value, unsigned int scale)
+{
+	return (value * scale + LED_PROC_LEVEL_FULL / 2) >> LED_PROC_LEVEL_SHIFT;
+}
+
+// the part of the frame the LED is lit for, from a duty cycle in the convention of its pin
+static int get_test_lit(int led_num, int pwm_dc)
+{
+	return test_board.pwm_states[led_num].led_duty_inverted ? LED_PWM_DUTY_MAX - pwm_dc : pwm_dc;
+}
+
+static unsigned int get_test_level(unsigned int * random)
+{
+	switch (next_test_random(random) % 8)
+	{
+	case 0:
+		return 0;
+	case 1:
+		return LED_PROC_LEVEL_FULL;
+	default:
+		return next_test_random(random) % (LED_PROC_LEVEL_FULL + 1);
+	}
+}
+
+// every PWM LED lit for the duty cycle it was set to, scaled by the levels
+static int check_test_duties(const char * after)
+{
+	for (int i = 0; i < TEST_NUM_PWM; i++)
+	{
+		int lit = get_test_lit(i, test_board.pwm_states[i].led_duty_cycle);
+		int expected = (int)scale_test_level((unsigned int)lit, get_test_scale(i));
+
+		if (!LED_CHECK_EQ(get_test_lit(i, test_board.duty[i]), expected))
+		{
+			printf("LED %d of group %d%s lit for %d after %s, duty cycle %d at master %u group %u\n", i,
+					test_board.pwm_states[i].led_group, test_board.pwm_states[i].led_duty_inverted ? " inverted" : "",
+					get_test_lit(i, test_board.duty[i]), after, test_board.pwm_states[i].led_duty_cycle, test_master,
+					test_groups[test_board.pwm_states[i].led_group]);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// levels are constant time and reach the HAL only from the tick, and then only for the groups they touched
+static void test_levels_commit(void)
+{
+	unsigned int random = 45;
+	int duty_set[TEST_NUM_PWM];
+
+	init_test_board(TEST_NUM_LEDS, TEST_NUM_PWM);
+	for (int i = 0; i < TEST_NUM_PWM; i++)
+	{
+		duty_set[i] = (int)(next_test_random(&random) % (LED_PWM_DUTY_MAX + 1));
+		LED_CHECK_EQ(set_led_num_pwm_duty_cycle(&test_board.proc, i, duty_set[i]), LED_PROC_ERROR_TYPE_NONE);
+	}
+
+	for (int op = 0; op < TEST_OPS; op++)
+	{
+		unsigned int choice = next_test_random(&random) % 8;
+		unsigned int writes[TEST_NUM_LEDS];
+		unsigned int dirty = 0;
+		int pins[TEST_NUM_LEDS];
+		int led_num = (int)(next_test_random(&random) % TEST_NUM_PWM);
+		int group = (int)(next_test_random(&random) % LED_PROC_MAX_GROUPS);
+		unsigned int hal_calls = test_board.hal_writes;
+
+		memcpy(writes, test_board.duty_writes, sizeof(writes));
+		memcpy(pins, test_board.pins, sizeof(pins));
+		if (choice < 2)
+		{
+			test_master = get_test_level(&random);
+			test_board.tick_irq = 0;
+			LED_CHECK_EQ(set_led_proc_master_level(&test_board.proc, test_master), LED_PROC_ERROR_TYPE_NONE);
+			dirty = (1u << LED_PROC_MAX_GROUPS) - 1;
+		}
+		else if (choice < 5)
+		{
+			test_groups[group] = get_test_level(&random);
+			test_board.tick_irq = 0;
+			LED_CHECK_EQ(set_led_proc_group_level(&test_board.proc, group, test_groups[group]), LED_PROC_ERROR_TYPE_NONE);
+			dirty = 1u << group;
+		}
+		else if (choice < 7)
+		{
+			duty_set[led_num] = (int)(next_test_random(&random) % (LED_PWM_DUTY_MAX + 1));
+			LED_CHECK_EQ(set_led_num_pwm_duty_cycle(&test_board.proc, led_num, duty_set[led_num]), LED_PROC_ERROR_TYPE_NONE);
+			// written straight away at the levels as they are
+			LED_CHECK_EQ(test_board.duty_writes[led_num], writes[led_num] + 1);
+			check_test_duties("a duty cycle");
+			writes[led_num]++;
+		}
+		else
+		{
+			led_num = TEST_NUM_PWM + (int)(next_test_random(&random) % (TEST_NUM_LEDS - TEST_NUM_PWM));
+			pins[led_num] = !pins[led_num];
+			if (pins[led_num])
+				LED_CHECK_EQ(turn_led_num_on(&test_board.proc, led_num), LED_PROC_ERROR_TYPE_NONE);
+			else
+				LED_CHECK_EQ(turn_led_num_off(&test_board.proc, led_num), LED_PROC_ERROR_TYPE_NONE);
+		}
+
+		if (dirty != 0)
+		{
+			// nothing reaches the HAL until the tick, which is woken to do it
+			LED_CHECK_EQ(test_board.hal_writes, hal_calls);
+			LED_CHECK(test_board.tick_irq);
+			LED_CHECK((test_board.proc.led_levels_dirty & dirty) == dirty);
+		}
+		run_led_proc_dispatch(&test_dispatch, TEST_TICK_MS);
+		LED_CHECK_EQ(test_board.proc.led_levels_dirty, 0);
+
+		for (int i = 0; i < TEST_NUM_PWM; i++)
+		{
+			int rewritten = (dirty >> test_board.pwm_states[i].led_group) & 1;
+
+			LED_CHECK_EQ(test_board.duty_writes[i], writes[i] + (unsigned int)rewritten);
+			// the duty cycle is kept as it was set, at full scale
+			LED_CHECK_EQ(test_board.pwm_states[i].led_duty_cycle, duty_set[i]);
+		}
+		if (!check_test_duties((dirty != 0) ? "a level" : "a tick"))
+			return;
+		// outputs are on or off and never scaled
+		if (!LED_CHECK(memcmp(pins, test_board.pins, sizeof(pins)) == 0))
+			return;
+	}
+}
+
+// the lit part goes down with the level on either polarity of pin, and is off at level 0
+static void test_levels_inverted(void)
+{
+	init_test_board(TEST_NUM_LEDS, TEST_NUM_PWM);
+	for (int dc = 0; dc <= LED_PWM_DUTY_MAX; dc++)
+	{
+		int last_lit[TEST_NUM_PWM];
+
+		for (int i = 0; i < TEST_NUM_PWM; i++)
+			set_led_num_pwm_duty_cycle(&test_board.proc, i, dc);
+		for (int i = 0; i < TEST_NUM_PWM; i++)
+			last_lit[i] = get_test_lit(i, dc);
+		for (int level = LED_PROC_LEVEL_FULL; level >= 0; level -= 97)
+		{
+			test_master = (unsigned int)level;
+			set_led_proc_master_level(&test_board.proc, test_master);
+			commit_led_proc_levels(&test_board.proc);
+			for (int i = 0; i < TEST_NUM_PWM; i++)
+			{
+				int lit = get_test_lit(i, test_board.duty[i]);
+
+				if (!LED_CHECK(lit <= last_lit[i]) || !LED_CHECK(lit >= 0 && lit <= LED_PWM_DUTY_MAX))
+				{
+					printf("LED %d duty cycle %d lit for %d at level %d, %d above it\n", i, dc, lit, level, last_lit[i]);
+					return;
+				}
+				last_lit[i] = lit;
+			}
+		}
+		test_master = 0;
+		set_led_proc_master_level(&test_board.proc, 0);
+		commit_led_proc_levels(&test_board.proc);
+		for (int i = 0; i < TEST_NUM_PWM; i++)
+			LED_CHECK_EQ(get_test_lit(i, test_board.duty[i]), 0);
+		test_master = LED_PROC_LEVEL_FULL;
+		set_led_proc_master_level(&test_board.proc, test_master);
+		commit_led_proc_levels(&test_board.proc);
+		for (int i = 0; i < TEST_NUM_PWM; i++)
+			LED_CHECK_EQ(test_board.duty[i], dc);
+	}
+}
+
+// the lit counts of a frame at a brightness and scale, to within the one count of the dither
+static int check_test_frame(int led_num, unsigned short brightness, unsigned int scale, unsigned int ms)
+{
+	unsigned int cycles = test_board.pwm_states[led_num].led_pwm_timing.cycles;
+	unsigned int target = scale_test_level(brightness, scale) * cycles;
+
+	if (!LED_CHECK(test_board.compare[led_num] == target >> 16 || test_board.compare[led_num] == (target >> 16) + 1))
+	{
+		printf("LED %d lit for %u counts at %u ms, brightness %u at scale %u is %u\n", led_num, test_board.compare[led_num],
+				ms, brightness, scale, target >> 16);
+		return 0;
+	}
+	return 1;
+}
+
+// a fade of the main loop carries on under the dimmer, at the levels committed by the tick
+static void test_levels_fade(void)
+{
+	static const int fade_leds[TEST_FADE_LEDS] = { 0, 2 };
+	unsigned int random = 7;
+	int brightness[TEST_FADE_LEDS] = { 0, LED_PWM_BRIGHTNESS_MAX };
+	int step[TEST_FADE_LEDS] = { TEST_FADE_STEP, -TEST_FADE_STEP };
+	unsigned int scale[TEST_FADE_LEDS];			// in effect at the LED
+	unsigned int level_changes = 0;
+	unsigned int commits = 0;
+	led_pwm_timing_t retune;
+
+	init_test_board(TEST_NUM_LEDS, TEST_NUM_PWM);
+	get_led_pwm_timing(TEST_CLOCK_HZ, TEST_RETUNE_HERTZ, 0, &retune);
+	for (int f = 0; f < TEST_FADE_LEDS; f++)
+	{
+		set_led_num_pwm_brightness(&test_board.proc, fade_leds[f], (unsigned short)brightness[f]);
+		scale[f] = get_test_scale(fade_leds[f]);
+	}
+
+	for (unsigned int ms = 1; ms <= TEST_FADE_SECONDS * 1000; ms++)
+	{
+		// the frame interrupt, at TEST_PWM_HERTZ or after the retune twice that, which is taken here once a ms
+		for (int f = 0; f < TEST_FADE_LEDS; f++)
+		{
+			// a retune scales the brightness to the new period at the levels as they are
+			if (test_board.pwm_states[fade_leds[f]].led_pwm_retune.cycles != 0)
+				scale[f] = get_test_scale(fade_leds[f]);
+			run_led_num_pwm_frame(&test_board.proc, fade_leds[f]);
+			if (!check_test_frame(fade_leds[f], (unsigned short)brightness[f], scale[f], ms))
+				return;
+		}
+
+		// the tick, which commits levels that changed since the last one
+		if (ms % TEST_TICK_MS == 0)
+		{
+			unsigned int dirty = test_board.proc.led_levels_dirty;
+
+			if (dirty != 0)
+				commits++;
+			run_led_proc_dispatch(&test_dispatch, TEST_TICK_MS);
+			for (int f = 0; f < TEST_FADE_LEDS; f++)
+			{
+				if (dirty & (1u << test_board.pwm_states[fade_leds[f]].led_group))
+					scale[f] = get_test_scale(fade_leds[f]);
+			}
+		}
+
+		// the main loop, a fade step and now and then a new ambient light reading
+		if (ms % TEST_FADE_MS == 0)
+		{
+			for (int f = 0; f < TEST_FADE_LEDS; f++)
+			{
+				// the fade reads back its own brightness, which the dimmer must leave at full scale
+				if (!LED_CHECK_EQ(test_board.pwm_states[fade_leds[f]].led_brightness, brightness[f]))
+					return;
+				brightness[f] += step[f];
+				if (brightness[f] < 0 || brightness[f] > LED_PWM_BRIGHTNESS_MAX)
+				{
+					step[f] = -step[f];
+					brightness[f] += 2 * step[f];
+				}
+				set_led_num_pwm_brightness(&test_board.proc, fade_leds[f], (unsigned short)brightness[f]);
+				scale[f] = get_test_scale(fade_leds[f]);
+			}
+		}
+		if (next_test_random(&random) % 97 == 0)
+		{
+			if (next_test_random(&random) % 2)
+			{
+				test_master = get_test_level(&random);
+				set_led_proc_master_level(&test_board.proc, test_master);
+			}
+			else
+			{
+				int group = (int)(next_test_random(&random) % LED_PROC_MAX_GROUPS);
+
+				test_groups[group] = get_test_level(&random);
+				set_led_proc_group_level(&test_board.proc, group, test_groups[group]);
+			}
+			level_changes++;
+		}
+		if (ms == TEST_FADE_SECONDS * 500)
+			retune_led_num_pwm(&test_board.proc, fade_leds[0], &retune);
+	}
+	LED_CHECK_EQ(test_board.pwm_states[fade_leds[0]].led_pwm_timing.cycles, retune.cycles);
+	LED_CHECK(level_changes > 1000);
+	LED_CHECK(commits > 1000);
+	printf("fade       %u level changes in %d s, %u commits\n", level_changes, TEST_FADE_SECONDS, commits);
+}
+
+static void test_levels_errors(void)
+{
+	init_test_board(TEST_NUM_LEDS, TEST_NUM_PWM);
+	LED_CHECK_EQ(set_led_proc_master_level(NULL, 0), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(set_led_proc_master_level(&test_board.proc, LED_PROC_LEVEL_FULL + 1), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(set_led_proc_group_level(NULL, 0, 0), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(set_led_proc_group_level(&test_board.proc, -1, 0), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(set_led_proc_group_level(&test_board.proc, LED_PROC_MAX_GROUPS, 0), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(set_led_proc_group_level(&test_board.proc, 0, LED_PROC_LEVEL_FULL + 1), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(commit_led_proc_levels(NULL), LED_PROC_ERROR_TYPE_NULL);
+	// none of those left anything to commit
+	LED_CHECK_EQ(test_board.proc.led_levels_dirty, 0);
+	LED_CHECK_EQ(test_board.hal_writes, 0);
+}
+
+// a dimmer change by level and commit, against the duty cycle of every LED set again as before the levels
+static void bench_led_levels(void)
+{
+	int led_nums[TEST_MAX_LEDS];
+
+	for (int i = 0; i < TEST_MAX_LEDS; i++)
+		led_nums[i] = i;
+	printf("%6s %14s %14s %14s %14s\n", "leds", "ns set level", "ns commit", "ns group", "ns every duty");
+	for (int num_leds = TEST_BENCH_MIN_LEDS; num_leds <= TEST_MAX_LEDS; num_leds *= 4)
+	{
+		double start;
+		double set;
+		double commit;
+		double group;
+		double every;
+
+		init_test_board(num_leds, num_leds);
+		for (int i = 0; i < num_leds; i++)
+			set_led_num_pwm_duty_cycle(&test_board.proc, i, i % (LED_PWM_DUTY_MAX + 1));
+
+		start = get_test_seconds();
+		for (int r = 0; r < TEST_BENCH_ROUNDS * 100; r++)
+			set_led_proc_master_level(&test_board.proc, (unsigned int)r % LED_PROC_LEVEL_FULL);
+		set = (get_test_seconds() - start) / (TEST_BENCH_ROUNDS * 100);
+
+		start = get_test_seconds();
+		for (int r = 0; r < TEST_BENCH_ROUNDS; r++)
+		{
+			set_led_proc_master_level(&test_board.proc, (unsigned int)r % LED_PROC_LEVEL_FULL);
+			commit_led_proc_levels(&test_board.proc);
+		}
+		commit = (get_test_seconds() - start) / TEST_BENCH_ROUNDS;
+
+		start = get_test_seconds();
+		for (int r = 0; r < TEST_BENCH_ROUNDS; r++)
+		{
+			set_led_proc_group_level(&test_board.proc, r % LED_PROC_MAX_GROUPS, (unsigned int)r % LED_PROC_LEVEL_FULL);
+			commit_led_proc_levels(&test_board.proc);
+		}
+		group = (get_test_seconds() - start) / TEST_BENCH_ROUNDS;
+
+		start = get_test_seconds();
+		for (int r = 0; r < TEST_BENCH_ROUNDS; r++)
+			set_led_nums_pwm_duty_cycle(&test_board.proc, led_nums, r % (LED_PWM_DUTY_MAX + 1), num_leds);
+		every = (get_test_seconds() - start) / TEST_BENCH_ROUNDS;
+
+		printf("%6d %14.1f %14.1f %14.1f %14.1f\n", num_leds, set * 1e9, commit * 1e9, group * 1e9, every * 1e9);
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	test_levels_errors();
+	test_levels_commit();
+	test_levels_inverted();
+	test_levels_fade();
+
+	if (argc > 1 && strcmp(argv[1], "-b") == 0)
+		bench_led_levels();
+
+	return led_test_summary("test_led_levels");
+}
@@ -0,0 +1,501 @@
+/*
+ * test_led_masks.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of the mask calls of led_proc, on a host HAL and on the led_lib HAL of the virtual B85 of tools/sim,
+ * built from the repository root.  Add -DLED_PROC_HAS_CTZ=0 to test the plain C walk of the mask bits:
+ *
+ *	gcc -O2 -Wno-cpp -Itools/sim -Ilib -I. -o test_led_masks tools/tests/test_led_masks.c tools/sim/tl_sim.c \
+ *		tools/sim/tl_flash.c lib/led_lib.c lib/led_proc.c lib/led_store.c lib/led_color.c lib/button_proc.c \
+ *		lib/led_coro.c lib/led_pattern.c lib/led_trace.c
+ *	./test_led_masks [-b]
+ *
+ *	-b	also time the mask calls against the calls that take an array of places, for 4 to 1024 LEDs
+ *
+ * A board of output and PWM LEDs, some of whose pins fail in the HAL at random, gets random masks of every density,
+ * some with bits past the array and some shorter than the array.  Every LED selected must be handled, whatever
+ * failed before it, and the failed mask must be exactly the LEDs that are past the array, of the wrong type, or
+ * failed in the HAL, with the return the first of those.  This runs with LEDs driven one at a time and through a
+ * led_set_outputs hook.  On the virtual B85 the led_lib hook must leave every pin at its led_output_state, and its
+ * register accesses are reported against driving the LEDs one at a time.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "tl_sim.h"
+#include "tl_flash.h"
+#include "led_proc.h"
+
+#define TEST_NUM_LEDS			300		// every fifth is PWM, and the last word is part full
+#define TEST_NUM_WORDS			LED_PROC_MASK_WORDS(TEST_NUM_LEDS)
+#define TEST_NULL_PWM_LED		4		// a PWM LED with no led_pwm_state
+#define TEST_OPS				20000
+#define TEST_SIM_PORTS			5		// LED_GPIO_NUM_PORTS of led_lib.c
+#define TEST_SIM_LEDS			(TEST_SIM_PORTS * 8)
+#define TEST_SIM_OPS			50000
+#define TEST_BENCH_MAX_LEDS		1024
+#define LED_TEST_BOARD_LEDS		TEST_BENCH_MAX_LEDS
+#include "led_test.h"
+
+#define TEST_BENCH_SELECTED		2000000		// LEDs handled per timing
+
+enum TEST_MASK_OPS {
+	TEST_MASK_OP_ON,
+	TEST_MASK_OP_OFF,
+	TEST_MASK_OP_TOGGLE,
+	TEST_MASK_OP_DUTY,
+	TEST_MASK_NUM_OPS
+};
+
+// the HAL of led_lib.c, with the pins of the board here rather than bsp.h
+led_proc_error_type init_led(led_t * led);
+led_proc_error_type set_led_polarity(led_t * led, led_output_state_t state);
+led_proc_error_type set_led_duty_cycle(led_t * led, int pwm_dc);
+led_proc_error_type get_state_of_led(led_t * led, int * state);
+led_proc_error_type init_led_outputs(led_t * leds, int num_leds);
+led_proc_error_type set_led_output_pins(led_t * leds, int num_leds, unsigned int mask);
+unsigned int enter_led_critical(void);
+void exit_led_critical(unsigned int key);
+
+// the HAL fails the pin of an LED with LED_PROC_ERROR_TYPE_UNKNOWN in test_board.fail
+static led_test_board_t test_board;
+static unsigned int test_hook_calls;
+static unsigned int test_ops_failed;
+
+// a port that takes a word of LEDs in one write, and fails the whole write when any of its pins is broken
+static led_proc_error_type set_test_outputs(led_t * leds, int num_leds, unsigned int mask)
+{
+	int first = (int)(leds - test_board.leds);
+
+	// a word of the array at a time, and never an LED past it
+	test_hook_calls++;
+	LED_CHECK_EQ(first % 32, 0);
+	LED_CHECK_EQ(num_leds, (test_board.proc.num_leds - first < 32) ? test_board.proc.num_leds - first : 32);
+	LED_CHECK(num_leds == 32 || (mask >> num_leds) == 0);
+	for (int i = 0; i < num_leds && (mask >> i) != 0; i++)
+	{
+		if ((mask & (1u << i)) && test_board.fail[&leds[i] - test_board.leds])
+			return LED_PROC_ERROR_TYPE_UNKNOWN;
+	}
+	for (int i = 0; i < num_leds && (mask >> i) != 0; i++)
+	{
+		if (mask & (1u << i))
+			test_board.pins[&leds[i] - test_board.leds] = (leds[i].led_output_state == LED_ON);
+	}
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static void init_test_board(int num_leds, int pwm_every, int with_hook)
+{
+	setup_led_test_board(&test_board, num_leds);
+	test_board.proc.led_set_outputs = with_hook ? set_test_outputs : NULL;
+	for (int i = pwm_every - 1; pwm_every != 0 && i < num_leds; i += pwm_every)
+		set_led_test_pwm(&test_board, i, &test_board.pwm_states[i]);
+	LED_CHECK_EQ(init_led_proc(&test_board.proc, test_board.leds, num_leds), LED_PROC_ERROR_TYPE_NONE);
+	test_board.hal_writes = 0;
+	test_hook_calls = 0;
+}
+
+// a mask of about one LED in 2^density, with 0 for every LED
+static void make_test_mask(unsigned int * random, unsigned int density, unsigned int mask[], int num_words)
+{
+	for (int w = 0; w < num_words; w++)
+	{
+		mask[w] = 0;
+		for (int bit = 0; bit < 32; bit++)
+		{
+			if ((next_test_random(random) & ((1u << density) - 1)) == 0)
+				mask[w] |= 1u << bit;
+		}
+	}
+}
+
+// works out what a mask call must do, one LED at a time in the order of the mask, then checks the call did it
+static int check_test_mask_op(unsigned int * random, int op, int with_hook)
+{
+	unsigned int mask[TEST_NUM_WORDS + 1];
+	unsigned int failed[TEST_NUM_WORDS + 2];
+	unsigned int expected[TEST_NUM_WORDS + 1];
+	int states[TEST_NUM_LEDS];
+	int pins[TEST_NUM_LEDS];
+	int duty[TEST_NUM_LEDS];
+	int num_words = TEST_NUM_WORDS - 1 + (int)(next_test_random(random) % 3);
+	int pwm_dc = (int)(next_test_random(random) % (LED_PWM_DUTY_MAX + 1));
+	led_proc_error_type expected_status = LED_PROC_ERROR_TYPE_NONE;
+	led_proc_error_type status;
+
+	make_test_mask(random, next_test_random(random) % 6, mask, num_words);
+	// half the calls only select LEDs of the right type, and half of those only in the array, so the bits past it
+	// and the broken pins are also seen on their own
+	if (next_test_random(random) % 2 == 0)
+	{
+		int keep_past = (int)(next_test_random(random) % 2);
+
+		for (int w = 0; w < num_words; w++)
+		{
+			for (int bit = 0; bit < 32; bit++)
+			{
+				int i = w * 32 + bit;
+
+				if (i >= TEST_NUM_LEDS ? !keep_past : (test_board.leds[i].led_type == LED_TYPE_PWM) != (op == TEST_MASK_OP_DUTY))
+					mask[w] &= ~(1u << bit);
+			}
+		}
+	}
+	for (int i = 0; i < TEST_NUM_LEDS; i++)
+	{
+		states[i] = test_board.leds[i].led_output_state;
+		pins[i] = test_board.pins[i];
+		duty[i] = test_board.duty[i];
+	}
+
+	for (int w = 0; w < num_words; w++)
+	{
+		unsigned int driven = 0;
+		led_proc_error_type hook_status = LED_PROC_ERROR_TYPE_NONE;
+
+		expected[w] = 0;
+		// the bits past the array are reported before the LEDs of their word
+		if (w * 32 + 32 > TEST_NUM_LEDS && (mask[w] >> (w * 32 < TEST_NUM_LEDS ? TEST_NUM_LEDS - w * 32 : 0)) != 0
+				&& expected_status == LED_PROC_ERROR_TYPE_NONE)
+			expected_status = LED_PROC_ERROR_TYPE_BAD_STATE;
+		for (int bit = 0; bit < 32; bit++)
+		{
+			int i = w * 32 + bit;
+			led_proc_error_type led_status = LED_PROC_ERROR_TYPE_NONE;
+
+			if (!(mask[w] & (1u << bit)))
+				continue;
+			if (i >= TEST_NUM_LEDS)
+			{
+				expected[w] |= 1u << bit;
+				led_status = LED_PROC_ERROR_TYPE_BAD_STATE;
+			}
+			else if (op == TEST_MASK_OP_DUTY)
+			{
+				if (test_board.leds[i].led_type != LED_TYPE_PWM)
+					led_status = LED_PROC_ERROR_TYPE_WRONG_TYPE;
+				else if (test_board.leds[i].led_pwm_state == NULL)
+					led_status = LED_PROC_ERROR_TYPE_NULL;
+				else if (test_board.fail[i])
+					led_status = LED_PROC_ERROR_TYPE_UNKNOWN;
+				else
+					duty[i] = pwm_dc;
+			}
+			else if (test_board.leds[i].led_type != LED_TYPE_OUTPUT)
+				led_status = LED_PROC_ERROR_TYPE_WRONG_TYPE;
+			else
+			{
+				// the state is taken whether or not the pin can be driven
+				states[i] = (op == TEST_MASK_OP_TOGGLE) ? !states[i] : (op == TEST_MASK_OP_ON);
+				if (with_hook)
+				{
+					driven |= 1u << bit;
+					if (test_board.fail[i])
+						hook_status = LED_PROC_ERROR_TYPE_UNKNOWN;
+				}
+				else if (test_board.fail[i])
+					led_status = LED_PROC_ERROR_TYPE_UNKNOWN;
+				else
+					pins[i] = states[i];
+			}
+			if (led_status != LED_PROC_ERROR_TYPE_NONE)
+			{
+				expected[w] |= 1u << bit;
+				if (expected_status == LED_PROC_ERROR_TYPE_NONE)
+					expected_status = led_status;
+			}
+		}
+
+		// the hook takes the whole word, so a broken pin fails every LED it drives
+		if (hook_status != LED_PROC_ERROR_TYPE_NONE)
+		{
+			expected[w] |= driven;
+			if (expected_status == LED_PROC_ERROR_TYPE_NONE)
+				expected_status = hook_status;
+		}
+		else
+		{
+			for (int bit = 0; bit < 32; bit++)
+			{
+				if (driven & (1u << bit))
+					pins[w * 32 + bit] = states[w * 32 + bit];
+			}
+		}
+	}
+
+	if (expected_status != LED_PROC_ERROR_TYPE_NONE)
+		test_ops_failed++;
+	memset(failed, 0xA5, sizeof(failed));
+	if (op == TEST_MASK_OP_ON)
+		status = turn_leds_mask_on(&test_board.proc, mask, failed, num_words);
+	else if (op == TEST_MASK_OP_OFF)
+		status = turn_leds_mask_off(&test_board.proc, mask, failed, num_words);
+	else if (op == TEST_MASK_OP_TOGGLE)
+		status = toggle_leds_mask(&test_board.proc, mask, failed, num_words);
+	else
+		status = set_leds_mask_pwm_duty_cycle(&test_board.proc, mask, pwm_dc, failed, num_words);
+
+	for (int w = 0; w < num_words; w++)
+	{
+		if (!LED_CHECK_EQ(failed[w], expected[w]))
+		{
+			printf("op %d of %d words, word %d failed 0x%08X, expected 0x%08X of mask 0x%08X\n", op, num_words, w,
+					failed[w], expected[w], mask[w]);
+			return 0;
+		}
+	}
+	// nothing past the words it was given
+	LED_CHECK_EQ(failed[num_words], 0xA5A5A5A5);
+	if (!LED_CHECK_EQ(status, expected_status))
+		return 0;
+	for (int i = 0; i < TEST_NUM_LEDS; i++)
+	{
+		if (!LED_CHECK_EQ(test_board.leds[i].led_output_state, states[i]) || !LED_CHECK_EQ(test_board.pins[i], pins[i])
+				|| !LED_CHECK_EQ(test_board.duty[i], duty[i]))
+		{
+			printf("op %d, LED %d state %d pin %d duty %d, expected %d %d %d\n", op, i, test_board.leds[i].led_output_state,
+					test_board.pins[i], test_board.duty[i], states[i], pins[i], duty[i]);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// random masks against the model, with pins that break and mend as it goes
+static void test_masks_model(int with_hook)
+{
+	unsigned int random = with_hook ? 4848 : 48;
+
+	init_test_board(TEST_NUM_LEDS, 5, with_hook);
+	test_ops_failed = 0;
+	test_board.leds[TEST_NULL_PWM_LED].led_pwm_state = NULL;
+	for (int op = 0; op < TEST_OPS; op++)
+	{
+		int led_num = (int)(next_test_random(&random) % TEST_NUM_LEDS);
+
+		// a few pins are broken at any time
+		if (next_test_random(&random) % 4 == 0)
+			test_board.fail[led_num] = (next_test_random(&random) % 32 == 0) ? LED_PROC_ERROR_TYPE_UNKNOWN : 0;
+		if (!check_test_mask_op(&random, (int)(next_test_random(&random) % TEST_MASK_NUM_OPS), with_hook))
+		{
+			printf("at op %d %s the hook\n", op, with_hook ? "with" : "without");
+			return;
+		}
+	}
+	// many calls have something fail, and the rest of their LEDs must still be handled
+	LED_CHECK(test_ops_failed > TEST_OPS / 4);
+	LED_CHECK(TEST_OPS - test_ops_failed > TEST_OPS / 10);
+	LED_CHECK(with_hook ? test_hook_calls > 0 : test_hook_calls == 0);
+	printf("%-10s %u of %d mask calls had LEDs fail, %u hook calls\n", with_hook ? "hook" : "each", test_ops_failed,
+			TEST_OPS, test_hook_calls);
+}
+
+static void test_masks_errors(void)
+{
+	unsigned int mask[TEST_NUM_WORDS] = { 0 };
+	unsigned int failed[TEST_NUM_WORDS];
+
+	init_test_board(TEST_NUM_LEDS, 5, 0);
+	LED_CHECK_EQ(turn_leds_mask_on(NULL, mask, failed, TEST_NUM_WORDS), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(turn_leds_mask_off(&test_board.proc, NULL, failed, TEST_NUM_WORDS), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(toggle_leds_mask(&test_board.proc, NULL, NULL, TEST_NUM_WORDS), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(set_leds_mask_pwm_duty_cycle(NULL, mask, 50, failed, TEST_NUM_WORDS), LED_PROC_ERROR_TYPE_NULL);
+
+	// the failed mask is optional, and an empty mask does nothing
+	mask[0] = LED_PROC_MASK_BIT(0) | LED_PROC_MASK_BIT(1);
+	mask[LED_PROC_MASK_WORD(TEST_NUM_LEDS)] = LED_PROC_MASK_BIT(TEST_NUM_LEDS);
+	LED_CHECK_EQ(turn_leds_mask_on(&test_board.proc, mask, NULL, TEST_NUM_WORDS), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(test_board.pins[0] + test_board.pins[1], 2);
+	memset(mask, 0, sizeof(mask));
+	test_board.hal_writes = 0;
+	LED_CHECK_EQ(toggle_leds_mask(&test_board.proc, mask, failed, TEST_NUM_WORDS), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(test_board.hal_writes, 0);
+	LED_CHECK_EQ(toggle_leds_mask(&test_board.proc, mask, failed, 0), LED_PROC_ERROR_TYPE_NONE);
+
+	// an array that ends on a word, so a whole word is in it and the next is past it
+	for (int with_hook = 0; with_hook <= 1; with_hook++)
+	{
+		init_test_board(64, 0, with_hook);
+		mask[0] = 0xFFFFFFFF;
+		mask[1] = 0xFFFFFFFF;
+		mask[2] = LED_PROC_MASK_BIT(64);
+		LED_CHECK_EQ(turn_leds_mask_on(&test_board.proc, mask, failed, 2), LED_PROC_ERROR_TYPE_NONE);
+		LED_CHECK_EQ(failed[0] | failed[1], 0);
+		LED_CHECK_EQ(test_board.pins[31] + test_board.pins[32] + test_board.pins[63], 3);
+		LED_CHECK_EQ(turn_leds_mask_off(&test_board.proc, mask, failed, 3), LED_PROC_ERROR_TYPE_BAD_STATE);
+		LED_CHECK_EQ(failed[0] | failed[1], 0);
+		LED_CHECK_EQ(failed[2], LED_PROC_MASK_BIT(64));
+		LED_CHECK_EQ(test_board.pins[31] + test_board.pins[32] + test_board.pins[63], 0);
+	}
+}
+
+// the mask calls and the calls that take places light a board the same when nothing fails
+static void test_masks_match_nums(void)
+{
+	unsigned int random = 480;
+	int nums_pins[TEST_NUM_LEDS];
+
+	init_test_board(TEST_NUM_LEDS, 0, 1);
+	for (int op = 0; op < 2000; op++)
+	{
+		unsigned int mask[TEST_NUM_WORDS];
+		int nums[TEST_NUM_LEDS];
+		int num_selected = 0;
+		int on = (int)(next_test_random(&random) % 2);
+
+		make_test_mask(&random, next_test_random(&random) % 4, mask, TEST_NUM_WORDS);
+		mask[TEST_NUM_WORDS - 1] &= (1u << (TEST_NUM_LEDS % 32)) - 1;
+		for (int i = 0; i < TEST_NUM_LEDS; i++)
+		{
+			if (mask[LED_PROC_MASK_WORD(i)] & LED_PROC_MASK_BIT(i))
+				nums[num_selected++] = i;
+		}
+
+		LED_CHECK_EQ((on ? turn_leds_nums_on : turn_leds_nums_off)(&test_board.proc, nums, num_selected), LED_PROC_ERROR_TYPE_NONE);
+		memcpy(nums_pins, test_board.pins, sizeof(nums_pins));
+		for (int i = 0; i < num_selected; i++)
+			test_board.pins[nums[i]] = !on;
+		LED_CHECK_EQ((on ? turn_leds_mask_on : turn_leds_mask_off)(&test_board.proc, mask, NULL, TEST_NUM_WORDS), LED_PROC_ERROR_TYPE_NONE);
+		if (!LED_CHECK(memcmp(nums_pins, test_board.pins, sizeof(nums_pins)) == 0))
+			return;
+	}
+}
+
+static struct led_proc_t test_sim_proc;
+static led_t test_sim_leds[TEST_SIM_LEDS];
+
+static void init_test_sim_board(void)
+{
+	tl_sim_reset();
+	memset(&test_sim_proc, 0, sizeof(test_sim_proc));
+	memset(test_sim_leds, 0, sizeof(test_sim_leds));
+	test_sim_proc.led_init = init_led;
+	test_sim_proc.led_set_polarity = set_led_polarity;
+	test_sim_proc.led_set_duty_cycle = set_led_duty_cycle;
+	test_sim_proc.led_get_state = get_state_of_led;
+	test_sim_proc.led_init_outputs = init_led_outputs;
+	test_sim_proc.led_set_outputs = set_led_output_pins;
+	test_sim_proc.led_enter_critical = enter_led_critical;
+	test_sim_proc.led_exit_critical = exit_led_critical;
+	for (int i = 0; i < TEST_SIM_LEDS; i++)
+	{
+		test_sim_leds[i].led_ptr = (GPIO_PinTypeDef)(((i / 8) << 8) | (1 << (i % 8)));
+		test_sim_leds[i].led_type = LED_TYPE_OUTPUT;
+	}
+	LED_CHECK_EQ(init_led_proc(&test_sim_proc, test_sim_leds, TEST_SIM_LEDS), LED_PROC_ERROR_TYPE_NONE);
+}
+
+// the led_lib hook writes each port once, and leaves every pin where led_proc has it
+static void test_masks_sim(void)
+{
+	unsigned int random = 4800;
+	unsigned int mask[LED_PROC_MASK_WORDS(TEST_SIM_LEDS)];
+	unsigned int failed[LED_PROC_MASK_WORDS(TEST_SIM_LEDS)];
+	tl_sim_stats_t before;
+	unsigned long mask_regs;
+	unsigned long long mask_cycles;
+
+	init_test_sim_board();
+	for (int op = 0; op < TEST_SIM_OPS; op++)
+	{
+		led_proc_error_type status;
+
+		make_test_mask(&random, next_test_random(&random) % 4, mask, 2);
+		mask[1] &= 0xFF;
+		if (op % 3 == 0)
+			status = turn_leds_mask_on(&test_sim_proc, mask, failed, 2);
+		else if (op % 3 == 1)
+			status = turn_leds_mask_off(&test_sim_proc, mask, failed, 2);
+		else
+			status = toggle_leds_mask(&test_sim_proc, mask, failed, 2);
+		LED_CHECK_EQ(status, LED_PROC_ERROR_TYPE_NONE);
+		LED_CHECK_EQ(failed[0] | failed[1], 0);
+		for (int i = 0; i < TEST_SIM_LEDS; i++)
+		{
+			if (!LED_CHECK_EQ(tl_sim_output_level(test_sim_leds[i].led_ptr), test_sim_leds[i].led_output_state))
+			{
+				printf("op %d, LED %d is not at its state\n", op, i);
+				return;
+			}
+		}
+	}
+
+	mask[0] = 0xFFFFFFFF;
+	mask[1] = 0xFF;
+	before = tl_sim_stats;
+	LED_CHECK_EQ(turn_leds_mask_on(&test_sim_proc, mask, NULL, 2), LED_PROC_ERROR_TYPE_NONE);
+	mask_regs = tl_sim_stats.reg_accesses - before.reg_accesses;
+	mask_cycles = tl_sim_stats.cycles - before.cycles;
+	before = tl_sim_stats;
+	for (int i = 0; i < TEST_SIM_LEDS; i++)
+		turn_led_num_off(&test_sim_proc, i);
+
+	printf("%-26s %12s %12s\n", "40 LEDs on 5 ports", "reg accesses", "cycles");
+	printf("%-26s %12lu %12llu\n", "turn_leds_mask_on", mask_regs, mask_cycles);
+	printf("%-26s %12lu %12llu\n", "turn_led_num_off each", tl_sim_stats.reg_accesses - before.reg_accesses,
+			tl_sim_stats.cycles - before.cycles);
+	// a read and a write of each port, and the interrupt mask around them
+	LED_CHECK(mask_regs <= 2 * TEST_SIM_PORTS + 4);
+	LED_CHECK(mask_regs * 4 < tl_sim_stats.reg_accesses - before.reg_accesses);
+}
+
+// ns per LED of one call over a board, every LED or one in 8
+static void bench_led_masks(void)
+{
+	static int nums[TEST_BENCH_MAX_LEDS];
+	static unsigned int mask[LED_PROC_MASK_WORDS(TEST_BENCH_MAX_LEDS)];
+	unsigned int failed[LED_PROC_MASK_WORDS(TEST_BENCH_MAX_LEDS)];
+	unsigned int bad = 0;
+
+	printf("%-16s %10s %12s %12s %12s\n", "ns per LED", "selected", "places", "mask", "mask, hook");
+	for (int num_leds = 4; num_leds <= TEST_BENCH_MAX_LEDS; num_leds *= 4)
+	{
+		for (int every = 1; every <= 8; every *= 8)
+		{
+			int num_selected = 0;
+			int rounds;
+			double times[3];
+
+			memset(mask, 0, sizeof(mask));
+			for (int i = 0; i < num_leds; i += every)
+			{
+				nums[num_selected++] = i;
+				mask[LED_PROC_MASK_WORD(i)] |= LED_PROC_MASK_BIT(i);
+			}
+			rounds = TEST_BENCH_SELECTED / num_selected;
+
+			for (int way = 0; way < 3; way++)
+			{
+				double start;
+
+				init_test_board(num_leds, 0, way == 2);
+				start = get_test_seconds();
+				for (int r = 0; r < rounds; r++)
+				{
+					if (way == 0)
+						bad |= (turn_leds_nums_on(&test_board.proc, nums, num_selected) != LED_PROC_ERROR_TYPE_NONE);
+					else
+						bad |= (turn_leds_mask_on(&test_board.proc, mask, failed, LED_PROC_MASK_WORDS(num_leds)) != LED_PROC_ERROR_TYPE_NONE);
+				}
+				times[way] = (get_test_seconds() - start) * 1e9 / ((double)rounds * num_selected);
+			}
+			printf("%-16d %10d %12.2f %12.2f %12.2f\n", num_leds, num_selected, times[0], times[1], times[2]);
+		}
+	}
+	LED_CHECK_EQ(bad, 0);
+}
+
+int main(int argc, char ** argv)
+{
+	test_masks_errors();
+	test_masks_model(0);
+	test_masks_model(1);
+	test_masks_match_nums();
+	test_masks_sim();
+
+	if (argc > 1 && strcmp(argv[1], "-b") == 0)
+		bench_led_masks();
+
+	return led_test_summary("test_led_masks");
+}
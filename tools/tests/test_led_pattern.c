@@ -0,0 +1,632 @@
+/*
+ * test_led_pattern.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Round trip test of the pattern compiler and player, built from the repository root:
+ *
+ *	gcc -O2 -Wno-cpp -Itools/sim -Ilib -o test_led_pattern tools/tests/test_led_pattern.c lib/led_pattern.c lib/led_proc.c
+ *	./test_led_pattern [-b]
+ *
+ *	-b	also compare the size of each blob with the same pattern written as C, a state machine with one case per
+ *		wait the way irq_handler stepped its patterns, compiled for the host with cc -Os
+ *
+ * tools/led_patc.c is built into the test and run in a child process for each pattern, so a pattern it rejects
+ * exits the child and not the test.  Random patterns are compiled, played by led_pattern through led_proc, and
+ * checked tick by tick against an interpreter of the text, which unrolls the loops where the blob has REPEATs.
+ */
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "led_pattern.h"
+
+// the compiler's main is renamed so it can be called from the child
+#define main run_led_patc
+#include "../led_patc.c"
+#undef main
+
+#define TEST_NUM_LEDS		6		// even LEDs are PWM, odd ones outputs
+#define LED_TEST_BOARD_LEDS	TEST_NUM_LEDS
+#include "led_test.h"
+
+#define TEST_TICK_MS		10
+#define TEST_MAX_TEXT		16384
+#define TEST_MAX_BLOB		4096
+#define TEST_MAX_FLAT		200000	// statements of a pattern with its loops unrolled
+#define TEST_MAX_TICKS		100000
+#define TEST_PATTERNS		300
+#define TEST_ONCHIP_TEXT	"tools/patterns/onchip.txt"
+#define TEST_ONCHIP_ARRAY	"lib/led_lib.c"
+
+static led_test_board_t test_board;
+static char test_text_file[64];
+
+typedef enum TEST_STATEMENTS {
+	TEST_SET,
+	TEST_FADE,
+	TEST_WAIT
+}test_statement_t;
+
+typedef struct test_flat_t {
+	test_statement_t statement;
+	int led;
+	int level;
+	unsigned int ticks;
+}test_flat_t;
+
+// the interpreter of the text, it follows the same tick as run_led_pattern but from the unrolled statements
+typedef struct test_ref_t {
+	test_flat_t * flat;
+	int num_flat;
+	int forever;
+	int pc;
+	unsigned int wait;
+	int done;
+	unsigned short level[TEST_NUM_LEDS];
+	unsigned short sent[TEST_NUM_LEDS];		// what the LED was last given, a fade only sends from its first step
+	int step[TEST_NUM_LEDS];
+	unsigned int fade_ticks[TEST_NUM_LEDS];
+}test_ref_t;
+
+static test_flat_t test_flat[TEST_MAX_FLAT];
+
+static void init_test_proc(void)
+{
+	setup_led_test_board(&test_board, TEST_NUM_LEDS);
+	test_board.proc.led_set_compare = set_led_test_compare;
+	for (int i = 0; i < TEST_NUM_LEDS; i += 2)
+		set_led_test_pwm(&test_board, i, &test_board.pwm_states[i]);
+	init_led_proc(&test_board.proc, test_board.leds, TEST_NUM_LEDS);
+}
+
+// compiles a pattern file in a child, returns the exit code of the compiler and the blob when it is 0
+static int compile_test_file(const char * path, unsigned char * blob, unsigned int * len)
+{
+	char blob_file[80];
+	int status;
+	pid_t pid;
+	FILE * in;
+
+	snprintf(blob_file, sizeof(blob_file), "%s.bin", test_text_file);
+	remove(blob_file);
+	fflush(stdout);
+	pid = fork();
+	if (pid == 0)
+	{
+		char * argv[] = { "led_patc", "-o", blob_file, (char *)path, NULL };
+
+		if (freopen("/dev/null", "w", stderr) == NULL)
+			_exit(3);
+		exit(run_led_patc(4, argv));
+	}
+	if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+		return -1;
+	if (WEXITSTATUS(status) != 0)
+		return WEXITSTATUS(status);
+
+	in = fopen(blob_file, "rb");
+	if (in == NULL)
+		return -1;
+	*len = (unsigned int)fread(blob, 1, TEST_MAX_BLOB, in);
+	fclose(in);
+	remove(blob_file);
+	return 0;
+}
+
+static int compile_test_text(const char * text, unsigned char * blob, unsigned int * len)
+{
+	FILE * out = fopen(test_text_file, "w");
+
+	if (out == NULL)
+		return -1;
+	fputs(text, out);
+	fclose(out);
+	return compile_test_file(test_text_file, blob, len);
+}
+
+// unrolls the statements of a block up to its } or the end, returns the number of statements or -1 if too many
+static int flatten_test_block(const char ** text, test_flat_t * flat, int num, int max, int * forever)
+{
+	char line[PATC_MAX_LINE];
+
+	while (**text != '\0')
+	{
+		const char * end = strchr(*text, '\n');
+		size_t len = end != NULL ? (size_t)(end - *text) : strlen(*text);
+		char word[16];
+		int a = 0;
+		int b = 0;
+		int c = 0;
+
+		memcpy(line, *text, len < sizeof(line) - 1 ? len : sizeof(line) - 1);
+		line[len < sizeof(line) - 1 ? len : sizeof(line) - 1] = '\0';
+		*text += len + (end != NULL);
+		if (strchr(line, '#') != NULL)
+			*strchr(line, '#') = '\0';
+		if (sscanf(line, "%15s %d %d %d", word, &a, &b, &c) < 1)
+			continue;
+
+		if (strcmp(word, "}") == 0)
+			return num;
+		if (strcmp(word, "loop") == 0)
+		{
+			const char * body = *text;
+			for (int n = 0; n < a; n++)
+			{
+				*text = body;
+				num = flatten_test_block(text, flat, num, max, forever);
+				if (num < 0)
+					return -1;
+			}
+			continue;
+		}
+		if (strcmp(word, "forever") == 0)
+			*forever = 1;
+		if (strcmp(word, "set") != 0 && strcmp(word, "fade") != 0 && strcmp(word, "wait") != 0)
+			continue;
+		if (num >= max)
+			return -1;
+
+		flat[num].statement = word[0] == 's' ? TEST_SET : word[0] == 'f' ? TEST_FADE : TEST_WAIT;
+		flat[num].led = a;
+		flat[num].level = b;
+		flat[num].ticks = (unsigned int)(word[0] == 'w' ? a : c) / TEST_TICK_MS;
+		num++;
+	}
+	return num;
+}
+
+static int init_test_ref(test_ref_t * ref, const char * text)
+{
+	memset(ref, 0, sizeof(*ref));
+	ref->flat = test_flat;
+	ref->num_flat = flatten_test_block(&text, test_flat, 0, TEST_MAX_FLAT, &ref->forever);
+	return ref->num_flat >= 0;
+}
+
+// one tick of the text: the fades step, then the statements run up to the next wait
+static void run_test_ref(test_ref_t * ref)
+{
+	if (ref->done)
+		return;
+
+	for (int i = 0; i < TEST_NUM_LEDS; i++)
+	{
+		if (ref->fade_ticks[i] == 0)
+			continue;
+		ref->level[i] = (unsigned short)(ref->level[i] + ref->step[i]);
+		ref->sent[i] = ref->level[i];
+		ref->fade_ticks[i]--;
+	}
+
+	if (ref->wait > 0 && --ref->wait > 0)
+		return;
+
+	while (1)
+	{
+		test_flat_t * flat;
+		int target;
+
+		if (ref->pc == ref->num_flat)
+		{
+			if (!ref->forever)
+			{
+				ref->done = 1;
+				return;
+			}
+			ref->pc = 0;
+		}
+		flat = &ref->flat[ref->pc++];
+		target = flat->level * 257;
+		switch (flat->statement)
+		{
+		case TEST_SET:
+			ref->level[flat->led] = (unsigned short)target;
+			ref->sent[flat->led] = (unsigned short)target;
+			ref->fade_ticks[flat->led] = 0;
+			break;
+		case TEST_FADE:
+			ref->step[flat->led] = (target - (int)ref->level[flat->led]) / (int)flat->ticks;
+			ref->level[flat->led] = (unsigned short)(target - ref->step[flat->led] * (int)flat->ticks);
+			ref->fade_ticks[flat->led] = flat->ticks;
+			break;
+		case TEST_WAIT:
+			ref->wait = flat->ticks;
+			return;
+		}
+	}
+}
+
+// what an LED shows, the brightness of a PWM LED, or full or nothing for an output LED
+static unsigned int get_test_output(int led_num)
+{
+	if (test_board.leds[led_num].led_type == LED_TYPE_PWM)
+		return test_board.pwm_states[led_num].led_brightness;
+	return (test_board.leds[led_num].led_output_state == LED_ON) ? 0xFFFF : 0;
+}
+
+static unsigned int get_test_ref_output(test_ref_t * ref, int led_num)
+{
+	if (test_board.leds[led_num].led_type == LED_TYPE_PWM)
+		return ref->sent[led_num];
+	return (ref->sent[led_num] & 0x8000) ? 0xFFFF : 0;
+}
+
+// plays a compiled blob against the interpreter of its text, returns 1 when every tick matched
+static int play_test_pattern(const char * text, const unsigned char * blob, unsigned int len)
+{
+	static test_ref_t ref;
+	led_pattern_t pattern;
+	int ticks = 0;
+
+	init_test_proc();
+	if (!LED_CHECK(init_test_ref(&ref, text)))
+		return 0;
+	if (!LED_CHECK_EQ(init_led_pattern(&pattern, &test_board.proc, blob, len, TEST_TICK_MS), LED_PROC_ERROR_TYPE_NONE))
+		return 0;
+
+	// a pattern that ends is played a little past its end, one that does not for a while
+	for (ticks = 0; ticks < TEST_MAX_TICKS && !(ref.done && pattern.pattern_done && ticks > 0); ticks++)
+	{
+		run_test_ref(&ref);
+		if (!LED_CHECK_EQ(run_led_pattern(&pattern), LED_PROC_ERROR_TYPE_NONE))
+			return 0;
+		if (!LED_CHECK_EQ(pattern.pattern_done, ref.done))
+			return 0;
+		for (int i = 0; i < TEST_NUM_LEDS; i++)
+		{
+			if (!LED_CHECK_EQ(get_test_output(i), get_test_ref_output(&ref, i)))
+			{
+				printf("LED %d at tick %d of:\n%s", i, ticks, text);
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+static void add_test_text(char * text, const char * format, int a, int b, int c)
+{
+	size_t len = strlen(text);
+
+	snprintf(text + len, TEST_MAX_TEXT - len, format, a, b, c);
+}
+
+static int get_test_wait_ms(unsigned int * random)
+{
+	// now and then long enough to need a second byte
+	if (next_test_random(random) % 8 == 0)
+		return (int)(16 + next_test_random(random) % 300) * TEST_TICK_MS;
+	return (int)(1 + next_test_random(random) % 15) * TEST_TICK_MS;
+}
+
+// a random block of statements, every loop ends in a wait, so no tick runs more than a handful of ops
+static void add_test_block(char * text, int depth, unsigned int * random)
+{
+	int num = 1 + (int)(next_test_random(random) % 6);
+
+	for (int n = 0; n < num; n++)
+	{
+		unsigned int pick = next_test_random(random) % 100;
+		int led = (int)(next_test_random(random) % TEST_NUM_LEDS);
+		int level = (next_test_random(random) % 4 == 0) ? 255 * (int)(next_test_random(random) % 2) : (int)(next_test_random(random) % 256);
+
+		if (pick < 25)
+			add_test_text(text, "set %d %d\n", led, level, 0);
+		else if (pick < 45)
+			add_test_text(text, "fade %d %d %d\n", led, level, (int)(1 + next_test_random(random) % 200) * TEST_TICK_MS);
+		else if (pick < 75)
+			add_test_text(text, "wait %d\n", get_test_wait_ms(random), 0, 0);
+		else if (pick < 88)
+		{
+			// the same steps written out several times, for the compiler to fold into a REPEAT
+			int times = 2 + (int)(next_test_random(random) % 5);
+			int wait_ms = get_test_wait_ms(random);
+			for (int k = 0; k < times; k++)
+			{
+				add_test_text(text, "set %d %d\n", led, level, 0);
+				add_test_text(text, "wait %d\n", wait_ms, 0, 0);
+				add_test_text(text, "set %d %d\n", led, 255 - level, 0);
+				add_test_text(text, "wait %d\n", wait_ms, 0, 0);
+			}
+		}
+		else if (depth < 3)
+		{
+			// only an innermost loop runs many times, so the unrolled text stays small
+			int count = (depth == 2 && next_test_random(random) % 4 == 0) ? 200 : 1 + (int)(next_test_random(random) % 4);
+			add_test_text(text, "loop %d {\n", count, 0, 0);
+			add_test_block(text, depth + 1, random);
+			add_test_text(text, "wait %d\n}\n", get_test_wait_ms(random), 0, 0);
+		}
+	}
+}
+
+// random patterns from the compiler, through the player, against the text
+static void test_pattern_random(void)
+{
+	static char text[TEST_MAX_TEXT];
+	static unsigned char blob[TEST_MAX_BLOB];
+	unsigned int random = 38;
+	unsigned long text_bytes = 0;
+	unsigned long blob_bytes = 0;
+	int played = 0;
+
+	for (int n = 0; n < TEST_PATTERNS; n++)
+	{
+		unsigned int len = 0;
+		int forever = (n % 2 == 0);
+
+		text[0] = '\0';
+		add_test_text(text, "tick %d\nleds %d\n", TEST_TICK_MS, TEST_NUM_LEDS, 0);
+		add_test_block(text, 0, &random);
+		if (forever)
+			add_test_text(text, "wait %d\nforever\n", TEST_TICK_MS, 0, 0);
+
+		if (!LED_CHECK_EQ(compile_test_text(text, blob, &len), 0))
+		{
+			printf("rejected:\n%s", text);
+			continue;
+		}
+		text_bytes += strlen(text);
+		blob_bytes += len;
+		played += play_test_pattern(text, blob, len);
+	}
+	LED_CHECK_EQ(played, TEST_PATTERNS);
+	printf("%d random patterns played tick for tick as written, %lu bytes of text in %lu bytes of blob\n", played,
+			text_bytes, blob_bytes);
+}
+
+// runs of the same steps take no more room than the loop that writes them once
+static void test_pattern_compress(void)
+{
+	static char text[TEST_MAX_TEXT];
+	static unsigned char written[TEST_MAX_BLOB];
+	static unsigned char looped[TEST_MAX_BLOB];
+	unsigned int written_len = 0;
+	unsigned int looped_len = 0;
+
+	strcpy(text, "tick 10\nleds 2\n");
+	for (int i = 0; i < 50; i++)
+		strcat(text, "set 0 255\nwait 20\nset 0 0\nwait 20\n");
+	LED_CHECK_EQ(compile_test_text(text, written, &written_len), 0);
+	LED_CHECK(play_test_pattern(text, written, written_len));
+	LED_CHECK_EQ(compile_test_text("tick 10\nleds 2\nloop 50 {\nset 0 255\nwait 20\nset 0 0\nwait 20\n}\n", looped,
+			&looped_len), 0);
+	LED_CHECK_EQ(written_len, looped_len);
+	LED_CHECK(memcmp(written, looped, looped_len) == 0);
+}
+
+// the compiler stops on what the player cannot do, and the player on what the compiler did not make
+static void test_pattern_errors(void)
+{
+	static const char * const rejected[] = {
+		"tick 10\nleds 2\nwait 15\n",								// not a whole number of ticks
+		"leds 2\ntick 10\nwait 10\n",								// tick not first
+		"tick 10\nleds 2\nset 2 255\nwait 10\n",					// LED not below leds
+		"tick 10\nleds 2\nset 0 256\nwait 10\n",					// level out of range
+		"tick 10\nleds 2\nfade 0 255 0\nwait 10\n",					// fade of no time
+		"tick 10\nleds 2\nwait 10\n}\n",							// } without a loop
+		"tick 10\nleds 2\nloop 2 {\nwait 10\n",						// loop without its }
+		"tick 10\nleds 2\nloop 0 {\nwait 10\n}\n",					// loop of nothing
+		"tick 10\nleds 2\nforever\nwait 10\n",						// forever not last
+		"tick 10\nleds 2\nset 0 255\nforever\n",					// forever and no wait
+		"tick 10\nleds 2\nloop 2 {\nloop 2 {\nloop 2 {\nloop 2 {\nloop 2 {\nwait 10\n}\n}\n}\n}\n}\n",
+		"tick 10\nleds 2\nloop 70 {\nset 0 1\n}\nwait 10\n",		// 70 ops in one tick
+	};
+	static unsigned char blob[TEST_MAX_BLOB];
+	static unsigned char bad[TEST_MAX_BLOB];
+	unsigned int len = 0;
+	led_pattern_t pattern;
+
+	for (int i = 0; i < (int)(sizeof(rejected) / sizeof(rejected[0])); i++)
+	{
+		if (!LED_CHECK_EQ(compile_test_text(rejected[i], blob, &len), 1))
+			printf("accepted:\n%s", rejected[i]);
+	}
+
+	LED_CHECK_EQ(compile_test_text("tick 10\nleds 2\nloop 3 {\nfade 0 255 300\nwait 300\nset 1 255\nfade 0 0 300\n"
+			"wait 300\nset 1 0\n}\n", blob, &len), 0);
+	init_test_proc();
+	LED_CHECK_EQ(init_led_pattern(&pattern, &test_board.proc, blob, len, TEST_TICK_MS + 1), LED_PROC_ERROR_TYPE_BAD_STATE);
+	memcpy(bad, blob, len);
+	bad[2] = LED_PATTERN_VERSION + 1;
+	LED_CHECK_EQ(init_led_pattern(&pattern, &test_board.proc, bad, len, TEST_TICK_MS), LED_PROC_ERROR_TYPE_BAD_STATE);
+	bad[2] = LED_PATTERN_VERSION;
+	bad[3] = TEST_NUM_LEDS + 1;
+	LED_CHECK_EQ(init_led_pattern(&pattern, &test_board.proc, bad, len, TEST_TICK_MS), LED_PROC_ERROR_TYPE_BAD_STATE);
+
+	// a blob cut short anywhere stops with an error, without reading past its end
+	for (unsigned int cut = LED_PATTERN_HEADER_SIZE + 1; cut < len; cut++)
+	{
+		led_proc_error_type status = LED_PROC_ERROR_TYPE_NONE;
+		int ticks;
+
+		LED_CHECK_EQ(init_led_pattern(&pattern, &test_board.proc, blob, cut, TEST_TICK_MS), LED_PROC_ERROR_TYPE_NONE);
+		for (ticks = 0; ticks < 10000 && status == LED_PROC_ERROR_TYPE_NONE; ticks++)
+			status = run_led_pattern(&pattern);
+		LED_CHECK_EQ(status, LED_PROC_ERROR_TYPE_BAD_STATE);
+		LED_CHECK(pattern.pattern_done);
+		LED_CHECK(pattern.pattern_pc <= cut);
+	}
+}
+
+// the array built into led_lib.c is what onchip.txt compiles to, and it plays as written
+static void test_pattern_onchip(void)
+{
+	static char text[TEST_MAX_TEXT];
+	static unsigned char blob[TEST_MAX_BLOB];
+	static char source[1 << 16];
+	unsigned int len = 0;
+	unsigned int num = 0;
+	unsigned int byte;
+	size_t size;
+	char * at;
+	FILE * in;
+
+	if (!LED_CHECK_EQ(compile_test_file(TEST_ONCHIP_TEXT, blob, &len), 0))
+		return;
+
+	in = fopen(TEST_ONCHIP_ARRAY, "r");
+	if (!LED_CHECK(in != NULL))
+		return;
+	size = fread(source, 1, sizeof(source) - 1, in);
+	fclose(in);
+	source[size] = '\0';
+	at = strstr(source, "onchip_led_pattern[");
+	if (!LED_CHECK(at != NULL))
+		return;
+	for (at = strchr(at, '{'); at != NULL && *at != '}'; at++)
+	{
+		if (at[0] == '0' && at[1] == 'x' && sscanf(at, "0x%2X", &byte) == 1)
+		{
+			LED_CHECK(num < len && blob[num] == byte);
+			num++;
+			at += 3;
+		}
+	}
+	LED_CHECK_EQ(num, len);
+
+	in = fopen(TEST_ONCHIP_TEXT, "r");
+	if (!LED_CHECK(in != NULL))
+		return;
+	size = fread(text, 1, sizeof(text) - 1, in);
+	fclose(in);
+	text[size] = '\0';
+
+	// it is compiled for the 500ms LED_TIMER_MS, the interpreter reads times in TEST_TICK_MS
+	for (char * tick = text; (tick = strstr(tick, "wait ")) != NULL; tick += 5)
+	{
+		int ms = atoi(tick + 5);
+		char * end = tick + 5 + strspn(tick + 5, "0123456789");
+		char scaled[16];
+		int n = snprintf(scaled, sizeof(scaled), "%d", ms / 500 * TEST_TICK_MS);
+
+		memmove(tick + 5 + n, end, strlen(end) + 1);
+		memcpy(tick + 5, scaled, (size_t)n);
+	}
+	blob[4] = TEST_TICK_MS;
+	blob[5] = 0;
+	LED_CHECK(play_test_pattern(text, blob, len));
+}
+
+// the pattern as C, one case per wait that sets the LEDs and the wait to the next case
+static void write_test_c(const char * text, FILE * out)
+{
+	static test_ref_t ref;
+	int step = 0;
+
+	init_test_ref(&ref, text);
+	fprintf(out, "struct led_proc_t;\n"
+			"int turn_led_num_on(struct led_proc_t *, int);\n"
+			"int turn_led_num_off(struct led_proc_t *, int);\n"
+			"int set_led_num_pwm_brightness(struct led_proc_t *, int, unsigned short);\n"
+			"int start_led_fade(struct led_proc_t *, int, unsigned short, unsigned int);\n"
+			"static unsigned int step;\nstatic unsigned int wait;\n"
+			"void run_pattern(struct led_proc_t * led_proc)\n{\n"
+			"\tif (wait > 0 && --wait > 0)\n\t\treturn;\n\tswitch (step)\n\t{\n\tcase 0:\n");
+	for (int i = 0; i < ref.num_flat; i++)
+	{
+		test_flat_t * flat = &ref.flat[i];
+
+		if (flat->statement == TEST_SET && test_board.leds[flat->led].led_type == LED_TYPE_PWM)
+			fprintf(out, "\t\tset_led_num_pwm_brightness(led_proc, %d, %d);\n", flat->led, flat->level * 257);
+		else if (flat->statement == TEST_SET)
+			fprintf(out, "\t\tturn_led_num_%s(led_proc, %d);\n", flat->level >= 128 ? "on" : "off", flat->led);
+		else if (flat->statement == TEST_FADE)
+			fprintf(out, "\t\tstart_led_fade(led_proc, %d, %d, %u);\n", flat->led, flat->level * 257, flat->ticks);
+		else
+			fprintf(out, "\t\twait = %u;\n\t\tstep = %d;\n\t\treturn;\n\tcase %d:\n", flat->ticks, step + 1, step + 1),
+			step++;
+	}
+	fprintf(out, "\t\tstep = %d;\n\t}\n}\n", ref.forever ? 0 : step);
+}
+
+// the .text of a C file built for the host with cc -Os, or 0 if it could not be built
+static long size_test_c(const char * c_file)
+{
+	char command[256];
+	long text = 0;
+	FILE * size;
+
+	snprintf(command, sizeof(command), "cc -Os -Wno-cpp -Ilib -Itools/sim -c -o %s.o %s && size %s.o", c_file,
+			c_file, c_file);
+	size = popen(command, "r");
+	if (size == NULL)
+		return 0;
+	if (fscanf(size, "%*[^\n]\n%ld", &text) != 1)
+		text = 0;
+	pclose(size);
+	snprintf(command, sizeof(command), "%s.o", c_file);
+	remove(command);
+	return text;
+}
+
+static void bench_led_pattern(void)
+{
+	static char text[TEST_MAX_TEXT];
+	static unsigned char blob[TEST_MAX_BLOB];
+	char c_file[80];
+	unsigned int random = 138;
+	size_t size;
+	FILE * in;
+
+	snprintf(c_file, sizeof(c_file), "%s.c", test_text_file);
+	printf("the player, lib/led_pattern.c, is %ld bytes of .text on the host, once for every pattern\n",
+			size_test_c("lib/led_pattern.c"));
+	printf("%-10s %12s %14s %12s\n", "pattern", "statements", "blob bytes", "C bytes");
+	for (int n = 0; n < 6; n++)
+	{
+		unsigned int len = 0;
+		FILE * out;
+
+		if (n == 0)
+		{
+			in = fopen(TEST_ONCHIP_TEXT, "r");
+			if (in == NULL)
+				return;
+			size = fread(text, 1, sizeof(text) - 1, in);
+			fclose(in);
+			text[size] = '\0';
+		}
+		else
+		{
+			text[0] = '\0';
+			add_test_text(text, "tick %d\nleds %d\n", TEST_TICK_MS, TEST_NUM_LEDS, 0);
+			add_test_block(text, 0, &random);
+			add_test_text(text, "wait %d\nforever\n", TEST_TICK_MS, 0, 0);
+		}
+		if (compile_test_text(text, blob, &len) != 0)
+			continue;
+
+		init_test_proc();
+		out = fopen(c_file, "w");
+		if (out == NULL)
+			return;
+		write_test_c(text, out);
+		fclose(out);
+		printf("%-10s %12d %14u %12ld\n", n == 0 ? "onchip" : "random", flatten_test_block(&(const char *){ text },
+				test_flat, 0, TEST_MAX_FLAT, &(int){ 0 }), len, size_test_c(c_file));
+	}
+	remove(c_file);
+}
+
+int main(int argc, char ** argv)
+{
+	int fd;
+
+	strcpy(test_text_file, "/tmp/test_led_pattern_XXXXXX");
+	fd = mkstemp(test_text_file);
+	if (!LED_CHECK(fd >= 0))
+		return led_test_summary("test_led_pattern");
+	close(fd);
+
+	test_pattern_random();
+	test_pattern_compress();
+	test_pattern_errors();
+	test_pattern_onchip();
+	if (argc > 1 && strcmp(argv[1], "-b") == 0)
+		bench_led_pattern();
+
+	remove(test_text_file);
+	return led_test_summary("test_led_pattern");
+}
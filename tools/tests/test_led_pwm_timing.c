@@ -0,0 +1,241 @@
+/*
+ * test_led_pwm_timing.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of get_led_pwm_timing, get_led_pwm_duty_cycles and retune_led_pwm, built from the repository root:
+ *
+ *	gcc -O2 -Wno-cpp -Itools/sim -Ilib -o test_led_pwm_timing tools/tests/test_led_pwm_timing.c lib/led_proc.c
+ *	./test_led_pwm_timing
+ *
+ * The timing is checked against the exact maths for every frequency the 24MHz PWM clock of the TLS8258 can give,
+ * and the duty cycles for every period and duty cycle.  Then a PWM channel is retuned on a simulated counter whose
+ * period and compare registers, as on the chip, are only taken at the end of a frame, and every frame it runs must
+ * be entirely at the old timing or entirely at the new one.
+ */
+#include <string.h>
+#include "led_proc.h"
+
+#define LED_TEST_BOARD_LEDS	1
+#include "led_test.h"
+
+#define TEST_CLOCK_HZ		24000000	// the undivided PWM clock of the TLS8258
+#define TEST_MAX_FRAMES		64
+
+// the period and compare the frame running now was started with, the ones the firmware writes are on the board
+typedef struct test_counter_t {
+	unsigned int frame_cycles;
+	unsigned int frame_compare;
+}test_counter_t;
+
+static led_test_board_t test_board;
+static test_counter_t test_counter;
+
+static void init_test_proc(unsigned int hertz, int pwm_dc)
+{
+	setup_led_test_board(&test_board, 1);
+	memset(&test_counter, 0, sizeof(test_counter));
+	test_board.proc.led_set_duty_cycle = set_led_test_duty_compare;
+	test_board.proc.led_set_compare = set_led_test_compare;
+	test_board.proc.led_set_cycles = set_led_test_cycles;
+	test_board.proc.led_set_frame_irq = set_led_test_frame_irq;
+	test_board.leds[0].led_type = LED_TYPE_PWM;
+	test_board.leds[0].led_pwm_state = &test_board.pwm_states[0];
+	test_board.pwm_states[0].led_pwm_hertz = (int)hertz;
+	get_led_pwm_timing(TEST_CLOCK_HZ, hertz, 0, &test_board.pwm_states[0].led_pwm_timing);
+	init_led_proc(&test_board.proc, test_board.leds, 1);
+
+	// as init_led does, the channel starts at its period and duty cycle
+	test_board.cycles[0] = test_board.pwm_states[0].led_pwm_timing.cycles;
+	set_led_pwm_duty_cycle(&test_board.proc, test_board.leds, pwm_dc);
+	test_counter.frame_cycles = test_board.cycles[0];
+	test_counter.frame_compare = test_board.compare[0];
+}
+
+// ends the running frame, the next one takes the registers as they are, then its frame interrupt runs
+static void run_test_frame(void)
+{
+	test_counter.frame_cycles = test_board.cycles[0];
+	test_counter.frame_compare = test_board.compare[0];
+	if (test_board.frame_irq)
+		run_led_pwm_frame(&test_board.proc, test_board.leds);
+}
+
+// the achieved frequency is the nearest whole number of counts, with the resolution that gives
+static void test_pwm_timing(void)
+{
+	led_pwm_timing_t timing;
+	int worst_ppm = 0;
+
+	for (unsigned int hertz = TEST_CLOCK_HZ / LED_PWM_MAX_CYCLES + 1; hertz <= TEST_CLOCK_HZ / 2; hertz += 1 + hertz / 64)
+	{
+		unsigned int want_cycles = (unsigned int)(((unsigned long long)TEST_CLOCK_HZ * 2 / hertz + 1) / 2);
+		unsigned int bits = 0;
+		long long error;
+		int ppm;
+
+		if (!LED_CHECK_EQ(get_led_pwm_timing(TEST_CLOCK_HZ, hertz, 0, &timing), LED_PROC_ERROR_TYPE_NONE))
+			break;
+		if (!LED_CHECK_EQ(timing.cycles, want_cycles))
+			break;
+		while ((2u << bits) <= timing.cycles)
+			bits++;
+		LED_CHECK_EQ(timing.resolution_bits, bits);
+		// the period is off by at most half a count
+		error = (long long)timing.cycles * hertz - TEST_CLOCK_HZ;
+		if (!LED_CHECK(2 * (error < 0 ? -error : error) <= (long long)hertz))
+			break;
+		// near the clock a period of a few counts is far off in ppm, the board asks for 256 steps at least
+		ppm = (int)((error < 0 ? -error : error) * 1000000 / TEST_CLOCK_HZ);
+		if (timing.cycles >= 256 && ppm > worst_ppm)
+			worst_ppm = ppm;
+		LED_CHECK_EQ(timing.hertz, (TEST_CLOCK_HZ + timing.cycles / 2) / timing.cycles);
+	}
+	printf("pwm timing: worst period error %d ppm with 256 steps or more\n", worst_ppm);
+
+	// the camera frequency of the white LED gets 960 counts, just under 10 bits
+	LED_CHECK_EQ(get_led_pwm_timing(TEST_CLOCK_HZ, 25000, 256, &timing), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(timing.cycles, 960);
+	LED_CHECK_EQ(timing.resolution_bits, 9);
+	LED_CHECK_EQ(timing.hertz, 25000);
+
+	// too slow for the 16 bit period, it is clamped and reported
+	LED_CHECK_EQ(get_led_pwm_timing(TEST_CLOCK_HZ, 300, 0, &timing), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(timing.cycles, LED_PWM_MAX_CYCLES);
+	LED_CHECK_EQ(timing.resolution_bits, 15);
+	// too fast for the steps asked for, the timing is still filled in
+	LED_CHECK_EQ(get_led_pwm_timing(TEST_CLOCK_HZ, 200000, 256, &timing), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(timing.cycles, 120);
+	LED_CHECK_EQ(timing.resolution_bits, 6);
+	LED_CHECK_EQ(get_led_pwm_timing(TEST_CLOCK_HZ, 0, 0, &timing), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(get_led_pwm_timing(TEST_CLOCK_HZ, TEST_CLOCK_HZ + 1, 0, &timing), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(get_led_pwm_timing(TEST_CLOCK_HZ, 1000, 0, NULL), LED_PROC_ERROR_TYPE_NULL);
+}
+
+// every duty cycle of every period within a count of the exact value, and the ends exact
+static void test_pwm_duty_cycles(void)
+{
+	led_pwm_timing_t timing;
+	int worst = 0;
+
+	memset(&timing, 0, sizeof(timing));
+	for (unsigned int cycles = 1; cycles <= LED_PWM_MAX_CYCLES; cycles++)
+	{
+		// the reciprocal as get_led_pwm_timing works it out for a clock that gives this many counts
+		get_led_pwm_timing(cycles * 100, 100, 0, &timing);
+		if (!LED_CHECK_EQ(timing.cycles, cycles))
+			break;
+
+		for (int pwm_dc = 0; pwm_dc <= LED_PWM_DUTY_MAX; pwm_dc++)
+		{
+			// in hundredths of a count, the exact value is pwm_dc * cycles / 100
+			int error = (int)get_led_pwm_duty_cycles(&timing, pwm_dc) * LED_PWM_DUTY_MAX - pwm_dc * (int)cycles;
+
+			if (error < 0)
+				error = -error;
+			if (error > worst)
+				worst = error;
+		}
+		if (!LED_CHECK(get_led_pwm_duty_cycles(&timing, 0) == 0 && get_led_pwm_duty_cycles(&timing, LED_PWM_DUTY_MAX) == cycles))
+			break;
+		LED_CHECK(get_led_pwm_duty_cycles(&timing, -1) == 0 && get_led_pwm_duty_cycles(&timing, LED_PWM_DUTY_MAX + 1) == cycles);
+	}
+	printf("pwm duty cycles: worst error %.2f counts\n", (double)worst / LED_PWM_DUTY_MAX);
+	// rounded to nearest, so at most half a count off
+	LED_CHECK(worst * 2 <= LED_PWM_DUTY_MAX);
+}
+
+// every frame that runs is at one timing, never the period of one with the compare of the other
+static int check_test_frame(led_pwm_timing_t * timings[], int num_timings, int pwm_dc, unsigned short brightness)
+{
+	for (int i = 0; i < num_timings; i++)
+	{
+		unsigned int cycles = timings[i]->cycles;
+
+		if (test_counter.frame_cycles != cycles)
+			continue;
+		if (brightness == 0)
+			return test_counter.frame_compare == get_led_pwm_duty_cycles(timings[i], pwm_dc);
+
+		// dithered between the two compare values either side of the brightness
+		unsigned int low = (unsigned int)(((unsigned long long)brightness * cycles) >> 16);
+		return test_counter.frame_compare == low || test_counter.frame_compare == low + 1;
+	}
+	return 0;
+}
+
+static void test_pwm_retune(int pwm_dc, unsigned short brightness)
+{
+	led_pwm_timing_t slow;
+	led_pwm_timing_t fast;
+	led_pwm_timing_t * timings[2] = { &slow, &fast };
+	int frames_at_fast = 0;
+
+	init_test_proc(1000, pwm_dc);
+	slow = test_board.pwm_states[0].led_pwm_timing;
+	get_led_pwm_timing(TEST_CLOCK_HZ, 25000, 256, &fast);
+	if (brightness != 0)
+	{
+		set_led_pwm_brightness(&test_board.proc, test_board.leds, brightness);
+		run_test_frame();
+		run_test_frame();
+	}
+
+	// retunes are made at every point of the frame, and back, so both directions are covered
+	for (int frame = 0; frame < TEST_MAX_FRAMES; frame++)
+	{
+		if (frame % 8 == 3)
+			LED_CHECK_EQ(retune_led_pwm(&test_board.proc, test_board.leds, (frame % 16 == 3) ? &fast : &slow), LED_PROC_ERROR_TYPE_NONE);
+		run_test_frame();
+		if (!LED_CHECK(check_test_frame(timings, 2, pwm_dc, brightness)))
+		{
+			printf("frame %d: period %u compare %u\n", frame, test_counter.frame_cycles, test_counter.frame_compare);
+			break;
+		}
+		frames_at_fast += (test_counter.frame_cycles == fast.cycles);
+	}
+	// the retune is taken by the frame interrupt after it, and runs from the frame after that
+	LED_CHECK_EQ(frames_at_fast, TEST_MAX_FRAMES / 2);
+	LED_CHECK_EQ(test_board.pwm_states[0].led_pwm_timing.cycles, slow.cycles);
+
+	// a steady duty cycle has nothing for the frame interrupt once the retune is in
+	if (brightness == 0)
+		LED_CHECK_EQ(test_board.frame_irq, 0);
+}
+
+static void test_pwm_retune_errors(void)
+{
+	led_pwm_timing_t timing;
+
+	init_test_proc(1000, 50);
+	get_led_pwm_timing(TEST_CLOCK_HZ, 25000, 0, &timing);
+
+	LED_CHECK_EQ(retune_led_pwm(&test_board.proc, test_board.leds, NULL), LED_PROC_ERROR_TYPE_NULL);
+	timing.cycles = 0;
+	LED_CHECK_EQ(retune_led_pwm(&test_board.proc, test_board.leds, &timing), LED_PROC_ERROR_TYPE_BAD_STATE);
+	timing.cycles = LED_PWM_MAX_CYCLES + 1;
+	LED_CHECK_EQ(retune_led_pwm(&test_board.proc, test_board.leds, &timing), LED_PROC_ERROR_TYPE_BAD_STATE);
+	timing.cycles = 960;
+	test_board.leds[0].led_type = LED_TYPE_OUTPUT;
+	LED_CHECK_EQ(retune_led_pwm(&test_board.proc, test_board.leds, &timing), LED_PROC_ERROR_TYPE_WRONG_TYPE);
+	test_board.leds[0].led_type = LED_TYPE_PWM;
+	test_board.proc.led_set_cycles = NULL;
+	LED_CHECK_EQ(retune_led_pwm(&test_board.proc, test_board.leds, &timing), LED_PROC_ERROR_TYPE_NULL);
+	// nothing was queued by the ones that failed
+	LED_CHECK_EQ(test_board.pwm_states[0].led_pwm_retune.cycles, 0);
+	LED_CHECK_EQ(test_board.frame_irq, 0);
+}
+
+int main(int argc, char ** argv)
+{
+	test_pwm_timing();
+	test_pwm_duty_cycles();
+	test_pwm_retune(30, 0);
+	test_pwm_retune(0, 0);
+	test_pwm_retune(LED_PWM_DUTY_MAX, 0);
+	test_pwm_retune(0, 0x1234);
+	test_pwm_retune(0, 0xFF80);
+	test_pwm_retune_errors();
+
+	return led_test_summary("test_led_pwm_timing");
+}
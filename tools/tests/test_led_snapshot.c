@@ -0,0 +1,478 @@
+/*
+ * test_led_snapshot.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host simulation of deep sleep and resume through save_led_proc_snapshot and restore_led_proc_snapshot, built
+ * from the repository root:
+ *
+ *	gcc -O2 -Wno-cpp -Itools/sim -Ilib -o test_led_snapshot tools/tests/test_led_snapshot.c lib/led_proc.c
+ *	./test_led_snapshot [-b]
+ *
+ *	-b	also time a resume from the snapshot against a cold boot that sets the same LEDs up again
+ *
+ * Two boards run the same random ops ms by ms, PWM frames every ms and a TEST_TICK_MS tick that calls the
+ * dispatch.  One stays awake, the other goes into a deep sleep at random ticks: its state is saved to a
+ * led_snapshot_t that stands in for retention RAM, then the whole board is wiped, pins and registers included,
+ * and booted again through restore_led_proc_snapshot.  Right after every wake the LED states, blinks, levels and
+ * application state must be those of the awake board, and from then on its pins must be the same every ms, so a
+ * blink or a fade carries on where it was.  The blink table is sparse once a blink is stopped, which is covered on
+ * its own too, and so are the snapshots that must not be resumed.
+ */
+#include <string.h>
+#include "led_proc.h"
+
+#define TEST_NUM_LEDS			8			// LEDs 0 and 4 are PWM, the rest outputs, 4 to a port
+#define LED_TEST_BOARD_LEDS		TEST_NUM_LEDS
+#include "led_test.h"
+
+#define TEST_NUM_PWM			2
+#define TEST_TICK_MS			10
+#define TEST_PWM_HZ				1000
+#define TEST_CLOCK_HZ			24000000
+#define TEST_APP_VERSION		3
+#define TEST_RUN_MS				(20 * 60 * 1000)
+#define TEST_OP_ONE_IN			20			// ticks with an op
+#define TEST_SLEEP_ONE_IN		50			// ticks the sleeping board goes to sleep after
+#define TEST_BENCH_RESUMES		200000
+
+// what the application keeps across a sleep, such as the position of its own fade
+typedef struct test_app_t {
+	unsigned int fade_pos;
+	unsigned char pattern_pos;
+}test_app_t;
+
+// the side table is packed at the front of hal.pwm_states, and hal.hal_writes counts the port writes too
+typedef struct test_board_t {
+	led_test_board_t hal;
+	led_proc_dispatch_t dispatch;
+	test_app_t app;
+	int ticked;									// a tick ran since the board booted or woke
+	int changed;								// an op ran this ms, a new level may only land on the next frame
+}test_board_t;
+
+enum {
+	TEST_AWAKE,
+	TEST_SLEEPER,
+	TEST_NUM_BOARDS
+};
+
+static test_board_t test_boards[TEST_NUM_BOARDS];
+static led_snapshot_t test_retained;			// the only thing that survives the sleep
+
+static int is_test_pwm(int led_num)
+{
+	return led_num % 4 == 0;
+}
+
+// a PWM LED starts at its period and duty cycle in one write, as pwm_set_cycle_and_duty does
+static led_proc_error_type init_test_led(led_t * led)
+{
+	led_test_board_t * board = find_led_test_board(led);
+	led_pwm_state_t * pwm_state = led->led_pwm_state;
+	led_proc_error_type status;
+
+	if (led->led_type != LED_TYPE_PWM)
+		return LED_PROC_ERROR_TYPE_NONE;
+	status = get_led_pwm_timing(TEST_CLOCK_HZ, (unsigned int)pwm_state->led_pwm_hertz, 0, &pwm_state->led_pwm_timing);
+	board->duty[led - board->leds] = pwm_state->led_duty_cycle;
+	board->hal_writes++;
+	return status;
+}
+
+// one write per port, as init_led_outputs does
+static led_proc_error_type init_test_outputs(led_t * leds, int num_leds)
+{
+	led_test_board_t * board = find_led_test_board(leds);
+	unsigned int ports = 0;
+
+	for (int i = 0; i < num_leds; i++)
+	{
+		if (leds[i].led_type != LED_TYPE_OUTPUT)
+			continue;
+		board->pins[i] = (leds[i].led_output_state == LED_ON);
+		ports |= 1u << ((unsigned int)leds[i].led_ptr >> 8);
+	}
+	board->hal_writes += (unsigned int)__builtin_popcount(ports);
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+// the application moves its own fade on every tick, which is the state it keeps in the snapshot
+static void run_test_tick(struct led_proc_t * led_proc)
+{
+	test_board_t * board = (test_board_t *)led_proc->led_context;
+
+	board->app.fade_pos++;
+	board->app.pattern_pos = (unsigned char)(board->app.fade_pos / 7);
+}
+
+// what a boot sets up before init_led_proc, the same cold or from a snapshot
+static void setup_test_board(test_board_t * board)
+{
+	int num_pwm = 0;
+
+	memset(board, 0, sizeof(*board));
+	setup_led_test_board(&board->hal, TEST_NUM_LEDS);
+	board->hal.proc.led_init = init_test_led;
+	board->hal.proc.led_init_outputs = init_test_outputs;
+	board->hal.proc.led_set_compare = set_led_test_compare;
+	board->hal.proc.led_tick = run_test_tick;
+	board->hal.proc.led_tick_period_ms = TEST_TICK_MS;
+	board->hal.proc.led_context = board;
+	for (int i = 0; i < TEST_NUM_LEDS; i++)
+	{
+		board->hal.leds[i].led_ptr = (GPIO_PinTypeDef)(((i / 4) << 8) | (1 << (i % 4)));
+		if (is_test_pwm(i))
+		{
+			board->hal.leds[i].led_type = LED_TYPE_PWM;
+			board->hal.leds[i].led_pwm_state = &board->hal.pwm_states[num_pwm];
+			board->hal.pwm_states[num_pwm].led_pwm_hertz = TEST_PWM_HZ;
+			board->hal.pwm_states[num_pwm].led_group = (unsigned char)num_pwm;
+			num_pwm++;
+		}
+	}
+}
+
+static void boot_test_board(test_board_t * board)
+{
+	setup_test_board(board);
+	LED_CHECK_EQ(init_led_proc(&board->hal.proc, board->hal.leds, TEST_NUM_LEDS), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(register_led_proc_dispatch(&board->dispatch, &board->hal.proc), LED_PROC_ERROR_TYPE_NONE);
+}
+
+// everything but test_retained is lost, returns the result of the restore
+static led_proc_error_type sleep_test_board(test_board_t * board)
+{
+	led_proc_error_type status;
+
+	LED_CHECK_EQ(save_led_proc_snapshot(&board->hal.proc, &test_retained, TEST_APP_VERSION, &board->app, sizeof(board->app)), LED_PROC_ERROR_TYPE_NONE);
+	setup_test_board(board);
+	status = restore_led_proc_snapshot(&board->hal.proc, board->hal.leds, TEST_NUM_LEDS, &test_retained, TEST_APP_VERSION, &board->app, sizeof(board->app));
+	LED_CHECK_EQ(init_led_proc(&board->hal.proc, board->hal.leds, TEST_NUM_LEDS), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(register_led_proc_dispatch(&board->dispatch, &board->hal.proc), LED_PROC_ERROR_TYPE_NONE);
+	return status;
+}
+
+static void run_test_ms(unsigned int now)
+{
+	for (int b = 0; b < TEST_NUM_BOARDS; b++)
+	{
+		test_board_t * board = &test_boards[b];
+
+		// the tick first, so levels it commits are written by the frames of the same ms
+		if (now % TEST_TICK_MS == 0)
+		{
+			run_led_proc_dispatch(&board->dispatch, TEST_TICK_MS);
+			board->ticked = 1;
+		}
+		for (int i = 0; i < TEST_NUM_LEDS; i += 4)
+			run_led_num_pwm_frame(&board->hal.proc, i);
+	}
+}
+
+// the state led_proc keeps, which must come back from the snapshot as it was
+static int check_test_state(test_board_t * awake, test_board_t * sleeper)
+{
+	int ok = 1;
+
+	for (int i = 0; i < TEST_NUM_LEDS; i++)
+	{
+		led_pwm_state_t * want = awake->hal.leds[i].led_pwm_state;
+		led_pwm_state_t * got = sleeper->hal.leds[i].led_pwm_state;
+
+		ok &= LED_CHECK_EQ(sleeper->hal.leds[i].led_output_state, awake->hal.leds[i].led_output_state);
+		if (!is_test_pwm(i))
+			continue;
+		ok &= LED_CHECK_EQ(got->led_duty_cycle, want->led_duty_cycle);
+		ok &= LED_CHECK_EQ(got->led_brightness, want->led_brightness);
+		ok &= LED_CHECK_EQ(got->led_dithering, want->led_dithering);
+		ok &= LED_CHECK_EQ(got->led_pwm_timing.cycles, want->led_pwm_timing.cycles);
+	}
+	ok &= LED_CHECK(memcmp(sleeper->hal.proc.led_blinks, awake->hal.proc.led_blinks, sizeof(awake->hal.proc.led_blinks)) == 0);
+	ok &= LED_CHECK_EQ(sleeper->hal.proc.led_num_blinks, awake->hal.proc.led_num_blinks);
+	ok &= LED_CHECK_EQ(sleeper->hal.proc.led_master_dim, awake->hal.proc.led_master_dim);
+	ok &= LED_CHECK(memcmp(sleeper->hal.proc.led_group_dim, awake->hal.proc.led_group_dim, sizeof(awake->hal.proc.led_group_dim)) == 0);
+	ok &= LED_CHECK(memcmp(&sleeper->app, &awake->app, sizeof(awake->app)) == 0);
+	return ok;
+}
+
+// what the LEDs show, a PWM LED only once the first tick after a wake has put its level back
+static int check_test_pins(test_board_t * awake, test_board_t * sleeper)
+{
+	int ok = 1;
+
+	ok &= LED_CHECK(memcmp(sleeper->hal.pins, awake->hal.pins, sizeof(awake->hal.pins)) == 0);
+	// a level set waits for the next tick to be committed, a wake in between commits it straight away
+	if (!sleeper->ticked || sleeper->changed || awake->hal.proc.led_levels_dirty != 0)
+	{
+		sleeper->changed = 0;
+		return ok;
+	}
+	for (int i = 0; i < TEST_NUM_LEDS; i += 4)
+	{
+		unsigned int want = awake->hal.compare[i];
+		unsigned int got = sleeper->hal.compare[i];
+
+		// the fraction carried by the dithering starts again from 0 on a wake, so a frame can be one count apart
+		if (awake->hal.leds[i].led_pwm_state->led_dithering)
+			ok &= LED_CHECK(got + 1 >= want && got <= want + 1);
+		else
+			ok &= LED_CHECK_EQ(sleeper->hal.duty[i], awake->hal.duty[i]);
+	}
+	return ok;
+}
+
+// one random op, the same on both boards, with the same result
+static void run_test_op(unsigned int * random)
+{
+	unsigned int op = next_test_random(random) % 8;
+	int led_num = 1 + (int)(next_test_random(random) % (TEST_NUM_LEDS - 1));
+	unsigned int period_ticks = 2 + next_test_random(random) % 60;
+	unsigned int on_ticks = 1 + next_test_random(random) % (period_ticks - 1);
+	unsigned int level = next_test_random(random) % (LED_PROC_LEVEL_FULL + 1);
+	unsigned short brightness = (unsigned short)next_test_random(random);
+	int pwm_dc = (int)(next_test_random(random) % (LED_PWM_DUTY_MAX + 1));
+	led_proc_error_type status[TEST_NUM_BOARDS];
+
+	if (is_test_pwm(led_num))
+		led_num++;
+	for (int b = 0; b < TEST_NUM_BOARDS; b++)
+	{
+		struct led_proc_t * proc = &test_boards[b].hal.proc;
+
+		test_boards[b].changed = 1;
+		switch (op)
+		{
+		case 0:
+			status[b] = toggle_led_num_ensure(proc, led_num);
+			break;
+		case 1:
+			status[b] = (level & 1) ? turn_led_num_on(proc, led_num) : turn_led_num_off(proc, led_num);
+			break;
+		case 2:
+		case 3:
+			status[b] = blink_led_num(proc, led_num, period_ticks * TEST_TICK_MS, on_ticks * TEST_TICK_MS);
+			break;
+		case 4:
+			status[b] = stop_led_num_blink(proc, led_num);
+			break;
+		case 5:
+			status[b] = set_led_num_pwm_brightness(proc, 0, brightness);
+			break;
+		case 6:
+			status[b] = set_led_num_pwm_duty_cycle(proc, 4, pwm_dc);
+			break;
+		default:
+			status[b] = (level & 1) ? set_led_proc_master_level(proc, level) : set_led_proc_group_level(proc, (int)(level >> 1) % TEST_NUM_PWM, level);
+			break;
+		}
+	}
+	LED_CHECK_EQ(status[TEST_SLEEPER], status[TEST_AWAKE]);
+}
+
+// random ops for TEST_RUN_MS, with the sleeper going to sleep at random ticks in between
+static void test_snapshot_sleeps(void)
+{
+	unsigned int random = 43;
+	unsigned int sleeps = 0;
+
+	boot_test_board(&test_boards[TEST_AWAKE]);
+	boot_test_board(&test_boards[TEST_SLEEPER]);
+	for (unsigned int now = 1; now <= TEST_RUN_MS; now++)
+	{
+		run_test_ms(now);
+		if (now % TEST_TICK_MS == 0)
+		{
+			if (next_test_random(&random) % TEST_OP_ONE_IN == 0)
+				run_test_op(&random);
+			if (next_test_random(&random) % TEST_SLEEP_ONE_IN == 0)
+			{
+				sleeps++;
+				if (!LED_CHECK_EQ(sleep_test_board(&test_boards[TEST_SLEEPER]), LED_PROC_ERROR_TYPE_NONE)
+						|| !check_test_state(&test_boards[TEST_AWAKE], &test_boards[TEST_SLEEPER]))
+				{
+					printf("wake at %u ms differs\n", now);
+					return;
+				}
+			}
+		}
+		if (!check_test_pins(&test_boards[TEST_AWAKE], &test_boards[TEST_SLEEPER]))
+		{
+			printf("pins differ at %u ms, %u sleeps in\n", now, sleeps);
+			return;
+		}
+	}
+	printf("%u sleeps over %u minutes\n", sleeps, TEST_RUN_MS / 60000);
+	LED_CHECK(sleeps > TEST_RUN_MS / TEST_TICK_MS / TEST_SLEEP_ONE_IN / 2);
+}
+
+// stopping a blink frees its entry wherever it is, a snapshot of the sparse table must still be resumed
+static void test_snapshot_sparse_blinks(void)
+{
+	static const int stops[] = { 1, 2, 5 };
+
+	for (int s = 0; s < (int)(sizeof(stops) / sizeof(stops[0])); s++)
+	{
+		boot_test_board(&test_boards[TEST_AWAKE]);
+		boot_test_board(&test_boards[TEST_SLEEPER]);
+		for (int b = 0; b < TEST_NUM_BOARDS; b++)
+		{
+			LED_CHECK_EQ(blink_led_num(&test_boards[b].hal.proc, 1, 500, 100), LED_PROC_ERROR_TYPE_NONE);
+			LED_CHECK_EQ(blink_led_num(&test_boards[b].hal.proc, 2, 300, 200), LED_PROC_ERROR_TYPE_NONE);
+			LED_CHECK_EQ(blink_led_num(&test_boards[b].hal.proc, 3, 1000, 300), LED_PROC_ERROR_TYPE_NONE);
+			LED_CHECK_EQ(blink_led_num(&test_boards[b].hal.proc, 5, 700, 350), LED_PROC_ERROR_TYPE_NONE);
+			LED_CHECK_EQ(stop_led_num_blink(&test_boards[b].hal.proc, stops[s]), LED_PROC_ERROR_TYPE_NONE);
+		}
+		for (unsigned int now = 1; now <= 1230; now++)
+			run_test_ms(now);
+
+		LED_CHECK_EQ(test_boards[TEST_SLEEPER].hal.proc.led_num_blinks, 3);
+		LED_CHECK_EQ(sleep_test_board(&test_boards[TEST_SLEEPER]), LED_PROC_ERROR_TYPE_NONE);
+		check_test_state(&test_boards[TEST_AWAKE], &test_boards[TEST_SLEEPER]);
+		for (unsigned int now = 1231; now <= 10000; now++)
+		{
+			run_test_ms(now);
+			if (!check_test_pins(&test_boards[TEST_AWAKE], &test_boards[TEST_SLEEPER]))
+			{
+				printf("blink %d stopped, pins differ at %u ms\n", stops[s], now);
+				break;
+			}
+		}
+	}
+}
+
+// a snapshot that must not be resumed leaves the LED array as it was, and the board boots cold
+static void test_snapshot_rejected(void)
+{
+	test_board_t * board = &test_boards[TEST_SLEEPER];
+	test_app_t app;
+	led_t leds[TEST_NUM_LEDS];
+	unsigned char big[LED_SNAPSHOT_APP_SIZE + 1];
+	unsigned int random = 7;
+
+	// retention RAM after a power on holds anything
+	for (unsigned int i = 0; i < sizeof(test_retained); i++)
+		((unsigned char *)&test_retained)[i] = (unsigned char)next_test_random(&random);
+	setup_test_board(board);
+	memcpy(leds, board->hal.leds, sizeof(leds));
+	LED_CHECK_EQ(restore_led_proc_snapshot(&board->hal.proc, board->hal.leds, TEST_NUM_LEDS, &test_retained, TEST_APP_VERSION, &app, sizeof(app)), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK(memcmp(leds, board->hal.leds, sizeof(leds)) == 0);
+
+	boot_test_board(board);
+	LED_CHECK_EQ(turn_led_num_on(&board->hal.proc, 1), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(blink_led_num(&board->hal.proc, 2, 400, 100), LED_PROC_ERROR_TYPE_NONE);
+
+	// a flipped bit anywhere is caught by the check, and the snapshot is not tried again
+	LED_CHECK_EQ(save_led_proc_snapshot(&board->hal.proc, &test_retained, TEST_APP_VERSION, &board->app, sizeof(board->app)), LED_PROC_ERROR_TYPE_NONE);
+	test_retained.snap_app[3] ^= 0x10;
+	setup_test_board(board);
+	LED_CHECK_EQ(restore_led_proc_snapshot(&board->hal.proc, board->hal.leds, TEST_NUM_LEDS, &test_retained, TEST_APP_VERSION, &app, sizeof(app)), LED_PROC_ERROR_TYPE_BAD_STATE);
+	test_retained.snap_app[3] ^= 0x10;
+	LED_CHECK_EQ(restore_led_proc_snapshot(&board->hal.proc, board->hal.leds, TEST_NUM_LEDS, &test_retained, TEST_APP_VERSION, &app, sizeof(app)), LED_PROC_ERROR_TYPE_BAD_STATE);
+
+	// resumed once only
+	boot_test_board(board);
+	LED_CHECK_EQ(save_led_proc_snapshot(&board->hal.proc, &test_retained, TEST_APP_VERSION, &board->app, sizeof(board->app)), LED_PROC_ERROR_TYPE_NONE);
+	setup_test_board(board);
+	LED_CHECK_EQ(restore_led_proc_snapshot(&board->hal.proc, board->hal.leds, TEST_NUM_LEDS, &test_retained, TEST_APP_VERSION, &app, sizeof(app)), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(restore_led_proc_snapshot(&board->hal.proc, board->hal.leds, TEST_NUM_LEDS, &test_retained, TEST_APP_VERSION, &app, sizeof(app)), LED_PROC_ERROR_TYPE_BAD_STATE);
+
+	// taken of another array, or of another application state
+	boot_test_board(board);
+	LED_CHECK_EQ(blink_led_num(&board->hal.proc, 2, 400, 100), LED_PROC_ERROR_TYPE_NONE);
+	for (int change = 0; change < 4; change++)
+	{
+		LED_CHECK_EQ(save_led_proc_snapshot(&board->hal.proc, &test_retained, TEST_APP_VERSION, &board->app, sizeof(board->app)), LED_PROC_ERROR_TYPE_NONE);
+		setup_test_board(board);
+		if (change == 0)
+			LED_CHECK_EQ(restore_led_proc_snapshot(&board->hal.proc, board->hal.leds, TEST_NUM_LEDS - 1, &test_retained, TEST_APP_VERSION, &app, sizeof(app)), LED_PROC_ERROR_TYPE_BAD_STATE);
+		else if (change == 1)
+			LED_CHECK_EQ(restore_led_proc_snapshot(&board->hal.proc, board->hal.leds, TEST_NUM_LEDS, &test_retained, TEST_APP_VERSION + 1, &app, sizeof(app)), LED_PROC_ERROR_TYPE_BAD_STATE);
+		else if (change == 2)
+			LED_CHECK_EQ(restore_led_proc_snapshot(&board->hal.proc, board->hal.leds, TEST_NUM_LEDS, &test_retained, TEST_APP_VERSION, &app, sizeof(app) - 1), LED_PROC_ERROR_TYPE_BAD_STATE);
+		else
+		{
+			// the blinking LED is PWM on the new board
+			board->hal.leds[2].led_type = LED_TYPE_PWM;
+			board->hal.leds[2].led_pwm_state = &board->hal.pwm_states[0];
+			memcpy(leds, board->hal.leds, sizeof(leds));
+			LED_CHECK_EQ(restore_led_proc_snapshot(&board->hal.proc, board->hal.leds, TEST_NUM_LEDS, &test_retained, TEST_APP_VERSION, &app, sizeof(app)), LED_PROC_ERROR_TYPE_BAD_STATE);
+			LED_CHECK(memcmp(leds, board->hal.leds, sizeof(leds)) == 0);
+		}
+		boot_test_board(board);
+		LED_CHECK_EQ(blink_led_num(&board->hal.proc, 2, 400, 100), LED_PROC_ERROR_TYPE_NONE);
+	}
+
+	// more than a snapshot holds is turned down when it is taken
+	LED_CHECK_EQ(save_led_proc_snapshot(&board->hal.proc, &test_retained, TEST_APP_VERSION, big, sizeof(big)), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(restore_led_proc_snapshot(&board->hal.proc, board->hal.leds, TEST_NUM_LEDS, &test_retained, TEST_APP_VERSION, big, sizeof(big)), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(save_led_proc_snapshot(NULL, &test_retained, TEST_APP_VERSION, NULL, 0), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(restore_led_proc_snapshot(&board->hal.proc, board->hal.leds, TEST_NUM_LEDS, NULL, TEST_APP_VERSION, NULL, 0), LED_PROC_ERROR_TYPE_NULL);
+}
+
+// the same LEDs set up again by a cold boot, the blinks start over and the application state is lost
+static void set_test_board_up(test_board_t * board)
+{
+	boot_test_board(board);
+	turn_led_num_on(&board->hal.proc, 1);
+	turn_led_num_on(&board->hal.proc, 6);
+	blink_led_num(&board->hal.proc, 2, 500, 100);
+	blink_led_num(&board->hal.proc, 3, 300, 200);
+	set_led_num_pwm_brightness(&board->hal.proc, 0, 20000);
+	set_led_num_pwm_duty_cycle(&board->hal.proc, 4, 35);
+	set_led_proc_master_level(&board->hal.proc, LED_PROC_LEVEL_FULL / 2);
+	commit_led_proc_levels(&board->hal.proc);
+}
+
+static void bench_led_snapshot(void)
+{
+	test_board_t * board = &test_boards[TEST_SLEEPER];
+	unsigned int cold_writes;
+	unsigned int resume_writes;
+	double start;
+	double cold;
+	double save;
+	double resume;
+
+	start = get_test_seconds();
+	for (int n = 0; n < TEST_BENCH_RESUMES; n++)
+		set_test_board_up(board);
+	cold = (get_test_seconds() - start) / TEST_BENCH_RESUMES;
+	cold_writes = board->hal.hal_writes;
+
+	start = get_test_seconds();
+	for (int n = 0; n < TEST_BENCH_RESUMES; n++)
+		save_led_proc_snapshot(&board->hal.proc, &test_retained, TEST_APP_VERSION, &board->app, sizeof(board->app));
+	save = (get_test_seconds() - start) / TEST_BENCH_RESUMES;
+
+	start = get_test_seconds();
+	for (int n = 0; n < TEST_BENCH_RESUMES; n++)
+	{
+		// restoring invalidates the snapshot, so the magic is put back each time as a fresh save would leave it
+		test_retained.snap_magic = LED_SNAPSHOT_MAGIC;
+		setup_test_board(board);
+		restore_led_proc_snapshot(&board->hal.proc, board->hal.leds, TEST_NUM_LEDS, &test_retained, TEST_APP_VERSION, &board->app, sizeof(board->app));
+		init_led_proc(&board->hal.proc, board->hal.leds, TEST_NUM_LEDS);
+		register_led_proc_dispatch(&board->dispatch, &board->hal.proc);
+	}
+	resume = (get_test_seconds() - start) / TEST_BENCH_RESUMES;
+	resume_writes = board->hal.hal_writes;
+
+	printf("led_snapshot_t is %u bytes of retention RAM\n", (unsigned int)sizeof(led_snapshot_t));
+	printf("%-12s %12s %12s\n", "", "ns", "HAL writes");
+	printf("%-12s %12.1f %12s\n", "save", save * 1e9, "-");
+	printf("%-12s %12.1f %12u\n", "cold boot", cold * 1e9, cold_writes);
+	printf("%-12s %12.1f %12u\n", "resume", resume * 1e9, resume_writes);
+}
+
+int main(int argc, char ** argv)
+{
+	test_snapshot_sleeps();
+	test_snapshot_sparse_blinks();
+	test_snapshot_rejected();
+
+	if (argc > 1 && strcmp(argv[1], "-b") == 0)
+		bench_led_snapshot();
+
+	return led_test_summary("test_led_snapshot");
+}
@@ -0,0 +1,338 @@
+/*
+ * test_led_store.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of led_store against the RAM flash of tools/sim/tl_flash.c, built from the repository root:
+ *
+ *	gcc -O2 -Itools/sim -Ilib -o test_led_store tools/tests/test_led_store.c tools/sim/tl_flash.c lib/led_store.c
+ *	./test_led_store
+ *
+ * Round trips values through the flash, checks the holdoff coalesces writes and that the erases are spread over
+ * the ring.  Then replays the same run of updates with the power cut after every single flash op in turn, and
+ * checks each key comes back from the torn flash with either the value it had before the cut or the one being
+ * written, and that the store goes on working afterwards.
+ */
+#include <string.h>
+#include "led_store.h"
+#include "tl_flash.h"
+#include "led_test.h"
+
+#define STORE_ADDR			0x70000
+#define STORE_SECTOR_SIZE	TL_FLASH_SECTOR_SIZE
+#define STORE_NUM_SECTORS	4
+#define STORE_RECORD_SIZE	4
+#define STORE_RECORD_OPS	(STORE_RECORD_SIZE + 1)	// the check byte is programmed again on its own, last
+
+#define CUT_STEPS			2600		// updates replayed for every cut, enough to go round the ring once
+
+static led_proc_error_type read_store_flash(unsigned int addr, unsigned char * buf, unsigned int len)
+{
+	flash_read_page(addr, len, buf);
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type write_store_flash(unsigned int addr, unsigned char * buf, unsigned int len)
+{
+	flash_write_page(addr, len, buf);
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type erase_store_flash(unsigned int addr)
+{
+	flash_erase_sector(addr);
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type open_store(struct led_store_t * store, unsigned int holdoff)
+{
+	memset(store, 0, sizeof(*store));
+	store->store_read = read_store_flash;
+	store->store_write = write_store_flash;
+	store->store_erase = erase_store_flash;
+	store->store_base_addr = STORE_ADDR;
+	store->store_sector_size = STORE_SECTOR_SIZE;
+	store->store_num_sectors = STORE_NUM_SECTORS;
+	store->store_holdoff = holdoff;
+	return init_led_store(store);
+}
+
+static unsigned int test_seed;
+
+static unsigned int test_random(void)
+{
+	test_seed = test_seed * 1103515245u + 12345u;
+	return test_seed >> 16;
+}
+
+// the same CRC-8 as led_store, to plant records in the flash
+static unsigned char record_check(unsigned char key, unsigned short value)
+{
+	unsigned char bytes[3] = { key, (unsigned char)(value & 0xFF), (unsigned char)(value >> 8) };
+	unsigned char crc = 0xFF;
+
+	for (int i = 0; i < 3; i++)
+	{
+		crc ^= bytes[i];
+		for (int b = 0; b < 8; b++)
+			crc = (crc & 0x80) ? (unsigned char)((crc << 1) ^ 0x07) : (unsigned char)(crc << 1);
+	}
+	return (crc == 0xFF) ? 0x7F : crc;
+}
+
+static void plant_record(unsigned int addr, unsigned char key, unsigned short value)
+{
+	unsigned char record[STORE_RECORD_SIZE] = { key, record_check(key, value), (unsigned char)(value & 0xFF), (unsigned char)(value >> 8) };
+	flash_write_page(addr, STORE_RECORD_SIZE, record);
+}
+
+// every key that is valid in one store is valid with the same value in the other
+static int check_same_values(struct led_store_t * got, struct led_store_t * want)
+{
+	int ok = LED_CHECK_EQ(got->valid_mask, want->valid_mask);
+
+	for (int key = 0; key < LED_STORE_MAX_KEYS && ok; key++)
+	{
+		if (want->valid_mask & (1u << key))
+			ok = LED_CHECK_EQ(got->values[key], want->values[key]);
+	}
+	return ok;
+}
+
+static void test_led_store_basics(void)
+{
+	struct led_store_t store;
+	struct led_store_t reopened;
+	unsigned short value;
+	unsigned long ops;
+
+	tl_flash_reset();
+	LED_CHECK_EQ(open_store(&store, 100), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(store.active_sector, 0);
+	LED_CHECK_EQ(get_led_store_value(&store, 0, &value), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(get_led_store_value(&store, LED_STORE_MAX_KEYS, &value), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(set_led_store_value(&store, -1, 0), LED_PROC_ERROR_TYPE_BAD_STATE);
+
+	// nothing is written until the holdoff has passed since the last write
+	LED_CHECK_EQ(set_led_store_value(&store, 0, 5), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(get_led_store_value(&store, 0, &value), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(value, 5);
+	ops = tl_flash_stats.ops;
+	process_led_store(&store, 50);
+	LED_CHECK_EQ(tl_flash_stats.ops, ops);
+	process_led_store(&store, 100);
+	LED_CHECK_EQ(tl_flash_stats.ops, ops + STORE_RECORD_OPS);
+
+	// changes within the holdoff are coalesced, only the latest is written
+	set_led_store_value(&store, 0, 6);
+	set_led_store_value(&store, 0, 7);
+	set_led_store_value(&store, 1, 1);
+	ops = tl_flash_stats.ops;
+	process_led_store(&store, 150);
+	LED_CHECK_EQ(tl_flash_stats.ops, ops);
+	process_led_store(&store, 200);
+	LED_CHECK_EQ(tl_flash_stats.ops, ops + 2 * STORE_RECORD_OPS);
+
+	// setting the value a key already has does not mark it dirty
+	set_led_store_value(&store, 0, 7);
+	ops = tl_flash_stats.ops;
+	process_led_store(&store, 1000);
+	LED_CHECK_EQ(tl_flash_stats.ops, ops);
+
+	LED_CHECK_EQ(open_store(&reopened, 100), LED_PROC_ERROR_TYPE_NONE);
+	check_same_values(&reopened, &store);
+	LED_CHECK_EQ(reopened.write_offset, store.write_offset);
+
+	// a flash with no valid header anywhere is formatted
+	tl_flash_reset();
+	memset(&tl_flash[STORE_ADDR], 0x5A, STORE_SECTOR_SIZE);
+	LED_CHECK_EQ(open_store(&store, 0), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(store.active_sector, 0);
+	LED_CHECK_EQ(store.valid_mask, 0);
+	LED_CHECK_EQ(tl_flash[STORE_ADDR], LED_STORE_KEY_HEADER);
+}
+
+static void test_led_store_round_trip(void)
+{
+	struct led_store_t store;
+	struct led_store_t reopened;
+	unsigned int min;
+	unsigned int max;
+
+	tl_flash_reset();
+	test_seed = 1;
+	LED_CHECK_EQ(open_store(&store, 0), LED_PROC_ERROR_TYPE_NONE);
+
+	for (int i = 0; i < 40000; i++)
+	{
+		set_led_store_value(&store, (int)(test_random() % LED_STORE_MAX_KEYS), (unsigned short)test_random());
+		if (test_random() % 4 == 0)
+			LED_CHECK_EQ(flush_led_store(&store), LED_PROC_ERROR_TYPE_NONE);
+
+		if (i % 997 == 0)
+		{
+			flush_led_store(&store);
+			LED_CHECK_EQ(open_store(&reopened, 0), LED_PROC_ERROR_TYPE_NONE);
+			if (!check_same_values(&reopened, &store) || !LED_CHECK_EQ(reopened.active_sector, store.active_sector))
+				break;
+		}
+	}
+
+	// compaction moves on round the ring, so no sector wears out ahead of the others
+	LED_CHECK(tl_flash_stats.sectors_erased > 2 * STORE_NUM_SECTORS);
+	tl_flash_erase_spread(STORE_ADDR, STORE_NUM_SECTORS, &min, &max);
+	LED_CHECK(max - min <= 1);
+}
+
+static void test_led_store_seq_wrap(void)
+{
+	struct led_store_t store;
+	struct led_store_t reopened;
+	unsigned short seq;
+
+	// start just short of the wrap, the newest sector must still win once the sequence number has wrapped
+	tl_flash_reset();
+	plant_record(STORE_ADDR, LED_STORE_KEY_HEADER, 0xFFFE);
+	plant_record(STORE_ADDR + STORE_RECORD_SIZE, 3, 0x1234);
+	LED_CHECK_EQ(open_store(&store, 0), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(store.sector_seq, 0xFFFE);
+	seq = store.sector_seq;
+
+	for (int i = 0; i < 6 * STORE_SECTOR_SIZE / STORE_RECORD_SIZE; i++)
+	{
+		set_led_store_value(&store, 0, (unsigned short)i);
+		flush_led_store(&store);
+		if (store.sector_seq != seq)
+		{
+			seq = store.sector_seq;
+			LED_CHECK_EQ(open_store(&reopened, 0), LED_PROC_ERROR_TYPE_NONE);
+			LED_CHECK_EQ(reopened.active_sector, store.active_sector);
+			LED_CHECK_EQ(reopened.sector_seq, seq);
+			check_same_values(&reopened, &store);
+		}
+	}
+	LED_CHECK_EQ(seq, 4);
+}
+
+typedef struct cut_model_t {
+	unsigned short durable[LED_STORE_MAX_KEYS];		// values of the last flush that finished
+	unsigned int durable_mask;
+	unsigned short writing[LED_STORE_MAX_KEYS];		// values of the flush the power was cut in
+	unsigned int writing_mask;
+}cut_model_t;
+
+// the same updates for every cut, returns 1 if the power was cut before they were all flushed
+static int run_cut_steps(struct led_store_t * store, cut_model_t * model)
+{
+	memset(model, 0, sizeof(*model));
+	test_seed = 7;
+
+	for (int step = 0; step < CUT_STEPS; step++)
+	{
+		int num_keys = 1 + (int)(test_random() % 3);
+
+		model->writing_mask = 0;
+		for (int i = 0; i < num_keys; i++)
+		{
+			int key = (int)(test_random() % LED_STORE_MAX_KEYS);
+			unsigned short value = (unsigned short)test_random();
+			set_led_store_value(store, key, value);
+			model->writing[key] = value;
+			model->writing_mask |= 1u << key;
+		}
+		flush_led_store(store);
+		if (!tl_flash_powered())
+			return 1;
+
+		for (int key = 0; key < LED_STORE_MAX_KEYS; key++)
+		{
+			if (model->writing_mask & (1u << key))
+				model->durable[key] = model->writing[key];
+		}
+		model->durable_mask |= model->writing_mask;
+	}
+	return 0;
+}
+
+// checks what came back from the torn flash, returns 0 on the first key that is wrong
+static int check_cut_values(struct led_store_t * store, cut_model_t * model)
+{
+	for (int key = 0; key < LED_STORE_MAX_KEYS; key++)
+	{
+		unsigned int bit = 1u << key;
+		int ok;
+
+		if (store->valid_mask & bit)
+		{
+			ok = ((model->durable_mask & bit) && store->values[key] == model->durable[key])
+					|| ((model->writing_mask & bit) && store->values[key] == model->writing[key]);
+		}
+		else
+		{
+			// a key only goes missing if it was never flushed before
+			ok = !(model->durable_mask & bit);
+		}
+
+		if (!LED_CHECK(ok))
+		{
+			printf("  key %d came back %s 0x%04X\n", key, (store->valid_mask & bit) ? "as" : "missing, was", store->values[key]);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static void test_led_store_power_cut(void)
+{
+	struct led_store_t store;
+	struct led_store_t reopened;
+	cut_model_t model;
+	unsigned long total_ops;
+
+	// a clean run to count the flash ops to cut at
+	tl_flash_reset();
+	open_store(&store, 0);
+	tl_flash_stats.ops = 0;
+	LED_CHECK_EQ(run_cut_steps(&store, &model), 0);
+	total_ops = tl_flash_stats.ops;
+	LED_CHECK(tl_flash_stats.sectors_erased >= STORE_NUM_SECTORS);
+
+	for (unsigned long cut = 0; cut < total_ops; cut++)
+	{
+		tl_flash_reset();
+		open_store(&store, 0);
+		tl_flash_cut_after((long)cut);
+		if (!LED_CHECK_EQ(run_cut_steps(&store, &model), 1))
+			break;
+
+		tl_flash_power_on();
+		if (!LED_CHECK_EQ(open_store(&reopened, 0), LED_PROC_ERROR_TYPE_NONE) || !check_cut_values(&reopened, &model))
+		{
+			printf("  power cut after %lu of %lu flash ops\n", cut, total_ops);
+			break;
+		}
+
+		// the store carries on from the torn flash, through a compaction if the cut was near one
+		for (int i = 0; i < 2 * LED_STORE_MAX_KEYS; i++)
+		{
+			set_led_store_value(&reopened, i % LED_STORE_MAX_KEYS, (unsigned short)(cut + (unsigned long)i));
+			flush_led_store(&reopened);
+		}
+		LED_CHECK_EQ(open_store(&store, 0), LED_PROC_ERROR_TYPE_NONE);
+		if (!check_same_values(&store, &reopened))
+		{
+			printf("  store did not recover from a power cut after %lu of %lu flash ops\n", cut, total_ops);
+			break;
+		}
+	}
+}
+
+int main(void)
+{
+	test_led_store_basics();
+	test_led_store_round_trip();
+	test_led_store_seq_wrap();
+	test_led_store_power_cut();
+
+	return led_test_summary("test_led_store");
+}
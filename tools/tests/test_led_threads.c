@@ -0,0 +1,294 @@
+/*
+ * test_led_threads.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of led_proc with several threads driving the same LEDs, built from the repository root.  Once with the
+ * compare-and-swap path, once with the critical section hooks, and once under ThreadSanitizer:
+ *
+ *	gcc -O2 -pthread -Itools/sim -Ilib -o test_led_threads tools/tests/test_led_threads.c lib/led_proc.c
+ *	gcc -O2 -pthread -Itools/sim -Ilib -DLED_PROC_HAS_ATOMIC_CAS=0 -o test_led_threads_locked tools/tests/test_led_threads.c lib/led_proc.c
+ *	gcc -O1 -g -fsanitize=thread -pthread -Itools/sim -Ilib -o test_led_threads_tsan tools/tests/test_led_threads.c lib/led_proc.c
+ *	./test_led_threads [-b]
+ *
+ *	-b	also time the threads, all on the same LEDs and then on an LED each
+ *
+ * The HAL keeps the pins in memory, written with atomics as a port register would be.  Every thread counts the
+ * toggles it made, and once they are all joined each LED must be in the state the total number of toggles gives,
+ * with its pin driven to match.  The pins can also be made to lag, so a write only reads back after a number of
+ * reads.  A lag of up to LED_PROC_ENSURE_READS - 1 reads must not fail a toggle or cost it a second write.  A lag
+ * of LED_PROC_ENSURE_READS must fail it as a pin that does not follow, after one more write.  The hooks are a
+ * pthread mutex.  ThreadSanitizer is only meant for the compare-and-swap path, the fallback reads led_output_state
+ * outside the hooks, which is a single byte load on the TLS8258.
+ */
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include "led_proc.h"
+
+#define TEST_NUM_LEDS		4
+#define LED_TEST_BOARD_LEDS	TEST_NUM_LEDS
+#include "led_test.h"
+
+#define TEST_MAX_THREADS	8
+#define TEST_TOGGLES		200000		// per thread
+
+// the LEDs and led_proc_t of the board, with test_pins for its pins
+static led_test_board_t test_board;
+// the level that reads back in bit 0, the level last written in bit 1, and the reads left until it reads back
+// from bit 8 up, so a write and the reads that let it catch up are each one atomic step
+static unsigned int test_pins[TEST_NUM_LEDS];
+static unsigned int test_lag;				// reads a write takes to read back
+static unsigned long test_writes;
+static pthread_mutex_t test_lock;
+
+typedef struct test_thread_t {
+	pthread_t thread;
+	unsigned int seed;
+	int spread;						// 1 to only use the LED of the thread, 0 to pick any of them
+	int mixed;						// 1 to also turn LEDs on and off, which makes the toggle count meaningless
+	unsigned long toggles[TEST_NUM_LEDS];
+	unsigned long errors;
+}test_thread_t;
+
+static led_proc_error_type init_test_led(led_t * led)
+{
+	__atomic_store_n(&test_pins[led->led_ptr], 0, __ATOMIC_RELAXED);
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type set_test_polarity(led_t * led, led_output_state_t state)
+{
+	unsigned int pin = __atomic_load_n(&test_pins[led->led_ptr], __ATOMIC_RELAXED);
+	unsigned int lag = __atomic_load_n(&test_lag, __ATOMIC_RELAXED);
+	unsigned int written;
+
+	do {
+		written = (lag == 0) ? (unsigned int)state * 3 : (pin & 1) | ((unsigned int)state << 1) | (lag << 8);
+	} while (!__atomic_compare_exchange_n(&test_pins[led->led_ptr], &pin, written, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	__atomic_fetch_add(&test_writes, 1, __ATOMIC_RELAXED);
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type get_test_state(led_t * led, int * state)
+{
+	unsigned int pin = __atomic_load_n(&test_pins[led->led_ptr], __ATOMIC_ACQUIRE);
+	unsigned int caught_up;
+
+	do {
+		if ((pin >> 8) == 0)
+			break;
+		// the last read before the write reads back still gets the old level
+		caught_up = ((pin >> 8) == 1) ? ((pin >> 1) & 1) * 3 : pin - (1 << 8);
+	} while (!__atomic_compare_exchange_n(&test_pins[led->led_ptr], &pin, caught_up, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+	*state = (int)(pin & 1);
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+// the level last written, which a lagging pin reads back once it catches up
+static int get_test_pin(int led_num)
+{
+	return (int)((__atomic_load_n(&test_pins[led_num], __ATOMIC_ACQUIRE) >> 1) & 1);
+}
+
+static unsigned int enter_test_critical(void)
+{
+	pthread_mutex_lock(&test_lock);
+	return 0;
+}
+
+static void exit_test_critical(unsigned int key)
+{
+	pthread_mutex_unlock(&test_lock);
+}
+
+static void init_test_proc(void)
+{
+	pthread_mutexattr_t attr;
+
+	// recursive, as a nested interrupt mask would be
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&test_lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+
+	setup_led_test_board(&test_board, TEST_NUM_LEDS);
+	test_board.proc.led_init = init_test_led;
+	test_board.proc.led_set_polarity = set_test_polarity;
+	test_board.proc.led_get_state = get_test_state;
+	test_board.proc.led_enter_critical = enter_test_critical;
+	test_board.proc.led_exit_critical = exit_test_critical;
+	for (int i = 0; i < TEST_NUM_LEDS; i++)
+		test_board.leds[i].led_ptr = (GPIO_PinTypeDef)i;
+	init_led_proc(&test_board.proc, test_board.leds, TEST_NUM_LEDS);
+}
+
+static void * run_test_thread(void * arg)
+{
+	test_thread_t * t = (test_thread_t *)arg;
+	int own_led = (int)(t->seed % TEST_NUM_LEDS);		// seeded with the number of the thread
+
+	for (int i = 0; i < TEST_TOGGLES; i++)
+	{
+		int led_num;
+		led_proc_error_type status;
+
+		t->seed = t->seed * 1103515245u + 12345u;
+		led_num = t->spread ? own_led : (int)((t->seed >> 16) % TEST_NUM_LEDS);
+
+		if (t->mixed && ((t->seed >> 8) & 3) == 0)
+			status = ((t->seed >> 12) & 1) ? turn_led_num_on(&test_board.proc, led_num) : turn_led_num_off(&test_board.proc, led_num);
+		else
+		{
+			status = toggle_led_num_ensure(&test_board.proc, led_num);
+			t->toggles[led_num]++;
+		}
+
+		if (status != LED_PROC_ERROR_TYPE_NONE)
+			t->errors++;
+	}
+
+	return NULL;
+}
+
+static double run_test_threads(test_thread_t * threads, int num_threads, int spread, int mixed)
+{
+	struct timespec start;
+	struct timespec end;
+
+	memset(threads, 0, sizeof(test_thread_t) * (size_t)num_threads);
+	for (int i = 0; i < TEST_NUM_LEDS; i++)
+		turn_led_num_off(&test_board.proc, i);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < num_threads; i++)
+	{
+		threads[i].seed = (unsigned int)i;
+		threads[i].spread = spread;
+		threads[i].mixed = mixed;
+		pthread_create(&threads[i].thread, NULL, run_test_thread, &threads[i]);
+	}
+	for (int i = 0; i < num_threads; i++)
+		pthread_join(threads[i].thread, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// no toggle was lost, every LED is in the state its toggle count gives and its pin agrees
+static void test_led_toggles(int num_threads)
+{
+	test_thread_t threads[TEST_MAX_THREADS];
+	unsigned long errors = 0;
+
+	run_test_threads(threads, num_threads, 0, 0);
+	for (int led = 0; led < TEST_NUM_LEDS; led++)
+	{
+		unsigned long toggles = 0;
+
+		for (int i = 0; i < num_threads; i++)
+			toggles += threads[i].toggles[led];
+		LED_CHECK_EQ(test_board.leds[led].led_output_state, (toggles & 1) ? LED_ON : LED_OFF);
+		LED_CHECK_EQ(get_test_pin(led), test_board.leds[led].led_output_state);
+	}
+	for (int i = 0; i < num_threads; i++)
+		errors += threads[i].errors;
+	LED_CHECK_EQ(errors, 0);
+}
+
+// with turns mixed in only the pins can be checked, each must be left where its LED state says
+static void test_led_mixed(int num_threads)
+{
+	test_thread_t threads[TEST_MAX_THREADS];
+	unsigned long errors = 0;
+
+	run_test_threads(threads, num_threads, 0, 1);
+	for (int led = 0; led < TEST_NUM_LEDS; led++)
+		LED_CHECK_EQ(get_test_pin(led), test_board.leds[led].led_output_state);
+	for (int i = 0; i < num_threads; i++)
+		errors += threads[i].errors;
+	LED_CHECK_EQ(errors, 0);
+}
+
+// a pin that reads back a few reads after it was written is waited for, not driven again.  One that takes longer
+// than every read is driven once more, and one that never catches up fails the toggles that need it to move,
+// though led_output_state still takes them
+static void test_led_lagging(void)
+{
+	test_thread_t threads[TEST_NUM_LEDS];
+	unsigned long errors = 0;
+	unsigned int lags[] = { 1, LED_PROC_ENSURE_READS - 1, LED_PROC_ENSURE_READS, 1000 };
+	int level;
+
+	for (int l = 0; l < (int)(sizeof(lags) / sizeof(lags[0])); l++)
+	{
+		unsigned long writes = 0;
+
+		__atomic_store_n(&test_lag, lags[l], __ATOMIC_RELAXED);
+		turn_led_num_off(&test_board.proc, 0);
+		for (int i = 0; i < 100; i++)
+			get_test_state(&test_board.leds[0], &level);
+		test_writes = 0;
+		for (int i = 0; i < 1000; i++)
+		{
+			led_output_state_t state = (i & 1) ? LED_OFF : LED_ON;
+			// stuck low as far as the reads go, turning it off needs nothing to read back
+			int stuck = (lags[l] > 2 * LED_PROC_ENSURE_READS);
+			led_proc_error_type expected = (stuck && state == LED_ON) ? LED_PROC_ERROR_TYPE_BAD_STATE : LED_PROC_ERROR_TYPE_NONE;
+
+			if (!LED_CHECK_EQ(toggle_led_ensure(&test_board.proc, &test_board.leds[0]), expected))
+			{
+				printf("toggle %d with a lag of %u reads\n", i, lags[l]);
+				break;
+			}
+			LED_CHECK_EQ(test_board.leds[0].led_output_state, state);
+			writes += (lags[l] < LED_PROC_ENSURE_READS || (stuck && state == LED_OFF)) ? 1 : 2;
+		}
+		LED_CHECK_EQ(test_writes, writes);
+		LED_CHECK_EQ(get_test_pin(0), LED_OFF);
+	}
+
+	// a thread on each LED, so nothing but the lag keeps a pin from reading back
+	__atomic_store_n(&test_lag, LED_PROC_ENSURE_READS - 1, __ATOMIC_RELAXED);
+	run_test_threads(threads, TEST_NUM_LEDS, 1, 0);
+	for (int led = 0; led < TEST_NUM_LEDS; led++)
+	{
+		LED_CHECK_EQ(test_board.leds[led].led_output_state, (threads[led].toggles[led] & 1) ? LED_ON : LED_OFF);
+		LED_CHECK_EQ(get_test_pin(led), test_board.leds[led].led_output_state);
+		errors += threads[led].errors;
+	}
+	LED_CHECK_EQ(errors, 0);
+	__atomic_store_n(&test_lag, 0, __ATOMIC_RELAXED);
+}
+
+static void bench_led_threads(void)
+{
+	test_thread_t threads[TEST_MAX_THREADS];
+
+	printf("%8s %16s %16s\n", "threads", "shared Mop/s", "LED each Mop/s");
+	for (int num_threads = 1; num_threads <= TEST_MAX_THREADS; num_threads *= 2)
+	{
+		double shared = run_test_threads(threads, num_threads, 0, 0);
+		double spread = run_test_threads(threads, num_threads, 1, 0);
+		double ops = (double)num_threads * TEST_TOGGLES / 1e6;
+
+		printf("%8d %16.2f %16.2f\n", num_threads, ops / shared, ops / spread);
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	printf("%s path\n", LED_PROC_HAS_ATOMIC_CAS ? "compare-and-swap" : "critical section");
+	init_test_proc();
+
+	for (int num_threads = 1; num_threads <= TEST_MAX_THREADS; num_threads *= 2)
+	{
+		test_led_toggles(num_threads);
+		test_led_mixed(num_threads);
+	}
+	test_led_lagging();
+	if (argc > 1 && strcmp(argv[1], "-b") == 0)
+		bench_led_threads();
+
+	return led_test_summary("test_led_threads");
+}
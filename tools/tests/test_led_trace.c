@@ -0,0 +1,424 @@
+/*
+ * test_led_trace.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of the VCD and Chrome trace JSON written by led_trace, built from the repository root:
+ *
+ *	gcc -O2 -Wno-cpp -Itools/sim -Ilib -o test_led_trace tools/tests/test_led_trace.c lib/led_trace.c
+ *	./test_led_trace [-b]
+ *
+ *	-b	also time log_led_trace for a value that changed and one that did not, in both formats
+ *
+ * An hour of random changes on pins, interrupts and a 16 bit compare is logged at a 16MHz tick that wraps its 32
+ * bits many times over, with the odd tick that comes in late.  The trace is caught from trace_write, which must
+ * only ever be handed a full buffer but for the last, and is read back: the VCD by its header, timestamps and
+ * value changes, and the JSON by its counter events.  What is read back must be the changes of a model of the
+ * tracks, exactly and at the right picosecond or nanosecond, and the trace_stats must add up to it.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "led_trace.h"
+#include "led_test.h"
+
+#define TEST_TICK_HZ			16000000
+#define TEST_TICK_PS			62500			// of a TEST_TICK_HZ tick
+#define TEST_HOUR_TICKS			(3600ULL * TEST_TICK_HZ)
+#define TEST_NUM_TRACKS			6
+#define TEST_MAX_CHANGES		400000
+#define TEST_BENCH_EVENTS		4000000
+
+static const char * const test_track_names[TEST_NUM_TRACKS] = { "red", "white", "green", "blue", "pwm2_irq", "timer0_irq" };
+static const int test_track_bits[TEST_NUM_TRACKS] = { 1, 16, 1, 1, 1, 1 };
+
+// a change the model expects to be read back
+typedef struct test_change_t {
+	unsigned long long time_ps;
+	int track;
+	unsigned int value;
+}test_change_t;
+
+// everything handed to trace_write
+typedef struct test_sink_t {
+	unsigned char * data;
+	unsigned int len;
+	unsigned int size;
+	unsigned int writes;
+	unsigned int short_writes;		// writes of less than a full buffer
+	unsigned int fail_every;		// every so many writes fails, 0 for none
+}test_sink_t;
+
+static test_change_t test_changes[TEST_MAX_CHANGES];
+static int test_num_changes;
+static test_change_t test_read[TEST_MAX_CHANGES];
+static int test_num_read;
+
+static led_proc_error_type write_test_sink(void * context, const unsigned char * data, unsigned int len)
+{
+	test_sink_t * sink = (test_sink_t *)context;
+
+	sink->writes++;
+	if (len != LED_TRACE_BUF_SIZE)
+		sink->short_writes++;
+	if (sink->fail_every != 0 && sink->writes % sink->fail_every == 0)
+		return LED_PROC_ERROR_TYPE_BAD_STATE;
+	if (sink->len + len + 1 > sink->size)
+	{
+		sink->size = (sink->len + len + 1) * 2;
+		sink->data = realloc(sink->data, sink->size);
+	}
+	memcpy(sink->data + sink->len, data, len);
+	sink->len += len;
+	sink->data[sink->len] = '\0';
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static led_proc_error_type write_test_nothing(void * context, const unsigned char * data, unsigned int len)
+{
+	return LED_PROC_ERROR_TYPE_NONE;
+}
+
+static void start_test_trace(led_trace_t * trace, led_trace_format format, test_sink_t * sink, unsigned int tick)
+{
+	LED_CHECK_EQ(init_led_trace(trace, format, TEST_TICK_HZ, write_test_sink, sink), LED_PROC_ERROR_TYPE_NONE);
+	for (int i = 0; i < TEST_NUM_TRACKS; i++)
+		LED_CHECK_EQ(add_led_trace_track(trace, test_track_names[i], test_track_bits[i]), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(start_led_trace(trace, tick), LED_PROC_ERROR_TYPE_NONE);
+}
+
+// an hour of changes, or of repeats of the value a track already has, which must not be written
+static void log_test_hour(led_trace_t * trace, unsigned int start_tick, unsigned int seed)
+{
+	unsigned int random = seed;
+	unsigned int values[TEST_NUM_TRACKS];
+	int logged[TEST_NUM_TRACKS] = { 0 };
+	unsigned long long now = 0;
+	unsigned long long logged_at = 0;		// a late tick is logged at the time of the last one
+	unsigned int events = 0;
+
+	test_num_changes = 0;
+	while (now < TEST_HOUR_TICKS && test_num_changes < TEST_MAX_CHANGES)
+	{
+		int track = (int)(next_test_random(&random) % TEST_NUM_TRACKS);
+		unsigned int value = next_test_random(&random) | (next_test_random(&random) << 16);
+		unsigned int choice = next_test_random(&random) % 256;
+		unsigned long long at;
+		unsigned int kept;
+
+		// mostly short steps, a long idle now and then, a few at the same tick and some read late
+		if (choice == 0)
+			now += next_test_random(&random) * 8000ULL;
+		else if (choice > 16)
+			now += next_test_random(&random) % 20000;
+		at = now;
+		if (choice % 32 == 1 && at > 1000)
+			at -= next_test_random(&random) % 1000;
+		if (at > logged_at)
+			logged_at = at;
+		if (next_test_random(&random) % 2 && logged[track])
+			value = values[track];
+
+		LED_CHECK_EQ(log_led_trace(trace, track, (unsigned int)(start_tick + at), value), LED_PROC_ERROR_TYPE_NONE);
+		events++;
+		kept = (test_track_bits[track] < 32) ? value & ((1u << test_track_bits[track]) - 1) : value;
+		if (logged[track] && values[track] == kept)
+			continue;
+		logged[track] = 1;
+		values[track] = kept;
+		test_changes[test_num_changes].time_ps = logged_at * TEST_TICK_PS;
+		test_changes[test_num_changes].track = track;
+		test_changes[test_num_changes].value = kept;
+		test_num_changes++;
+	}
+	LED_CHECK_EQ(trace->trace_stats.trace_events, events);
+	LED_CHECK_EQ(trace->trace_stats.trace_changes, test_num_changes);
+}
+
+static int compare_test_read(const char * format)
+{
+	if (!LED_CHECK_EQ(test_num_read, test_num_changes))
+		return 0;
+	for (int i = 0; i < test_num_changes; i++)
+	{
+		if (!LED_CHECK(memcmp(&test_read[i], &test_changes[i], sizeof(test_change_t)) == 0))
+		{
+			printf("%s change %d is track %d at %llu ps to %u, expected track %d at %llu ps to %u\n", format, i,
+					test_read[i].track, test_read[i].time_ps, test_read[i].value, test_changes[i].track,
+					test_changes[i].time_ps, test_changes[i].value);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// the header declares every track, and the dump leaves them all unknown until they are first logged
+static char * read_test_vcd_header(char * text)
+{
+	char line[64];
+	char * at = text;
+
+	if (!LED_CHECK(strncmp(at, "$timescale 1 ps $end\n$scope module leds $end\n", 45) == 0))
+		return NULL;
+	at += 45;
+	for (int i = 0; i < TEST_NUM_TRACKS; i++)
+	{
+		snprintf(line, sizeof(line), "$var wire %d %c %s $end\n", test_track_bits[i], '!' + i, test_track_names[i]);
+		if (!LED_CHECK(strncmp(at, line, strlen(line)) == 0))
+			return NULL;
+		at += strlen(line);
+	}
+	if (!LED_CHECK(strncmp(at, "$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n", 48) == 0))
+		return NULL;
+	at += 48;
+	for (int i = 0; i < TEST_NUM_TRACKS; i++)
+	{
+		if (test_track_bits[i] == 1)
+			snprintf(line, sizeof(line), "x%c\n", '!' + i);
+		else
+			snprintf(line, sizeof(line), "bx %c\n", '!' + i);
+		if (!LED_CHECK(strncmp(at, line, strlen(line)) == 0))
+			return NULL;
+		at += strlen(line);
+	}
+	if (!LED_CHECK(strncmp(at, "$end\n", 5) == 0))
+		return NULL;
+	return at + 5;
+}
+
+static void read_test_vcd(char * text)
+{
+	unsigned long long time_ps = 0;
+	int have_time = 0;
+	char * at = read_test_vcd_header(text);
+
+	test_num_read = 0;
+	while (at != NULL && *at != '\0' && test_num_read < TEST_MAX_CHANGES)
+	{
+		char * end;
+		test_change_t * change = &test_read[test_num_read];
+
+		if (*at == '#')
+		{
+			unsigned long long next = strtoull(at + 1, &end, 10);
+
+			// only written when the time moves on
+			if (!LED_CHECK(!have_time || next > time_ps))
+				return;
+			time_ps = next;
+			have_time = 1;
+		}
+		else if (*at == '0' || *at == '1')
+		{
+			change->value = (unsigned int)(*at - '0');
+			change->track = at[1] - '!';
+			end = at + 2;
+		}
+		else if (*at == 'b')
+		{
+			change->value = (unsigned int)strtoul(at + 1, &end, 2);
+			if (!LED_CHECK(*end == ' '))
+				return;
+			change->track = end[1] - '!';
+			end += 2;
+		}
+		else
+		{
+			LED_CHECK(0);
+			printf("unexpected VCD line at byte %ld\n", (long)(at - text));
+			return;
+		}
+		if (!LED_CHECK(*end == '\n'))
+			return;
+		if (*at != '#')
+		{
+			if (!LED_CHECK(change->track >= 0 && change->track < TEST_NUM_TRACKS))
+				return;
+			change->time_ps = time_ps;
+			test_num_read++;
+		}
+		at = end + 1;
+	}
+}
+
+static int find_test_track(const char * name, int len)
+{
+	for (int i = 0; i < TEST_NUM_TRACKS; i++)
+	{
+		if ((int)strlen(test_track_names[i]) == len && strncmp(name, test_track_names[i], (size_t)len) == 0)
+			return i;
+	}
+	return -1;
+}
+
+static void read_test_json(char * text)
+{
+	static const char * const header = "[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"leds\"}}";
+	char * at = text;
+
+	test_num_read = 0;
+	if (!LED_CHECK(strncmp(at, header, strlen(header)) == 0))
+		return;
+	at += strlen(header);
+	while (strncmp(at, ",\n{\"name\":\"", 11) == 0 && test_num_read < TEST_MAX_CHANGES)
+	{
+		test_change_t * change = &test_read[test_num_read];
+		char * name = at + 11;
+		char * quote = strchr(name, '"');
+		unsigned long long us;
+		unsigned long long fraction;
+
+		change->track = find_test_track(name, (int)(quote - name));
+		if (!LED_CHECK(change->track >= 0) || !LED_CHECK(strncmp(quote, "\",\"ph\":\"C\",\"pid\":1,\"ts\":", 24) == 0))
+			return;
+		at = quote + 24;
+		us = strtoull(at, &at, 10);
+		if (!LED_CHECK(*at == '.') || !LED_CHECK(at[1] >= '0' && at[2] >= '0' && at[3] >= '0' && at[4] == ','))
+			return;
+		fraction = strtoull(at + 1, &at, 10);
+		// ts is in us to the ns, the ps the model keeps are cut down to match
+		change->time_ps = (us * 1000 + fraction) * 1000;
+		if (!LED_CHECK(strncmp(at, ",\"args\":{\"value\":", 17) == 0))
+			return;
+		change->value = (unsigned int)strtoul(at + 17, &at, 10);
+		if (!LED_CHECK(strncmp(at, "}}", 2) == 0))
+			return;
+		at += 2;
+		test_num_read++;
+	}
+	LED_CHECK(strcmp(at, "\n]\n") == 0);
+	for (int i = 0; i < test_num_changes; i++)
+		test_changes[i].time_ps -= test_changes[i].time_ps % 1000;
+}
+
+static void test_trace_formats(void)
+{
+	static const char * const format_names[2] = { "VCD", "JSON" };
+	static const unsigned int start_ticks[2] = { 0xFFFF0000u, 12345 };
+
+	for (int format = LED_TRACE_FORMAT_VCD; format <= LED_TRACE_FORMAT_JSON; format++)
+	{
+		for (int s = 0; s < 2; s++)
+		{
+			led_trace_t trace;
+			test_sink_t sink = { 0 };
+
+			start_test_trace(&trace, (led_trace_format)format, &sink, start_ticks[s]);
+			log_test_hour(&trace, start_ticks[s], 11u + (unsigned int)s);
+			LED_CHECK_EQ(end_led_trace(&trace), LED_PROC_ERROR_TYPE_NONE);
+
+			// streamed, a full buffer at a time, with only the last one short
+			LED_CHECK(sink.writes > 100);
+			LED_CHECK(sink.short_writes <= 1);
+			LED_CHECK_EQ(trace.trace_stats.trace_flushes, sink.writes);
+			LED_CHECK_EQ(trace.trace_stats.trace_bytes, sink.len);
+			LED_CHECK_EQ(trace.trace_stats.trace_write_errors, 0);
+			LED_CHECK_EQ(trace.trace_buf_len, 0);
+
+			if (format == LED_TRACE_FORMAT_VCD)
+				read_test_vcd((char *)sink.data);
+			else
+				read_test_json((char *)sink.data);
+			compare_test_read(format_names[format]);
+			printf("%-5s %6d changes in %8u bytes, %5.1f bytes a change\n", format_names[format], test_num_changes,
+					sink.len, (double)sink.len / test_num_changes);
+			free(sink.data);
+		}
+	}
+}
+
+// a trace_write that fails loses its bytes, and the trace carries on
+static void test_trace_write_errors(void)
+{
+	led_trace_t trace;
+	test_sink_t sink = { 0 };
+
+	sink.fail_every = 3;
+	start_test_trace(&trace, LED_TRACE_FORMAT_VCD, &sink, 0);
+	for (unsigned int n = 0; n < 10000; n++)
+		LED_CHECK_EQ(log_led_trace(&trace, (int)(n % TEST_NUM_TRACKS), n * 100, n / TEST_NUM_TRACKS % 2), LED_PROC_ERROR_TYPE_NONE);
+	end_led_trace(&trace);
+	LED_CHECK_EQ(trace.trace_stats.trace_flushes, sink.writes);
+	LED_CHECK_EQ(trace.trace_stats.trace_write_errors, sink.writes / 3);
+	LED_CHECK_EQ(trace.trace_stats.trace_bytes, sink.len);
+	LED_CHECK(sink.len < (sink.writes - sink.writes / 3) * LED_TRACE_BUF_SIZE + 1);
+	free(sink.data);
+}
+
+static void test_trace_errors(void)
+{
+	led_trace_t trace;
+	test_sink_t sink = { 0 };
+
+	LED_CHECK_EQ(init_led_trace(NULL, LED_TRACE_FORMAT_VCD, TEST_TICK_HZ, write_test_sink, &sink), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(init_led_trace(&trace, LED_TRACE_FORMAT_VCD, TEST_TICK_HZ, NULL, &sink), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(init_led_trace(&trace, LED_TRACE_FORMAT_VCD, 0, write_test_sink, &sink), LED_PROC_ERROR_TYPE_BAD_STATE);
+
+	LED_CHECK_EQ(init_led_trace(&trace, LED_TRACE_FORMAT_VCD, TEST_TICK_HZ, write_test_sink, &sink), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(log_led_trace(&trace, 0, 0, 1), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(add_led_trace_track(&trace, NULL, 1), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(add_led_trace_track(&trace, "wide", 33), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(add_led_trace_track(&trace, "empty", 0), LED_PROC_ERROR_TYPE_BAD_STATE);
+	for (int i = 0; i < LED_TRACE_MAX_TRACKS; i++)
+		LED_CHECK_EQ(add_led_trace_track(&trace, "led", 1), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(add_led_trace_track(&trace, "led", 1), LED_PROC_ERROR_TYPE_BAD_STATE);
+
+	LED_CHECK_EQ(start_led_trace(&trace, 0), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(start_led_trace(&trace, 0), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(add_led_trace_track(&trace, "late", 1), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(log_led_trace(&trace, -1, 0, 1), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(log_led_trace(&trace, LED_TRACE_MAX_TRACKS, 0, 1), LED_PROC_ERROR_TYPE_BAD_STATE);
+	LED_CHECK_EQ(log_led_trace(NULL, 0, 0, 1), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(end_led_trace(&trace), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(log_led_trace(&trace, 0, 0, 1), LED_PROC_ERROR_TYPE_BAD_STATE);
+
+	// started again, a new timeline with its own header
+	sink.len = 0;
+	LED_CHECK_EQ(start_led_trace(&trace, 500), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK_EQ(end_led_trace(&trace), LED_PROC_ERROR_TYPE_NONE);
+	LED_CHECK(sink.len > 0 && strncmp((char *)sink.data, "$timescale", 10) == 0);
+	free(sink.data);
+}
+
+static void bench_led_trace(void)
+{
+	static const char * const format_names[2] = { "VCD", "JSON" };
+
+	printf("%-6s %16s %16s\n", "", "ns same value", "ns changed");
+	for (int format = LED_TRACE_FORMAT_VCD; format <= LED_TRACE_FORMAT_JSON; format++)
+	{
+		led_trace_t trace;
+		double start;
+		double same;
+		double changed;
+
+		init_led_trace(&trace, (led_trace_format)format, TEST_TICK_HZ, write_test_nothing, NULL);
+		for (int i = 0; i < TEST_NUM_TRACKS; i++)
+			add_led_trace_track(&trace, test_track_names[i], test_track_bits[i]);
+		start_led_trace(&trace, 0);
+
+		start = get_test_seconds();
+		for (unsigned int n = 0; n < TEST_BENCH_EVENTS; n++)
+			log_led_trace(&trace, (int)(n % TEST_NUM_TRACKS), n * 16, 1);
+		same = (get_test_seconds() - start) / TEST_BENCH_EVENTS;
+
+		start = get_test_seconds();
+		for (unsigned int n = 0; n < TEST_BENCH_EVENTS; n++)
+			log_led_trace(&trace, (int)(n % TEST_NUM_TRACKS), n * 16, n);
+		changed = (get_test_seconds() - start) / TEST_BENCH_EVENTS;
+		end_led_trace(&trace);
+
+		printf("%-6s %16.1f %16.1f\n", format_names[format], same * 1e9, changed * 1e9);
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	test_trace_formats();
+	test_trace_write_errors();
+	test_trace_errors();
+
+	if (argc > 1 && strcmp(argv[1], "-b") == 0)
+		bench_led_trace();
+
+	return led_test_summary("test_led_trace");
+}
@@ -0,0 +1,249 @@
+/*
+ * test_led_verify.c
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * Host test of verify_led_outputs and toggle_led_ensure with the led_lib HAL on the virtual B85 of tools/sim,
+ * built from the repository root:
+ *
+ *	gcc -O2 -Wno-cpp -Itools/sim -Ilib -I. -o test_led_verify tools/tests/test_led_verify.c tools/sim/tl_sim.c \
+ *		tools/sim/tl_flash.c lib/led_lib.c lib/led_proc.c lib/led_store.c lib/led_color.c lib/button_proc.c \
+ *		lib/led_coro.c lib/led_pattern.c lib/led_trace.c
+ *	./test_led_verify [-b]
+ *
+ *	-b	also time verify_led_outputs against reading the LEDs one at a time, on the host
+ *
+ * TEST_NUM_LEDS output LEDs fill every pin of the GPIO ports.  They are turned on, off and toggled at random while
+ * output data bits are stuck at a level and freed again with tl_sim_set_stuck_output.  After every step the
+ * mismatch mask of verify_led_outputs must be exactly the LEDs stuck away from their led_output_state, a
+ * toggle_led_ensure that a stuck bit keeps from taking must fail, and one that lands on the stuck level must pass.
+ * The register reads and estimated cycles of one verify are reported against reading every LED.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "tl_sim.h"
+#include "tl_flash.h"
+#include "led_proc.h"
+#include "led_test.h"
+
+#define TEST_NUM_PORTS			5		// LED_GPIO_NUM_PORTS of led_lib.c
+#define TEST_NUM_LEDS			(TEST_NUM_PORTS * 8)
+#define TEST_MASK_WORDS			(LED_PROC_MASK_WORDS(TEST_NUM_LEDS) + 1)	// one more, which must be left clear
+#define TEST_STEPS				200000
+#define TEST_BENCH_ROUNDS		200000
+
+// the HAL of led_lib.c, with the pins of the board here rather than bsp.h
+led_proc_error_type init_led(led_t * led);
+led_proc_error_type set_led_polarity(led_t * led, led_output_state_t state);
+led_proc_error_type set_led_duty_cycle(led_t * led, int pwm_dc);
+led_proc_error_type get_state_of_led(led_t * led, int * state);
+led_proc_error_type init_led_outputs(led_t * leds, int num_leds);
+led_proc_error_type verify_led_output_pins(led_t * leds, int num_leds, unsigned int * mismatch);
+unsigned int enter_led_critical(void);
+void exit_led_critical(unsigned int key);
+
+static led_t test_leds[TEST_NUM_LEDS];
+static struct led_proc_t test_proc;
+static int test_stuck[TEST_NUM_LEDS];		// level the output data bit is stuck at, -1 when it is free
+
+static void init_test_board(void)
+{
+	tl_sim_reset();
+	memset(&test_proc, 0, sizeof(test_proc));
+	memset(test_leds, 0, sizeof(test_leds));
+	test_proc.led_init = init_led;
+	test_proc.led_set_polarity = set_led_polarity;
+	test_proc.led_set_duty_cycle = set_led_duty_cycle;
+	test_proc.led_get_state = get_state_of_led;
+	test_proc.led_init_outputs = init_led_outputs;
+	test_proc.led_verify_outputs = verify_led_output_pins;
+	test_proc.led_enter_critical = enter_led_critical;
+	test_proc.led_exit_critical = exit_led_critical;
+	for (int i = 0; i < TEST_NUM_LEDS; i++)
+	{
+		test_leds[i].led_ptr = (GPIO_PinTypeDef)(((i / 8) << 8) | (1 << (i % 8)));
+		test_leds[i].led_type = LED_TYPE_OUTPUT;
+		test_stuck[i] = -1;
+	}
+	LED_CHECK_EQ(init_led_proc(&test_proc, test_leds, TEST_NUM_LEDS), LED_PROC_ERROR_TYPE_NONE);
+}
+
+// the mismatch mask must be the stuck LEDs that are not at their led_output_state, and the pins the model
+static int check_test_verify(unsigned int step)
+{
+	unsigned int mismatch[TEST_MASK_WORDS];
+	unsigned int expected[TEST_MASK_WORDS] = { 0 };
+	led_proc_error_type status;
+
+	for (int i = 0; i < TEST_NUM_LEDS; i++)
+	{
+		int state = test_leds[i].led_output_state;
+		int level = (test_stuck[i] >= 0) ? test_stuck[i] : state;
+
+		if (level != state)
+			expected[i / 32] |= 1u << (i % 32);
+		if (!LED_CHECK_EQ(tl_sim_output_level(test_leds[i].led_ptr), level))
+			return 0;
+	}
+
+	memset(mismatch, 0xA5, sizeof(mismatch));
+	status = verify_led_outputs(&test_proc, mismatch, TEST_MASK_WORDS);
+	for (int w = 0; w < TEST_MASK_WORDS; w++)
+	{
+		if (!LED_CHECK_EQ(mismatch[w], expected[w]))
+		{
+			printf("step %u, word %d of the mismatch is 0x%08X, 0x%08X are stuck away from their state\n", step, w,
+					mismatch[w], expected[w]);
+			return 0;
+		}
+	}
+	return LED_CHECK_EQ(status, (expected[0] | expected[1]) ? LED_PROC_ERROR_TYPE_BAD_STATE : LED_PROC_ERROR_TYPE_NONE);
+}
+
+static void test_verify_stuck(void)
+{
+	unsigned int random = 46;
+	unsigned int detected = 0;
+	unsigned int ensure_failed = 0;
+	int num_stuck = 0;
+
+	init_test_board();
+	check_test_verify(0);
+	for (unsigned int step = 1; step <= TEST_STEPS; step++)
+	{
+		int led_num = (int)(next_test_random(&random) % TEST_NUM_LEDS);
+		unsigned int choice = next_test_random(&random) % 16;
+		int state = test_leds[led_num].led_output_state;
+
+		if (choice == 0 && num_stuck < 4)
+		{
+			if (test_stuck[led_num] < 0)
+				num_stuck++;
+			test_stuck[led_num] = (int)(next_test_random(&random) % 2);
+			tl_sim_set_stuck_output(test_leds[led_num].led_ptr, test_stuck[led_num]);
+			if (test_stuck[led_num] != state)
+				detected++;
+		}
+		else if (choice <= 2)
+		{
+			if (test_stuck[led_num] >= 0)
+				num_stuck--;
+			test_stuck[led_num] = -1;
+			tl_sim_set_stuck_output(test_leds[led_num].led_ptr, -1);
+			// a freed bit keeps the level it was stuck at until it is next written
+			if (tl_sim_output_level(test_leds[led_num].led_ptr) != state)
+				LED_CHECK_EQ(((state == LED_ON) ? turn_led_num_on : turn_led_num_off)(&test_proc, led_num), LED_PROC_ERROR_TYPE_NONE);
+		}
+		else if (choice <= 8)
+		{
+			led_proc_error_type status = toggle_led_ensure(&test_proc, &test_leds[led_num]);
+			int wanted = !state;
+
+			// the readback sees a stuck bit that keeps the toggle from taking
+			if (!LED_CHECK_EQ(status, (test_stuck[led_num] >= 0 && test_stuck[led_num] != wanted) ?
+					LED_PROC_ERROR_TYPE_BAD_STATE : LED_PROC_ERROR_TYPE_NONE))
+			{
+				printf("step %u, toggle_led_ensure of LED %d to %d stuck at %d returned %d\n", step, led_num, wanted,
+						test_stuck[led_num], status);
+				return;
+			}
+			if (status != LED_PROC_ERROR_TYPE_NONE)
+				ensure_failed++;
+			LED_CHECK_EQ(test_leds[led_num].led_output_state, wanted);
+		}
+		else if (choice <= 12)
+			LED_CHECK_EQ(turn_led_num_on(&test_proc, led_num), LED_PROC_ERROR_TYPE_NONE);
+		else
+			LED_CHECK_EQ(turn_led_num_off(&test_proc, led_num), LED_PROC_ERROR_TYPE_NONE);
+
+		if (!check_test_verify(step))
+			return;
+	}
+	LED_CHECK(detected > 1000);
+	LED_CHECK(ensure_failed > 1000);
+	printf("stuck      %u faults seen at once by verify_led_outputs, %u toggles refused by toggle_led_ensure\n",
+			detected, ensure_failed);
+}
+
+// one read of each port against one read of each LED
+static void test_verify_cost(void)
+{
+	unsigned int mismatch[TEST_MASK_WORDS];
+	tl_sim_stats_t before;
+	unsigned long verify_regs;
+	unsigned long long verify_cycles;
+	int state;
+
+	init_test_board();
+	before = tl_sim_stats;
+	LED_CHECK_EQ(verify_led_outputs(&test_proc, mismatch, TEST_MASK_WORDS), LED_PROC_ERROR_TYPE_NONE);
+	verify_regs = tl_sim_stats.reg_accesses - before.reg_accesses;
+	verify_cycles = tl_sim_stats.cycles - before.cycles;
+
+	before = tl_sim_stats;
+	for (int i = 0; i < TEST_NUM_LEDS; i++)
+		get_led_num_state(&test_proc, i, &state);
+
+	printf("%-26s %12s %12s\n", "40 LEDs on 5 ports", "reg reads", "cycles");
+	printf("%-26s %12lu %12llu\n", "verify_led_outputs", verify_regs, verify_cycles);
+	printf("%-26s %12lu %12llu\n", "get_led_num_state each", tl_sim_stats.reg_accesses - before.reg_accesses,
+			tl_sim_stats.cycles - before.cycles);
+	// the port reads, and the interrupt mask around them
+	LED_CHECK(verify_regs <= TEST_NUM_PORTS + 4);
+	LED_CHECK(verify_cycles * 2 < tl_sim_stats.cycles - before.cycles);
+}
+
+static void test_verify_errors(void)
+{
+	unsigned int mismatch[TEST_MASK_WORDS];
+
+	init_test_board();
+	LED_CHECK_EQ(verify_led_outputs(NULL, mismatch, TEST_MASK_WORDS), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(verify_led_outputs(&test_proc, NULL, TEST_MASK_WORDS), LED_PROC_ERROR_TYPE_NULL);
+	LED_CHECK_EQ(verify_led_outputs(&test_proc, mismatch, LED_PROC_MASK_WORDS(TEST_NUM_LEDS) - 1), LED_PROC_ERROR_TYPE_BAD_STATE);
+	test_proc.led_verify_outputs = NULL;
+	LED_CHECK_EQ(verify_led_outputs(&test_proc, mismatch, TEST_MASK_WORDS), LED_PROC_ERROR_TYPE_NULL);
+}
+
+static void bench_led_verify(void)
+{
+	unsigned int mismatch[TEST_MASK_WORDS];
+	unsigned int bad = 0;
+	double start;
+	double verify;
+	double each;
+
+	init_test_board();
+	start = get_test_seconds();
+	for (int r = 0; r < TEST_BENCH_ROUNDS; r++)
+		bad |= (verify_led_outputs(&test_proc, mismatch, TEST_MASK_WORDS) != LED_PROC_ERROR_TYPE_NONE);
+	verify = (get_test_seconds() - start) / TEST_BENCH_ROUNDS;
+
+	start = get_test_seconds();
+	for (int r = 0; r < TEST_BENCH_ROUNDS; r++)
+	{
+		for (int i = 0; i < TEST_NUM_LEDS; i++)
+		{
+			int state;
+
+			get_led_num_state(&test_proc, i, &state);
+			bad |= (state != test_leds[i].led_output_state);
+		}
+	}
+	each = (get_test_seconds() - start) / TEST_BENCH_ROUNDS;
+	LED_CHECK_EQ(bad, 0);
+	printf("host ns per check of %d LEDs, %.1f verify_led_outputs, %.1f one at a time\n", TEST_NUM_LEDS, verify * 1e9,
+			each * 1e9);
+}
+
+int main(int argc, char ** argv)
+{
+	test_verify_errors();
+	test_verify_stuck();
+	test_verify_cost();
+
+	if (argc > 1 && strcmp(argv[1], "-b") == 0)
+		bench_led_verify();
+
+	return led_test_summary("test_led_verify");
+}